@@ -8,6 +8,7 @@
 		c4slog;
 		c4log_writeToCallback;
 		c4log_writeToBinaryFile;
+		c4log_flushLogFiles;
 		c4log_callbackLevel;
 		c4log_setCallbackLevel;
 		c4log_binaryFileLevel;
@@ -36,6 +37,8 @@
 		c4db_getLastSequence;
 		c4db_getMaxRevTreeDepth;
 		c4db_setMaxRevTreeDepth;
+		c4db_setReaderPoolSize;
+		c4db_getStatistics;
 		c4db_getUUIDs;
 		c4db_getExtraInfo;
 		c4db_setExtraInfo;
@@ -53,6 +56,8 @@
 		c4doc_retain;
 		c4doc_free;
 		c4doc_get;
+		c4doc_getMeta;
+		c4db_getDocs;
 		c4doc_getBySequence;
 		c4db_purgeDoc;
 		c4doc_selectRevision;
@@ -75,6 +80,7 @@
 		c4doc_getExpiration;
 		c4db_nextDocExpiration;
 		c4db_purgeExpiredDocs;
+		c4db_startHousekeeping;
 		c4doc_isOldMetaProperty;
 		c4doc_dictContainsBlobs;
 
@@ -82,8 +88,10 @@
 
 		c4db_enumerateChanges;
 		c4db_enumerateAllDocs;
+		c4db_enumerateDocRange;
 		c4db_createIndex;
 		c4db_deleteIndex;
+		c4db_getIndexBuildProgress;
 		c4db_getIndexes;
 		c4enum_next;
 		c4enum_getDocumentInfo;
@@ -114,8 +122,10 @@
 		c4blob_getFilePath;
 		c4blob_openReadStream;
 		c4blob_create;
+		c4blob_createCompressed;
 		c4blob_delete;
 		c4blob_openWriteStream;
+		c4blob_openCompressedWriteStream;
 		c4db_getBlobStore;
 
 		c4stream_read;
@@ -143,6 +153,7 @@
 		c4repl_getStatus;
 		c4repl_getPendingDocIDs;
 		c4repl_isDocumentPending;
+		c4repl_getStatistics;
 
 		c4socket_registerFactory;
 		c4socket_fromNative;
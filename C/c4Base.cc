@@ -335,6 +335,10 @@ bool c4log_writeToBinaryFile(C4LogFileOptions options, C4Error *outError) noexce
     });
 }
 
+void c4log_flushLogFiles() noexcept {
+    LogDomain::flushLogFiles();
+}
+
 C4LogLevel c4log_callbackLevel() noexcept        {return (C4LogLevel)LogDomain::callbackLogLevel();} // LCOV_EXCL_LINE
 C4LogLevel c4log_binaryFileLevel() noexcept      {return (C4LogLevel)LogDomain::fileLogLevel();}
 
@@ -119,11 +119,12 @@ C4SliceResult c4blob_getContents(C4BlobStore* store, C4BlobKey key, C4Error* out
 
 C4StringResult c4blob_getFilePath(C4BlobStore* store, C4BlobKey key, C4Error* outError) noexcept {
     try {
-        auto path = store->get(asInternal(key)).path();
+        Blob blob = store->get(asInternal(key));
+        auto path = blob.path();
         if (!path.exists()) {
             recordError(LiteCoreDomain, kC4ErrorNotFound, outError);
             return {nullptr, 0};
-        } else if (store->isEncrypted()) {
+        } else if (store->isEncrypted() || blob.isCompressed()) {
             recordError(LiteCoreDomain, kC4ErrorWrongFormat, outError);
             return {nullptr, 0};
         }
@@ -154,6 +155,22 @@ bool c4blob_create(C4BlobStore* store,
 }
 
 
+bool c4blob_createCompressed(C4BlobStore* store,
+                             C4Slice contents,
+                             const C4BlobKey *expectedKey,
+                             C4BlobKey *outKey,
+                             C4Error* outError) noexcept
+{
+    try {
+        Blob blob = store->put(contents, asInternal(expectedKey), true);
+        if (outKey)
+            *outKey = external(blob.key());
+        return true;
+    } catchError(outError)
+    return false;
+}
+
+
 bool c4blob_delete(C4BlobStore* store, C4BlobKey key, C4Error* outError) noexcept {
     try {
         store->get(asInternal(key)).del();
@@ -217,6 +234,14 @@ C4WriteStream* c4blob_openWriteStream(C4BlobStore* store, C4Error* outError) noe
 }
 
 
+C4WriteStream* c4blob_openCompressedWriteStream(C4BlobStore* store, C4Error* outError) noexcept {
+    try {
+        return external(new BlobWriteStream(*store, true));
+    } catchError(outError)
+    return nullptr;
+}
+
+
 bool c4stream_write(C4WriteStream* stream, const void *bytes, size_t length, C4Error* outError) noexcept {
     if (length == 0)
         return true;
@@ -33,6 +33,7 @@
 #include "SecureSymmetricCrypto.hh"
 #include "StringUtil.hh"
 #include "PrebuiltCopier.hh"
+#include "Encoder.hh"
 #include <thread>
 
 using namespace fleece;
@@ -248,6 +249,13 @@ void c4db_setMaxRevTreeDepth(C4Database *database, uint32_t depth) noexcept {
 }
 
 
+void c4db_setReaderPoolSize(C4Database *database, unsigned poolSize) noexcept {
+    tryCatch(nullptr, [&]{
+        database->dataFile()->setReaderPoolSize(poolSize);
+    });
+}
+
+
 bool c4db_getUUIDs(C4Database* database, C4UUID *publicUUID, C4UUID *privateUUID,
                    C4Error *outError) noexcept
 {
@@ -273,6 +281,15 @@ void c4db_setExtraInfo(C4Database *database C4NONNULL, C4ExtraInfo x) C4API {
 }
 
 
+C4SliceResult c4db_getStatistics(C4Database *database, C4Error *outError) noexcept {
+    return tryCatch<C4SliceResult>(outError, [&]{
+        fleece::impl::Encoder enc;
+        database->dataFile()->stats().writeTo(enc);
+        return C4SliceResult(enc.finish());
+    });
+}
+
+
 bool c4db_isInTransaction(C4Database* database) noexcept {
     return database->inTransaction();
 }
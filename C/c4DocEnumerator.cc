@@ -49,6 +49,31 @@ struct C4DocEnumerator : public RecordEnumerator, fleece::InstanceCounted {
     ,_database(database)
     { }
 
+    C4DocEnumerator(C4Database *database,
+                    slice startDocID, slice endDocID,
+                    uint64_t skip, uint64_t limit,
+                    const C4EnumeratorOptions &c4options)
+    :RecordEnumerator(database->defaultKeyStore(),
+                      rangeOptions(c4options, startDocID, endDocID, skip, limit))
+    ,_database(database)
+    { }
+
+    static RecordEnumerator::Options rangeOptions(const C4EnumeratorOptions &c4options,
+                                                  slice startDocID, slice endDocID,
+                                                  uint64_t skip, uint64_t limit)
+    {
+        RecordEnumerator::Options options = recordOptions(c4options);
+        if (options.sortOption == kDescending)
+            swap(startDocID, endDocID);
+        if (startDocID)
+            options.minKey = alloc_slice(startDocID);
+        if (endDocID)
+            options.maxKey = alloc_slice(endDocID);
+        options.skip = skip;
+        options.limit = limit;
+        return options;
+    }
+
     static RecordEnumerator::Options recordOptions(const C4EnumeratorOptions &c4options) {
         RecordEnumerator::Options options;
         if (c4options.flags & kC4Descending)
@@ -119,6 +144,21 @@ C4DocEnumerator* c4db_enumerateAllDocs(C4Database *database,
 }
 
 
+C4DocEnumerator* c4db_enumerateDocRange(C4Database *database,
+                                        C4Slice startDocID,
+                                        C4Slice endDocID,
+                                        uint64_t skip,
+                                        uint64_t limit,
+                                        const C4EnumeratorOptions *c4options,
+                                        C4Error *outError) noexcept
+{
+    return tryCatch<C4DocEnumerator*>(outError, [&]{
+        return new C4DocEnumerator(database, startDocID, endDocID, skip, limit,
+                                   c4options ? *c4options : kC4DefaultEnumeratorOptions);
+    });
+}
+
+
 bool c4enum_next(C4DocEnumerator *e, C4Error *outError) noexcept {
     return tryCatch<bool>(outError, [&]{
         if (e->next())
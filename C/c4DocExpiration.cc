@@ -38,8 +38,10 @@ bool c4doc_setExpiration(C4Database *db, C4Slice docId, C4Timestamp timestamp, C
     if (!c4db_beginTransaction(db, outError))
         return false;
     bool ok = tryCatch<bool>(outError, [=]{
-        if (db->defaultKeyStore().setExpiration(docId, timestamp))
+        if (db->defaultKeyStore().setExpiration(docId, timestamp)) {
+            db->documentExpirationChanged(timestamp);
             return true;
+        }
         recordError(LiteCoreDomain, kC4ErrorNotFound, outError);
         return false;
     });
@@ -74,3 +76,10 @@ int64_t c4db_purgeExpiredDocs(C4Database *db, C4Error *outError) C4API {
     }
     return count;
 }
+
+
+bool c4db_startHousekeeping(C4Database *db, C4Error *outError) C4API {
+    return tryCatch(outError, [=]{
+        db->startHousekeeping();
+    });
+}
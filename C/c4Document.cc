@@ -83,6 +83,46 @@ C4Document* c4doc_getSingleRevision(C4Database *database,
 }
 
 
+C4Document* c4doc_getMeta(C4Database *database,
+                          C4Slice docID,
+                          C4Error *outError) noexcept
+{
+    return newDoc(true, outError, [=] {
+        Record rec = database->defaultKeyStore().get(docID, kMetaOnly);
+        return database->documentFactory().newDocumentInstance(rec);
+    });
+}
+
+
+bool c4db_getDocs(C4Database *database,
+                  const C4String docIDs[],
+                  size_t count,
+                  bool metadataOnly,
+                  C4Document* outDocs[],
+                  C4Error *outError) noexcept
+{
+    fill(outDocs, outDocs + count, nullptr);
+    return tryCatch<bool>(outError, [&]{
+        vector<slice> keys(docIDs, docIDs + count);
+        vector<Retained<Document>> docs;
+        docs.reserve(count);
+        {
+            ReadOnlyTransaction t(database->dataFile());
+            auto content = metadataOnly ? kMetaOnly : kEntireBody;
+            database->defaultKeyStore().getMany(keys, content, [&](Record &rec) {
+                if (rec.exists())
+                    docs.push_back(database->documentFactory().newDocumentInstance(rec));
+                else
+                    docs.push_back(nullptr);
+            });
+        }
+        for (size_t i = 0; i < count; ++i)
+            outDocs[i] = retain(docs[i].get());
+        return true;
+    });
+}
+
+
 C4Document* c4doc_getBySequence(C4Database *database,
                                 C4SequenceNumber sequence,
                                 C4Error *outError) noexcept
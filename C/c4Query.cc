@@ -44,7 +44,8 @@ using namespace fleece::impl;
 
 
 CBL_CORE_API const C4QueryOptions kC4DefaultQueryOptions = {
-    true
+    true,
+    false
 };
 
 
@@ -190,7 +191,19 @@ struct c4Query : public RefCounted, fleece::InstanceCounted, LiveQuerier::Delega
     void setParameters(slice parameters)    {_parameters = parameters;}
 
     Retained<C4QueryEnumeratorImpl> createEnumerator(const C4QueryOptions *c4options, slice encodedParameters) {
-        Query::Options options(encodedParameters ? encodedParameters : _parameters);
+        Query::Options options(encodedParameters ? encodedParameters : _parameters, 0, 0,
+                               c4options && c4options->streaming);
+        if (!options.streaming) {
+            // Record the results on a pooled reader if one's free, so that queries on different
+            // threads don't take turns on the database's connection. (A streaming enumerator
+            // borrows its own reader for as long as it lives.)
+            DataFile::BorrowedReader reader(*_database->dataFile(), false);
+            if (reader) {
+                Retained<Query> query = reader.get()->defaultKeyStore().compileQuery(
+                                                        _query->expression(), _query->language());
+                return wrapEnumerator( query->createEnumerator(&options) );
+            }
+        }
         return wrapEnumerator( _query->createEnumerator(&options) );
     }
 
@@ -423,6 +436,28 @@ bool c4db_createIndex(C4Database *database,
                                                  (KeyStore::IndexType)indexType,
                                                  alloc_slice(propertyPath)},
                                                 (const KeyStore::IndexOptions*)indexOptions);
+        if (indexOptions && indexOptions->background)
+            database->buildIndexesInBackground();
+    });
+}
+
+
+bool c4db_getIndexBuildProgress(C4Database *database,
+                                C4Slice name,
+                                uint64_t *outIndexed,
+                                uint64_t *outTotal,
+                                C4Error *outError) noexcept
+{
+    *outIndexed = *outTotal = 0;
+    return tryCatch<bool>(outError, [&]{
+        sequence_t indexed, total;
+        if (!database->defaultKeyStore().getIndexBuildProgress(slice(name), indexed, total)) {
+            clearError(outError);      // index is complete; not an error
+            return false;
+        }
+        *outIndexed = indexed;
+        *outTotal = total;
+        return true;
     });
 }
 
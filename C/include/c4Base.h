@@ -237,6 +237,10 @@ void c4log_writeToCallback(C4LogLevel level, C4LogCallback callback, bool prefor
     @return  True on success, false on failure. */
 bool c4log_writeToBinaryFile(C4LogFileOptions options, C4Error *error) C4API;
 
+/** Log messages are written to the file(s) asynchronously, on a background thread. This writes
+    any messages logged so far, and flushes the file(s), before returning. */
+void c4log_flushLogFiles(void) C4API;
+
 C4LogLevel c4log_callbackLevel(void) C4API;
 void c4log_setCallbackLevel(C4LogLevel level) C4API;
 
@@ -99,8 +99,8 @@ extern "C" {
     C4SliceResult c4blob_getContents(C4BlobStore* C4NONNULL, C4BlobKey, C4Error*) C4API;
 
     /** Returns the path of the file that stores the blob, if possible. This call may fail with
-        error kC4ErrorWrongFormat if the blob is encrypted (in which case the file would be
-        unreadable by the caller) or with kC4ErrorUnsupported if for some implementation reason
+        error kC4ErrorWrongFormat if the blob is encrypted or compressed (in which case the file
+        would be unreadable by the caller) or with kC4ErrorUnsupported if for some implementation reason
         the blob isn't stored as a standalone file.
         Thus, the caller MUST use this function only as an optimization, and fall back to reading
         the contents via the API if it fails.
@@ -119,6 +119,14 @@ extern "C" {
                        C4BlobKey *outKey,
                        C4Error *error) C4API;
 
+    /** Stores a blob in compressed form, as for a stream opened by
+        c4blob_openCompressedWriteStream. Otherwise the same as c4blob_create. */
+    bool c4blob_createCompressed(C4BlobStore *store C4NONNULL,
+                                 C4Slice contents,
+                                 const C4BlobKey *expectedKey,
+                                 C4BlobKey *outKey,
+                                 C4Error *error) C4API;
+
     /** Deletes a blob from the store given its key. */
     bool c4blob_delete(C4BlobStore* C4NONNULL, C4BlobKey, C4Error*) C4API;
 
@@ -177,6 +185,12 @@ extern "C" {
         the store, and then c4stream_closeWriter. */
     C4WriteStream* c4blob_openWriteStream(C4BlobStore* C4NONNULL, C4Error*) C4API;
 
+    /** Opens a write stream for creating a new blob that's stored compressed. This saves space
+        for compressible content, such as blobs for which c4doc_blobIsCompressible returns true,
+        at some CPU cost when reading and writing. The blob is read the same way as any other,
+        and its key is still the digest of the uncompressed data. */
+    C4WriteStream* c4blob_openCompressedWriteStream(C4BlobStore* C4NONNULL, C4Error*) C4API;
+
     /** Writes data to a stream. */
     bool c4stream_write(C4WriteStream* C4NONNULL,
                         const void *bytes C4NONNULL,
@@ -43,6 +43,9 @@ extern "C" {
         kC4DB_SharedKeys    = 0x10, // OBSOLETE; shared keys are always used
         kC4DB_NoUpgrade     = 0x20, ///< Disable upgrading an older-version database
         kC4DB_NonObservable = 0x40, ///< Disable c4DatabaseObserver
+        kC4DB_SplitBodies   = 0x80, ///< New db stores current revision apart from rev history
+        kC4DB_CompressBodies= 0x100,///< New db compresses document bodies
+        kC4DB_DeltaRevBodies= 0x200,///< Store kept ancestor revision bodies as deltas
     };
 
     /** Document versioning system (also determines database storage schema) */
@@ -234,12 +237,24 @@ extern "C" {
         @return  The number of documents purged, or -1 on error. */
     int64_t c4db_purgeExpiredDocs(C4Database *db, C4Error*) C4API;
 
+    /** Starts purging expired documents automatically, on a background thread, as their
+        expiration times arrive. Large numbers of expired documents are purged in a series of
+        short transactions, so other writers aren't blocked for long. Database observers are
+        notified of the purges. Housekeeping stops when the database is closed.
+        @return  True on success, false on error. */
+    bool c4db_startHousekeeping(C4Database *db C4NONNULL, C4Error *outError) C4API;
+
     /** Returns the number of revisions of a document that are tracked. (Defaults to 20.) */
     uint32_t c4db_getMaxRevTreeDepth(C4Database *database C4NONNULL) C4API;
 
     /** Configures the number of revisions of a document that are tracked. */
     void c4db_setMaxRevTreeDepth(C4Database *database C4NONNULL, uint32_t maxRevTreeDepth) C4API;
 
+    /** Configures the maximum number of extra read-only connections the database opens to run
+        queries in parallel. (Defaults to 4; 0 restores the default.) Call this before running
+        queries; connections already open aren't closed. */
+    void c4db_setReaderPoolSize(C4Database *database C4NONNULL, unsigned poolSize) C4API;
+
     typedef struct {
         uint8_t bytes[16];
     } C4UUID;
@@ -252,6 +267,18 @@ extern "C" {
     C4ExtraInfo c4db_getExtraInfo(C4Database *database C4NONNULL) C4API;
     void c4db_setExtraInfo(C4Database *database C4NONNULL, C4ExtraInfo) C4API;
 
+    /** Returns cumulative performance statistics of the database file, since it was first
+        opened by this process: counts of SQLite statement steps, records and body bytes read,
+        queries run, and histograms of transaction wait and commit times.
+        Each histogram is a dict with keys "count", "total" and "max" (in seconds), and
+        "buckets", an array of counts: bucket 0 counts durations under 1µs, and bucket i those
+        from 2^(i-1) to 2^i µs.
+        @param database  The database.
+        @param outError  On failure, will be set to the error status.
+        @return  A Fleece-encoded dictionary, or NULL on failure. */
+    C4SliceResult c4db_getStatistics(C4Database *database C4NONNULL,
+                                     C4Error *outError) C4API;
+
     /** @} */
     /** \name Compaction
         @{ */
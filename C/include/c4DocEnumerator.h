@@ -89,7 +89,8 @@ extern "C" {
 
     /** Creates an enumerator ordered by docID.
         Options have the same meanings as in Couchbase Lite.
-        There's no 'limit' option; just stop enumerating when you're done.
+        There's no 'limit' option; just stop enumerating when you're done, or use
+        c4db_enumerateDocRange.
         Caller is responsible for freeing the enumerator when finished with it.
         @param database  The database.
         @param options  Enumeration options (NULL for defaults).
@@ -99,6 +100,27 @@ extern "C" {
                                            const C4EnumeratorOptions *options,
                                            C4Error *outError) C4API;
 
+    /** Creates an enumerator ordered by docID, over a range of docIDs. The range and limit are
+        applied by the storage engine, which is much faster than enumerating all docs and
+        skipping the unwanted ones.
+        Caller is responsible for freeing the enumerator when finished with it.
+        @param database  The database.
+        @param startDocID  The docID to start at (inclusive), or null to start at the beginning.
+                        If the kC4Descending flag is set, this should be the greater docID.
+        @param endDocID  The docID to end at (inclusive), or null to go to the end.
+        @param skip  The number of documents to skip at the start of the range.
+        @param limit  The maximum number of documents to return; UINT64_MAX means no limit.
+        @param options  Enumeration options (NULL for defaults).
+        @param outError  Error will be stored here on failure.
+        @return  A new enumerator, or NULL on failure. */
+    C4DocEnumerator* c4db_enumerateDocRange(C4Database *database C4NONNULL,
+                                            C4Slice startDocID,
+                                            C4Slice endDocID,
+                                            uint64_t skip,
+                                            uint64_t limit,
+                                            const C4EnumeratorOptions *options,
+                                            C4Error *outError) C4API;
+
     /** Advances the enumerator to the next document.
         Returns false at the end, or on error; look at the C4Error to determine which occurred,
         and don't forget to free the enumerator. */
@@ -99,6 +99,32 @@ extern "C" {
                           bool mustExist,
                           C4Error *outError) C4API;
 
+    /** Gets a document's metadata -- its docID, current revID, flags and sequence -- without
+        reading its body or revision history from the database. This is much faster than
+        \ref c4doc_get when only the metadata is needed.
+        The current revision is selected, but its body is not loaded. Calling
+        \ref c4doc_loadRevisionBody reads the rest of the document; do that before selecting
+        any other revision.
+        If there's no such document, returns NULL with a kC4ErrorNotFound error.
+        You must call `c4doc_release()` when finished with the document. */
+    C4Document* c4doc_getMeta(C4Database *database C4NONNULL,
+                              C4String docID,
+                              C4Error *outError) C4API;
+
+    /** Gets multiple documents from the database at once. On return, `outDocs[i]` is the
+        document whose ID is `docIDs[i]`, with its current revision selected, or NULL if there's
+        no such document. This is faster than calling \ref c4doc_get repeatedly, since the
+        documents are read with a few queries inside a single read transaction.
+        If `metadataOnly` is true, the documents are loaded as by \ref c4doc_getMeta.
+        You must call `c4doc_release()` on each non-NULL document when finished with it.
+        @return  True on success, false on error (in which case no documents are returned.) */
+    bool c4db_getDocs(C4Database *database C4NONNULL,
+                      const C4String docIDs[] C4NONNULL,
+                      size_t count,
+                      bool metadataOnly,
+                      C4Document* outDocs[] C4NONNULL,
+                      C4Error *outError) C4API;
+
     /** Gets a document from the database given its sequence number.
         You must call `c4doc_release()` when finished with the document.  */
     C4Document* c4doc_getBySequence(C4Database *database C4NONNULL,
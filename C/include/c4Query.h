@@ -93,6 +93,11 @@ extern "C" {
     /** Options for running queries. */
     typedef struct {
         bool rankFullText;      ///< Should full-text results be ranked by relevance?
+        bool streaming;         ///< Read rows lazily, without collecting them all first.
+                                ///< c4queryenum_getRowCount and c4queryenum_seek will fail, and
+                                ///< the enumerator must be freed before the database is closed.
+                                ///< Running the query fails with kC4ErrorBusy if all the
+                                ///< database's readers are in use, or in a transaction.
     } C4QueryOptions;
 
 
@@ -171,15 +176,16 @@ extern "C" {
                           C4Error *outError) C4API;
 
     /** Returns the total number of rows in the query, if known.
-        Not all query enumerators may support this (but the current implementation does.)
+        Not all query enumerators may support this (the current implementation does, unless the
+        `streaming` option was used.)
         @param e  The query enumerator
         @param outError  On failure, an error will be stored here (probably kC4ErrorUnsupported.)
         @return  The number of rows, or -1 on failure. */
     int64_t c4queryenum_getRowCount(C4QueryEnumerator *e C4NONNULL,
                                      C4Error *outError) C4API;
 
-    /** Jumps to a specific row. Not all query enumerators may support this (but the current
-        implementation does.)
+    /** Jumps to a specific row. Not all query enumerators may support this (the current
+        implementation does, unless the `streaming` option was used.)
         @param e  The query enumerator
         @param rowIndex  The number of the row, starting at 0, or -1 to restart before first row
         @param outError  On failure, an error will be stored here (probably kC4ErrorUnsupported.)
@@ -264,6 +270,16 @@ extern "C" {
             To provide a custom list of words, use a string containing the words in lowercase
             separated by spaces. */
         const char *stopWords;
+
+        /** If true, a full-text, array or predictive index doesn't index the existing documents
+            right away; instead they're indexed in the background, in a series of short
+            transactions, so other writers (like the replicator) aren't locked out for long.
+            The index isn't used by queries until it's complete; until then, queries that use
+            `MATCH` on it fail, and others run without it. Progress can be checked with
+            \ref c4db_getIndexBuildProgress. Building continues when housekeeping is started
+            (see \ref c4db_startHousekeeping) if the database was closed before it finished.
+            Value indexes ignore this option, since SQLite builds them in a single step. */
+        bool background;
     } C4IndexOptions;
 
 
@@ -294,6 +310,15 @@ extern "C" {
         `[[".name.first"]]` will index on the first-name property. Note the two levels of brackets,
         since an expression is already an array.
 
+        A value index can also store extra properties without indexing on them, making it a
+        "covering" index: the JSON is then a dict whose "WHAT" key holds the array of expressions,
+        and whose "INCLUDE" key holds an array of properties, for example
+        `{"WHAT": [[".type"], [".date"]], "INCLUDE": [[".title"], [".author"]]}`.
+        The indexed expressions and included items must all be properties. The index keeps a
+        copy of those properties' values, so a query that uses no other properties (besides the
+        document ID and sequence) can be answered from the index without reading any document
+        bodies.
+
         Currently, full-text indexes are limited to a single expression only.
 
         In an array index, the first expression must evaluate to an array to be unnested; it's
@@ -321,6 +346,20 @@ extern "C" {
                           const C4IndexOptions *indexOptions,
                           C4Error *outError) C4API;
 
+    /** Checks the progress of an index created with the `background` option.
+        @param database  The database.
+        @param name  The name of the index.
+        @param outIndexed  On return, the number of existing sequences indexed so far.
+        @param outTotal  On return, the number of existing sequences to index in all.
+        @param outError  On failure, will be set to the error status.
+        @return  True if the index is still being built, false if it's complete or on failure
+                 (in which case `outError` is set, e.g. to kC4ErrorNoSuchIndex.) */
+    bool c4db_getIndexBuildProgress(C4Database *database C4NONNULL,
+                                    C4String name,
+                                    uint64_t *outIndexed C4NONNULL,
+                                    uint64_t *outTotal C4NONNULL,
+                                    C4Error *outError) C4API;
+
     /** Deletes an index that was created by `c4db_createIndex`.
         @param database  The database to index.
         @param name The name of the index to delete
@@ -231,6 +231,15 @@ extern "C" {
      */
     bool c4repl_isDocumentPending(C4Replicator* repl C4NONNULL, C4String docID, C4Error* outErr) C4API;
 
+    /** Returns performance statistics of the replicator, as a Fleece-encoded dictionary.
+        Currently its "insertion" key holds a dict describing how incoming revisions are saved,
+        as adapted to the database's speed: "batchSize" (the number of revisions saved per
+        transaction), "delay" (seconds to wait for a batch to fill) and "batches" (the number of
+        transactions so far.)
+        @param outErr Records error information, if any.
+        @return A Fleece-encoded dictionary, or nullslice on failure. */
+    C4SliceResult c4repl_getStatistics(C4Replicator* repl C4NONNULL, C4Error* outErr) C4API;
+
 
 #pragma mark - COOKIES:
 
@@ -275,6 +284,7 @@ extern "C" {
     #define kC4ReplicatorOptionRemoteDBUniqueID "remoteDBUniqueID" ///< Stable ID for remote db with unstable URL (string)
     #define kC4ReplicatorHeartbeatInterval      "heartbeat" ///< Interval in secs to send a keepalive ping
     #define kC4ReplicatorResetCheckpoint        "reset"     ///< Start over w/o checkpoint (bool)
+    #define kC4ReplicatorCheckpointRanges       "checkpointRanges" ///< Checkpoint pushed seqs past the oldest pending one (bool)
     #define kC4ReplicatorOptionProgressLevel    "progress"  ///< If >=1, notify on every doc; if >=2, on every attachment (int)
     #define kC4ReplicatorOptionDisableDeltas    "noDeltas"   ///< Disables delta sync (bool)
 
@@ -324,6 +324,88 @@ N_WAY_TEST_CASE_METHOD(BlobStoreTest, "write blobs of many sizes", "[blob][Encry
 }
 
 
+N_WAY_TEST_CASE_METHOD(BlobStoreTest, "write compressed blob with stream", "[blob][Encryption][C]") {
+    // Write enough lines to span several compressed blocks:
+    string data;
+    for (int i = 0; i < 5000; i++) {
+        char buf[100];
+        sprintf(buf, "This is line %04d.\n", i);
+        data += buf;
+    }
+    C4Slice dataSlice = {data.data(), data.size()};
+
+    C4Error error;
+    C4WriteStream *stream = c4blob_openCompressedWriteStream(store, &error);
+    REQUIRE(stream);
+    for (size_t pos = 0; pos < data.size(); pos += 1000)
+        REQUIRE(c4stream_write(stream, &data[pos], min(data.size() - pos, size_t(1000)), &error));
+    CHECK(c4stream_bytesWritten(stream) == data.size());
+
+    // The key is the digest of the uncompressed data:
+    C4BlobKey key = c4stream_computeBlobKey(stream);
+    CHECK(memcmp(c4blob_computeKey(dataSlice).bytes, key.bytes, 20) == 0);
+    CHECK(c4stream_install(stream, nullptr, &error));
+    c4stream_closeWriter(stream);
+
+    CHECK(c4blob_getSize(store, key) == (int64_t)data.size());
+    C4SliceResult contents = c4blob_getContents(store, key, &error);
+    CHECK(string((char*)contents.buf, contents.size) == data);
+    c4slice_free(contents);
+
+    // The file isn't readable by the caller:
+    C4StringResult path = c4blob_getFilePath(store, key, &error);
+    CHECK(path.buf == nullptr);
+    CHECK(error.code == kC4ErrorWrongFormat);
+
+    // Read it back random-access:
+    C4ReadStream *reader = c4blob_openReadStream(store, key, &error);
+    REQUIRE(reader);
+    CHECK(c4stream_getLength(reader, &error) == (int64_t)data.size());
+    static const int increment = 3*3*3*3*3;
+    int line = increment;
+    for (uint64_t i = 0; i < 5000; i++) {
+        line = (line + increment) % 5000;
+        INFO("Reading line " << line << " at offset " << 19*line);
+        char readBuf[100];
+        REQUIRE(c4stream_seek(reader, 19*line, &error));
+        REQUIRE(c4stream_read(reader, readBuf, 19, &error) == 19);
+        REQUIRE(string(readBuf, 19) == data.substr(19*line, 19));
+    }
+    c4stream_close(reader);
+
+    // Storing the same data uncompressed replaces the compressed copy:
+    C4BlobKey key2;
+    REQUIRE(c4blob_create(store, dataSlice, nullptr, &key2, &error));
+    CHECK(memcmp(&key2, &key, sizeof(key2)) == 0);
+    path = c4blob_getFilePath(store, key, &error);
+    CHECK((path.buf != nullptr) == !encrypted);
+    c4slice_free(path);
+}
+
+
+N_WAY_TEST_CASE_METHOD(BlobStoreTest, "write compressed blobs of many sizes", "[blob][Encryption][C]") {
+    // The interesting sizes for compressed blobs are around the block size (32768):
+    const vector<size_t> kSizes = {0, 1, 100, 32767, 32768, 32769, 65535, 65536, 65537};
+    for (size_t size : kSizes) {
+        INFO("Testing " << size << "-byte blob");
+        string data;
+        const char *chars = "ABCDEFGHIJKLMNOPQRSTUVWXY";
+        for (size_t i = 0; i < size; i++)
+            data += chars[i % strlen(chars)];
+        C4Slice dataSlice = {data.data(), data.size()};
+
+        C4Error error;
+        C4BlobKey key;
+        REQUIRE(c4blob_createCompressed(store, dataSlice, nullptr, &key, &error));
+        CHECK(memcmp(c4blob_computeKey(dataSlice).bytes, key.bytes, 20) == 0);
+        CHECK(c4blob_getSize(store, key) == (int64_t)size);
+        C4SliceResult contents = c4blob_getContents(store, key, &error);
+        CHECK(string((char*)contents.buf, contents.size) == data);
+        c4slice_free(contents);
+    }
+}
+
+
 N_WAY_TEST_CASE_METHOD(BlobStoreTest, "write blob and cancel", "[blob][Encryption][C]") {
     // Write the blob:
     C4Error error;
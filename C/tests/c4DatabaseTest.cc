@@ -23,6 +23,7 @@
 #include <cmath>
 #include <errno.h>
 #include <iostream>
+#include <thread>
 
 #include "sqlite3.h"
 
@@ -267,6 +268,43 @@ N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database AllDocs", "[Database][C]") {
 }
 
 
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database DocRange", "[Database][C]") {
+    setupAllDocs();
+    C4Error error;
+    C4EnumeratorOptions options = kC4DefaultEnumeratorOptions;
+
+    auto check = [&](C4Slice start, C4Slice end, uint64_t skip, uint64_t limit,
+                     int first, int last) {
+        C4DocEnumerator *e = c4db_enumerateDocRange(db, start, end, skip, limit,
+                                                    &options, &error);
+        REQUIRE(e);
+        int step = (options.flags & kC4Descending) ? -1 : 1;
+        int i = first;
+        char docID[20];
+        while (c4enum_next(e, &error)) {
+            C4DocumentInfo info;
+            REQUIRE(c4enum_getDocumentInfo(e, &info));
+            sprintf(docID, "doc-%03d", i);
+            CHECK(info.docID == c4str(docID));
+            i += step;
+        }
+        CHECK(error.code == 0);
+        CHECK(i == last + step);
+        c4enum_free(e);
+    };
+
+    check(C4STR("doc-010"), C4STR("doc-019"), 0, UINT64_MAX, 10, 19);
+    check(C4STR("doc-090"), kC4SliceNull, 0, UINT64_MAX, 90, 99);
+    check(kC4SliceNull, kC4SliceNull, 5, 10, 6, 15);
+    check(C4STR("doc-050"), C4STR("doc-060"), 2, 3, 52, 54);
+    check(C4STR("doc-050"), C4STR("doc-060"), 0, 0, 50, 49);
+
+    options.flags |= kC4Descending;
+    check(C4STR("doc-019"), C4STR("doc-010"), 0, UINT64_MAX, 19, 10);
+    check(kC4SliceNull, kC4SliceNull, 0, 3, 99, 97);
+}
+
+
 N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database AllDocsInfo", "[Database][C]") {
     setupAllDocs();
     C4Error error;
@@ -295,6 +333,42 @@ N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database AllDocsInfo", "[Database][C]")
 }
 
 
+static uint64_t statistic(C4Database *db, const char *key, const char *subkey =nullptr) {
+    C4Error error;
+    C4SliceResult stats = c4db_getStatistics(db, &error);
+    REQUIRE(stats.buf);
+    FLDict root = FLValue_AsDict(FLValue_FromData((FLSlice)stats, kFLTrusted));
+    FLValue value = FLDict_Get(root, FLStr(key));
+    if (subkey)
+        value = FLDict_Get(FLValue_AsDict(value), FLStr(subkey));
+    uint64_t result = FLValue_AsUnsigned(value);
+    c4slice_free(stats);
+    return result;
+}
+
+
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Statistics", "[Database][C]") {
+    auto commits = statistic(db, "commitTime", "count");
+    setupAllDocs();
+    CHECK(statistic(db, "commitTime", "count") > commits);
+    CHECK(statistic(db, "sqliteCommitTime", "count") > 0);
+
+    auto records = statistic(db, "recordsRead");
+    auto bytes = statistic(db, "bodyBytesRead");
+    auto steps = statistic(db, "statementSteps");
+    C4Error error;
+    C4EnumeratorOptions options = kC4DefaultEnumeratorOptions;
+    C4DocEnumerator *e = c4db_enumerateAllDocs(db, &options, &error);
+    REQUIRE(e);
+    while (c4enum_next(e, &error))
+        ;
+    c4enum_free(e);
+    CHECK(statistic(db, "recordsRead") >= records + 99);
+    CHECK(statistic(db, "bodyBytesRead") > bytes);
+    CHECK(statistic(db, "statementSteps") >= steps + 100);
+}
+
+
 N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Changes", "[Database][C]") {
     createNumberedDocs(99);
 
@@ -441,6 +515,52 @@ N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Expired Multiple Instances", "[
     c4db_free(db2);
 }
 
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Housekeeping", "[Database][C]") {
+    C4Error err;
+    // Start before any docs expire, so the Housekeeper has to notice the new expiration times:
+    REQUIRE(c4db_startHousekeeping(db, &err));
+
+    // More docs than are purged per transaction:
+    static constexpr unsigned kNumDocs = 2500;
+    C4Timestamp expire = c4_now() + 1*secs;
+    {
+        TransactionHelper t(db);
+        char docID[20];
+        for (unsigned i = 0; i < kNumDocs; ++i) {
+            sprintf(docID, "doc-%04u", i);
+            createRev(c4str(docID), kRevID, kFleeceBody);
+            REQUIRE(c4doc_setExpiration(db, c4str(docID), expire, &err));
+        }
+    }
+    createRev(C4STR("dont_expire_me"), kRevID, kFleeceBody);
+    REQUIRE(c4db_getDocumentCount(db) == kNumDocs + 1);
+
+    auto observer = c4dbobs_create(db, [](C4DatabaseObserver*, void*) { }, nullptr);
+
+    C4Log("---- Wait for docs to be purged...");
+    for (int i = 0; i < 100 && c4db_getDocumentCount(db) > 1; ++i)
+        this_thread::sleep_for(chrono::milliseconds(100));
+    CHECK(c4_now() >= expire);
+    CHECK(c4db_getDocumentCount(db) == 1);
+    CHECK(c4db_nextDocExpiration(db) == 0);
+
+    // The observer should have been notified of each purge:
+    unsigned purged = 0;
+    C4DatabaseChange changes[100];
+    bool external;
+    uint32_t n;
+    while ((n = c4dbobs_getChanges(observer, changes, 100, &external)) > 0) {
+        CHECK(external);
+        for (uint32_t i = 0; i < n; ++i) {
+            if (changes[i].sequence == 0)
+                ++purged;
+        }
+        c4dbobs_releaseChanges(changes, n);
+    }
+    CHECK(purged == kNumDocs);
+    c4dbobs_free(observer);
+}
+
 N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database BlobStore", "[Database][C]")
 {
     C4Error err;
@@ -512,6 +632,43 @@ N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Compact", "[Database][C]")
     REQUIRE(c4blob_getSize(store, key3) == -1);
 }
 
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Compact Many Docs", "[Database][C]")
+{
+    // Enough docs that the blob scan is split across several threads:
+    static const unsigned kNumDocs = 2500;
+    C4Error err;
+    vector<C4BlobKey> keys;
+    char docID[20], content[40];
+    {
+        TransactionHelper t(db);
+        for (unsigned i = 0; i < kNumDocs; ++i) {
+            sprintf(docID, "doc-%04u", i);
+            sprintf(content, "Attachment #%u", i);
+            vector<string> atts {content};
+            keys.push_back(addDocWithAttachments(c4str(docID), atts, "text/plain")[0]);
+        }
+    }
+    // Delete every other doc:
+    {
+        TransactionHelper t(db);
+        for (unsigned i = 0; i < kNumDocs; i += 2) {
+            sprintf(docID, "doc-%04u", i);
+            createRev(c4str(docID), kRev2ID, kC4SliceNull, kRevDeleted);
+        }
+    }
+
+    REQUIRE(c4db_compact(db, &err));
+    C4BlobStore* store = c4db_getBlobStore(db, &err);
+    REQUIRE(store);
+    for (unsigned i = 0; i < kNumDocs; ++i) {
+        INFO("Doc #" << i);
+        if (i % 2 == 0)
+            CHECK(c4blob_getSize(store, keys[i]) == -1);
+        else
+            CHECK(c4blob_getSize(store, keys[i]) > 0);
+    }
+}
+
 N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database copy", "[Database][C]") {
     C4Slice doc1ID = C4STR("doc001");
     C4Slice doc2ID = C4STR("doc002");
@@ -630,3 +787,267 @@ N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Config2 And ExtraInfo", "[Datab
 
     REQUIRE(c4db_deleteNamed(slice(db2Name), config.parentDirectory, &error));
 }
+
+
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Split Bodies", "[Database][C]") {
+    C4DatabaseConfig2 config = {};
+    config.parentDirectory = slice(TempDir());
+    config.flags = kC4DB_Create | kC4DB_SplitBodies;
+    const string splitName = kDatabaseName + "_split";
+    C4Error error;
+
+    c4db_deleteNamed(slice(splitName), config.parentDirectory, &error);
+    REQUIRE(error.code == 0);
+    C4Database *splitDB = c4db_openNamed(slice(splitName), &config, &error);
+    REQUIRE(splitDB);
+
+    auto encode = [&](const char *json) {
+        TransactionHelper t(splitDB);
+        alloc_slice body = c4db_encodeJSON(splitDB, slice(json5(json)), &error);
+        REQUIRE(body);
+        return body;
+    };
+    alloc_slice body1 = encode("{'n':1}");
+    alloc_slice body2 = encode("{'n':2}");
+    alloc_slice body3 = encode("{'n':3}");
+    createRev(splitDB, kDocID, kRevID, body1);
+    createRev(splitDB, kDocID, kRev2ID, body2);
+    createConflictingRev(splitDB, kDocID, kRevID, "2-aaaaaaaa"_sl, body3);
+
+    auto checkDoc = [&](C4Database *theDB) {
+        C4Document *doc = c4doc_get(theDB, kDocID, true, &error);
+        REQUIRE(doc);
+        CHECK(slice(doc->revID) == slice(kRev2ID));
+        CHECK(doc->selectedRev.body == body2);
+        // The conflicting leaf's body lives in the rev history, not in the body column:
+        REQUIRE(c4doc_selectRevision(doc, "2-aaaaaaaa"_sl, true, &error));
+        CHECK(doc->selectedRev.body == body3);
+        // Non-leaf bodies are still pruned:
+        REQUIRE(c4doc_selectRevision(doc, kRevID, false, &error));
+        CHECK(!c4doc_hasRevisionBody(doc));
+        c4doc_free(doc);
+
+        // Queries see the current revision:
+        C4Query *query = c4query_new2(theDB, kC4JSONQuery, json5slice("{WHAT: [['.n']]}"),
+                                      nullptr, &error);
+        REQUIRE(query);
+        C4QueryEnumerator *e = c4query_run(query, nullptr, nullslice, &error);
+        REQUIRE(e);
+        REQUIRE(c4queryenum_next(e, &error));
+        CHECK(FLValue_AsInt(FLArrayIterator_GetValueAt(&e->columns, 0)) == 2);
+        CHECK(!c4queryenum_next(e, &error));
+        c4queryenum_free(e);
+        c4query_free(query);
+    };
+    checkDoc(splitDB);
+
+    // Reopening without the flag still uses split bodies:
+    REQUIRE(c4db_close(splitDB, &error));
+    c4db_release(splitDB);
+    config.flags = kC4DB_Create;
+    splitDB = c4db_openNamed(slice(splitName), &config, &error);
+    REQUIRE(splitDB);
+    checkDoc(splitDB);
+
+    REQUIRE(c4db_delete(splitDB, &error));
+    c4db_release(splitDB);
+}
+
+
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Compressed Bodies", "[Database][C]") {
+    C4DatabaseConfig2 config = {};
+    config.parentDirectory = slice(TempDir());
+    config.flags = kC4DB_Create | kC4DB_CompressBodies;
+    const string compressedName = kDatabaseName + "_compressed";
+    C4Error error;
+
+    c4db_deleteNamed(slice(compressedName), config.parentDirectory, &error);
+    REQUIRE(error.code == 0);
+    C4Database *compressedDB = c4db_openNamed(slice(compressedName), &config, &error);
+    REQUIRE(compressedDB);
+
+    // One body that's small, and one that's big & repetitive enough to be compressed:
+    string longText;
+    for (int i = 0; i < 100; ++i)
+        longText += "All work and no play makes Jack a dull boy. ";
+    alloc_slice smallBody, bigBody;
+    {
+        TransactionHelper t(compressedDB);
+        smallBody = c4db_encodeJSON(compressedDB, slice(json5("{'n':1}")), &error);
+        bigBody = c4db_encodeJSON(compressedDB, slice(json5("{'n':2,'text':'" + longText + "'}")),
+                                  &error);
+        REQUIRE(smallBody);
+        REQUIRE(bigBody);
+    }
+    createRev(compressedDB, "small"_sl, kRevID, smallBody);
+    createRev(compressedDB, "big"_sl, kRevID, bigBody);
+
+    auto checkDocs = [&](C4Database *theDB) {
+        C4Document *doc = c4doc_get(theDB, "small"_sl, true, &error);
+        REQUIRE(doc);
+        CHECK(doc->selectedRev.body == smallBody);
+        c4doc_free(doc);
+        doc = c4doc_get(theDB, "big"_sl, true, &error);
+        REQUIRE(doc);
+        CHECK(doc->selectedRev.body == bigBody);
+        c4doc_free(doc);
+
+        // Queries see the decompressed bodies:
+        C4Query *query = c4query_new2(theDB, kC4JSONQuery,
+                                      json5slice("{WHAT: [['.n'], ['length()', ['.text']]],"
+                                                 " ORDER_BY: [['.n']]}"),
+                                      nullptr, &error);
+        REQUIRE(query);
+        C4QueryEnumerator *e = c4query_run(query, nullptr, nullslice, &error);
+        REQUIRE(e);
+        REQUIRE(c4queryenum_next(e, &error));
+        CHECK(FLValue_AsInt(FLArrayIterator_GetValueAt(&e->columns, 0)) == 1);
+        REQUIRE(c4queryenum_next(e, &error));
+        CHECK(FLValue_AsInt(FLArrayIterator_GetValueAt(&e->columns, 0)) == 2);
+        CHECK(FLValue_AsInt(FLArrayIterator_GetValueAt(&e->columns, 1)) == (int64_t)longText.size());
+        CHECK(!c4queryenum_next(e, &error));
+        c4queryenum_free(e);
+        c4query_free(query);
+
+        // Enumerating without bodies reports the same (decompressed) body sizes as with them:
+        auto bodySizes = [&](bool includeBodies) {
+            C4EnumeratorOptions options = kC4DefaultEnumeratorOptions;
+            if (!includeBodies)
+                options.flags &= ~kC4IncludeBodies;
+            vector<uint64_t> sizes;
+            C4DocEnumerator *docs = c4db_enumerateAllDocs(theDB, &options, &error);
+            REQUIRE(docs);
+            while (c4enum_next(docs, &error)) {
+                C4DocumentInfo info;
+                REQUIRE(c4enum_getDocumentInfo(docs, &info));
+                sizes.push_back(info.bodySize);
+            }
+            c4enum_free(docs);
+            return sizes;
+        };
+        auto sizes = bodySizes(true);
+        CHECK(sizes.size() == 2);
+        CHECK(bodySizes(false) == sizes);
+    };
+    checkDocs(compressedDB);
+
+    // Reopening without the flag still uses compressed bodies:
+    REQUIRE(c4db_close(compressedDB, &error));
+    c4db_release(compressedDB);
+    config.flags = kC4DB_Create;
+    compressedDB = c4db_openNamed(slice(compressedName), &config, &error);
+    REQUIRE(compressedDB);
+    checkDocs(compressedDB);
+
+    REQUIRE(c4db_delete(compressedDB, &error));
+    c4db_release(compressedDB);
+}
+
+
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Delta Revision Bodies", "[Database][C]") {
+    if (!isRevTrees())
+        return;
+
+    C4DatabaseConfig2 config = {};
+    config.parentDirectory = slice(TempDir());
+    config.flags = kC4DB_Create | kC4DB_DeltaRevBodies;
+    const string deltaName = kDatabaseName + "_delta";
+    C4Error error;
+
+    c4db_deleteNamed(slice(deltaName), config.parentDirectory, &error);
+    REQUIRE(error.code == 0);
+    C4Database *deltaDB = c4db_openNamed(slice(deltaName), &config, &error);
+    REQUIRE(deltaDB);
+
+    string longText;
+    for (int i = 0; i < 100; ++i)
+        longText += "All work and no play makes Jack a dull boy. ";
+    auto encode = [&](int n) {
+        TransactionHelper t(deltaDB);
+        string json = json5("{'n':" + to_string(n) + ",'text':'" + longText + "'}");
+        alloc_slice body = c4db_encodeJSON(deltaDB, slice(json), &error);
+        REQUIRE(body);
+        return body;
+    };
+    alloc_slice body1 = encode(1), body2 = encode(2), body3 = encode(3);
+
+    // Rev 1's body is kept after it stops being current, so it's saved as a delta:
+    createRev(deltaDB, kDocID, kRevID, body1, kRevKeepBody);
+    createRev(deltaDB, kDocID, kRev2ID, body2);
+
+    auto checkDoc = [&](C4Database *theDB, C4Slice currentRevID, slice currentBody) {
+        C4Document *doc = c4doc_get(theDB, kDocID, true, &error);
+        REQUIRE(doc);
+        CHECK(slice(doc->revID) == slice(currentRevID));
+        CHECK(doc->selectedRev.body == currentBody);
+        REQUIRE(c4doc_selectRevision(doc, kRevID, true, &error));
+        CHECK(c4doc_hasRevisionBody(doc));
+        CHECK(doc->selectedRev.body == body1);
+        c4doc_free(doc);
+    };
+    checkDoc(deltaDB, kRev2ID, body2);
+
+    // Adding a revision re-encodes the delta against the new current revision:
+    createRev(deltaDB, kDocID, kRev3ID, body3);
+    checkDoc(deltaDB, kRev3ID, body3);
+
+    // Reopening without the flag can still read the delta:
+    REQUIRE(c4db_close(deltaDB, &error));
+    c4db_release(deltaDB);
+    config.flags = kC4DB_Create;
+    deltaDB = c4db_openNamed(slice(deltaName), &config, &error);
+    REQUIRE(deltaDB);
+    checkDoc(deltaDB, kRev3ID, body3);
+
+    REQUIRE(c4db_delete(deltaDB, &error));
+    c4db_release(deltaDB);
+}
+
+
+N_WAY_TEST_CASE_METHOD(C4DatabaseTest, "Database Compressed Blobs Mark Schema", "[Database][blob][C]") {
+    auto rawInt = [&](slice sql) {
+        C4Error error;
+        alloc_slice result = c4db_rawQuery(db, sql, &error);
+        REQUIRE(result);
+        FLArray rows = FLValue_AsArray(FLValue_FromData((FLSlice)result, kFLTrusted));
+        return FLValue_AsInt(FLArray_Get(FLValue_AsArray(FLArray_Get(rows, 0)), 0));
+    };
+    auto userVersion = [&]() {
+        return rawInt("PRAGMA user_version"_sl);
+    };
+    auto hasCompressedBlobsFlag = [&]() {
+        return rawInt("SELECT count(*) FROM sqlite_master WHERE type='table' AND name='info'"_sl)
+            && rawInt("SELECT value & 8 FROM info WHERE key='features'"_sl) != 0;
+    };
+    int64_t initialVersion = userVersion();
+    CHECK(!hasCompressedBlobsFlag());
+
+    // Storing an uncompressed blob doesn't change the schema version:
+    C4Error error;
+    C4BlobStore *store = c4db_getBlobStore(db, &error);
+    REQUIRE(store);
+    C4BlobKey key;
+    REQUIRE(c4blob_create(store, "plain blob"_sl, nullptr, &key, &error));
+    {
+        TransactionHelper t(db);
+    }
+    CHECK(userVersion() == initialVersion);
+    CHECK(!hasCompressedBlobsFlag());
+
+    // A compressed blob locks out older versions once the next transaction commits, before
+    // any document can refer to it:
+    string text;
+    for (int i = 0; i < 100; ++i)
+        text += "All work and no play makes Jack a dull boy. ";
+    REQUIRE(c4blob_createCompressed(store, slice(text), nullptr, &key, &error));
+    {
+        TransactionHelper t(db);
+    }
+    CHECK(userVersion() >= 400);
+    CHECK(hasCompressedBlobsFlag());
+
+    // The database can still be reopened:
+    reopenDB();
+    CHECK(userVersion() >= 400);
+    CHECK(hasCompressedBlobsFlag());
+}
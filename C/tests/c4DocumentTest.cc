@@ -355,6 +355,69 @@ N_WAY_TEST_CASE_METHOD(C4Test, "Document Get Single Revision", "[Document][C]")
     CHECK(error.code == kC4ErrorNotFound);
 }
 
+N_WAY_TEST_CASE_METHOD(C4Test, "Document Get Metadata", "[Document][C]") {
+    if (!isRevTrees()) return;
+
+    createRev(kDocID, kRevID, kFleeceBody);
+    createRev(kDocID, kRev2ID, kFleeceBody);
+
+    C4Error error;
+    C4Document *doc = c4doc_getMeta(db, kDocID, &error);
+    REQUIRE(doc);
+    CHECK(doc->docID == kDocID);
+    CHECK(doc->revID == kRev2ID);
+    CHECK(doc->flags == kDocExists);
+    CHECK(doc->sequence == 2);
+    CHECK(doc->selectedRev.revID == kRev2ID);
+    CHECK(doc->selectedRev.body == nullslice);
+
+    // The rest of the document is loaded on demand:
+    REQUIRE(c4doc_loadRevisionBody(doc, &error));
+    CHECK(doc->selectedRev.body == kFleeceBody);
+    REQUIRE(c4doc_selectParentRevision(doc));
+    CHECK(doc->selectedRev.revID == kRevID);
+    c4doc_free(doc);
+
+    doc = c4doc_getMeta(db, "missing"_sl, &error);
+    CHECK(!doc);
+    CHECK(error.domain == LiteCoreDomain);
+    CHECK(error.code == kC4ErrorNotFound);
+}
+
+
+N_WAY_TEST_CASE_METHOD(C4Test, "Document Get Multiple", "[Document][C]") {
+    createNumberedDocs(100);
+
+    // Request every other doc, plus some that don't exist, in an arbitrary order:
+    vector<string> docIDs;
+    char docID[20];
+    for (unsigned i = 199; i >= 1; i -= 2) {
+        sprintf(docID, "doc-%03u", i);
+        docIDs.push_back(docID);
+    }
+    vector<C4String> keys;
+    for (auto &docID : docIDs)
+        keys.push_back(c4str(docID.c_str()));
+
+    vector<C4Document*> docs(keys.size());
+    C4Error error;
+    REQUIRE(c4db_getDocs(db, keys.data(), keys.size(), false, docs.data(), &error));
+    for (size_t i = 0; i < docs.size(); ++i) {
+        INFO("Checking " << docIDs[i]);
+        unsigned n = 199 - 2 * unsigned(i);
+        if (n <= 100) {
+            REQUIRE(docs[i]);
+            CHECK(docs[i]->docID == keys[i]);
+            CHECK(docs[i]->revID == kRevID);
+            CHECK(docs[i]->selectedRev.body == kFleeceBody);
+        } else {
+            CHECK(docs[i] == nullptr);
+        }
+        c4doc_free(docs[i]);
+    }
+}
+
+
 N_WAY_TEST_CASE_METHOD(C4Test, "Document Purge", "[Database][C]") {
     const auto kFleeceBody2 = json2fleece("{'ok':'go'}");
     const auto kFleeceBody3 = json2fleece("{'ubu':'roi'}");
@@ -150,6 +150,19 @@ public:
         }
         b.printReport(1, "doc");
     }
+
+
+    // Deletes the database and recreates it, empty, with the given flags added to its config.
+    void recreateDB(C4DatabaseFlags extraFlags) {
+        alloc_slice path(c4db_getPath(db));
+        auto config = *c4db_getConfig(db);
+        config.flags |= kC4DB_Create | extraFlags;
+        C4Error error;
+        REQUIRE(c4db_delete(db, &error));
+        c4db_free(db);
+        db = c4db_open(path, &config, &error);
+        REQUIRE(db);
+    }
 };
 
 
@@ -217,3 +230,36 @@ N_WAY_TEST_CASE_METHOD(PerfTest, "Import Wikipedia", "[Perf][C][.slow]") {
     reopenDB();
     readRandomDocs(numDocs, 100000);
 }
+
+
+N_WAY_TEST_CASE_METHOD(PerfTest, "Compressed bodies", "[Perf][C][.slow]") {
+    // Compares size, write & read speed, and query latency with and without body compression.
+    unsigned queryRowCount = 0;
+    for (int compress = 0; compress <= 1; ++compress) {
+        recreateDB(compress ? kC4DB_CompressBodies : 0);
+        fprintf(stderr, "******** %s bodies:\n", (compress ? "Compressed" : "Uncompressed"));
+
+        Stopwatch st;
+        auto numDocs = importJSONLines(sFixturesDir + "iTunesMusicLibrary.json");
+        CHECK(numDocs == 12189);
+        st.printReport("Importing", numDocs, "doc");
+
+        reopenDB();     // checkpoints the WAL, so the size below is accurate
+        litecore::FilePath path(alloc_slice(c4db_getPath(db)).asString(), "db.sqlite3");
+        fprintf(stderr, "DB size is %llu\n", path.dataSize());
+
+        readRandomDocs(numDocs, 100000);
+
+        Benchmark b;
+        for (int i = 0; i < 20; ++i) {
+            b.start();
+            auto n = queryWhere("[\"=\", [\".Artist\"], \"Miles Davis\"]");
+            b.stop();
+            if (compress)
+                CHECK(n == queryRowCount);
+            else
+                queryRowCount = n;
+        }
+        b.printReport(1, "query");
+    }
+}
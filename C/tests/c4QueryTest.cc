@@ -53,6 +53,107 @@ N_WAY_TEST_CASE_METHOD(QueryTest, "DB Query", "[Query][C]") {
     CHECK(run("{\"offset\":0,\"limit\":4}") == (vector<string>{}));
 }
 
+N_WAY_TEST_CASE_METHOD(QueryTest, "DB Query streaming", "[Query][C]") {
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    vector<string> expected = run();
+
+    C4QueryOptions options = kC4DefaultQueryOptions;
+    options.streaming = true;
+    C4Error error;
+    auto e = c4query_run(query, &options, nullslice, &error);
+    REQUIRE(e);
+    {
+        ExpectingExceptions x;
+        CHECK(c4queryenum_getRowCount(e, &error) == -1);
+        CHECK(error.code == kC4ErrorUnsupported);
+        CHECK(!c4queryenum_seek(e, 1, &error));
+        CHECK(error.code == kC4ErrorUnsupported);
+    }
+    vector<string> results;
+    error = {};
+    while (c4queryenum_next(e, &error)) {
+        alloc_slice docID = FLValue_ToString(FLArrayIterator_GetValueAt(&e->columns, 0));
+        results.push_back(docID.asString());
+    }
+    CHECK(error.code == 0);
+    CHECK(results == expected);
+
+    // Nothing has changed, so there's nothing to refresh:
+    CHECK(c4queryenum_refresh(e, &error) == nullptr);
+    CHECK(error.code == 0);
+    c4queryenum_free(e);
+
+    // Streaming isn't possible in a transaction, whose changes a reader couldn't see:
+    {
+        TransactionHelper t(db);
+        ExpectingExceptions x;
+        CHECK(c4query_run(query, &options, nullslice, &error) == nullptr);
+        CHECK(error.domain == LiteCoreDomain);
+        CHECK(error.code == kC4ErrorBusy);
+    }
+}
+
+N_WAY_TEST_CASE_METHOD(QueryTest, "DB Query streaming isolation", "[Query][C]") {
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    vector<string> expected = run();
+    REQUIRE(expected.size() > 2);
+
+    C4QueryOptions options = kC4DefaultQueryOptions;
+    options.streaming = true;
+    C4Error error;
+    auto e = c4query_run(query, &options, nullslice, &error);
+    REQUIRE(e);
+    vector<string> results;
+    REQUIRE(c4queryenum_next(e, &error));
+    results.push_back(slice(FLValue_AsString(FLArrayIterator_GetValueAt(&e->columns, 0))).asString());
+
+    // Purging the rest of the matching docs mustn't affect the enumerator, which started first:
+    {
+        TransactionHelper t(db);
+        for (size_t i = 1; i < expected.size(); ++i)
+            REQUIRE(c4db_purgeDoc(db, slice(expected[i]), &error));
+    }
+    while (c4queryenum_next(e, &error))
+        results.push_back(slice(FLValue_AsString(FLArrayIterator_GetValueAt(&e->columns, 0))).asString());
+    CHECK(error.code == 0);
+    CHECK(results == expected);
+    c4queryenum_free(e);
+
+    // Closing the database while enumerating ends the enumeration, but the enumerator can
+    // still be freed afterwards:
+    e = c4query_run(query, &options, nullslice, &error);
+    REQUIRE(e);
+    REQUIRE(c4queryenum_next(e, &error));
+    auto config = *c4db_getConfig(db);
+    REQUIRE(c4db_close(db, &error));
+    {
+        ExpectingExceptions x;
+        CHECK(!c4queryenum_next(e, &error));
+        CHECK(error.domain == LiteCoreDomain);
+        CHECK(error.code == kC4ErrorNotOpen);
+    }
+    c4queryenum_free(e);
+    c4db_free(db);
+    db = c4db_open(databasePath(), &config, &error);
+    REQUIRE(db);
+}
+
+N_WAY_TEST_CASE_METHOD(QueryTest, "DB Query in transaction", "[Query][C]") {
+    // Queries usually run on a pooled reader, but in a transaction they have to see its changes:
+    compile(json5("['=', ['.', 'contact', 'address', 'state'], 'CA']"));
+    vector<string> expected = run();
+    REQUIRE(expected.size() > 2);
+    {
+        TransactionHelper t(db);
+        C4Error error;
+        REQUIRE(c4db_purgeDoc(db, slice(expected[0]), &error));
+        expected.erase(expected.begin());
+        CHECK(run() == expected);
+    }
+    CHECK(run() == expected);
+}
+
+
 N_WAY_TEST_CASE_METHOD(QueryTest, "DB Query LIKE", "[Query][C]") {
     SECTION("General") {
         compile(json5("['LIKE', ['.name.first'], '%j%']"));
@@ -393,6 +494,65 @@ N_WAY_TEST_CASE_METHOD(QueryTest, "Full-text query", "[Query][C][FTS]") {
     c4slice_free(matched);
 }
 
+N_WAY_TEST_CASE_METHOD(QueryTest, "Indexes built in background", "[Query][C][FTS]") {
+    // Add enough docs that building the indexes takes several batches:
+    {
+        TransactionHelper t(db);
+        char docID[20];
+        for (int i = 0; i < 2500; ++i) {
+            sprintf(docID, "filler-%04d", i);
+            createFleeceRev(db, c4str(docID), kRevID, C4STR("{\"filler\":true}"));
+        }
+    }
+    C4IndexOptions options = {};
+    options.background = true;
+    C4Error err;
+    REQUIRE(c4db_createIndex(db, C4STR("byStreet"), C4STR("[[\".contact.address.street\"]]"),
+                             kC4FullTextIndex, &options, &err));
+    REQUIRE(c4db_createIndex(db, C4STR("likes"), C4STR("[[\".likes\"]]"),
+                             kC4ArrayIndex, &options, &err));
+
+    // Close the database before the builds can finish; they resume when housekeeping starts:
+    reopenDB();
+    uint64_t indexed, total;
+    REQUIRE(c4db_getIndexBuildProgress(db, C4STR("byStreet"), &indexed, &total, &err));
+    CHECK(indexed < total);
+    CHECK(total == 2600);
+    {
+        ExpectingExceptions x;
+        CHECK(!c4query_new(db, c4str(json5("['MATCH', 'byStreet', 'Hwy']").c_str()), &err));
+        CHECK(err.domain == LiteCoreDomain);
+        CHECK(err.code == kC4ErrorNoSuchIndex);
+    }
+    // An UNNEST query doesn't use the array index yet:
+    string unnestQuery = json5("{WHAT: ['.person._id'],\
+                                 FROM: [{as: 'person'}, \
+                                        {as: 'like', unnest: ['.person.likes']}],\
+                                WHERE: ['=', ['.like'], 'climbing'],\
+                             ORDER_BY: [['.person.name.first']]}");
+    compileSelect(unnestQuery);
+    alloc_slice explanation = c4query_explain(query);
+    CHECK(explanation.find(":unnest:likes"_sl) == nullslice);
+
+    REQUIRE(c4db_startHousekeeping(db, &err));
+    for (int i = 0; i < 200; ++i) {
+        if (!c4db_getIndexBuildProgress(db, C4STR("byStreet"), &indexed, &total, &err)
+                && !c4db_getIndexBuildProgress(db, C4STR("likes"), &indexed, &total, &err))
+            break;
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+    CHECK(!c4db_getIndexBuildProgress(db, C4STR("byStreet"), &indexed, &total, &err));
+    CHECK(err.code == 0);
+
+    // Now queries use the indexes, even though they were finished on another connection:
+    compile(json5("['MATCH', 'byStreet', 'Hwy']"));
+    CHECK(runFTS().size() == 5);
+    compileSelect(unnestQuery);
+    explanation = c4query_explain(query);
+    CHECK(explanation.find(":unnest:likes"_sl) != nullslice);
+    CHECK(run() == (vector<string>{ "0000021", "0000017", "0000045", "0000060", "0000023" }));
+}
+
 
 N_WAY_TEST_CASE_METHOD(QueryTest, "Full-text multiple properties", "[Query][C][FTS]") {
     C4Error err;
@@ -20,6 +20,7 @@
 #include "FilePath.hh"
 #include "Error.hh"
 #include "EncryptedStream.hh"
+#include "CompressedStream.hh"
 #include "Logging.hh"
 #include "StringUtil.hh"
 #include <stdint.h>
@@ -38,6 +39,9 @@ namespace litecore {
 
     static constexpr size_t kBlobKeyStringLength = ((sizeof(blobKey::bytes) + 2) / 3) * 4;
 
+    static const char* const kBlobFileExtension = ".blob";
+    static const char* const kCompressedBlobFileExtension = ".blobz";
+
 
     blobKey::blobKey(slice s) {
         if (s.size != sizeof(bytes))
@@ -76,17 +80,20 @@ namespace litecore {
     }
 
 
-    string blobKey::filename() const {
+    string blobKey::filename(bool compressed) const {
         string str = slice(bytes, sizeof(bytes)).base64String();
         replace(str.begin(), str.end(), '/', '_');
-        return str + ".blob";
+        return str + (compressed ? kCompressedBlobFileExtension : kBlobFileExtension);
     }
 
 
     bool blobKey::readFromFilename(string filename) {
-        if (!hasSuffix(filename, ".blob"))
+        if (hasSuffix(filename, kBlobFileExtension))
+            filename.resize(filename.size() - strlen(kBlobFileExtension));
+        else if (hasSuffix(filename, kCompressedBlobFileExtension))
+            filename.resize(filename.size() - strlen(kCompressedBlobFileExtension));
+        else
             return false;
-        filename.resize(filename.size() - 5);
         replace(filename.begin(), filename.end(), '_', '/');
         return readFromBase64(slice(filename), false);
     }
@@ -109,15 +116,36 @@ namespace litecore {
 #pragma mark - BLOB READING:
     
     
+    // A blob is stored in one of two files, depending on whether it's compressed.
+    static FilePath blobPath(const BlobStore &store, const blobKey &key) {
+        FilePath path(store.dir(), key.filename());
+        if (!path.exists()) {
+            FilePath compressedPath(store.dir(), key.filename(true));
+            if (compressedPath.exists())
+                return compressedPath;
+        }
+        return path;
+    }
+
+
     Blob::Blob(const BlobStore &store, const blobKey &key)
-    :_path(store.dir(), key.filename()),
+    :_path(blobPath(store, key)),
      _key(key),
      _store(store)
     { }
 
 
+    bool Blob::isCompressed() const {
+        return hasSuffix(_path.fileName(), kCompressedBlobFileExtension);
+    }
+
+
     int64_t Blob::contentLength() const {
         int64_t length = path().dataSize();
+        if (length >= 0 && isCompressed()) {
+            // The file size says little about the content size, so read it from the file:
+            return (int64_t)read()->getLength();
+        }
         if (length >= 0 && _store.options().encryptionAlgorithm != kNoEncryption)
             length -= EncryptedReadStream::kFileSizeOverhead;
         return length;
@@ -133,6 +161,8 @@ namespace litecore {
                                              options.encryptionAlgorithm,
                                              options.encryptionKey);
         }
+        if (isCompressed())
+            reader = new CompressedReadStream(shared_ptr<SeekableReadStream>(reader));
         return unique_ptr<SeekableReadStream>{reader};
     }
 
@@ -140,8 +170,9 @@ namespace litecore {
 #pragma mark - BLOB WRITING:
 
 
-    BlobWriteStream::BlobWriteStream(BlobStore &store)
-    :_store(store)
+    BlobWriteStream::BlobWriteStream(BlobStore &store, bool compressed)
+    :_store(store),
+     _compressed(compressed)
     {
         FILE *file;
         _tmpPath = store.dir()["incoming_"].mkTempFile(&file);
@@ -152,6 +183,9 @@ namespace litecore {
                                                         options.encryptionAlgorithm,
                                                         options.encryptionKey);
         }
+        // Compress before encrypting, since ciphertext is incompressible:
+        if (_compressed)
+            _writer = make_shared<CompressedWriteStream>(_writer);
         sha1_begin(&_sha1ctx);
     }
 
@@ -197,18 +231,28 @@ namespace litecore {
         auto key = computeKey();
         if (expectedKey && *expectedKey != key)
             error::_throw(error::CorruptData);
-        Blob blob(_store, key);
+        if (_compressed && _store.options().willStoreCompressedBlob)
+            _store.options().willStoreCompressedBlob();
         _tmpPath.setReadOnly(true);
-        _tmpPath.moveTo(blob.path());
+        _tmpPath.moveTo(FilePath(_store.dir(), key.filename(_compressed)));
         _installed = true;
-        return blob;
+        // Don't leave behind a copy of the same blob in the other format:
+        FilePath otherPath(_store.dir(), key.filename(!_compressed));
+        if (otherPath.exists())
+            otherPath.del();
+        return Blob(_store, key);
     }
     
 #pragma mark - DELETING:
     
     void BlobStore::deleteAllExcept(const unordered_set<string> &inUse) {
         _dir.forEachFile([&inUse](const FilePath &path) {
-            if(find(inUse.cbegin(), inUse.cend(), path.fileName()) == inUse.cend()) {
+            // `inUse` contains uncompressed filenames, so map compressed ones to those:
+            string name = path.fileName();
+            blobKey key;
+            if (key.readFromFilename(name))
+                name = key.filename();
+            if(find(inUse.cbegin(), inUse.cend(), name) == inUse.cend()) {
                 path.del();
             }
         });
@@ -235,8 +279,8 @@ namespace litecore {
     }
 
 
-    Blob BlobStore::put(slice data, const blobKey *expectedKey) {
-        BlobWriteStream stream(*this);
+    Blob BlobStore::put(slice data, const blobKey *expectedKey, bool compressed) {
+        BlobWriteStream stream(*this, compressed);
         stream.write(data);
         return stream.install(expectedKey);
     }
@@ -249,7 +293,7 @@ namespace litecore {
                 return;
             Blob srcBlob(*this, key);
             auto src = srcBlob.read();
-            BlobWriteStream dst(toStore);
+            BlobWriteStream dst(toStore, srcBlob.isCompressed());
             uint8_t buffer[4096];
             size_t bytesRead;
             while ((bytesRead = src->read(buffer, sizeof(buffer))) > 0) {
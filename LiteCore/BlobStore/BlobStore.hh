@@ -21,6 +21,7 @@
 #include "FilePath.hh"
 #include "Stream.hh"
 #include "SecureDigest.hh"
+#include <functional>
 #include <unordered_set>
 
 #if !SECURE_DIGEST_AVAILABLE
@@ -46,7 +47,7 @@ namespace litecore {
         operator slice() const          {return slice(bytes, sizeof(bytes));}
         std::string hexString() const   {return operator slice().hexString();}
         std::string base64String() const;
-        std::string filename() const;
+        std::string filename(bool compressed =false) const;
 
         bool operator== (const blobKey &k) const {
             return 0 == memcmp(bytes, k.bytes, sizeof(bytes));
@@ -67,6 +68,7 @@ namespace litecore {
         blobKey key() const             {return _key;}
         FilePath path() const           {return _path;}
         int64_t contentLength() const;      // An overestimate, if blob is encrypted
+        bool isCompressed() const;          // True if stored in compressed form
 
         alloc_slice contents() const    {return read()->readAll();}
 
@@ -89,7 +91,9 @@ namespace litecore {
     /** A stream for writing a new Blob. */
     class BlobWriteStream : public WriteStream {
     public:
-        BlobWriteStream(BlobStore&);
+        /** If `compressed` is true, the data is stored compressed (see CompressedStream.hh).
+            The blob's key is still the digest of the uncompressed data. */
+        BlobWriteStream(BlobStore&, bool compressed =false);
         ~BlobWriteStream();
 
         void write(slice) override;
@@ -114,6 +118,7 @@ namespace litecore {
         uint64_t _bytesWritten {0};
         sha1Context _sha1ctx;
         blobKey _key;
+        bool _compressed;
         bool _computedKey {false};
         bool _installed {false};
     };
@@ -128,6 +133,9 @@ namespace litecore {
             bool writeable      :1;     ///< If false, opened read-only
             EncryptionAlgorithm encryptionAlgorithm;
             alloc_slice encryptionKey;
+            /// Called before a compressed blob is installed, since older versions of LiteCore
+            /// can't read those. (May be called on any thread.)
+            std::function<void()> willStoreCompressedBlob;
             
             static const Options defaults;
         };
@@ -149,7 +157,7 @@ namespace litecore {
         const Blob get(const blobKey &key) const    {return Blob(*this, key);}
         Blob get(const blobKey &key)                {return Blob(*this, key);}
 
-        Blob put(slice data, const blobKey *expectedKey =nullptr);
+        Blob put(slice data, const blobKey *expectedKey =nullptr, bool compressed =false);
 
         void copyBlobsTo(BlobStore &toStore);       // Copy my blobs into toStore
         void moveTo(BlobStore &toStore);            // Replace toStore's dir & options
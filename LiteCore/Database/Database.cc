@@ -22,6 +22,7 @@
 #include "c4Document.h"
 #include "c4Document+Fleece.h"
 #include "BackgroundDB.hh"
+#include "Housekeeper.hh"
 #include "DataFile.hh"
 #include "Record.hh"
 #include "SequenceTracker.hh"
@@ -30,8 +31,12 @@
 #include "Upgrader.hh"
 #include "SecureRandomize.hh"
 #include "StringUtil.hh"
+#include "VersionedDocument.hh"
 #include "make_unique.h"
+#include "Stopwatch.hh"
 #include <functional>
+#include <mutex>
+#include <thread>
 
 namespace litecore { namespace constants
 {
@@ -114,6 +119,8 @@ namespace c4Internal {
         options.create = (config.flags & kC4DB_Create) != 0;
         options.writeable = (config.flags & kC4DB_ReadOnly) == 0;
         options.upgradeable = (config.flags & kC4DB_NoUpgrade) == 0;
+        options.splitBodies = (config.flags & kC4DB_SplitBodies) != 0;
+        options.compressBodies = (config.flags & kC4DB_CompressBodies) != 0;
         options.useDocumentKeys = true;
         options.encryptionAlgorithm = (EncryptionAlgorithm)config.encryptionKey.algorithm;
         if (options.encryptionAlgorithm != kNoEncryption) {
@@ -185,6 +192,7 @@ namespace c4Internal {
     Database::~Database() {
         Assert(_transactionLevel == 0,
                "Database being destructed while in a transaction");
+        stopHousekeeping();
 
         // Eagerly close the data file to ensure that no other instances will
         // be trying to use me as a delegate (for example in externalTransactionCommitted)
@@ -246,56 +254,118 @@ namespace c4Internal {
         return factory->deleteFile(path);
     }
 
-    unordered_set<string> Database::collectBlobs() {
+    // Adds the keys of all blobs referenced by a revision body to `usedDigests`.
+    static void findBlobDigests(const Dict *body, unordered_set<string> &usedDigests) {
+        // Iterate over blobs:
+        Document::findBlobReferences(body, [&](const Dict *blob) {
+            blobKey key;
+            if (Document::dictIsBlob(blob, key))    // get the key
+                usedDigests.insert(key.filename());
+            return true;
+        });
+
+        // Now look for old-style _attachments:
+        auto attachments = body->get(slice(kC4LegacyAttachmentsProperty));
+        if (attachments) {
+            blobKey key;
+            for (Dict::iterator i(attachments->asDict()); i; ++i) {
+                auto att = i.value()->asDict();
+                if (att) {
+                    const Value* digest = att->get(slice(kC4BlobDigestProperty));
+                    if (digest && key.readFromBase64(digest->asString())) {
+                        usedDigests.insert(key.filename());
+                    }
+                }
+            }
+        }
+    }
+
+
+    // Scans the docs with blobs whose sequences are in the range (after, last], adding the keys
+    // of the blobs referenced by any of their revisions to `usedDigests`.
+    // This uses only the given KeyStore (and its DataFile's shared keys), not the Database,
+    // so it can run on a pooled reader on another thread.
+    static void collectBlobsInRange(KeyStore &store, sequence_t after, sequence_t last,
+                                    unordered_set<string> &usedDigests)
+    {
         RecordEnumerator::Options options;
         options.onlyBlobs = true;
-        options.sortOption = kUnsorted;
-        RecordEnumerator e(defaultKeyStore(), options);
-        unordered_set<string> usedDigests;
-        while (e.next()) {
-            Retained<Document> doc = documentFactory().newDocumentInstance(*e);
-            doc->selectCurrentRevision();
-            do {
-                if(!doc->loadSelectedRevBody()) {
+        RecordEnumerator e(store, after, options);
+        while (e.next() && e->sequence() <= last) {
+            VersionedDocument doc(store, *e);
+            for (auto rev : doc.allRevisions()) {
+                slice body = rev->body();
+                if (!body)
                     continue;
-                }
-
-                Retained<Doc> fleeceDoc = doc->fleeceDoc();
-                const Dict* body = fleeceDoc->asDict();
+                const Dict *root = Value::fromTrustedData(body)->asDict();
+                if (root)
+                    findBlobDigests(root, usedDigests);
+            }
+        }
+    }
 
-                // Iterate over blobs:
-                Document::findBlobReferences(body, [&](const Dict *blob) {
-                    blobKey key;
-                    if (Document::dictIsBlob(blob, key))    // get the key
-                        usedDigests.insert(key.filename());
-                    return true;
-                });
 
-                // Now look for old-style _attachments:
-                auto attachments = body->get(slice(kC4LegacyAttachmentsProperty));
-                if (attachments) {
-                    blobKey key;
-                    for (Dict::iterator i(attachments->asDict()); i; ++i) {
-                        auto att = i.value()->asDict();
-                        if (att) {
-                            const Value* digest = att->get(slice(kC4BlobDigestProperty));
-                            if (digest && key.readFromBase64(digest->asString())) {
-                                usedDigests.insert(key.filename());
-                            }
-                        }
-                    }
+    // Finds the keys of all blobs referenced by any document revision. The sequence range is
+    // split among several threads, each of which reads and decodes its docs on its own pooled
+    // read-only connection. The caller must be in a Transaction, so that no other connection
+    // can save a doc during the scan and every reader sees the same snapshot.
+    unordered_set<string> Database::collectBlobs() {
+        static constexpr sequence_t kMinSequencesPerThread = 1000;
+
+        sequence_t lastSeq = defaultKeyStore().lastSequence();
+        unsigned nThreads = dataFile()->options().readerPoolSize;
+        if (nThreads == 0)
+            nThreads = DataFile::kDefaultReaderPoolSize;
+        nThreads = min(nThreads, max(thread::hardware_concurrency(), 1u));
+        nThreads = (unsigned)min(sequence_t(nThreads), lastSeq / kMinSequencesPerThread + 1);
+
+        vector<unordered_set<string>> results(nThreads);
+        vector<thread> threads;
+        mutex errorMutex;
+        exception_ptr error;
+        sequence_t rangeSize = lastSeq / nThreads + 1;
+        for (unsigned i = 0; i < nThreads; ++i) {
+            // The last range is open-ended, in case lastSequence is behind what's on disk:
+            sequence_t after = i * rangeSize;
+            sequence_t last = (i + 1 < nThreads) ? after + rangeSize : UINT64_MAX;
+            threads.emplace_back([&, i, after, last] {
+                try {
+                    dataFile()->useReader([&](DataFile *reader) {
+                        collectBlobsInRange(reader->defaultKeyStore(), after, last, results[i]);
+                    });
+                } catch (...) {
+                    lock_guard<mutex> lock(errorMutex);
+                    if (!error)
+                        error = current_exception();
                 }
-            } while(doc->selectNextRevision());
+            });
         }
-        
+        for (auto &t : threads)
+            t.join();
+        if (error)
+            rethrow_exception(error);
+
+        unordered_set<string> usedDigests = move(results[0]);
+        for (unsigned i = 1; i < nThreads; ++i)
+            usedDigests.insert(results[i].begin(), results[i].end());
         return usedDigests;
     }
 
     void Database::compact() {
         mustNotBeInTransaction();
         dataFile()->compact();
+
+        // The readers scanning for blobs are read-only, so create the indexes they use first:
+        RecordEnumerator::Options options;
+        options.onlyBlobs = true;
+        defaultKeyStore().createEnumeratorIndexes(true, options);
+
+        // Hold a transaction from the scan through the deletion, so no doc can be saved in
+        // between; otherwise a doc saved during the scan could lose its blobs:
+        Transaction t(dataFile());
         unordered_set<string> digestsInUse = collectBlobs();
         blobStore()->deleteAllExcept(digestsInUse);
+        t.abort();
     }
 
 
@@ -306,6 +376,7 @@ namespace c4Internal {
             newKey = &keyBuf;
 
         mustNotBeInTransaction();
+        bool housekeeping = _housekeepingStarted, buildingIndexes = (_housekeeper != nullptr);
         closeBackgroundDatabase();
 
         // Create a new BlobStore and copy/rekey the blobs into it:
@@ -328,6 +399,11 @@ namespace c4Internal {
         // Finally replace the old BlobStore with the new one:
         newStore->moveTo(*realBlobStore);
         _dataFile->_logInfo("Finished rekeying database!");
+
+        if (housekeeping)
+            startHousekeeping();
+        else if (buildingIndexes)
+            buildIndexesInBackground();
     }
 
 
@@ -335,6 +411,8 @@ namespace c4Internal {
 
 
     slice Database::fleeceAccessor(slice recordBody) const {
+        if (_dataFile->options().splitBodies)
+            return recordBody;      // body column holds only the current revision's Fleece data
         return TreeDocumentFactory::fleeceAccessor(recordBody);
     }
 
@@ -401,6 +479,8 @@ namespace c4Internal {
         if (options.encryptionAlgorithm != kNoEncryption) {
             options.encryptionKey = alloc_slice(encryptionKey.bytes, sizeof(encryptionKey.bytes));
         }
+        // Compressed blobs make the database unreadable by older versions:
+        options.willStoreCompressedBlob = [this] {_dataFile->willStoreCompressedBlobs();};
         return make_unique<BlobStore>(blobStorePath, &options);
     }
 
@@ -420,6 +500,7 @@ namespace c4Internal {
 
 
     void Database::closeBackgroundDatabase() {
+        stopHousekeeping();
         if (_backgroundDB) {
             _backgroundDB->close();
             _backgroundDB = nullptr;
@@ -505,6 +586,7 @@ namespace c4Internal {
             error::_throw(error::NotInTransaction);
         if (--_transactionLevel == 0) {
             auto t = _transaction;
+            Stopwatch st;
             try {
                 if (commit)
                     t->commit();
@@ -515,6 +597,8 @@ namespace c4Internal {
                 throw;
             }
             _cleanupTransaction(commit);
+            if (commit)
+                _dataFile->stats().commitTime.record(st.elapsed());
         }
     }
 
@@ -662,4 +746,36 @@ namespace c4Internal {
         return _dataFile->defaultKeyStore().expireRecords(_sequenceTracker ? cb : nullptr);
     }
 
+
+    void Database::startHousekeeping() {
+        if (!_housekeepingStarted) {
+            if (!_housekeeper)
+                _housekeeper = new Housekeeper(this);
+            _housekeeper->start();
+            _housekeepingStarted = true;
+        }
+    }
+
+
+    void Database::stopHousekeeping() {
+        if (_housekeeper) {
+            _housekeeper->stop();
+            _housekeeper = nullptr;
+        }
+        _housekeepingStarted = false;
+    }
+
+
+    void Database::buildIndexesInBackground() {
+        if (!_housekeeper)
+            _housekeeper = new Housekeeper(this);
+        _housekeeper->buildIndexes();
+    }
+
+
+    void Database::documentExpirationChanged(expiration_t exp) {
+        if (_housekeepingStarted)
+            _housekeeper->documentExpirationChanged(exp);
+    }
+
 }
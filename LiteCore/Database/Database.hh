@@ -38,6 +38,7 @@ namespace litecore {
     class SequenceTracker;
     class BlobStore;
     class BackgroundDB;
+    class Housekeeper;
 }
 
 
@@ -93,6 +94,13 @@ namespace c4Internal {
         bool purgeDocument(slice docID);
         int64_t purgeExpiredDocs();
 
+        /** Starts purging expired documents automatically in the background. */
+        void startHousekeeping();
+        void stopHousekeeping();
+        /** Indexes existing documents for indexes created with the `background` option. */
+        void buildIndexesInBackground();
+        void documentExpirationChanged(expiration_t);
+
 #if DEBUG
         void validateRevisionBody(slice body);
 #else
@@ -153,6 +161,8 @@ namespace c4Internal {
         uint32_t                    _maxRevTreeDepth {0};   // Max revision-tree depth
         recursive_mutex             _clientMutex;           // Mutex for c4db_lock/unlock
         unique_ptr<BackgroundDB>    _backgroundDB;          // for background operations
+        Retained<Housekeeper>       _housekeeper;           // for expiring docs & building indexes
+        bool                        _housekeepingStarted {false}; // Is doc expiration running?
     };
 
 
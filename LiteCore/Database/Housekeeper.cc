@@ -0,0 +1,150 @@
+//
+// Housekeeper.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+
+#include "Housekeeper.hh"
+#include "BackgroundDB.hh"
+#include "DataFile.hh"
+#include "Database.hh"
+#include "KeyStore.hh"
+#include "SequenceTracker.hh"
+#include <algorithm>
+
+namespace litecore {
+    using namespace actor;
+    using namespace std;
+
+
+    // Max number of docs to purge in one transaction.
+    static constexpr unsigned kExpirationBatchSize = 1000;
+
+    // How long to pause between batches, to give other writers a chance at the database.
+    static constexpr delay_t kExpirationBatchPause = chrono::milliseconds(10);
+
+    // How long to wait before retrying after a batch fails; doubled after each further failure.
+    static constexpr delay_t kExpirationRetryDelay = chrono::seconds(1);
+    static constexpr delay_t kMaxExpirationRetryDelay = chrono::minutes(5);
+
+    // Max number of sequences to index in one transaction.
+    static constexpr sequence_t kIndexBatchSize = 1000;
+
+    // How long to pause between index batches.
+    static constexpr delay_t kIndexBatchPause = chrono::milliseconds(10);
+
+
+    Housekeeper::Housekeeper(c4Internal::Database *db)
+    :Logging(DBLog)
+    ,_bgdb(db->backgroundDatabase())
+    ,_expiryTimer([this]{ enqueue(&Housekeeper::_doExpiration); })
+    { }
+
+
+    void Housekeeper::_stop() {
+        _expiryTimer.stop();
+        _scheduledTime = 0;
+        _stopped = true;
+        logInfo("Stopped");
+    }
+
+
+    // Sets the timer for the next time a doc will expire.
+    void Housekeeper::_scheduleExpiration() {
+        if (_stopped)
+            return;
+        expiration_t next = 0;
+        _bgdb->use([&](DataFile *dataFile) {
+            next = dataFile->defaultKeyStore().nextExpiration();
+        });
+        if (next > 0)
+            scheduleAt(next);
+        else
+            logVerbose("No documents are set to expire");
+    }
+
+
+    void Housekeeper::_documentExpirationChanged(expiration_t exp) {
+        if (!_stopped && exp > 0 && (_scheduledTime == 0 || exp < _scheduledTime))
+            scheduleAt(exp);
+    }
+
+
+    void Housekeeper::scheduleAt(expiration_t exp) {
+        _scheduledTime = exp;
+        expiration_t delay = max(exp - KeyStore::now(), expiration_t(0));
+        logVerbose("Next expiration is in %lld ms", (long long)delay);
+        _expiryTimer.fireAfter(chrono::milliseconds(delay));
+    }
+
+
+    // Purges one batch of expired docs, then either schedules the next batch or, if there are
+    // no more to purge, sets the timer for the next expiration time.
+    void Housekeeper::_doExpiration() {
+        if (_stopped)
+            return;
+        _scheduledTime = 0;
+        unsigned expired = 0;
+        try {
+            _bgdb->useInTransaction([&](DataFile *dataFile, SequenceTracker *sequenceTracker) {
+                expired = dataFile->defaultKeyStore().expireRecords([&](slice docID) {
+                    sequenceTracker->documentPurged(docID);
+                }, kExpirationBatchSize);
+                return expired > 0;
+            });
+        } catch (const exception &x) {
+            _expirationRetryDelay = (_expirationRetryDelay == delay_t::zero())
+                                        ? kExpirationRetryDelay
+                                        : min(delay_t(2 * _expirationRetryDelay),
+                                              kMaxExpirationRetryDelay);
+            logError("Failed to purge expired documents: %s; retrying in %.0f sec",
+                     x.what(), chrono::duration<double>(_expirationRetryDelay).count());
+            enqueueAfter(_expirationRetryDelay, &Housekeeper::_doExpiration);
+            return;
+        }
+        _expirationRetryDelay = delay_t::zero();
+
+        if (expired == kExpirationBatchSize) {
+            logVerbose("Purged %u expired docs; pausing before the next batch", expired);
+            enqueueAfter(kExpirationBatchPause, &Housekeeper::_doExpiration);
+        } else {
+            _scheduleExpiration();
+        }
+    }
+
+
+    void Housekeeper::_startBuildingIndexes() {
+        if (_stopped || _buildingIndexes)
+            return;
+        _buildingIndexes = true;
+        _buildIndexes();
+    }
+
+
+    // Indexes one batch of existing docs for the indexes being built in the background, then
+    // schedules the next batch if there's more to do.
+    void Housekeeper::_buildIndexes() {
+        if (_stopped)
+            return;
+        sequence_t indexed = 0;
+        try {
+            _bgdb->useInTransaction([&](DataFile *dataFile, SequenceTracker*) {
+                indexed = dataFile->defaultKeyStore().buildIndexes(kIndexBatchSize);
+                return indexed > 0;
+            });
+        } catch (const exception &x) {
+            logError("Failed to build index: %s", x.what());
+            _buildingIndexes = false;
+            return;
+        }
+
+        if (indexed > 0) {
+            logVerbose("Indexed %llu sequences; pausing before the next batch",
+                       (unsigned long long)indexed);
+            enqueueAfter(kIndexBatchPause, &Housekeeper::_buildIndexes);
+        } else {
+            _buildingIndexes = false;
+        }
+    }
+
+}
@@ -0,0 +1,68 @@
+//
+// Housekeeper.hh
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+
+#pragma once
+#include "Actor.hh"
+#include "Timer.hh"
+#include "Logging.hh"
+#include "Record.hh"
+
+namespace c4Internal {
+    class Database;
+}
+
+namespace litecore {
+    class BackgroundDB;
+
+
+    /** Purges expired documents in the background. It keeps a timer set for the next
+        expiration time; when that arrives, it purges the expired docs on the BackgroundDB in
+        batches, each in its own short transaction, pausing between batches so that foreground
+        writers aren't locked out. Database observers are notified of the purges as usual.
+        It also builds indexes that were created with the `background` option, in the same way. */
+    class Housekeeper : public actor::Actor, Logging {
+    public:
+        explicit Housekeeper(c4Internal::Database* NONNULL);
+
+        /** Starts purging expired documents, and resumes any unfinished index builds. */
+        void start() {
+            enqueue(&Housekeeper::_scheduleExpiration);
+            buildIndexes();
+        }
+
+        void stop()                             {enqueue(&Housekeeper::_stop); waitTillCaughtUp();}
+
+        /** Call this when a document's expiration time is set, in case it's earlier than the
+            one the Housekeeper is waiting for. */
+        void documentExpirationChanged(expiration_t exp) {
+            enqueue(&Housekeeper::_documentExpirationChanged, exp);
+        }
+
+        /** Call this after creating an index with the `background` option, to index the
+            existing documents. Does nothing if the indexes are already being built. */
+        void buildIndexes()                     {enqueue(&Housekeeper::_startBuildingIndexes);}
+
+    protected:
+        virtual ~Housekeeper() =default;
+
+    private:
+        void _scheduleExpiration();
+        void _documentExpirationChanged(expiration_t);
+        void _doExpiration();
+        void _startBuildingIndexes();
+        void _buildIndexes();
+        void _stop();
+        void scheduleAt(expiration_t);
+
+        BackgroundDB* const _bgdb;
+        actor::Timer _expiryTimer;
+        expiration_t _scheduledTime {0};        // Time the timer is set for, or 0 if not set
+        actor::delay_t _expirationRetryDelay {}; // Delay before retrying a failed batch, or 0
+        bool _buildingIndexes {false};          // True while a series of index batches runs
+        bool _stopped {false};
+    };
+
+}
@@ -34,7 +34,6 @@ namespace litecore {
                                          Delegate *delegate)
     :Logging(QueryLog)
     ,_database(db)
-    ,_backgroundDB(db->backgroundDatabase())
     ,_expression(query->expression())
     ,_language(query->language())
     ,_continuous(continuous)
@@ -45,7 +44,7 @@ namespace litecore {
 
 
     LiveQuerier::~LiveQuerier() {
-        if (_query || _dbNotifier)
+        if (_dbNotifier)
             _stop();
     }
 
@@ -56,23 +55,87 @@ namespace litecore {
     }
 
 
+    // Max number of changed docs to check individually, before just re-running the query.
+    static constexpr size_t kMaxChangedDocsToCheck = 100;
+
+
+    // Calls `fn` with a pooled reader if one is free. Otherwise, rather than blocking this
+    // actor's thread until one is returned, uses the BackgroundDB. (Not the database's own
+    // connection, which belongs to the app's threads.)
+    void LiveQuerier::useReader(function_ref<void(DataFile*)> fn) {
+        DataFile::BorrowedReader reader(*_database->dataFile(), false);
+        if (reader) {
+            fn(reader.get());
+        } else {
+            logVerbose("No pooled reader is free; using the background database");
+            _database->backgroundDatabase()->use([&](DataFile *df) {
+                ReadOnlyTransaction t(df);
+                fn(df);
+            });
+        }
+    }
+
+
     // Runs the query.
     void LiveQuerier::_run(Query::Options options) {
+        if (_dbNotifier) {
+            lock_guard<mutex> lock(_database->sequenceTracker().mutex());
+            collectChanges();
+        }
+
+        // If the query can check changed docs individually, first see whether any of them
+        // could affect the results; if not, there's no need to re-run the whole query.
+        // (If any could, the query is re-run in full below; previous results aren't patched.)
+        if (_currentEnumerator && _haveMatchingKeys && !_tooManyChanges) {
+            fleece::Stopwatch st;
+            bool affected = true;
+            try {
+                useReader([&](DataFile *df) {
+                    Retained<Query> query = df->defaultKeyStore().compileQuery(_expression,
+                                                                               _language);
+                    affected = changesAffectResults(query, options);
+                });
+            } catch (const std::exception &x) {
+                logError("Checking changed docs failed (%s); re-running query", x.what());
+            }
+            if (!affected) {
+                logVerbose("Results unaffected by %zu changed docs through seq %llu (%.3fms)",
+                           _changedKeys.size(), (unsigned long long)_changedSequence,
+                           st.elapsedMS());
+                _changedKeys.clear();
+                _checkedSequence = _changedSequence;
+                watchForChanges();
+                return;
+            }
+        }
+
+        // Finding the matching docs takes a second scan, so it's only done if the changes that
+        // led to this run were few; after a large batch, the next one is likely to be too large
+        // to check individually, so the next run would be a full one anyway.
+        bool findMatchingKeys = !_tooManyChanges;
+        _matchingKeys.clear();
+        _haveMatchingKeys = false;
+
         logVerbose("Running query...");
         Retained<QueryEnumerator> newQE;
         C4Error error = {};
         fleece::Stopwatch st;
-        _backgroundDB->use([&](DataFile *df) {
-            try {
-                // Create my own Query object associated with the Backgrounder's DataFile:
-                if (!_query) {
-                    _query = df->defaultKeyStore().compileQuery(_expression, _language);
-                    _expression = nullslice;
+        try {
+            // Run the query on a pooled reader, so other queries can run in parallel:
+            useReader([&](DataFile *df) {
+                // Get a Query object associated with the reader's DataFile. (Its translation
+                // and prepared statements come from the reader's query cache.)
+                Retained<Query> query = df->defaultKeyStore().compileQuery(_expression, _language);
+                _checkChangedDocs = _continuous && query->canCheckChangedDocs();
+                // Now run the query. If changed docs will be checked, also record which docs
+                // match it, in the same read transaction so the two are consistent:
+                newQE = query->createEnumerator(&options);
+                if (_checkChangedDocs && findMatchingKeys && newQE) {
+                    _matchingKeys = query->matchingKeys(&options);
+                    _haveMatchingKeys = true;
                 }
-                // Now run the query:
-                newQE = _query->createEnumerator(&options);
-            } catchError(&error);
-        });
+            });
+        } catchError(&error);
         auto time = st.elapsedMS();
 
         if (!newQE)
@@ -93,10 +156,31 @@ namespace litecore {
                 _currentEnumerator = newQE;
                 _delegate->liveQuerierUpdated(newQE, error);
             }
+            _checkedSequence = _changedSequence = newQE->lastSequence();
+            _changedKeys.clear();
+            _tooManyChanges = false;
         }
 
+        watchForChanges();
+    }
+
+
+    // Returns true if any of the changed docs matched the query as of its last run, or
+    // matches it now.
+    bool LiveQuerier::changesAffectResults(Query *query, const Query::Options &options) {
+        for (auto &key : _changedKeys) {
+            if (_matchingKeys.count(key) > 0)
+                return true;
+        }
+        return !_changedKeys.empty() && query->anyKeyMatches(_changedKeys, &options);
+    }
+
+
+    // Starts or re-arms the db change notifier, and triggers another run if the db has changed
+    // since the results were last checked.
+    void LiveQuerier::watchForChanges() {
         sequence_t after = _currentEnumerator ? _currentEnumerator->lastSequence() : 0;
-        sequence_t lastSequence = 0;
+        bool changed;
         {
             lock_guard<mutex> lock(_database->sequenceTracker().mutex());
             if (_dbNotifier == nullptr) {
@@ -109,26 +193,51 @@ namespace litecore {
                 logVerbose("Re-arming DB change notifier, after sequence %lld", after);
             }
 
-            // Read changes from db change notifier, so it can fire again:
-            SequenceTracker::Change changes[100];
-            bool external;
-            size_t n;
-            while ((n = _dbNotifier->readChanges(changes, 100, external)) > 0)
-                lastSequence = changes[n-1].sequence;
+            changed = collectChanges();
         }
 
-        if (lastSequence > after && _currentEnumerator) {
-            logVerbose("Hm, DB has changed to %lld already; triggering another run", lastSequence);
+        if (changed && _currentEnumerator) {
+            logVerbose("Hm, DB has changed to %lld already; triggering another run",
+                       _changedSequence);
             _dbChanged();
         }
     }
 
 
+    // Reads changes from the db change notifier, so it can fire again, and collects the docs
+    // that changed since the results were last checked. Returns true if there were any.
+    // (Must be called with the sequence tracker's mutex locked.)
+    bool LiveQuerier::collectChanges() {
+        bool changed = false;
+        SequenceTracker::Change changes[100];
+        bool external;
+        size_t n;
+        while ((n = _dbNotifier->readChanges(changes, 100, external)) > 0) {
+            for (size_t i = 0; i < n; ++i) {
+                auto &change = changes[i];
+                // (A purged doc has sequence 0)
+                if (change.sequence > _checkedSequence || change.sequence == 0) {
+                    changed = true;
+                    _changedSequence = max(_changedSequence, change.sequence);
+                    if (_checkChangedDocs && !_tooManyChanges) {
+                        _changedKeys.insert(change.docID);
+                        if (_changedKeys.size() > kMaxChangedDocsToCheck) {
+                            _tooManyChanges = true;
+                            _changedKeys.clear();
+                        }
+                    }
+                }
+            }
+        }
+        return changed;
+    }
+
+
     void LiveQuerier::_stop() {
-        _backgroundDB->use([&](DataFile *df) {
-            _query = nullptr;
-        });
         _currentEnumerator = nullptr;
+        _matchingKeys.clear();
+        _haveMatchingKeys = false;
+        _changedKeys.clear();
         lock_guard<mutex> lock(_database->sequenceTracker().mutex());
         _dbNotifier.reset();
     }
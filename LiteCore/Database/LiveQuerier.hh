@@ -16,7 +16,6 @@ namespace c4Internal {
 }
 
 namespace litecore {
-    class BackgroundDB;
     class DatabaseChangeNotifier;
 
 
@@ -43,22 +42,34 @@ namespace litecore {
     private:
         void dbChanged(DatabaseChangeNotifier&) {enqueue(&LiveQuerier::_dbChanged);}
 
+        void useReader(function_ref<void(DataFile*)>);
         void _run(Query::Options);
         void _stop();
         void _dbChanged();
+        bool changesAffectResults(Query*, const Query::Options&);
+        void watchForChanges();
+        bool collectChanges();
 
         using clock = std::chrono::steady_clock;
 
         Retained<c4Internal::Database> _database;
-        BackgroundDB* _backgroundDB;
         Delegate* _delegate;
         alloc_slice _expression;
         QueryLanguage _language;
-        Retained<Query> _query;
         bool _continuous;
         Retained<QueryEnumerator> _currentEnumerator;
         std::unique_ptr<DatabaseChangeNotifier> _dbNotifier;
         clock::time_point _lastTime;
+
+        // Skipping re-runs that can't change the results (see Query::canCheckChangedDocs).
+        // Affected results are always recomputed by re-running the whole query.
+        bool _checkChangedDocs {false};     // Can changed docs be checked individually?
+        Query::KeySet _matchingKeys;        // Docs that matched the query as of its last run
+        bool _haveMatchingKeys {false};     // Was _matchingKeys found on the last run?
+        Query::KeySet _changedKeys;         // Docs changed since the results were last checked
+        bool _tooManyChanges {false};       // Too many changed docs to check individually
+        sequence_t _checkedSequence {0};    // Results are known current through this sequence
+        sequence_t _changedSequence {0};    // Latest sequence seen in db changes
     };
 
 }
@@ -194,7 +194,8 @@ namespace litecore {
             logInfo("addExternalTransaction from %s", other.loggingIdentifier().c_str());
             for (auto e = next(other._transaction->_placeholder); e != other._changes.end(); ++e) {
                 if (!e->isPlaceholder()) {
-                    _lastSequence = e->sequence;
+                    if (e->sequence > 0)                // (purged docs have no sequence)
+                        _lastSequence = e->sequence;
                     _documentChanged(e->docID, e->revID, e->sequence, e->bodySize);
                 }
             }
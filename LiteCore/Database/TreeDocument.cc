@@ -76,6 +76,7 @@ namespace c4Internal {
         void init() {
             _versionedDoc.owner = this;
             _versionedDoc.setPruneDepth(_db->maxRevTreeDepth());
+            _versionedDoc.setDeltaBodies((_db->config.flags & kC4DB_DeltaRevBodies) != 0);
             flags = (C4DocumentFlags)_versionedDoc.flags();
             if (_versionedDoc.exists())
                 flags = (C4DocumentFlags)(flags | kDocExists);
@@ -22,6 +22,7 @@
 #include "FleeceImpl.hh"
 #include "Error.hh"
 #include <atomic>
+#include <unordered_set>
 
 namespace litecore {
     class QueryEnumerator;
@@ -66,14 +67,17 @@ namespace litecore {
             Options() { }
             
             Options(const Options &o)
-            :paramBindings(o.paramBindings), afterSequence(o.afterSequence) { }
+            :paramBindings(o.paramBindings), afterSequence(o.afterSequence)
+            ,purgeCount(o.purgeCount), streaming(o.streaming) { }
 
             template <class T>
-            Options(T bindings, sequence_t afterSeq =0, uint64_t withPurgeCount =0)
-            :paramBindings(bindings), afterSequence(afterSeq), purgeCount(withPurgeCount) { }
+            Options(T bindings, sequence_t afterSeq =0, uint64_t withPurgeCount =0,
+                    bool stream =false)
+            :paramBindings(bindings), afterSequence(afterSeq), purgeCount(withPurgeCount)
+            ,streaming(stream) { }
 
-            Options after(sequence_t afterSeq) const {return Options(paramBindings, afterSeq, purgeCount);}
-            Options withPurgeCount(uint64_t purgeCnt) const {return Options(paramBindings, afterSequence, purgeCnt);}
+            Options after(sequence_t afterSeq) const {return Options(paramBindings, afterSeq, purgeCount, streaming);}
+            Options withPurgeCount(uint64_t purgeCnt) const {return Options(paramBindings, afterSequence, purgeCnt, streaming);}
 
             bool notOlderThan(sequence_t afterSeq, uint64_t purgeCnt) const {
                 return afterSequence > 0 && afterSequence >= afterSeq && purgeCnt == purgeCount;
@@ -82,10 +86,31 @@ namespace litecore {
             alloc_slice const paramBindings;
             sequence_t const  afterSequence {0};
             uint64_t const purgeCount {0};
+            bool const streaming {false};   ///< Read rows lazily; no getRowCount or seek.
+                                            ///< Throws Busy if no pooled reader is free.
         };
 
         virtual QueryEnumerator* createEnumerator(const Options* =nullptr) =0;
 
+        //////// Checking changed documents:
+
+        using KeySet = std::unordered_set<alloc_slice, fleece::sliceHash>;
+
+        /** True if the query's results can only be affected by a change to a document that
+            matches its WHERE clause before or after the change (i.e. it has a single data source
+            and no aggregation, full-text matching or subqueries.) A LiveQuerier can then check
+            changed documents individually to decide whether it needs to re-run the query.
+            This only tells whether the results may have changed; it doesn't compute them. */
+        virtual bool canCheckChangedDocs() const noexcept               {return false;}
+
+        /** Returns the keys of all documents currently matching the WHERE clause.
+            Only supported if canCheckChangedDocs() is true. */
+        virtual KeySet matchingKeys(const Options* =nullptr)   {error::_throw(error::UnsupportedOperation);}
+
+        /** Returns true if any of the documents with these keys currently matches the WHERE
+            clause. Only supported if canCheckChangedDocs() is true. */
+        virtual bool anyKeyMatches(const KeySet&, const Options* =nullptr) {error::_throw(error::UnsupportedOperation);}
+
     protected:
         Query(KeyStore &keyStore, slice expression, QueryLanguage language);
         
@@ -113,7 +138,7 @@ namespace litecore {
         virtual uint64_t missingColumns() const noexcept =0;
         
         /** Random access to rows. May not be supported by all implementations, but does work with
-            the current SQLite query implementation. */
+            the current SQLite query implementation (unless the `streaming` option is set.) */
         virtual int64_t getRowCount() const         {return -1;}
         virtual void seek(int64_t rowIndex)         {error::_throw(error::UnsupportedOperation);}
 
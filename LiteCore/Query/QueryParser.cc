@@ -161,6 +161,10 @@ namespace litecore {
         _columnTitles.clear();
         _1stCustomResultCol = 0;
         _isAggregateQuery = _aggregatesOK = _propertiesUseSourcePrefix = _checkedExpiration = false;
+        _hasSubquery = false;
+        _fromAndWhereSQL.clear();
+        _coveringIndex = nullptr;
+        _notCovered = false;
 
         _aliases.insert({_dbAlias, kDBAlias});
     }
@@ -185,25 +189,45 @@ namespace litecore {
     
     
     void QueryParser::parse(const Value *expression) {
-        reset();
         try {
-            if (expression->asDict()) {
-                // Given a dict; assume it's the operands of a SELECT:
-                writeSelect(expression->asDict());
-            } else {
-                const Array *a = expression->asArray();
-                if (a && a->count() > 0 && a->get(0)->asString() == "SELECT"_sl) {
-                    // Given an entire SELECT statement:
-                    parseNode(expression);
-                } else {
-                    // Given some other expression; treat it as a WHERE clause of an implicit SELECT:
-                    writeSelect(expression, Dict::kEmpty);
+            parseSelect(expression);
+            if (isSingleSource() && !_checkedExpiration) {
+                // If a covering index's table has every property the query uses, query that
+                // table instead of the documents, so their bodies don't have to be read:
+                auto coveringIndexes = _delegate.coveringIndexes();
+                for (auto &index : coveringIndexes) {
+                    parseSelect(expression, &index);
+                    if (!_notCovered) {
+                        _coveringIndex = nullptr;
+                        return;
+                    }
                 }
+                if (!coveringIndexes.empty())
+                    parseSelect(expression);
             }
         } catch (const FleeceException &x) {handleFleeceException(x);}
     }
 
 
+    void QueryParser::parseSelect(const Value *expression, const CoveringIndex *coveringIndex) {
+        reset();
+        _coveringIndex = coveringIndex;
+        if (expression->asDict()) {
+            // Given a dict; assume it's the operands of a SELECT:
+            writeSelect(expression->asDict());
+        } else {
+            const Array *a = expression->asArray();
+            if (a && a->count() > 0 && a->get(0)->asString() == "SELECT"_sl) {
+                // Given an entire SELECT statement:
+                parseNode(expression);
+            } else {
+                // Given some other expression; treat it as a WHERE clause of an implicit SELECT:
+                writeSelect(expression, Dict::kEmpty);
+            }
+        }
+    }
+
+
     void QueryParser::parseJustExpression(const Value *expression) {
         reset();
         try {
@@ -263,10 +287,12 @@ namespace litecore {
         }
 
         // FROM clause:
+        auto startPosOfFrom = _sql.tellp();
         writeFromClause(from);
 
         // WHERE clause:
         writeWhereClause(where);
+        _fromAndWhereSQL = _sql.str().substr((size_t)startPosOfFrom);
 
         // GROUP_BY clause:
         bool grouped = (writeSelectListClause(operands, "GROUP_BY"_sl, " GROUP BY ") > 0);
@@ -336,6 +362,17 @@ namespace litecore {
     }
 
 
+    bool QueryParser::isSingleSource() const {
+        if (_isAggregateQuery || _hasSubquery || !_ftsTables.empty() || !_indexJoinTables.empty())
+            return false;
+        for (auto &alias : _aliases) {
+            if (alias.second != kDBAlias && alias.second != kResultAlias)
+                return false;
+        }
+        return !_fromAndWhereSQL.empty();
+    }
+
+
     void QueryParser::writeWhereClause(const Value *where) {
         _checkedDeleted = false;
         _sql << " WHERE ";
@@ -450,7 +487,10 @@ namespace litecore {
     void QueryParser::writeFromClause(const Value *from) {
         auto fromArray = (const Array*)from;    // already type-checked by parseFromClause
 
-        _sql << " FROM " << _tableName;
+        if (_coveringIndex)
+            _sql << " FROM " << quoteTableName(_coveringIndex->tableName);
+        else
+            _sql << " FROM " << _tableName;
 
         if (fromArray && !fromArray->empty()) {
             for (Array::iterator i(fromArray); i; ++i) {
@@ -1053,6 +1093,7 @@ namespace litecore {
             writeSelect(dict);
         } else {
             // Nested SELECT; use a fresh parser
+            _hasSubquery = true;
             QueryParser nested(this);
             nested.parse(dict);
             _sql << nested.SQL();
@@ -1322,6 +1363,17 @@ namespace litecore {
             }
         }
 
+        if (_coveringIndex) {
+            // A plain property value can be read from its column in the covering index's table;
+            // anything else needs the document body, which that table doesn't have.
+            string column = "." + string(property);
+            if (fn == kValueFnName && !param && _coveringIndex->columns.count(column) > 0) {
+                _sql << tablePrefix << '"' << column << '"';
+                return;
+            }
+            _notCovered = true;
+        }
+
         // It's more efficent to get the doc root with fl_root than with fl_value:
         if (property.empty() && fn == kValueFnName)
             fn = kRootFnName;
@@ -1475,6 +1527,17 @@ namespace litecore {
 
 
 
+    // Returns the name of a covering index table's column that holds the value of an index
+    // expression, or an empty string if the expression isn't a plain property.
+    string QueryParser::coveringColumnName(const Value *expression) {
+        string property(propertyFromNode(expression));
+        if (property.empty() || property.find('"') != string::npos)
+            return "";
+        return "." + property;      // the '.' keeps it distinct from the key/sequence/flags columns
+    }
+
+
+
 #pragma mark - UNNEST QUERY:
 
 
@@ -37,6 +37,14 @@ namespace litecore {
 
     class QueryParser {
     public:
+        /** A covering value index's table, which holds the values of the index's properties for
+            every document. It can stand in for the documents table in a query that uses no
+            other properties. */
+        struct CoveringIndex {
+            std::string tableName;
+            std::set<std::string> columns;      // Column names, from coveringColumnName()
+        };
+
         /** Delegate knows about the naming & existence of tables. */
         class delegate {
         public:
@@ -49,6 +57,7 @@ namespace litecore {
             virtual std::string predictiveTableName(const std::string &property) const =0;
 #endif
             virtual bool tableExists(const std::string &tableName) const =0;
+            virtual std::vector<CoveringIndex> coveringIndexes() const  {return {};}
         };
 
         QueryParser(const delegate &delegate)
@@ -79,10 +88,18 @@ namespace litecore {
         bool isAggregateQuery() const                               {return _isAggregateQuery;}
         bool usesExpiration() const                                 {return _checkedExpiration;}
 
+        /** True if the query reads only the documents table, without joins, UNNEST, full-text,
+            indexed predictions, subqueries or aggregation. Each result row of such a query
+            depends only on a single document that matches the WHERE clause. */
+        bool isSingleSource() const;
+        /** The query's FROM and WHERE clauses, for selecting the matching documents. */
+        const std::string& fromAndWhereSQL() const                  {return _fromAndWhereSQL;}
+
         std::string expressionSQL(const fleece::impl::Value*);
         std::string eachExpressionSQL(const fleece::impl::Value*);
         std::string FTSExpressionSQL(const fleece::impl::Value*);
         static std::string FTSColumnName(const fleece::impl::Value *expression);
+        static std::string coveringColumnName(const fleece::impl::Value *expression);
         std::string unnestedTableName(const fleece::impl::Value *key) const;
         std::string predictiveIdentifier(const fleece::impl::Value *) const;
         std::string predictiveTableName(const fleece::impl::Value *) const;
@@ -119,6 +136,7 @@ namespace litecore {
         QueryParser& operator=(const QueryParser&) =delete;
 
         void reset();
+        void parseSelect(const fleece::impl::Value*, const CoveringIndex* =nullptr);
         void parseNode(const fleece::impl::Value*);
         void parseOpNode(const fleece::impl::Array*);
         void handleOperation(const Operation*, slice actualOperator, fleece::impl::Array::iterator& operands);
@@ -212,6 +230,10 @@ namespace litecore {
         bool _isAggregateQuery {false};             // Is this an aggregate query?
         bool _checkedDeleted {false};               // Has query accessed _deleted meta-property?
         bool _checkedExpiration {false};            // Has query accessed _expiration meta-property?
+        bool _hasSubquery {false};                  // Does the query contain a nested SELECT?
+        std::string _fromAndWhereSQL;               // SQL of FROM and WHERE clauses
+        const CoveringIndex* _coveringIndex {nullptr}; // Index table to read instead of docs
+        bool _notCovered {false};                   // Did query use props not in _coveringIndex?
         Collation _collation;                       // Collation in use during parse
         bool _collationUsed {true};                 // Emitted SQL "COLLATION" yet?
         bool _functionWantsCollation {false};       // The current function wants to receive collation in its argument list
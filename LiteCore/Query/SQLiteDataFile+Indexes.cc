@@ -18,6 +18,7 @@
 
 #include "SQLiteDataFile.hh"
 #include "SQLiteKeyStore.hh"
+#include "SQLiteQueryCache.hh"
 #include "SQLite_Internal.hh"
 #include "Error.hh"
 #include "Logging.hh"
@@ -66,7 +67,7 @@ namespace litecore {
         stmt.bind(      2, spec.type);
         stmt.bindNoCopy(3, keyStoreName);
         stmt.bindNoCopy(4, (char*)spec.expressionJSON.buf, (int)spec.expressionJSON.size);
-        if (spec.type != KeyStore::kValueIndex)
+        if (!indexTableName.empty())
             stmt.bindNoCopy(5, indexTableName);
         LogStatement(stmt);
         stmt.exec();
@@ -82,6 +83,15 @@ namespace litecore {
     }
 
 
+    // Called when the indexes change, since that affects the QueryParser's translation. Clears
+    // this connection's query cache now, and other connections' when the transaction ends.
+    void SQLiteDataFile::indexesChanged() {
+        Assert(inTransaction());
+        queryCache().clear();
+        _indexesChanged = true;
+    }
+
+
 #pragma mark - CREATING INDEXES:
 
 
@@ -95,10 +105,18 @@ namespace litecore {
         if (existingSpec) {
             if (existingSpec.type == spec.type && existingSpec.keyStoreName == keyStore->name()) {
                 bool same;
-                if (spec.type == KeyStore::kFullTextIndex)
+                if (spec.type == KeyStore::kFullTextIndex) {
                     same = schemaExistsWithSQL(indexTableName, "table", indexTableName, indexSQL);
-                else
+                } else if (spec.type == KeyStore::kValueIndex) {
+                    // (A covering value index's table isn't the one the SQL index is on, and
+                    // the index's SQL doesn't show which properties it includes.)
+                    same = schemaExistsWithSQL(spec.name, "index", keyStore->tableName(), indexSQL)
+                        && existingSpec.indexTableName == indexTableName
+                        && (indexTableName.empty()
+                                || existingSpec.expressionJSON == spec.expressionJSON);
+                } else {
                     same = schemaExistsWithSQL(spec.name, "index", indexTableName, indexSQL);
+                }
                 if (same)
                     return false;       // This is a duplicate of an existing index; do nothing
             }
@@ -109,6 +127,7 @@ namespace litecore {
               KeyStore::kIndexTypeName[spec.type], spec.name.c_str());
         exec(indexSQL);
         registerIndex(spec, keyStore->name(), indexTableName);
+        indexesChanged();           // Cached queries may have been translated without the index
         return true;
     }
 
@@ -125,6 +144,7 @@ namespace litecore {
             exec(CONCAT("DROP INDEX IF EXISTS \"" << spec.name << "\""));
         if (!spec.indexTableName.empty())
             garbageCollectIndexTable(spec.indexTableName);
+        indexesChanged();           // Cached queries may refer to the index's table
     }
 
 
@@ -139,6 +159,7 @@ namespace litecore {
 
         LogTo(QueryLog, "Dropping unused index table '%s'", tableName.c_str());
         exec(CONCAT("DROP TABLE \"" << tableName << "\""));
+        unregisterIndexBuild(tableName);
 
         stringstream sql;
         static const char* kTriggerSuffixes[] = {"ins", "del", "upd", "preupdate", "postupdate",
@@ -150,6 +171,143 @@ namespace litecore {
     }
 
 
+#pragma mark - BACKGROUND INDEX BUILDS:
+
+
+    /*
+     An index table created with the `background` option starts out empty; its triggers keep it
+     up to date with new changes, but the records that already existed are indexed later, a range
+     of sequences at a time, by continueIndexBuild(). The 'indexBuilds' table has a row for each
+     index table that's still being built:
+        - tableName (string primary key)
+        - keyStore (string)
+        - sequence: the high-water mark; records up to this sequence have been indexed
+        - lastSequence: the KeyStore's last sequence when the index was created
+        - sql: an INSERT statement that indexes the records in a sequence range, given as the
+            parameters ?1 (exclusive) and ?2 (inclusive)
+        - finishSQL: statements to run once the table is built, e.g. to replace triggers that
+            had to allow for records not yet indexed (may be empty)
+     Any record with a sequence above `lastSequence` was written after the triggers were created.
+     */
+
+
+    bool SQLiteDataFile::indexBuildTableExists() const {
+        return tableExists("indexBuilds");
+    }
+
+
+    void SQLiteDataFile::registerIndexBuild(const string &indexTableName,
+                                            const string &keyStoreName,
+                                            sequence_t lastSequence,
+                                            const string &populateSQL,
+                                            const string &finishSQL)
+    {
+        Assert(inTransaction());
+        if (!indexBuildTableExists())
+            _exec("CREATE TABLE indexBuilds (tableName TEXT PRIMARY KEY, keyStore TEXT NOT NULL,"
+                  " sequence INTEGER NOT NULL, lastSequence INTEGER NOT NULL, sql TEXT NOT NULL,"
+                  " finishSQL TEXT NOT NULL)");
+        SQLite::Statement stmt(*this, "INSERT OR REPLACE INTO indexBuilds "
+                                      "(tableName, keyStore, sequence, lastSequence, sql, finishSQL) "
+                                      "VALUES (?, ?, 0, ?, ?, ?)");
+        stmt.bindNoCopy(1, indexTableName);
+        stmt.bindNoCopy(2, keyStoreName);
+        stmt.bind(      3, (long long)lastSequence);
+        stmt.bindNoCopy(4, populateSQL);
+        stmt.bindNoCopy(5, finishSQL);
+        LogStatement(stmt);
+        stmt.exec();
+        LogTo(QueryLog, "Index table '%s' will be built in the background (%llu sequences)",
+              indexTableName.c_str(), (unsigned long long)lastSequence);
+    }
+
+
+    void SQLiteDataFile::unregisterIndexBuild(const string &indexTableName) {
+        if (!indexBuildTableExists())
+            return;
+        SQLite::Statement stmt(*this, "DELETE FROM indexBuilds WHERE tableName=?");
+        stmt.bindNoCopy(1, indexTableName);
+        LogStatement(stmt);
+        stmt.exec();
+    }
+
+
+    bool SQLiteDataFile::getIndexBuild(const string &indexTableName,
+                                       sequence_t &outSequence, sequence_t &outLastSequence) const
+    {
+        if (!indexBuildTableExists())
+            return false;
+        SQLite::Statement stmt(*_sqlDb, "SELECT sequence, lastSequence FROM indexBuilds "
+                                        "WHERE tableName=?");
+        stmt.bindNoCopy(1, indexTableName);
+        if (!stmt.executeStep())
+            return false;
+        outSequence = (int64_t)stmt.getColumn(0);
+        outLastSequence = (int64_t)stmt.getColumn(1);
+        return true;
+    }
+
+
+    bool SQLiteDataFile::indexTableIsBuilding(const string &indexTableName) const {
+        sequence_t sequence, lastSequence;
+        return getIndexBuild(indexTableName, sequence, lastSequence);
+    }
+
+
+    // Indexes the next range of existing records for one of a KeyStore's index tables that are
+    // being built, and advances its high-water mark; when it's complete, removes it from
+    // 'indexBuilds' so queries can start using it. Returns the number of sequences covered.
+    sequence_t SQLiteDataFile::continueIndexBuild(const string &keyStoreName, sequence_t limit) {
+        Assert(inTransaction());
+        if (!indexBuildTableExists())
+            return 0;
+        string tableName, sql, finishSQL;
+        sequence_t sequence, lastSequence;
+        {
+            SQLite::Statement stmt(*this, "SELECT tableName, sequence, lastSequence, sql, finishSQL "
+                                          "FROM indexBuilds WHERE keyStore=? "
+                                          "ORDER BY tableName LIMIT 1");
+            stmt.bindNoCopy(1, keyStoreName);
+            if (!stmt.executeStep())
+                return 0;
+            tableName = stmt.getColumn(0).getString();
+            sequence = (int64_t)stmt.getColumn(1);
+            lastSequence = (int64_t)stmt.getColumn(2);
+            sql = stmt.getColumn(3).getString();
+            finishSQL = stmt.getColumn(4).getString();
+        }
+
+        sequence_t endSequence = lastSequence;
+        if (limit > 0 && limit < lastSequence - sequence)
+            endSequence = sequence + limit;
+        {
+            SQLite::Statement populate(*this, sql);
+            populate.bind(1, (long long)sequence);
+            populate.bind(2, (long long)endSequence);
+            LogStatement(populate);
+            populate.exec();
+        }
+
+        if (endSequence < lastSequence) {
+            SQLite::Statement stmt(*this, "UPDATE indexBuilds SET sequence=? WHERE tableName=?");
+            stmt.bind(      1, (long long)endSequence);
+            stmt.bindNoCopy(2, tableName);
+            LogStatement(stmt);
+            stmt.exec();
+            LogVerbose(QueryLog, "Built index table '%s' through sequence %llu of %llu",
+                       tableName.c_str(), (unsigned long long)endSequence,
+                       (unsigned long long)lastSequence);
+        } else {
+            if (!finishSQL.empty())
+                exec(finishSQL);
+            unregisterIndexBuild(tableName);
+            indexesChanged();           // Cached queries were translated without the index table
+            LogTo(QueryLog, "Finished building index table '%s'", tableName.c_str());
+        }
+        return endSequence - sequence;
+    }
+
+
 #pragma mark - GETTING INDEX INFO:
 
 
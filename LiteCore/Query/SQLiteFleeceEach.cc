@@ -221,9 +221,18 @@ private:
             Warn("fleece_each filter called with null document! Query is likely to fail. (#379)");
             return SQLITE_OK;
         }
+        alloc_slice decompressed;
+        if (_vtab->context.compressedBodies) {
+            try {
+                data = decompressBody(_vtab->context, data, decompressed);
+            } catch (const std::exception &) {
+                Warn("Invalid compressed body in SQLite table");
+                return SQLITE_CORRUPT;
+            }
+        }
         data = _vtab->context.delegate->fleeceAccessor(data);
 
-        if (size_t(data.buf) & 1) {
+        if (decompressed || (size_t(data.buf) & 1)) {
             // Fleece data at odd addresses used to be allowed, and CBL 2.0/2.1 didn't 16-bit-align
             // revision data, so it could occur. Now that it's not allowed, we have to work around
             // this by copying the data to an even address. (#787)
@@ -41,7 +41,16 @@ namespace litecore {
         if (body) {
             DebugAssert(sqlite3_value_type(argv[0]) == SQLITE_BLOB);
             DebugAssert(sqlite3_value_subtype(argv[0]) == 0);
-            setResultBlobFromFleeceData(ctx, fleeceAccessor(ctx, body));
+            try {
+                alloc_slice decompressed;
+                slice fleece = fleeceAccessor(ctx, body, decompressed);
+                if (decompressed)
+                    setResultBlobFromFleeceData(ctx, alloc_slice(fleece));
+                else
+                    setResultBlobFromFleeceData(ctx, fleece);
+            } catch (const std::exception &) {
+                sqlite3_result_error(ctx, "fl_root: exception!", -1);
+            }
             return;
         }
         // If arg isn't a blob, check if it's a tagged Fleece pointer:
@@ -225,7 +234,13 @@ namespace litecore {
                         break;
                     }
                     case 0:
-                        sqlite3_result_value(ctx, arg);
+                        if (sqlite3_value_bytes(arg) == 0) {
+                            // A JSON null that lost its subtype by being stored in a table
+                            // (a covering index's); it can't be Fleece data, which is never empty.
+                            setResultBlobFromEncodedValue(ctx, Value::kNullValue);
+                        } else {
+                            sqlite3_result_value(ctx, arg);
+                        }
                         break;
                     case kPlainBlobSubtype: {
                         // A plain blob/data value has to be wrapped in a Fleece container to avoid
@@ -42,7 +42,10 @@ namespace litecore {
             return nullslice;             // No 'body' column; may be deleted doc
         Assert(type == SQLITE_BLOB);
         Assert(sqlite3_value_subtype(arg) == 0);
-        slice fleece = fleeceAccessor(ctx, valueAsSlice(arg));
+        // A decompressed body stays in the connection's cache until another body is
+        // decompressed, which can't happen during this function call, so it needn't be copied.
+        alloc_slice decompressed;
+        slice fleece = fleeceAccessor(ctx, valueAsSlice(arg), decompressed);
 
         if (size_t(fleece.buf) & 1) {
             // Fleece data at odd addresses used to be allowed, and CBL 2.0/2.1 didn't 16-bit-align
@@ -275,8 +278,9 @@ namespace litecore {
         RegisterFleeceEachFunctions(db, context);
 
         // The functions registered below operate on virtual tables, not on the actual db,
-        // so they should not use the db's Fleece accessor. That's why we clear it first.
+        // so they should not use the db's Fleece accessor or decompress. That's why we clear those.
         context.delegate = nullptr;
+        context.compressedBodies = false;
         registerFunctionSpecs(db, context, kFleeceNullAccessorFunctionsSpec);
     }
 
@@ -20,6 +20,7 @@
 #include "Base.hh"
 #include "DataFile.hh"
 #include "SQLite_Internal.hh"
+#include "Compression.hh"
 #include "FleeceImpl.hh"
 #include <sqlite3.h>
 
@@ -56,9 +57,31 @@ namespace litecore {
         return ((fleeceFuncContext*)sqlite3_user_data(ctx))->delegate;
     }
 
-    static inline slice fleeceAccessor(sqlite3_context *ctx, slice body) {
-        auto delegate = getDBDelegate(ctx);
-        return delegate ? delegate->fleeceAccessor(body) : body;
+    // Decompresses a document body, reusing the connection's last result if it's the same body.
+    // If it was compressed, `buffer` owns the result. May throw.
+    static inline slice decompressBody(const fleeceFuncContext &context, slice stored,
+                                       alloc_slice &buffer)
+    {
+        DecompressedBodyCache &cache = *context.bodyCache;
+        if (cache.body && stored == cache.stored) {
+            buffer = cache.body;
+            return buffer;
+        }
+        slice body = DecompressBody(stored, buffer);
+        if (buffer) {
+            cache.stored = alloc_slice(stored);
+            cache.body = buffer;
+        }
+        return body;
+    }
+
+    // Returns the Fleece data in a document body. If the database compresses bodies, the body is
+    // decompressed into `buffer` first, and the result points into that. May throw.
+    static inline slice fleeceAccessor(sqlite3_context *ctx, slice body, alloc_slice &buffer) {
+        auto context = (fleeceFuncContext*)sqlite3_user_data(ctx);
+        if (context->compressedBodies)
+            body = decompressBody(*context, body, buffer);
+        return context->delegate ? context->delegate->fleeceAccessor(body) : body;
     }
 
     // Returns the data of a SQLite blob value as a slice
@@ -60,10 +60,12 @@ namespace litecore {
             string eachExpr = qp.eachExpressionSQL(expression);
 
             // Populate the index-table with data from existing documents:
-            db().exec(CONCAT("INSERT INTO \"" << unnestTableName << "\" (docid, i, body) "
-                             "SELECT new.rowid, _each.rowid, _each.value " <<
-                             "FROM " << kvTableName << " as new, " << eachExpr << " AS _each "
-                             "WHERE (new.flags & 1) = 0"));
+            populateIndexTable(unnestTableName,
+                               CONCAT("INSERT INTO \"" << unnestTableName << "\" (docid, i, body) "
+                                      "SELECT new.rowid, _each.rowid, _each.value " <<
+                                      "FROM " << kvTableName << " as new, "
+                                              << eachExpr << " AS _each"),
+                               "(new.flags & 1) = 0", options);
 
             // Set up triggers to keep the index-table up to date
             // ...on insertion:
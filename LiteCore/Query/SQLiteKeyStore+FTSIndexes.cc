@@ -67,9 +67,24 @@ namespace litecore {
         if (!db().createIndex(spec, this, ftsTableName, sqlStr))
             return false;
 
-        // Index the existing records:
-        db().exec(CONCAT("INSERT INTO \"" << ftsTableName << "\" (docid, " << columns << ") "
-                         "SELECT rowid, " << exprs << " FROM kv_" << name() << " AS new"));
+        // The trigger that updates the FTS table when a record is updated:
+        stringstream upd;
+        upd << "UPDATE \"" << ftsTableName << "\" SET ";
+        for (size_t i = 0; i < colNames.size(); ++i) {
+            if (i > 0)
+                upd << ", ";
+            upd << colNames[i] << " = " << colExprs[i];
+        }
+        upd << " WHERE docid = new.rowid";
+        string updateTriggerSQL = triggerSQL(ftsTableName, "upd", "AFTER UPDATE", "", upd.str());
+
+        // Index the existing records. If that's done in the background, the update trigger is
+        // replaced by the above once it's done:
+        string insertSQL = CONCAT("INSERT INTO \"" << ftsTableName << "\" (docid, " << columns
+                                  << ") SELECT rowid, " << exprs << " FROM kv_" << name() << " AS new");
+        bool building = populateIndexTable(ftsTableName, insertSQL, nullptr, options,
+                                           CONCAT("DROP TRIGGER \"" << ftsTableName << "::upd\"; "
+                                                  << updateTriggerSQL));
 
         // Set up triggers to keep the FTS table up to date
         // ...on insertion:
@@ -82,15 +97,15 @@ namespace litecore {
                       CONCAT("DELETE FROM \"" << ftsTableName << "\" WHERE docid = old.rowid"));
 
         // ...on update:
-        stringstream upd;
-        upd << "UPDATE \"" << ftsTableName << "\" SET ";
-        for (size_t i = 0; i < colNames.size(); ++i) {
-            if (i > 0)
-                upd << ", ";
-            upd << colNames[i] << " = " << colExprs[i];
+        if (building) {
+            // The record may not have been indexed yet, so replace its row instead of updating it
+            createTrigger(ftsTableName, "upd", "AFTER UPDATE", "",
+                          CONCAT("DELETE FROM \"" << ftsTableName << "\" WHERE docid = old.rowid; "
+                                 << "INSERT INTO \"" << ftsTableName << "\" (docid, " << columns
+                                 << ") VALUES (new.rowid, " << exprs << ")"));
+        } else {
+            db().exec(updateTriggerSQL);
         }
-        upd << " WHERE docid = new.rowid";
-        createTrigger(ftsTableName, "upd", "AFTER UPDATE", "", upd.str());
         return true;
     }
 
@@ -26,6 +26,8 @@
 #include "StringUtil.hh"
 #include "SQLiteCpp/SQLiteCpp.h"
 #include "Stopwatch.hh"
+#include <algorithm>
+#include <sstream>
 
 using namespace std;
 using namespace fleece;
@@ -34,7 +36,9 @@ using namespace fleece::impl;
 namespace litecore {
 
     /*
-     - A value index is a SQL index named 'NAME'.
+     - A value index is a SQL index named 'NAME'. A covering value index also has:
+         * A SQL table named `kv_default:cover:NAME` holding the values of its properties
+         * An index on that table named `kv_default:cover:NAME::index`
      - A FTS index is a SQL virtual table named 'kv_default::NAME'
      - An array index has two parts:
          * A SQL table named `kv_default:unnest:PATH`, where PATH is the property path
@@ -53,15 +57,16 @@ namespace litecore {
      */
 
     static void validateIndexName(slice name);
-    static pair<alloc_slice, const Array*> parseIndexExpr(slice expression, KeyStore::IndexType);
+    static tuple<alloc_slice, const Array*, const Array*> parseIndexExpr(slice expression,
+                                                                        KeyStore::IndexType);
 
 
     bool SQLiteKeyStore::createIndex(const IndexSpec &spec,
                                      const IndexOptions *options) {
         validateIndexName(spec.name);
         alloc_slice expressionFleece;
-        const Array *params;
-        tie(expressionFleece, params) = parseIndexExpr(spec.expressionJSON, spec.type);
+        const Array *params, *included;
+        tie(expressionFleece, params, included) = parseIndexExpr(spec.expressionJSON, spec.type);
 
         Stopwatch st;
         Transaction t(db());
@@ -69,7 +74,7 @@ namespace litecore {
         switch (spec.type) {
             case kValueIndex: {
                 Array::iterator iParams(params);
-                created = createValueIndex(spec, tableName(), iParams, options);
+                created = createValueIndex(spec, tableName(), iParams, options, included);
                 break;
             }
             case kFullTextIndex:  created = createFTSIndex(spec, params, options); break;
@@ -144,30 +149,178 @@ namespace litecore {
     }
 
 
+    sequence_t SQLiteKeyStore::buildIndexes(sequence_t limit) {
+        return db().continueIndexBuild(name(), limit);
+    }
+
+
+    bool SQLiteKeyStore::getIndexBuildProgress(slice name, sequence_t &indexed, sequence_t &total) {
+        auto spec = db().getIndex(name);
+        if (!spec || spec.keyStoreName != this->name())
+            error::_throw(error::NoSuchIndex);
+        return !spec.indexTableName.empty()
+            && db().getIndexBuild(spec.indexTableName, indexed, total);
+    }
+
+
 #pragma mark - VALUE INDEX:
 
 
-    // Creates a value index.
+    // Creates a value index. If `included` is non-null, it's a covering index: see below.
     bool SQLiteKeyStore::createValueIndex(const IndexSpec &spec,
                                           const string &sourceTableName,
                                           Array::iterator &expressions,
-                                          const IndexOptions *options)
+                                          const IndexOptions *options,
+                                          const Array *included)
     {
         Assert(spec.type != kFullTextIndex);
+        Array::iterator indexed(expressions);      // (writeCreateIndex consumes `expressions`)
         QueryParser qp(*this);
         qp.setTableName(CONCAT('"' << sourceTableName << '"'));
         qp.writeCreateIndex(spec.name, expressions, (spec.type != kValueIndex));
         string sql = qp.SQL();
-        return db().createIndex(spec, this, sourceTableName, sql);
+        if (!included) {
+            return db().createIndex(spec, this,
+                                    (spec.type == kValueIndex ? string() : sourceTableName), sql);
+        }
+
+        string coveringTableName = CONCAT(tableName() << ":cover:" << spec.name);
+        if (!db().createIndex(spec, this, coveringTableName, sql))
+            return false;
+        createCoveringTable(coveringTableName, indexed, included, options);
+        return true;
+    }
+
+
+    // A covering index has a table with the key, sequence and flags of every record, plus a
+    // column holding the value of each indexed and included property, and a SQL index on those
+    // columns. A query that uses only those can read that SQL index instead of the records, whose
+    // bodies would otherwise have to be parsed for each row. (SQLite's own covering indexes
+    // can't do this for indexed expressions, only columns.)
+    void SQLiteKeyStore::createCoveringTable(const string &coveringTableName,
+                                             Array::iterator indexed,
+                                             const Array *included,
+                                             const IndexOptions *options)
+    {
+        QueryParser qp(*this);
+        qp.setBodyColumnName("new.body");
+        vector<string> columns;
+        stringstream columnNames, columnValues;
+        auto addColumns = [&](Array::iterator i) {
+            for (; i; ++i) {
+                string column = QueryParser::coveringColumnName(i.value());
+                if (column.empty())
+                    error::_throw(error::InvalidQuery,
+                                  "A covering index can only index and include properties");
+                if (find(columns.begin(), columns.end(), column) != columns.end())
+                    continue;
+                columns.push_back(column);
+                columnNames << ", \"" << column << '"';
+                columnValues << ", " << qp.expressionSQL(i.value());
+            }
+        };
+        addColumns(indexed);
+        addColumns(Array::iterator(included));
+
+        LogTo(QueryLog, "Creating covering index table '%s'", coveringTableName.c_str());
+        auto kvTableName = tableName();
+        stringstream sql;
+        sql << "CREATE TABLE \"" << coveringTableName << "\" "
+               "(docid INTEGER PRIMARY KEY REFERENCES " << kvTableName << "(rowid), "
+               " key TEXT UNIQUE NOT NULL, sequence INTEGER, flags INTEGER";
+        for (auto &column : columns)
+            sql << ", \"" << column << '"';
+        sql << "); CREATE INDEX \"" << coveringTableName << "::index\" ON \""
+            << coveringTableName << "\" (";
+        for (auto &column : columns)
+            sql << '"' << column << "\", ";
+        sql << "flags)";
+        db().exec(sql.str());
+
+        string columnList = CONCAT("(docid, key, sequence, flags" << columnNames.str() << ")");
+
+        // Populate the table with data from existing records:
+        populateIndexTable(coveringTableName,
+                           CONCAT("INSERT OR REPLACE INTO \"" << coveringTableName << "\" "
+                                  << columnList << " SELECT new.rowid, new.key, new.sequence, "
+                                  "new.flags" << columnValues.str() <<
+                                  " FROM " << kvTableName << " AS new"),
+                           nullptr, options);
+
+        // Set up triggers to keep the table up to date:
+        string insertTriggerExpr = CONCAT("INSERT OR REPLACE INTO \"" << coveringTableName
+                                          << "\" " << columnList << " VALUES (new.rowid, new.key, "
+                                          "new.sequence, new.flags" << columnValues.str() << ")");
+        createTrigger(coveringTableName, "ins", "AFTER INSERT", "", insertTriggerExpr);
+        createTrigger(coveringTableName, "upd", "AFTER UPDATE", "", insertTriggerExpr);
+        createTrigger(coveringTableName, "del", "BEFORE DELETE", "",
+                      CONCAT("DELETE FROM \"" << coveringTableName << "\" "
+                             "WHERE docid = old.rowid"));
+    }
+
+
+    // Part of the QueryParser delegate API.
+    // Returns the covering indexes' tables, except ones still being populated.
+    vector<QueryParser::CoveringIndex> SQLiteKeyStore::coveringIndexes() const {
+        vector<QueryParser::CoveringIndex> indexes;
+        for (auto &spec : db().getIndexes(this)) {
+            if (spec.type != kValueIndex || spec.indexTableName.empty() || !spec.expressionJSON
+                    || !tableExists(spec.indexTableName))
+                continue;
+            alloc_slice expressionFleece;
+            const Array *params, *included;
+            tie(expressionFleece, params, included) = parseIndexExpr(spec.expressionJSON,
+                                                                     spec.type);
+            QueryParser::CoveringIndex index;
+            index.tableName = spec.indexTableName;
+            for (Array::iterator i(params); i; ++i)
+                index.columns.insert(QueryParser::coveringColumnName(i.value()));
+            for (Array::iterator i(included); i; ++i)
+                index.columns.insert(QueryParser::coveringColumnName(i.value()));
+            indexes.push_back(move(index));
+        }
+        return indexes;
     }
 
 
 #pragma mark - UTILITIES:
 
 
-    // Part of the QueryParser delegate API
+    // Populates a new index table from the existing records, by running `insertSQL` (an
+    // INSERT...SELECT whose source table has the alias `new`) with an optional WHERE condition.
+    // With the `background` option the table is left empty instead, and registered to be filled
+    // in later by buildIndexes(), a range of sequences at a time; `finishSQL`, if any, is run when
+    // that's done. Returns true if the table was registered to be built in the background.
+    bool SQLiteKeyStore::populateIndexTable(const string &indexTableName,
+                                            const string &insertSQL,
+                                            const char *condition,
+                                            const IndexOptions *options,
+                                            const string &finishSQL)
+    {
+        if (options && options->background) {
+            sequence_t lastSeq = lastSequence();
+            if (lastSeq == 0)
+                return false;     // No existing records to index
+            stringstream sql;
+            sql << insertSQL << " WHERE ";
+            if (condition)
+                sql << '(' << condition << ") AND ";
+            sql << "new.sequence > ?1 AND new.sequence <= ?2";
+            db().registerIndexBuild(indexTableName, name(), lastSeq, sql.str(), finishSQL);
+            return true;
+        } else if (condition) {
+            db().exec(CONCAT(insertSQL << " WHERE " << condition));
+        } else {
+            db().exec(insertSQL);
+        }
+        return false;
+    }
+
+
+    // Part of the QueryParser delegate API.
+    // A table still being populated by a background index build can't be used by queries yet.
     bool SQLiteKeyStore::tableExists(const std::string &tableName) const {
-        return db().tableExists(tableName);
+        return db().tableExists(tableName) && !db().indexTableIsBuilding(tableName);
     }
 
 
@@ -182,20 +335,37 @@ namespace litecore {
     }
 
 
-    // Parses the JSON index-spec expression into an Array:
-    static pair<alloc_slice, const Array*> parseIndexExpr(slice expression,
-                                                          KeyStore::IndexType type)
+    // Parses the JSON index-spec expression into an Array of expressions, plus an optional
+    // Array of included properties. The spec is either an array of expressions, or (for a value
+    // index) a dict of the form {"WHAT": [expressions...], "INCLUDE": [properties...]}.
+    static tuple<alloc_slice, const Array*, const Array*> parseIndexExpr(slice expression,
+                                                                        KeyStore::IndexType type)
     {
         alloc_slice expressionFleece;
-        const Array *params = nullptr;
+        const Array *params = nullptr, *included = nullptr;
         try {
             Retained<Doc> doc = Doc::fromJSON(expression);
             expressionFleece = doc->allocedData();
-            params = doc->asArray();
+            auto dict = doc->asDict();
+            if (dict) {
+                if (type != KeyStore::kValueIndex)
+                    error::_throw(error::InvalidQuery,
+                                  "Only value indexes can include properties");
+                auto what = dict->get("WHAT"_sl);
+                params = what ? what->asArray() : nullptr;
+                auto include = dict->get("INCLUDE"_sl);
+                if (include) {
+                    included = include->asArray();
+                    if (!included || included->count() == 0)
+                        error::_throw(error::InvalidQuery, "INCLUDE must be a non-empty array");
+                }
+            } else {
+                params = doc->asArray();
+            }
         } catch (const FleeceException &) { }
         if (!params || params->count() == 0)
             error::_throw(error::InvalidQuery, "JSON syntax error, or not an array");
-        return {expressionFleece, params};
+        return make_tuple(expressionFleece, params, included);
     }
 
 }
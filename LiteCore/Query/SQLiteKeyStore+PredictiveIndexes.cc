@@ -85,15 +85,16 @@ namespace litecore {
             db().exec(sql);
 
             // Populate the index-table with data from existing documents:
+            qp.setBodyColumnName("new.body");
             string predictExpr = qp.expressionSQL(expression);
-            db().exec(CONCAT("INSERT INTO \"" << predTableName << "\" (docid, body) "
-                             "SELECT rowid, " << predictExpr <<
-                             "FROM " << kvTableName << " WHERE (flags & 1) = 0"));
+            populateIndexTable(predTableName,
+                               CONCAT("INSERT INTO \"" << predTableName << "\" (docid, body) "
+                                      "SELECT new.rowid, " << predictExpr << " "
+                                      "FROM " << kvTableName << " AS new"),
+                               "(new.flags & 1) = 0", options);
 
             // Set up triggers to keep the index-table up to date
             // ...on insertion:
-            qp.setBodyColumnName("new.body");
-            predictExpr = qp.expressionSQL(expression);
             string insertTriggerExpr = CONCAT("INSERT INTO \"" << predTableName <<
                                               "\" (docid, body) "
                                               "VALUES (new.rowid, " << predictExpr << ")");
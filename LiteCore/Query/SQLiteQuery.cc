@@ -19,6 +19,7 @@
 #include "SQLiteKeyStore.hh"
 #include "SQLiteDataFile.hh"
 #include "SQLite_Internal.hh"
+#include "SQLiteQueryCache.hh"
 #include "Logging.hh"
 #include "Query.hh"
 #include "QueryParser.hh"
@@ -29,10 +30,13 @@
 #include "MutableDict.hh"
 #include "Path.hh"
 #include "Stopwatch.hh"
+#include "Instrumentation.hh"
 #include "SQLiteCpp/SQLiteCpp.h"
 #include <sqlite3.h>
 #include <sstream>
 #include <iostream>
+#include <mutex>
+#include <set>
 
 extern "C" {
 #include "sqlite3_unicodesn_tokenizer.h"        // for unicodesn_tokenizerRunningQuery()
@@ -44,6 +48,7 @@ using namespace fleece::impl;
 namespace litecore {
 
     class SQLiteQueryEnumerator;
+    class SQLiteStreamingQueryEnumerator;
 
 
     // Implicit columns in full-text query result:
@@ -77,40 +82,66 @@ namespace litecore {
                 }
             }
 
-            QueryParser qp(keyStore);
-            qp.parseJSON(_json);
+            // Equivalent queries share a cache entry, keyed by the canonical form of their JSON:
+            string key = keyStore.name() + '\n' + string(canonicalJSON(_json));
+            _compiled = keyStore.db().queryCache().get(key, keyStore,
+                                                       [&](SQLiteQueryCache::Entry &entry) {
+                QueryParser qp(keyStore);
+                qp.parseJSON(_json);
+
+                entry.parameters = qp.parameters();
+                for (auto p = entry.parameters.begin(); p != entry.parameters.end();) {
+                    if (hasPrefix(*p, "opt_"))
+                        p = entry.parameters.erase(p); // Optional param, don't warn if it's unbound
+                    else
+                        ++p;
+                }
 
-            _parameters = qp.parameters();
-            for (auto p = _parameters.begin(); p != _parameters.end();) {
-                if (hasPrefix(*p, "opt_"))
-                    p = _parameters.erase(p);       // Optional param, don't warn if it's unbound
-                else
-                    ++p;
-            }
+                entry.ftsTables = qp.ftsTablesUsed();
+                for (auto ftsTable : entry.ftsTables) {
+                    if (!keyStore.tableExists(ftsTable))
+                        error::_throw(error::NoSuchIndex, "'match' test requires a full-text index");
+                }
 
-            _ftsTables = qp.ftsTablesUsed();
-            for (auto ftsTable : _ftsTables) {
-                if (!keyStore.db().tableExists(ftsTable))
-                    error::_throw(error::NoSuchIndex, "'match' test requires a full-text index");
-            }
+                entry.usesExpiration = qp.usesExpiration();
+                entry.sql = qp.SQL();
+                entry.firstCustomResultColumn = qp.firstCustomResultColumn();
+                entry.columnTitles = qp.columnTitles();
+                if (qp.isSingleSource())
+                    entry.fromAndWhereSQL = qp.fromAndWhereSQL();
+                logInfo("Compiled as %s", entry.sql.c_str());
+            });
 
-            if (qp.usesExpiration())
+            if (_compiled->usesExpiration)
                 keyStore.addExpiration();
 
-            string sql = qp.SQL();
-            logInfo("Compiled as %s", sql.c_str());
-            LogTo(SQL, "Compiled {Query#%u}: %s", getObjectRef(), sql.c_str());
-            _statement.reset(keyStore.compile(sql));
-            
-            _1stCustomResultColumn = qp.firstCustomResultColumn();
-            _columnTitles = qp.columnTitles();
+            LogTo(SQL, "Compiled {Query#%u}: %s", getObjectRef(), _compiled->sql.c_str());
+            _parameters = _compiled->parameters;
+            _ftsTables = _compiled->ftsTables;
+            _1stCustomResultColumn = _compiled->firstCustomResultColumn;
+            _columnTitles = _compiled->columnTitles;
+            _fromAndWhereSQL = _compiled->fromAndWhereSQL;
         }
 
 
-        virtual void close() override {
+        // Returns the canonical JSON form of a query, or the original if it can't be parsed.
+        static alloc_slice canonicalJSON(const alloc_slice &json) {
+            try {
+                return Doc::fromJSON(json)->root()->toJSON(true);
+            } catch (const FleeceException&) {
+                return json;
+            }
+        }
+
+
+        virtual void close() override;
+
+        void _close() {
             logInfo("Closing query (db is closing)");
-            _statement.reset();
+            _compiled.reset();
             _matchedTextStatement.reset();
+            _matchingKeysStatement.reset();
+            _keyMatchesStatement.reset();
             Query::close();
         }
 
@@ -150,7 +181,7 @@ namespace litecore {
 
 
         virtual unsigned columnCount() const noexcept override {
-            return statement()->getColumnCount() - _1stCustomResultColumn;
+            return _compiled->columnCount - _1stCustomResultColumn;
         }
 
 
@@ -162,7 +193,7 @@ namespace litecore {
         string explain() override {
             stringstream result;
             // https://www.sqlite.org/eqp.html
-            string query = statement()->getQuery();
+            string query = compiled().sql;
             result << query << "\n\n";
 
             string sql = "EXPLAIN QUERY PLAN " + query;
@@ -179,11 +210,28 @@ namespace litecore {
         }
 
         QueryEnumerator* createEnumerator(const Options *options) override;
+        QueryEnumerator* createStreamingEnumerator(const Options*,
+                                                   unique_ptr<DataFile::BorrowedReader>);
+
+        bool canCheckChangedDocs() const noexcept override {
+            return !_fromAndWhereSQL.empty();
+        }
+
+        KeySet matchingKeys(const Options *options) override;
+        bool anyKeyMatches(const KeySet &keys, const Options *options) override;
+
+        const SQLiteQueryCache::Entry& compiled() const {
+            if (!_compiled)
+                error::_throw(error::NotOpen);
+            return *_compiled;
+        }
 
-        shared_ptr<SQLite::Statement> statement() const {
-            if (!_statement)
+        // Returns a prepared statement for the exclusive use of one run of the query.
+        shared_ptr<SQLite::Statement> checkOutStatement() const {
+            if (!_compiled)
                 error::_throw(error::NotOpen);
-            return _statement;
+            auto &keyStore = (SQLiteKeyStore&)this->keyStore();
+            return keyStore.db().queryCache().checkOut(_compiled, keyStore);
         }
 
         unsigned objectRef() const                  {return getObjectRef();}   // (for logging)
@@ -192,14 +240,20 @@ namespace litecore {
         vector<string> _ftsTables;          // Names of the FTS tables used
         unsigned _1stCustomResultColumn;    // Column index of the 1st column declared in JSON
 
+        mutex _streamingMutex;              // Protects _streamingEnumerators
+        set<SQLiteStreamingQueryEnumerator*> _streamingEnumerators; // Open ones, closed with me
+
     protected:
         ~SQLiteQuery() =default;
         string loggingClassName() const override    {return "Query";}
 
     private:
         alloc_slice _json;                                  // Original JSON form of the query
-        shared_ptr<SQLite::Statement> _statement;           // Compiled SQLite statement
+        shared_ptr<SQLiteQueryCache::Entry> _compiled;      // Cached SQL & statements
         unique_ptr<SQLite::Statement> _matchedTextStatement;// Gets the matched text
+        string _fromAndWhereSQL;                            // Empty if not single-source
+        shared_ptr<SQLite::Statement> _matchingKeysStatement;// Gets keys of matching docs
+        shared_ptr<SQLite::Statement> _keyMatchesStatement; // Tests whether a doc matches
         vector<string> _columnTitles;                       // Titles of columns
     };
 
@@ -207,6 +261,26 @@ namespace litecore {
 #pragma mark - QUERY ENUMERATOR:
 
 
+    // Parses the FTS columns of a result row into FullTextTerms.
+    static void parseFullTextTerms(const Array *row, QueryEnumerator::FullTextTerms &terms) {
+        terms.clear();
+        uint64_t dataSource = row->get(kFTSRowidCol)->asInt();
+        // The offsets() function returns a string of space-separated numbers in groups of 4.
+        string offsets = row->get(kFTSOffsetsCol)->asString().asString();
+        const char *termStr = offsets.c_str();
+        while (*termStr) {
+            uint32_t n[4];
+            for (int i = 0; i < 4; ++i) {
+                char *next;
+                n[i] = (uint32_t)strtol(termStr, &next, 10);
+                termStr = next;
+            }
+            terms.push_back({dataSource, n[0], n[1], n[2], n[3]});
+            // {rowid, key #, term #, byte offset, byte length}
+        }
+    }
+
+
     // Query enumerator that reads from prerecorded Fleece data (generated by fastForward(), below)
     // Each array item is a row, which is itself an array of column values.
     class SQLiteQueryEnumerator : public QueryEnumerator, Logging {
@@ -318,21 +392,7 @@ namespace litecore {
         }
 
         const FullTextTerms& fullTextTerms() override {
-            _fullTextTerms.clear();
-            uint64_t dataSource = _iter->asArray()->get(kFTSRowidCol)->asInt();
-            // The offsets() function returns a string of space-separated numbers in groups of 4.
-            string offsets = _iter->asArray()->get(kFTSOffsetsCol)->asString().asString();
-            const char *termStr = offsets.c_str();
-            while (*termStr) {
-                uint32_t n[4];
-                for (int i = 0; i < 4; ++i) {
-                    char *next;
-                    n[i] = (uint32_t)strtol(termStr, &next, 10);
-                    termStr = next;
-                }
-                _fullTextTerms.push_back({dataSource, n[0], n[1], n[2], n[3]});
-                // {rowid, key #, term #, byte offset, byte length}
-            }
+            parseFullTextTerms(_iter->asArray(), _fullTextTerms);
             return _fullTextTerms;
         }
 
@@ -351,16 +411,20 @@ namespace litecore {
 
     // Reads from 'live' SQLite statement and records the results into a Fleece array,
     // which is then used as the data source of a SQLiteQueryEnum.
+    // (Or, when streaming, is used by a SQLiteStreamingQueryEnumerator to read one row at a time.)
     class SQLiteQueryRunner {
     public:
-        SQLiteQueryRunner(SQLiteQuery *query, const Query::Options *options, sequence_t lastSequence, uint64_t purgeCount)
+        SQLiteQueryRunner(SQLiteQuery *query, const Query::Options *options, sequence_t lastSequence, uint64_t purgeCount,
+                          shared_ptr<SQLite::Statement> statement =nullptr)
         :_query(query)
         ,_lastSequence(lastSequence)
         ,_purgeCount(purgeCount)
-        ,_statement(query->statement())
+        ,_statement(statement ? statement : query->checkOutStatement())
         ,_sk(query->keyStore().dataFile().documentKeys())
+        ,_stats(query->keyStore().dataFile().stats())
         ,_options(options ? *options : Query::Options())
         {
+            DataFileStats::add(_stats.queriesRun);
             _statement->clearBindings();
             _unboundParameters = query->_parameters;
             if (options && options->paramBindings.buf)
@@ -460,11 +524,38 @@ namespace litecore {
             return true;
         }
 
+        // Writes the current row as an array, and returns a bit-map of its missing columns.
+        uint64_t encodeRow(Encoder &enc) {
+            int nCols = _statement->getColumnCount();
+            uint64_t missingCols = 0;
+            enc.beginArray(nCols);
+            for (int i = 0; i < nCols; ++i) {
+                if (!encodeColumn(enc, i) && i < 64)
+                    missingCols |= (1 << i);
+            }
+            enc.endArray();
+            return missingCols;
+        }
+
+        // Steps the statement to the next row; returns false at the end.
+        bool step() {
+            unicodesn_tokenizerRunningQuery(true);
+            DataFileStats::add(_stats.statementSteps);
+            try {
+                bool gotRow = _statement->executeStep();
+                unicodesn_tokenizerRunningQuery(false);
+                return gotRow;
+            } catch (...) {
+                unicodesn_tokenizerRunningQuery(false);
+                throw;
+            }
+        }
+
         // Collects all the (remaining) rows into a Fleece array of arrays,
         // and returns an enumerator impl that will replay them.
         SQLiteQueryEnumerator* fastForward() {
+            Signpost signpost(Signpost::queryFastForward, uintptr_t(this));
             fleece::Stopwatch st;
-            int nCols = _statement->getColumnCount();
             uint64_t rowCount = 0;
             // Give this encoder its own SharedKeys instead of using the database's DocumentKeys,
             // because the query results might include dicts with new keys that aren't in the
@@ -474,30 +565,20 @@ namespace litecore {
             enc.setSharedKeys(sk);
             enc.beginArray();
 
-            unicodesn_tokenizerRunningQuery(true);
-            try {
-                while (_statement->executeStep()) {
-                    uint64_t missingCols = 0;
-                    enc.beginArray(nCols);
-                    for (int i = 0; i < nCols; ++i) {
-                        if (!encodeColumn(enc, i) && i < 64)
-                            missingCols |= (1 << i);
-                    }
-                    enc.endArray();
-                    // Add an integer containing a bit-map of which columns are missing/undefined:
-                    enc.writeUInt(missingCols);
-                    ++rowCount;
-                }
-            } catch (...) {
-                unicodesn_tokenizerRunningQuery(false);
-                throw;
+            while (step()) {
+                uint64_t missingCols = encodeRow(enc);
+                // Add an integer containing a bit-map of which columns are missing/undefined:
+                enc.writeUInt(missingCols);
+                ++rowCount;
             }
-            unicodesn_tokenizerRunningQuery(false);
 
             enc.endArray();
             Retained<Doc> recording = enc.finishDoc();
+            double elapsed = st.elapsed();
+            DataFileStats::add(_stats.queryRowsRecorded, rowCount);
+            _stats.fastForwardTime.record(elapsed);
             return new SQLiteQueryEnumerator(_query, &_options, _lastSequence, _purgeCount,
-                                             recording, rowCount, st.elapsed());
+                                             recording, rowCount, elapsed);
         }
 
     private:
@@ -508,10 +589,164 @@ namespace litecore {
         shared_ptr<SQLite::Statement> _statement;
         set<string> _unboundParameters;
         SharedKeys* _sk;
+        DataFileStats &_stats;
     };
 
 
 
+    // Query enumerator that reads rows directly from a SQLite statement as it's iterated, instead
+    // of recording them all up front. Each row is encoded into its own small Fleece Doc, so memory
+    // use doesn't grow with the size of the result set. Doesn't support getRowCount() or seek().
+    // Since it keeps reading after createEnumerator returns, it runs on its own pooled reader,
+    // in a read transaction that lasts until its rows are exhausted; that isolates it from writes
+    // made meanwhile on the query's connection, without holding any lock. If the database closes
+    // first, the enumerator gives back the reader and further calls to next() throw NotOpen.
+    class SQLiteStreamingQueryEnumerator : public QueryEnumerator, Logging {
+    public:
+        SQLiteStreamingQueryEnumerator(SQLiteQuery *query,
+                                       const Query::Options *options,
+                                       sequence_t lastSequence,
+                                       uint64_t purgeCount,
+                                       unique_ptr<DataFile::BorrowedReader> reader,
+                                       Retained<Query> readerQuery)
+        :QueryEnumerator(options, lastSequence, purgeCount)
+        ,Logging(QueryLog)
+        ,_query(query)
+        ,_reader(move(reader))
+        ,_readerQuery(move(readerQuery))
+        ,_sk(new SharedKeys)
+        ,_1stCustomResultColumn(query->_1stCustomResultColumn)
+        ,_hasFullText(!query->_ftsTables.empty())
+        {
+            _runner.reset(new SQLiteQueryRunner((SQLiteQuery*)_readerQuery.get(), options,
+                                                lastSequence, purgeCount));
+            lock_guard<mutex> lock(_query->_streamingMutex);
+            _query->_streamingEnumerators.insert(this);
+            logInfo("Created streaming enumerator on {Query#%u}", query->objectRef());
+        }
+
+        ~SQLiteStreamingQueryEnumerator() {
+            {
+                lock_guard<mutex> lock(_query->_streamingMutex);
+                _query->_streamingEnumerators.erase(this);
+            }
+            release();
+            logInfo("Deleted after %llu rows", (unsigned long long)_rowCount);
+        }
+
+        // Called by the Query when the database is closing.
+        void close() {
+            lock_guard<mutex> lock(_mutex);
+            if (_runner)
+                _closed = true;
+            release();
+        }
+
+        virtual int64_t getRowCount() const override {
+            error::_throw(error::UnsupportedOperation,
+                          "Streaming query enumerator doesn't know its row count");
+        }
+
+        virtual void seek(int64_t rowIndex) override {
+            error::_throw(error::UnsupportedOperation,
+                          "Streaming query enumerator doesn't support seeking");
+        }
+
+        bool next() override {
+            lock_guard<mutex> lock(_mutex);
+            if (_closed)
+                error::_throw(error::NotOpen, "Database was closed during query enumeration");
+            if (!_runner)
+                return false;
+            if (!_runner->step()) {
+                logVerbose("END");
+                _row = nullptr;
+                release();              // frees the statement and gives back the reader
+                return false;
+            }
+
+            // Give each row's encoder the same SharedKeys, for the reason given in fastForward():
+            Encoder enc;
+            enc.setSharedKeys(_sk);
+            _missingColumns = _runner->encodeRow(enc);
+            _row = enc.finishDoc();
+            ++_rowCount;
+            if (willLog(LogLevel::Verbose)) {
+                alloc_slice json = _row->asArray()->toJSON();
+                logVerbose("--> %.*s", SPLAT(json));
+            }
+            return true;
+        }
+
+        Array::iterator columns() const noexcept override {
+            Array::iterator i(_row->asArray());
+            i += _1stCustomResultColumn;
+            return i;
+        }
+
+        uint64_t missingColumns() const noexcept override {
+            return _missingColumns;
+        }
+
+        // There's no recording to compare, so any change to the database counts.
+        virtual bool obsoletedBy(const QueryEnumerator *other) override {
+            return other && (other->purgeCount() != _purgeCount
+                             || other->lastSequence() > _lastSequence);
+        }
+
+        QueryEnumerator* refresh(Query *query) override {
+            // createEnumerator returns null if the database hasn't changed since I was created
+            auto newOptions = _options.after(_lastSequence).withPurgeCount(_purgeCount);
+            return query->createEnumerator(&newOptions);
+        }
+
+        bool hasFullText() const override {
+            return _hasFullText;
+        }
+
+        const FullTextTerms& fullTextTerms() override {
+            parseFullTextTerms(_row->asArray(), _fullTextTerms);
+            return _fullTextTerms;
+        }
+
+    protected:
+        string loggingClassName() const override    {return "QueryEnum";}
+
+    private:
+        // Frees the statement, then ends the read transaction and gives back the reader.
+        void release() {
+            _runner.reset();
+            _readerQuery = nullptr;
+            _reader.reset();
+        }
+
+        Retained<SQLiteQuery> _query;
+        mutex _mutex;
+        unique_ptr<DataFile::BorrowedReader> _reader;   // Pooled reader the query runs on
+        Retained<Query> _readerQuery;                   // The query compiled on the reader
+        unique_ptr<SQLiteQueryRunner> _runner;
+        Retained<SharedKeys> _sk;
+        Retained<Doc> _row;                 // The current row
+        uint64_t _missingColumns {0};
+        uint64_t _rowCount {0};
+        unsigned _1stCustomResultColumn;    // Column index of the 1st column declared in JSON
+        bool _hasFullText;
+        bool _closed {false};               // Set if the db closed before I was done
+    };
+
+
+    void SQLiteQuery::close() {
+        {
+            // (Keep the lock, so an enumerator can't be deleted while it's being closed.)
+            lock_guard<mutex> lock(_streamingMutex);
+            for (auto e : _streamingEnumerators)
+                e->close();
+        }
+        _close();
+    }
+
+
+
     // The factory method that creates a SQLite Query.
     Retained<Query> SQLiteKeyStore::compileQuery(slice selectorExpression, QueryLanguage language) {
         return new SQLiteQuery(*this, selectorExpression, language);
@@ -521,6 +756,19 @@ namespace litecore {
     // The factory method that creates a SQLite QueryEnumerator, but only if the database has
     // changed since lastSeq.
     QueryEnumerator* SQLiteQuery::createEnumerator(const Options *options) {
+        if (options && options->streaming && !keyStore().dataFile().options().pooledReader) {
+            // Don't wait for a reader; if they're all in use (maybe by other streaming enumerators
+            // on this thread, which would then deadlock) fail, rather than quietly returning an
+            // enumerator with different capabilities than the caller asked for.
+            // (A query that's already on a pooled reader just records the results.)
+            unique_ptr<DataFile::BorrowedReader> reader(
+                                    new DataFile::BorrowedReader(keyStore().dataFile(), false));
+            if (!*reader)
+                error::_throw(error::Busy, "Can't stream query results: all readers are in use, "
+                                           "or a transaction is open");
+            return createStreamingEnumerator(options, move(reader));
+        }
+
         // Start a read-only transaction, to ensure that the result of lastSequence() and purgeCount() will be
         // consistent with the query results.
         ReadOnlyTransaction t(keyStore().dataFile());
@@ -533,4 +781,55 @@ namespace litecore {
         return recorder.fastForward();
     }
 
+
+    // Runs the query on a borrowed pooled reader, whose read transaction lasts as long as the
+    // enumerator; the lastSequence and purgeCount are read in that same transaction.
+    QueryEnumerator* SQLiteQuery::createStreamingEnumerator(const Options *options,
+                                        unique_ptr<DataFile::BorrowedReader> reader)
+    {
+        KeyStore &readerStore = reader->get()->getKeyStore(keyStore().name());
+        sequence_t curSeq = readerStore.lastSequence();
+        uint64_t purgeCnt = readerStore.purgeCount();
+        if (options->notOlderThan(curSeq, purgeCnt))
+            return nullptr;
+        Retained<Query> readerQuery = readerStore.compileQuery(expression(), language());
+        return new SQLiteStreamingQueryEnumerator(this, options, curSeq, purgeCnt,
+                                                  move(reader), move(readerQuery));
+    }
+
+
+    Query::KeySet SQLiteQuery::matchingKeys(const Options *options) {
+        if (!canCheckChangedDocs())
+            error::_throw(error::UnsupportedOperation);
+        if (!_matchingKeysStatement) {
+            _matchingKeysStatement.reset(((SQLiteKeyStore&)keyStore()).compile(
+                                                            "SELECT key" + _fromAndWhereSQL));
+        }
+        KeySet keys;
+        SQLiteQueryRunner runner(this, options, 0, 0, _matchingKeysStatement);
+        while (runner.step())
+            keys.emplace(SQLiteKeyStore::columnAsSlice(_matchingKeysStatement->getColumn(0)));
+        return keys;
+    }
+
+
+    bool SQLiteQuery::anyKeyMatches(const KeySet &keys, const Options *options) {
+        if (!canCheckChangedDocs())
+            error::_throw(error::UnsupportedOperation);
+        if (!_keyMatchesStatement) {
+            // (Query parameters are always named "$_..." so "$key" can't conflict.)
+            _keyMatchesStatement.reset(((SQLiteKeyStore&)keyStore()).compile(
+                                            "SELECT 1" + _fromAndWhereSQL + " AND key=$key"));
+        }
+        SQLiteQueryRunner runner(this, options, 0, 0, _keyMatchesStatement);
+        for (const alloc_slice &key : keys) {
+            _keyMatchesStatement->bindNoCopy("$key", (const char*)key.buf, (int)key.size);
+            bool matches = runner.step();
+            _keyMatchesStatement->reset();
+            if (matches)
+                return true;
+        }
+        return false;
+    }
+
 }
@@ -0,0 +1,154 @@
+//
+// SQLiteQueryCache.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "SQLiteQueryCache.hh"
+#include "SQLiteKeyStore.hh"
+#include "SQLiteDataFile.hh"
+#include "DataFileStats.hh"
+#include "Logging.hh"
+#include "SQLiteCpp/SQLiteCpp.h"
+
+using namespace std;
+
+namespace litecore {
+
+
+    SQLiteQueryCache::~SQLiteQueryCache() {
+        clear();
+    }
+
+
+    size_t SQLiteQueryCache::size() const {
+        lock_guard<mutex> lock(_mutex);
+        return _lru.size();
+    }
+
+
+    shared_ptr<SQLiteQueryCache::Entry> SQLiteQueryCache::get(const string &key,
+                                                             const SQLiteKeyStore &keyStore,
+                                                             function_ref<void(Entry&)> compile)
+    {
+        Stamp stamp = ((SQLiteDataFile&)keyStore.dataFile()).queryCacheStamp();
+        {
+            lock_guard<mutex> lock(_mutex);
+            auto i = _map.find(key);
+            if (i != _map.end()) {
+                if (i->second->second->_stamp == stamp) {
+                    // Move the entry to the front of the LRU list:
+                    _lru.splice(_lru.begin(), _lru, i->second);
+                    DataFileStats::add(_stats.queryCacheHits);
+                    return _lru.front().second;
+                }
+                LogVerbose(QueryLog, "Query cache entry is stale: %s",
+                           i->second->second->sql.c_str());
+                remove(i->second);
+            }
+        }
+
+        auto entry = make_shared<Entry>();
+        entry->_stamp = stamp;
+        compile(*entry);
+        // Prepare a statement now, so invalid SQL is caught before the entry is cached:
+        unique_ptr<SQLite::Statement> stmt(keyStore.compile(entry->sql));
+        DataFileStats::add(_stats.statementsPrepared);
+        entry->columnCount = stmt->getColumnCount();
+        entry->_idle.push_back(move(stmt));
+        DataFileStats::add(_stats.queryCacheMisses);
+
+        lock_guard<mutex> lock(_mutex);
+        auto i = _map.find(key);
+        if (i != _map.end())
+            remove(i->second);      // Another thread compiled the same query meanwhile
+        _lru.emplace_front(key, entry);
+        _map[key] = _lru.begin();
+
+        while (_lru.size() > kMaxEntries) {
+            LogVerbose(QueryLog, "Query cache evicting: %s", _lru.back().second->sql.c_str());
+            remove(prev(_lru.end()));
+            DataFileStats::add(_stats.queryCacheEvictions);
+        }
+        return entry;
+    }
+
+
+    // Removes an item from the cache. Must be called with _mutex locked.
+    void SQLiteQueryCache::remove(LRUList::iterator item) {
+        evict(*item->second);
+        _map.erase(item->first);
+        _lru.erase(item);
+    }
+
+
+    shared_ptr<SQLite::Statement> SQLiteQueryCache::checkOut(const shared_ptr<Entry> &entry,
+                                                             const SQLiteKeyStore &keyStore)
+    {
+        unique_ptr<SQLite::Statement> stmt;
+        {
+            lock_guard<mutex> lock(entry->_mutex);
+            if (!entry->_idle.empty()) {
+                stmt = move(entry->_idle.back());
+                entry->_idle.pop_back();
+            }
+        }
+        if (stmt) {
+            DataFileStats::add(_stats.statementsReused);
+        } else {
+            stmt.reset(keyStore.compile(entry->sql));
+            DataFileStats::add(_stats.statementsPrepared);
+        }
+        weak_ptr<Entry> weakEntry = entry;
+        return shared_ptr<SQLite::Statement>(stmt.release(), [weakEntry](SQLite::Statement *s) {
+            checkIn(weakEntry, s);
+        });
+    }
+
+
+    // Called when a checked-out statement is released; returns it to its entry's pool.
+    void SQLiteQueryCache::checkIn(const weak_ptr<Entry> &weakEntry, SQLite::Statement *stmt) {
+        unique_ptr<SQLite::Statement> owned(stmt);
+        auto entry = weakEntry.lock();
+        if (!entry)
+            return;
+        try {
+            owned->reset();
+            owned->clearBindings();
+        } catch (...) {
+            return;
+        }
+        lock_guard<mutex> lock(entry->_mutex);
+        if (!entry->_evicted && entry->_idle.size() < kMaxIdleStatements)
+            entry->_idle.push_back(move(owned));
+    }
+
+
+    void SQLiteQueryCache::evict(Entry &entry) {
+        lock_guard<mutex> lock(entry._mutex);
+        entry._evicted = true;
+        entry._idle.clear();
+    }
+
+
+    void SQLiteQueryCache::clear() {
+        lock_guard<mutex> lock(_mutex);
+        for (auto &item : _lru)
+            evict(*item.second);
+        _lru.clear();
+        _map.clear();
+    }
+
+}
@@ -0,0 +1,109 @@
+//
+// SQLiteQueryCache.hh
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "function_ref.hh"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace SQLite {
+    class Statement;
+}
+
+namespace litecore {
+    class SQLiteKeyStore;
+    struct DataFileStats;
+
+
+    /** A cache of compiled queries, owned by a SQLiteDataFile. Entries are keyed by KeyStore name
+        and normalized query expression, so equivalent queries share one. Each entry holds the SQL
+        and metadata produced by the QueryParser, plus a pool of idle prepared statements.
+        A statement is checked out for the exclusive use of one query run, and goes back to the
+        pool when its last shared_ptr is released. Past kMaxEntries, the least recently used
+        entry is evicted; queries already using it keep it alive.
+        Each entry is stamped with SQLiteDataFile::queryCacheStamp() as of its translation, and
+        isn't returned once the stamp changes, since another connection may have changed the
+        indexes the translation depended on. */
+    class SQLiteQueryCache {
+    public:
+        static constexpr size_t kMaxEntries = 50;
+        static constexpr size_t kMaxIdleStatements = 4;     // per entry
+
+        using Stamp = std::pair<int64_t, uint64_t>;         // see SQLiteDataFile::queryCacheStamp
+
+        class Entry {
+        public:
+            std::string sql;                        // SQL translation of the query
+            std::set<std::string> parameters;       // Names of the bindable parameters
+            std::vector<std::string> ftsTables;     // Names of the FTS tables used
+            std::vector<std::string> columnTitles;  // Titles of columns
+            std::string fromAndWhereSQL;            // Empty if not single-source
+            unsigned firstCustomResultColumn {0};   // Column index of the 1st column in JSON
+            int columnCount {0};                    // Number of columns the statement returns
+            bool usesExpiration {false};
+
+        private:
+            friend class SQLiteQueryCache;
+            std::mutex _mutex;
+            std::vector<std::unique_ptr<SQLite::Statement>> _idle;  // Statements not in use
+            Stamp _stamp;                           // Schema/index state it was translated with
+            bool _evicted {false};                  // If true, released statements are freed
+        };
+
+        SQLiteQueryCache(DataFileStats &stats)          :_stats(stats) { }
+        ~SQLiteQueryCache();
+
+        /** Returns the entry with the given key; if there is none, or it's stale, creates one,
+            calls `compile` to fill it in, and prepares its first statement. (That's done without
+            holding the cache's lock, so other threads' lookups don't wait for it.) Exceptions
+            thrown by `compile` or by SQLite propagate, and nothing is cached. */
+        std::shared_ptr<Entry> get(const std::string &key,
+                                   const SQLiteKeyStore&,
+                                   function_ref<void(Entry&)> compile);
+
+        /** Returns a prepared statement of an entry for exclusive use, compiling a new one if
+            all the entry's statements are in use. */
+        std::shared_ptr<SQLite::Statement> checkOut(const std::shared_ptr<Entry>&,
+                                                    const SQLiteKeyStore&);
+
+        /** Removes all entries and frees their idle statements. Called when the database closes
+            or when its indexes change, since those affect the QueryParser's translation. */
+        void clear();
+
+        size_t size() const;
+
+    private:
+        using LRUList = std::list<std::pair<std::string, std::shared_ptr<Entry>>>;
+
+        static void evict(Entry&);
+        void remove(LRUList::iterator);
+        static void checkIn(const std::weak_ptr<Entry>&, SQLite::Statement*);
+
+        DataFileStats& _stats;
+        mutable std::mutex _mutex;
+        LRUList _lru;                                               // Most recently used first
+        std::unordered_map<std::string, LRUList::iterator> _map;    // Keys to items of _lru
+    };
+
+}
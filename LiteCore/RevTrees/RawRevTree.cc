@@ -38,7 +38,8 @@ namespace litecore {
     std::deque<Rev> RawRevision::decodeTree(slice raw_tree,
                                             RevTree::RemoteRevMap &remoteMap,
                                             RevTree* owner,
-                                            sequence_t curSeq)
+                                            sequence_t curSeq,
+                                            const slice *currentBody)
     {
         const RawRevision *rawRev = (const RawRevision*)raw_tree.buf;
         unsigned count = rawRev->count();
@@ -53,6 +54,8 @@ namespace litecore {
             rev->owner = owner;
             rev++;
         }
+        if (currentBody && count > 0 && revs[0]._body)
+            revs[0]._body = *currentBody;
 
         auto entry = (const RemoteEntry*)offsetby(rawRev, sizeof(uint32_t));
         while (entry < raw_tree.end()) {
@@ -72,20 +75,26 @@ namespace litecore {
 
 
     alloc_slice RawRevision::encodeTree(const vector<Rev*> &revs,
-                                        const RevTree::RemoteRevMap &remoteMap)
+                                        const RevTree::RemoteRevMap &remoteMap,
+                                        bool omitCurrentBody)
     {
         // Allocate output buffer:
         size_t totalSize = sizeof(uint32_t);  // start with space for trailing 0 size
-        for (Rev *rev : revs)
-            totalSize += sizeToWrite(*rev);
+        bool withBody = !omitCurrentBody;
+        for (Rev *rev : revs) {
+            totalSize += sizeToWrite(*rev, withBody);
+            withBody = true;
+        }
         totalSize += remoteMap.size() * sizeof(RemoteEntry);
 
         alloc_slice result(totalSize);
 
         // Write the raw revs:
         RawRevision *dst = (RawRevision*)result.buf;
+        withBody = !omitCurrentBody;
         for (Rev *src : revs) {
-            dst = dst->copyFrom(*src);
+            dst = dst->copyFrom(*src, withBody);
+            withBody = true;
         }
         dst->size_BE = _enc32(0);   // write trailing 0 size marker
 
@@ -101,15 +110,15 @@ namespace litecore {
     }
 
 
-    size_t RawRevision::sizeToWrite(const Rev &rev) {
+    size_t RawRevision::sizeToWrite(const Rev &rev, bool withBody) {
         return offsetof(RawRevision, revID)
              + rev.revID.size
              + SizeOfVarInt(rev.sequence)
-             + rev._body.size;
+             + (withBody ? rev._body.size : 0);
     }
 
-    RawRevision* RawRevision::copyFrom(const Rev &rev) {
-        size_t revSize = sizeToWrite(rev);
+    RawRevision* RawRevision::copyFrom(const Rev &rev, bool withBody) {
+        size_t revSize = sizeToWrite(rev, withBody);
         this->size_BE = _enc32((uint32_t)revSize);
         this->revIDLen = (uint8_t)rev.revID.size;
         memcpy(this->revID, rev.revID.buf, rev.revID.size);
@@ -118,11 +127,14 @@ namespace litecore {
         uint8_t dstFlags = rev.flags & ~kNonPersistentFlags;
         if (rev._body)
             dstFlags |= RawRevision::kHasData;
+        if (rev._bodyIsDelta && withBody)
+            dstFlags |= RawRevision::kIsDelta;
         this->flags = (Rev::Flags)dstFlags;
 
         void *dstData = offsetby(&this->revID[0], rev.revID.size);
         dstData = offsetby(dstData, PutUVarInt(dstData, rev.sequence));
-        memcpy(dstData, rev._body.buf, rev._body.size);
+        if (withBody)
+            memcpy(dstData, rev._body.buf, rev._body.size);
 
         return (RawRevision*)offsetby(this, revSize);
     }
@@ -143,6 +155,7 @@ namespace litecore {
             dst._body = slice(data, end);
         else
             dst._body = nullslice;
+        dst._bodyIsDelta = (this->flags & RawRevision::kIsDelta) != 0;
     }
 
 
@@ -34,15 +34,20 @@ namespace litecore {
     // Revs are stored in decending priority, with the current leaf rev(s) coming first.
     // Following the revs is a series of (remote DB ID, revision index) pairs that mark which
     // revision is the current one for every remote database.
+    // In split form, the first (current) rev keeps its HasData flag but its data is omitted;
+    // the body is stored elsewhere and passed to decodeTree as `currentBody`.
+    // A rev with the IsDelta flag has a JSON delta from the first rev's body as its data.
     class RawRevision {
     public:
         static std::deque<Rev> decodeTree(slice raw_tree,
                                           RevTree::RemoteRevMap &remoteMap,
                                           RevTree *owner NONNULL,
-                                          sequence_t curSeq);
+                                          sequence_t curSeq,
+                                          const slice *currentBody =nullptr);
 
         static alloc_slice encodeTree(const std::vector<Rev*> &revs,
-                                      const RevTree::RemoteRevMap &remoteMap);
+                                      const RevTree::RemoteRevMap &remoteMap,
+                                      bool omitCurrentBody =false);
 
         static inline slice getCurrentRevBody(slice raw_tree) noexcept {
             const RawRevision *rawRev = (const RawRevision*)raw_tree.buf;
@@ -55,8 +60,10 @@ namespace litecore {
         // Private RevisionFlags bits used in encoded form:
         enum : uint8_t {
             kHasData = 0x80,  /**< Does this raw rev contain JSON/Fleece data? */
+            kIsDelta = 0x04,  /**< Is the data a delta? (Reuses the bit of kNew, never saved;
+                                   files with deltas have a newer schema version) */
             kNonPersistentFlags  = (Rev::kNew),         // Not saved to disk
-            kPersistentOnlyFlags = (kHasData),          // Only used on disk, not in memory
+            kPersistentOnlyFlags = (kHasData | kIsDelta), // Only used on disk, not in memory
         };
 
         uint32_t        size_BE;        // Total size of this tree rev (big-endian)
@@ -86,9 +93,9 @@ namespace litecore {
             return count;
         }
 
-        static size_t sizeToWrite(const Rev&);
+        static size_t sizeToWrite(const Rev&, bool withBody =true);
         void copyTo(Rev &dst, const std::deque<Rev>&) const;
-        RawRevision* copyFrom(const Rev &rev);
+        RawRevision* copyFrom(const Rev &rev, bool withBody =true);
     };
 
 #pragma pack()
@@ -45,6 +45,7 @@ namespace litecore {
     ,_sorted(other._sorted)
     ,_changed(other._changed)
     ,_unknown(other._unknown)
+    ,_deltaBodies(other._deltaBodies)
     {
         // It's important to have _revs in the same order as other._revs.
         // That means we can't just copy other._revsStorage to _revsStorage;
@@ -64,6 +65,8 @@ namespace litecore {
         for (auto &i : other._remoteRevs) {
             _remoteRevs[i.first] = _revs[i.second->index()];
         }
+        if (other._deltaBase)
+            _deltaBase = _revs[other._deltaBase->index()];
     }
 
     void RevTree::decode(litecore::slice raw_tree, sequence_t seq) {
@@ -71,20 +74,37 @@ namespace litecore {
         initRevs();
     }
 
+    void RevTree::decodeSplit(slice raw_tree, slice currentBody, sequence_t seq) {
+        _revsStorage = RawRevision::decodeTree(raw_tree, _remoteRevs, this, seq, &currentBody);
+        initRevs();
+    }
+
     void RevTree::initRevs() {
         _revs.resize(_revsStorage.size());
+        _deltaBase = nullptr;
         auto i = _revs.begin();
         for (Rev &rev : _revsStorage) {
             *i = &rev;
             ++i;
+            // Delta bodies are always relative to the first rev in the encoded tree:
+            if (rev._bodyIsDelta)
+                _deltaBase = _revs[0];
         }
     }
 
     alloc_slice RevTree::encode() {
         sort();
+        encodeDeltaBodies();
         return RawRevision::encodeTree(_revs, _remoteRevs);
     }
 
+    alloc_slice RevTree::encodeSplit(slice &outCurrentBody) {
+        sort();
+        encodeDeltaBodies();
+        outCurrentBody = _revs.empty() ? nullslice : _revs[0]->_body;
+        return RawRevision::encodeTree(_revs, _remoteRevs, true);
+    }
+
 #if DEBUG
     void Rev::dump(std::ostream& out) {
         out << "(" << sequence << ") " << (std::string)revID.expanded() << "  ";
@@ -164,7 +184,13 @@ namespace litecore {
 
     slice Rev::body() const {
         slice body = _body;
-        if ((size_t)body.buf & 1) {
+        if (_usuallyFalse(_bodyIsDelta)) {
+            // Body is stored as a delta, so reconstruct it:
+            auto xthis = const_cast<Rev*>(this);
+            auto xowner = const_cast<RevTree*>(owner);
+            body = xthis->_body = (slice)xowner->copyBody(owner->readBodyOfRevision(this));
+            xthis->_bodyIsDelta = false;
+        } else if ((size_t)body.buf & 1) {
             // Fleece data must be 2-byte-aligned, so we have to copy body to the heap:
             auto xthis = const_cast<Rev*>(this);
             auto xowner = const_cast<RevTree*>(owner);
@@ -210,6 +236,10 @@ namespace litecore {
     }
 
     alloc_slice RevTree::readBodyOfRevision(const Rev* rev) const {
+        if (rev->_bodyIsDelta) {
+            Assert(_deltaBase && !_deltaBase->_bodyIsDelta);
+            return applyBodyDelta(_deltaBase->body(), rev->_body);
+        }
         if (rev->_body.buf != nullptr)
             return alloc_slice(rev->_body);
         return alloc_slice(); // VersionedDocument overrides this
@@ -241,6 +271,16 @@ namespace litecore {
     }
 
 
+    alloc_slice RevTree::createBodyDelta(slice baseBody, slice body) {
+        return nullslice;   // VersionedDocument overrides this
+    }
+
+
+    alloc_slice RevTree::applyBodyDelta(slice baseBody, slice delta) const {
+        error::_throw(error::Unimplemented);   // VersionedDocument overrides this
+    }
+
+
     // Lowest-level insert method. Does no sanity checking, always inserts.
     Rev* RevTree::_insert(revid unownedRevID,
                           alloc_slice body,
@@ -422,6 +462,8 @@ namespace litecore {
     }
 
     void RevTree::removeBody(const Rev* rev) {
+        if (rev == _deltaBase)
+            expandDeltaBodies();
         if (rev->body()) {
             const_cast<Rev*>(rev)->removeBody();
             _changed = true;
@@ -432,6 +474,8 @@ namespace litecore {
     void RevTree::removeNonLeafBodies() {
         for (Rev *rev : _revs) {
             if (rev->_body.size > 0 && !(rev->flags & (Rev::kLeaf | Rev::kNew | Rev::kKeepBody))) {
+                if (rev == _deltaBase)
+                    expandDeltaBodies();
                 rev->removeBody();
                 _changed = true;
             }
@@ -506,12 +550,16 @@ namespace litecore {
     int RevTree::purgeAll() {
         int result = (int)_revs.size();
         _revs.resize(0);
+        _deltaBase = nullptr;
         _changed = true;
         _sorted = true;
         return result;
     }
 
     void RevTree::compact() {
+        if (_deltaBase && _deltaBase->isMarkedForPurge())
+            expandDeltaBodies();
+
         // Slide the surviving revs down:
         auto dst = _revs.begin();
         for (auto rev = dst; rev != _revs.end(); rev++) {
@@ -534,6 +582,42 @@ namespace litecore {
     }
 
 
+#pragma mark - DELTA BODIES:
+
+    // Stores the kept bodies of non-leaf revs as deltas from the current rev's body.
+    // Called just before encoding, after sorting.
+    void RevTree::encodeDeltaBodies() {
+        const Rev *base = _revs.empty() ? nullptr : _revs[0];
+        if (_deltaBase && _deltaBase != base)
+            expandDeltaBodies();            // Existing deltas are from a no-longer-current rev
+        if (!_deltaBodies || !base)
+            return;
+        slice baseBody = base->body();
+        if (baseBody.size == 0)
+            return;
+        for (Rev *rev : _revs) {
+            if (rev != base && !rev->isLeaf() && !rev->_bodyIsDelta && rev->_body.size > 0) {
+                alloc_slice delta = createBodyDelta(baseBody, rev->body());
+                if (delta && delta.size < rev->_body.size) {
+                    // (Not a virtual call, since the delta isn't Fleece data)
+                    rev->_body = (slice)RevTree::copyBody(delta);
+                    rev->_bodyIsDelta = true;
+                    _deltaBase = base;
+                }
+            }
+        }
+    }
+
+    // Reconstructs all delta bodies; called before the delta base's body goes away.
+    void RevTree::expandDeltaBodies() {
+        for (Rev *rev : _revs) {
+            if (rev->_bodyIsDelta)
+                (void)rev->body();
+        }
+        _deltaBase = nullptr;
+    }
+
+
 #pragma mark - SORT / SAVE:
 
     // Sort comparison function for an array of Revisions. Higher priority comes _first_, so this
@@ -74,11 +74,12 @@ namespace litecore {
 
     private:
         slice       _body;          /**< Revision body (JSON), or empty if not stored in this tree*/
+        bool        _bodyIsDelta {false}; /**< If true, _body is a delta from the delta base */
 
         void addFlag(Flags f)           {flags = (Flags)(flags | f);}
         void clearFlag(Flags f)         {flags = (Flags)(flags & ~f);}
         void removeBody()               {clearFlag((Flags)(kKeepBody | kHasAttachments));
-                                         _body = nullslice;}
+                                         _body = nullslice; _bodyIsDelta = false;}
         bool isMarkedForPurge() const   {return (flags & kPurge) != 0;}
 #if DEBUG
         void dump(std::ostream&);
@@ -98,8 +99,15 @@ namespace litecore {
 
         void decode(slice raw_tree, sequence_t seq);
 
+        /** Decodes a tree produced by encodeSplit, given the current revision's body. */
+        void decodeSplit(slice raw_tree, slice currentBody, sequence_t seq);
+
         alloc_slice encode();
 
+        /** Encodes the tree without the current revision's body, which is instead returned in
+            `outCurrentBody` so the caller can store it separately. */
+        alloc_slice encodeSplit(slice &outCurrentBody);
+
         size_t size() const                             {return _revs.size();}
         const Rev* get(unsigned index) const;
         const Rev* get(revid) const;
@@ -151,6 +159,14 @@ namespace litecore {
 
         void removeNonLeafBodies();
 
+        /** If true, the kept bodies of non-leaf revisions are encoded as deltas from the current
+            revision's body, and reconstructed when accessed. Requires a subclass that implements
+            createBodyDelta and applyBodyDelta. */
+        void setDeltaBodies(bool delta)                 {_deltaBodies = delta;}
+
+        /** True if any revision's body is stored as a delta. */
+        bool hasDeltaBodies() const                     {return _deltaBase != nullptr;}
+
         /** Removes a leaf revision and any of its ancestors that aren't shared with other leaves. */
         int purge(revid);
         int purgeAll();
@@ -178,6 +194,8 @@ namespace litecore {
         virtual alloc_slice readBodyOfRevision(const Rev* r NONNULL) const;
         virtual alloc_slice copyBody(slice body);
         virtual alloc_slice copyBody(const alloc_slice &body);
+        virtual alloc_slice createBodyDelta(slice baseBody, slice body);
+        virtual alloc_slice applyBodyDelta(slice baseBody, slice delta) const;
 #if DEBUG
         virtual void dump(std::ostream&);
 #endif
@@ -193,6 +211,8 @@ namespace litecore {
         bool confirmLeaf(Rev* testRev NONNULL);
         void compact();
         void checkForResolvedConflict();
+        void encodeDeltaBodies();
+        void expandDeltaBodies();
 
         using RemoteRevMap = std::unordered_map<RemoteID, const Rev*>;
 
@@ -202,6 +222,8 @@ namespace litecore {
         std::vector<alloc_slice> _insertedData;         // Storage for new revids
         RemoteRevMap             _remoteRevs;           // Tracks current rev for a remote DB URL
         unsigned                 _pruneDepth {UINT_MAX};// Tree depth to prune to
+        const Rev*               _deltaBase {nullptr};  // Rev whose body delta bodies apply to
+        bool                     _deltaBodies {false};  // Encode kept bodies as deltas?
     };
 
 }
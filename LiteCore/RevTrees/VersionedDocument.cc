@@ -22,6 +22,9 @@
 #include "DataFile.hh"
 #include "Error.hh"
 #include "Doc.hh"
+#include "Encoder.hh"
+#include "JSONDelta.hh"
+#include "SharedKeys.hh"
 #include "varint.hh"
 #include "MutableArray.hh"
 #include "MutableDict.hh"
@@ -60,11 +63,22 @@ namespace litecore {
         decode();
     }
 
+    // With split bodies, the record's `extra` holds the encoded tree and its `body` holds just
+    // the current revision's body; otherwise the body holds the entire encoded tree.
+    bool VersionedDocument::splitBodies() const {
+        return _store.dataFile().options().splitBodies;
+    }
+
     void VersionedDocument::decode() {
         _unknown = false;
         updateScope();
-        if (_rec.body().buf) {
-            RevTree::decode(_rec.body(), _rec.sequence());
+        bool split = splitBodies();
+        slice rawTree = split ? _rec.extra() : _rec.body();
+        if (rawTree.buf) {
+            if (split)
+                RevTree::decodeSplit(rawTree, _rec.body(), _rec.sequence());
+            else
+                RevTree::decode(rawTree, _rec.sequence());
             // The kSynced flag is set when the document's current revision is pushed to a server.
             // This is done instead of updating the doc body, for reasons of speed. So when loading
             // the document, detect that flag and belatedly update the current revision's flags.
@@ -75,7 +89,7 @@ namespace litecore {
                 keepBody(currentRevision());
                 _changed = false;
             }
-        } else if (_rec.bodySize() > 0) {
+        } else if (split ? _rec.exists() : _rec.bodySize() > 0) {
             _unknown = true;        // i.e. rec was read as meta-only
         }
     }
@@ -83,6 +97,7 @@ namespace litecore {
     void VersionedDocument::updateScope() {
         Assert(_fleeceScopes.empty());
         addScope(_rec.body());
+        addScope(_rec.extra());
     }
 
     alloc_slice VersionedDocument::addScope(const alloc_slice &body) {
@@ -122,6 +137,32 @@ namespace litecore {
         return addScope(RevTree::copyBody(body));
     }
 
+    // Delta bodies are JSON deltas between the Fleece bodies (see RevTree::setDeltaBodies.)
+    alloc_slice VersionedDocument::createBodyDelta(slice baseBody, slice body) {
+        const Value *baseRoot = Value::fromTrustedData(baseBody);
+        const Value *root = Value::fromTrustedData(body);
+        if (!baseRoot || !root)
+            return nullslice;
+        return JSONDelta::create(baseRoot, root);
+    }
+
+    alloc_slice VersionedDocument::applyBodyDelta(slice baseBody, slice delta) const {
+        const Value *baseRoot = Value::fromTrustedData(baseBody);
+        if (!baseRoot)
+            error::_throw(error::CorruptRevisionData);
+        // Encode the result with the SharedKeys the base body was read with. The result's keys
+        // all appeared in a body encoded with them before, so encoding it doesn't add any keys
+        // (which would require a transaction) -- as long as this connection's copy of the keys
+        // isn't stale, as a pooled reader's can be, so bring it up to date first:
+        SharedKeys *sharedKeys = baseRoot->sharedKeys();
+        if (auto persistentKeys = dynamic_cast<PersistentSharedKeys*>(sharedKeys))
+            persistentKeys->refresh();
+        Encoder enc;
+        enc.setSharedKeys(sharedKeys);
+        JSONDelta::apply(baseRoot, delta, false, enc);
+        return enc.finish();
+    }
+
     const fleece::impl::Scope& VersionedDocument::scopeFor(slice s) const {
         for (auto &scope : _fleeceScopes) {
             if (scope.data().containsAddressRange(s))
@@ -167,11 +208,20 @@ namespace litecore {
         bool createSequence;
         if (currentRevision()) {
             removeNonLeafBodies();
-            auto newBody = encode();
+            alloc_slice newBody, newExtra;
+            slice currentBody;
+            if (splitBodies()) {
+                newExtra = encodeSplit(currentBody);
+            } else {
+                newBody = encode();
+                currentBody = newBody;
+            }
             createSequence = seq == 0 || hasNewRevisions();
+            if (hasDeltaBodies())
+                _store.dataFile().willSaveDeltaBodies();
             // (Don't call _rec.setBody(), because it'd invalidate all the inner pointers from
             // Revs into the existing body buffer.)
-            seq = _store.set(_rec.key(), _rec.version(), newBody, _rec.flags(),
+            seq = _store.set(_rec.key(), _rec.version(), currentBody, newExtra, _rec.flags(),
                           transaction, &seq, createSequence);
             if (!seq)
                 return kConflict;               // Conflict
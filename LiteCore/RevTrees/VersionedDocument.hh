@@ -80,6 +80,8 @@ namespace litecore {
     protected:
         virtual alloc_slice copyBody(slice body) override;
         virtual alloc_slice copyBody(const alloc_slice &body) override;
+        virtual alloc_slice createBodyDelta(slice baseBody, slice body) override;
+        virtual alloc_slice applyBodyDelta(slice baseBody, slice delta) const override;
 #if DEBUG
         virtual void dump(std::ostream&) override;
 #endif
@@ -96,6 +98,7 @@ namespace litecore {
             VersionedDocument* const document;
         };
 
+        bool splitBodies() const;
         void decode();
         void updateScope();
         alloc_slice addScope(const alloc_slice &body);
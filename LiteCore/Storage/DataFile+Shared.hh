@@ -10,8 +10,13 @@
 #include "Error.hh"
 #include "Logging.hh"
 #include "InstanceCounted.hh"
+#include "Instrumentation.hh"
+#include "DataFileStats.hh"
+#include "Stopwatch.hh"
+#include <atomic>
 #include <mutex>              // std::mutex, std::unique_lock
 #include <condition_variable> // std::condition_variable
+#include <chrono>
 #include <unordered_map>
 #include <algorithm>
 
@@ -21,7 +26,8 @@ namespace litecore {
 
 
     /** Shared state between all open DataFile instances on the same filesystem file.
-        Manages a mutex that ensures that only one DataFile can open a transaction at once.
+        Manages a mutex that ensures that only one DataFile can open a transaction at once,
+        and a pool of read-only DataFiles for concurrent readers.
         This class is internal to DataFile. */
     class DataFile::Shared : public RefCounted, fleece::InstanceCountedIn<RefCounted>, Logging {
     public:
@@ -110,8 +116,14 @@ namespace litecore {
         void setTransaction(Transaction* t) {
             Assert(t);
             unique_lock<mutex> lock(_transactionMutex);
-            while (_transaction != nullptr)
-                _transactionCond.wait(lock);
+            if (_transaction != nullptr) {
+                Signpost signpost(Signpost::transactionWait, uintptr_t(t));
+                fleece::Stopwatch st;
+                while (_transaction != nullptr)
+                    _transactionCond.wait(lock);
+                DataFileStats::add(stats.transactionWaits);
+                stats.transactionWaitTime.record(st.elapsed());
+            }
             _transaction = t;
         }
 
@@ -140,6 +152,108 @@ namespace litecore {
         }
 
 
+        //////// READER POOL:
+
+
+        // Returns an idle pooled reader that uses the same delegate as `owner`, or opens a new
+        // one if the pool isn't full; otherwise waits for a reader to be returned, or if `wait`
+        // is false returns null.
+        DataFile* borrowReader(DataFile *owner, bool wait =true) {
+            unsigned poolSize = owner->options().readerPoolSize;
+            if (poolSize == 0)
+                poolSize = kDefaultReaderPoolSize;
+            DataFile *evicted = nullptr;
+            {
+                unique_lock<mutex> lock(_readerMutex);
+                for (;;) {
+                    auto i = find_if(_idleReaders.begin(), _idleReaders.end(), [&](DataFile *r) {
+                        return r->delegate() == owner->delegate();
+                    });
+                    if (i != _idleReaders.end()) {
+                        DataFile *reader = *i;
+                        _idleReaders.erase(i);
+                        _busyReaders.push_back(reader);
+                        return reader;
+                    }
+                    if (_idleReaders.size() + _busyReaders.size() < poolSize)
+                        break;
+                    if (!_idleReaders.empty()) {
+                        // Pool is full, but an idle reader belongs to another delegate; replace it:
+                        evicted = _idleReaders.front();
+                        _idleReaders.erase(_idleReaders.begin());
+                        break;
+                    }
+                    if (!wait)
+                        return nullptr;
+                    _readerCond.wait(lock);
+                }
+                _busyReaders.push_back(nullptr);    // Reserve a slot while opening
+            }
+            delete evicted;
+
+            DataFile *reader = nullptr;
+            try {
+                auto options = owner->options();
+                options.create = options.writeable = options.upgradeable = false;
+                options.pooledReader = true;
+                reader = owner->factory().openFile(owner->filePath(), owner->delegate(), &options);
+                logVerbose("Opened pooled reader %p", reader);
+            } catch (...) {
+                reserveReaderSlot(nullptr, nullptr);
+                throw;
+            }
+            reserveReaderSlot(nullptr, reader);
+            return reader;
+        }
+
+
+        // Returns a reader to the pool after use.
+        void returnReader(DataFile *reader) {
+            unique_lock<mutex> lock(_readerMutex);
+            auto i = find(_busyReaders.begin(), _busyReaders.end(), reader);
+            Assert(i != _busyReaders.end());
+            _busyReaders.erase(i);
+            _idleReaders.push_back(reader);
+            _readerCond.notify_all();
+        }
+
+
+        // Closes all pooled readers using `delegate` (or all readers if it's null), first waiting
+        // for any in use to be returned. If `timeoutSecs` is non-negative and some are still in
+        // use after that long, closes just the idle ones and throws Busy.
+        void closeReaders(Delegate *delegate, double timeoutSecs =-1) {
+            auto matches = [=](DataFile *r) {
+                return r == nullptr || delegate == nullptr || r->delegate() == delegate;
+            };
+            vector<DataFile*> closing;
+            bool timedOut = false;
+            {
+                unique_lock<mutex> lock(_readerMutex);
+                auto deadline = chrono::steady_clock::now()
+                              + chrono::duration<double>(max(timeoutSecs, 0.0));
+                while (any_of(_busyReaders.begin(), _busyReaders.end(), matches)) {
+                    if (timeoutSecs < 0) {
+                        _readerCond.wait(lock);
+                    } else if (_readerCond.wait_until(lock, deadline) == cv_status::timeout) {
+                        timedOut = any_of(_busyReaders.begin(), _busyReaders.end(), matches);
+                        break;
+                    }
+                }
+                auto i = stable_partition(_idleReaders.begin(), _idleReaders.end(),
+                                          [&](DataFile *r) {return !matches(r);});
+                closing.assign(i, _idleReaders.end());
+                _idleReaders.erase(i, _idleReaders.end());
+                _readerCond.notify_all();
+            }
+            if (!closing.empty())
+                logVerbose("Closing %zu pooled readers", closing.size());
+            for (auto reader : closing)
+                delete reader;
+            if (timedOut)
+                error::_throw(error::Busy, "Pooled readers of the database are still in use");
+        }
+
+
     protected:
         Shared(const string &p)
         :Logging(DBLog)
@@ -154,11 +268,28 @@ namespace litecore {
             sFileMap.erase(path);
         }
 
+        // Replaces a busy-reader slot (nullptr means a slot reserved while opening a reader.)
+        // Passing a null `newReader` removes the slot.
+        void reserveReaderSlot(DataFile *oldReader, DataFile *newReader) {
+            unique_lock<mutex> lock(_readerMutex);
+            auto i = find(_busyReaders.begin(), _busyReaders.end(), oldReader);
+            Assert(i != _busyReaders.end());
+            if (newReader)
+                *i = newReader;
+            else
+                _busyReaders.erase(i);
+            _readerCond.notify_all();
+        }
+
         void mustNotBeCondemned() {
             if (_condemned)
                 error::_throw(error::Busy, "Database file is being deleted");
         }
 
+        DataFileStats stats;                        // Performance counters of the file
+        atomic<uint64_t> indexGeneration {0};       // Incremented when any DataFile's indexes change
+        atomic<bool> compressedBlobsStored {false}; // Set when a compressed blob is stored
+
 
     private:
         mutex              _transactionMutex;       // Mutex for transactions
@@ -168,6 +299,10 @@ namespace litecore {
         unordered_map<string, Retained<RefCounted>> _sharedObjects;
         bool               _condemned {false};      // Prevents db from being opened or deleted
         mutex              _mutex;                  // Mutex for non-transaction state
+        mutex              _readerMutex;            // Mutex for the reader pool
+        condition_variable _readerCond;             // Signals changes to the reader pool
+        vector<DataFile*>  _idleReaders;            // Pooled readers available for use
+        vector<DataFile*>  _busyReaders;            // Pooled readers currently borrowed
 
         static unordered_map<string, Shared*> sFileMap;
         static mutex sFileMapMutex;
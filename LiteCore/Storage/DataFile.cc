@@ -101,7 +101,8 @@ namespace litecore {
 
     const DataFile::Options DataFile::Options::defaults = DataFile::Options {
         {true},                 // sequences
-        true, true, true, true  // create, writeable, useDocumentKeys, upgradeable
+        true, true, true, true, // create, writeable, useDocumentKeys, upgradeable
+        false, false, false     // splitBodies, compressBodies, pooledReader
     };
 
 
@@ -112,7 +113,9 @@ namespace litecore {
     ,_options(options ? *options : Options::defaults)
     {
         // Do this last so I'm fully constructed before other threads can see me (#425)
-        _shared = Shared::forPath(path, this);
+        // (Pooled readers are tracked by the reader pool, not as regular open DataFiles.)
+        _shared = Shared::forPath(path, _options.pooledReader ? nullptr : this);
+        _stats = &_shared->stats;
     }
 
 
@@ -139,9 +142,10 @@ namespace litecore {
         //    other classes with interest in the data file do not continue to
         //    operate on it
         _closeSignaled = true;
-        for (auto &query : _queries)
-            query->close();
-        _queries.clear();
+        // (Close queries first, since their enumerators may have borrowed pooled readers.)
+        closeQueries();
+        if (!_options.pooledReader)
+            _shared->closeReaders(_delegate);
 
         for (auto& i : _keyStores) {
             i.second->close();
@@ -154,7 +158,8 @@ namespace litecore {
 
     void DataFile::reopen() {
         logInfo("Opening database");
-        _shared->addDataFile(this);
+        if (!_options.pooledReader)
+            _shared->addDataFile(this);
     }
 
 
@@ -181,6 +186,75 @@ namespace litecore {
     }
 
 
+#pragma mark - READER POOL:
+
+
+    void DataFile::useReader(function_ref<void(DataFile*)> fn) {
+        BorrowedReader reader(*this);
+        fn(reader.get());
+    }
+
+
+    DataFile::BorrowedReader::BorrowedReader(DataFile &owner, bool wait)
+    :_owner(owner)
+    {
+        owner.checkOpen();
+        if (!wait && owner._inTransaction) {
+            // A reader wouldn't see the transaction's changes; the caller should use the owner.
+            _reader = nullptr;
+            return;
+        }
+        _reader = owner._shared->borrowReader(&owner, wait);
+        if (!_reader)
+            return;
+        try {
+            _transaction.reset(new ReadOnlyTransaction(_reader));
+        } catch (...) {
+            owner._shared->returnReader(_reader);
+            throw;
+        }
+    }
+
+
+    DataFile::BorrowedReader::~BorrowedReader() {
+        if (_reader) {
+            _transaction.reset();
+            _owner._shared->returnReader(_reader);
+        }
+    }
+
+
+    void DataFile::closeReaders() {
+        _shared->closeReaders(nullptr, kOtherDBCloseTimeoutSecs);
+    }
+
+
+    uint64_t DataFile::indexGeneration() const {
+        return _shared->indexGeneration;
+    }
+
+
+    void DataFile::bumpIndexGeneration() {
+        ++_shared->indexGeneration;
+    }
+
+
+    void DataFile::willStoreCompressedBlobs() {
+        _shared->compressedBlobsStored = true;
+    }
+
+
+    void DataFile::closeQueries() {
+        auto queries = move(_queries);
+        _queries.clear();
+        for (auto &query : queries)
+            query->close();
+    }
+
+
+#pragma mark - SHARED OBJECTS:
+
+
     Retained<RefCounted> DataFile::sharedObject(const string &key) {
         return _shared->sharedObject(key);
     }
@@ -208,6 +282,13 @@ namespace litecore {
     {
         shared->condemn(true);
         try {
+            // Pooled readers don't count as other connections; just close them (after closing
+            // the queries that may be using them), giving ones borrowed by other connections
+            // the same time to be returned as those connections get to close:
+            if (file)
+                file->closeQueries();
+            shared->closeReaders(nullptr, kOtherDBCloseTimeoutSecs);
+
             // Wait for other connections to close -- in multithreaded setups there may be races where
             // another thread takes a bit longer to close its connection.
             int n = 0;
@@ -323,6 +404,8 @@ namespace litecore {
     }
 
     void DataFile::transactionEnding(Transaction*, bool committing) {
+        if (committing && _shared->compressedBlobsStored)
+            markCompressedBlobs();
         if (_documentKeys) {
             if (committing)
                 _documentKeys->save();
@@ -346,7 +429,8 @@ namespace litecore {
 
 
     void DataFile::withFileLock(function_ref<void(void)> fn) {
-        if (_inTransaction) {
+        // (Pooled readers can't write, and mustn't block on a transaction in another DataFile.)
+        if (_inTransaction || _options.pooledReader) {
             fn();
         } else {
             Transaction t(this, false);
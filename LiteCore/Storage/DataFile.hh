@@ -22,6 +22,7 @@
 #include "Logging.hh"
 #include "RefCounted.hh"
 #include "InstanceCounted.hh"          // For fleece::InstanceCountedIn
+#include "DataFileStats.hh"
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -64,8 +65,12 @@ namespace litecore {
             bool                writeable      :1;      ///< If false, db is opened read-only
             bool                useDocumentKeys:1;      ///< Use SharedKeys for Fleece docs
             bool                upgradeable    :1;      ///< DB schema can be upgraded
+            bool                splitBodies    :1;      ///< Store `extra` apart from the body
+            bool                compressBodies :1;      ///< Compress bodies (and `extra`)
+            bool                pooledReader   :1;      ///< Internal: opened by the reader pool
             EncryptionAlgorithm encryptionAlgorithm;    ///< What encryption (if any)
             alloc_slice         encryptionKey;          ///< Encryption key, if encrypting
+            unsigned            readerPoolSize;         ///< Max pooled readers (0 = default)
             static const Options defaults;
         };
 
@@ -75,6 +80,9 @@ namespace litecore {
         FilePath filePath() const noexcept                  {return _path;}
         const Options& options() const noexcept             {return _options;}
 
+        /** Performance counters of the database file, shared by all DataFiles open on it. */
+        DataFileStats& stats() const noexcept               {return *_stats;}
+
         bool isClosing() const noexcept                     {return _closeSignaled;}
         virtual bool isOpen() const noexcept = 0;
 
@@ -98,9 +106,36 @@ namespace litecore {
         Delegate* delegate() const                          {return _delegate;}
         fleece::impl::SharedKeys* documentKeys() const;
 
+        /** Called in a transaction before saving a record whose rev tree contains delta bodies,
+            which older versions can't read, so the file can be marked as unreadable by them. */
+        virtual void willSaveDeltaBodies()                  { }
+
+        /** Called (on any thread) before a compressed blob is added to the database's blob
+            store. Older versions can't read those, and would delete them when compacting, so the
+            next transaction committed on the file marks it as unreadable by them, before any
+            saved document can refer to the blob. */
+        void willStoreCompressedBlobs();
+
 
         void forOtherDataFiles(function_ref<void(DataFile*)> fn);
 
+        //////// READER POOL:
+
+        static constexpr unsigned kDefaultReaderPoolSize = 4;
+
+        /** Calls `fn` with a read-only DataFile on the same file, borrowed from a pool shared by
+            all DataFiles on the file, inside a ReadOnlyTransaction (i.e. a WAL snapshot.)
+            This lets multiple threads read in parallel without blocking each other or a writer.
+            If `options().readerPoolSize` readers are already in use, waits for one to be returned.
+            The reader uses this DataFile's delegate, and must not be used after `fn` returns. */
+        void useReader(function_ref<void(DataFile*)> fn);
+
+        /** Changes `options().readerPoolSize`. Should be called before any readers are borrowed;
+            readers already open aren't closed. */
+        void setReaderPoolSize(unsigned size)           {_options.readerPoolSize = size;}
+
+        class BorrowedReader;
+
         /** Private API to run a raw (e.g. SQL) query, for diagnostic purposes only */
         virtual fleece::alloc_slice rawQuery(const std::string &query) =0;
 
@@ -216,6 +251,20 @@ namespace litecore {
 
         void forOpenKeyStores(function_ref<void(KeyStore&)> fn);
 
+        /** Closes all pooled readers on this file, waiting a few seconds for any in use to be
+            returned; if some are still in use, throws Busy. */
+        void closeReaders();
+
+        /** A counter shared by all DataFiles on this file, which a subclass increments (after
+            committing) when it changes the indexes, so the others know their compiled queries
+            may be out of date. */
+        uint64_t indexGeneration() const;
+        void bumpIndexGeneration();
+
+        /** Called in a transaction about to be committed, if a compressed blob has been stored
+            (see willStoreCompressedBlobs), to mark the file as unreadable by older versions. */
+        virtual void markCompressedBlobs()                  { }
+
         virtual Factory& factory() const =0;
 
     private:
@@ -229,6 +278,7 @@ namespace litecore {
                                    Shared *shared, Factory &factory);
         
         KeyStore& addKeyStore(const std::string &name, KeyStore::Capabilities);
+        void closeQueries();
         void beginTransactionScope(Transaction*);
         void transactionBegan(Transaction*);
         void transactionEnding(Transaction*, bool committing);
@@ -240,13 +290,14 @@ namespace litecore {
 
         Delegate* const         _delegate;
         Retained<Shared>        _shared;                        // Shared state of file (lock)
+        DataFileStats*          _stats {nullptr};               // Stats, owned by _shared
         FilePath const          _path;                          // Path as given (non-canonical)
         Options                 _options;                       // Option/capability flags
         mutable KeyStore*       _defaultKeyStore {nullptr};     // The default KeyStore
         std::unordered_map<std::string, std::unique_ptr<KeyStore>> _keyStores;// Opened KeyStores
         mutable Retained<fleece::impl::PersistentSharedKeys> _documentKeys;
         std::unordered_set<Query*> _queries;                    // Query objects
-        bool                    _inTransaction {false};         // Am I in a Transaction?
+        std::atomic_bool        _inTransaction {false};         // Am I in a Transaction?
         std::atomic_bool        _closeSignaled {false};         // Have I been asked to close?
     };
 
@@ -295,4 +346,26 @@ namespace litecore {
         DataFile *_db {nullptr};
     };
 
+
+    /** A pooled reader borrowed from a DataFile for as long as this object exists, inside a
+        ReadOnlyTransaction; for when DataFile::useReader's callback won't do, e.g. for the
+        lifetime of an enumerator. It must be destructed before the owning DataFile closes.
+        If `wait` is false and the pool is exhausted, it's empty instead of waiting; it's also
+        empty if the owner is in a Transaction, whose changes a reader wouldn't see. */
+    class DataFile::BorrowedReader {
+    public:
+        explicit BorrowedReader(DataFile &owner, bool wait =true);
+        ~BorrowedReader();
+
+        DataFile* get() const                   {return _reader;}
+        explicit operator bool() const          {return _reader != nullptr;}
+
+    private:
+        BorrowedReader(const BorrowedReader&) = delete;
+
+        DataFile &_owner;
+        DataFile *_reader;
+        std::unique_ptr<ReadOnlyTransaction> _transaction;
+    };
+
 }
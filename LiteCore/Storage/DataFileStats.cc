@@ -0,0 +1,95 @@
+//
+// DataFileStats.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "DataFileStats.hh"
+#include "Encoder.hh"
+#include <algorithm>
+
+using namespace std;
+using namespace fleece;
+using namespace fleece::impl;
+
+namespace litecore {
+
+    void LatencyHistogram::record(double seconds) noexcept {
+        auto micros = uint64_t(max(seconds, 0.0) * 1e6);
+        unsigned bucket = 0;
+        while (bucket < kNumBuckets - 1 && (uint64_t(1) << bucket) <= micros)
+            ++bucket;
+        _buckets[bucket].fetch_add(1, memory_order_relaxed);
+        _count.fetch_add(1, memory_order_relaxed);
+        _totalMicros.fetch_add(micros, memory_order_relaxed);
+        auto prevMax = _maxMicros.load(memory_order_relaxed);
+        while (micros > prevMax && !_maxMicros.compare_exchange_weak(prevMax, micros,
+                                                                     memory_order_relaxed))
+            ;
+    }
+
+
+    void LatencyHistogram::writeTo(Encoder &enc) const {
+        enc.beginDictionary();
+        enc.writeKey("count"_sl);
+        enc.writeUInt(count());
+        enc.writeKey("total"_sl);
+        enc.writeDouble(_totalMicros.load(memory_order_relaxed) / 1e6);
+        enc.writeKey("max"_sl);
+        enc.writeDouble(_maxMicros.load(memory_order_relaxed) / 1e6);
+        enc.writeKey("buckets"_sl);
+        enc.beginArray();
+        unsigned n = kNumBuckets;
+        while (n > 0 && _buckets[n-1].load(memory_order_relaxed) == 0)
+            --n;
+        for (unsigned i = 0; i < n; ++i)
+            enc.writeUInt(_buckets[i].load(memory_order_relaxed));
+        enc.endArray();
+        enc.endDictionary();
+    }
+
+
+    void DataFileStats::writeTo(Encoder &enc) const {
+        auto writeCounter = [&](slice key, const atomic<uint64_t> &counter) {
+            enc.writeKey(key);
+            enc.writeUInt(counter.load(memory_order_relaxed));
+        };
+        auto writeHistogram = [&](slice key, const LatencyHistogram &histogram) {
+            enc.writeKey(key);
+            histogram.writeTo(enc);
+        };
+
+        enc.beginDictionary();
+        writeCounter("statementSteps"_sl,       statementSteps);
+        writeCounter("recordsRead"_sl,          recordsRead);
+        writeCounter("bodyBytesRead"_sl,        bodyBytesRead);
+        writeCounter("bodyBytesCompressed"_sl,  bodyBytesCompressed);
+        writeCounter("bodyBytesStored"_sl,      bodyBytesStored);
+        writeCounter("transactionWaits"_sl,     transactionWaits);
+        writeHistogram("transactionWaitTime"_sl, transactionWaitTime);
+        writeHistogram("sqliteCommitTime"_sl,   sqliteCommitTime);
+        writeHistogram("commitTime"_sl,         commitTime);
+        writeCounter("queriesRun"_sl,           queriesRun);
+        writeCounter("queryRowsRecorded"_sl,    queryRowsRecorded);
+        writeHistogram("fastForwardTime"_sl,    fastForwardTime);
+        writeCounter("queryCacheHits"_sl,       queryCacheHits);
+        writeCounter("queryCacheMisses"_sl,     queryCacheMisses);
+        writeCounter("queryCacheEvictions"_sl,  queryCacheEvictions);
+        writeCounter("statementsPrepared"_sl,   statementsPrepared);
+        writeCounter("statementsReused"_sl,     statementsReused);
+        enc.endDictionary();
+    }
+
+}
@@ -0,0 +1,82 @@
+//
+// DataFileStats.hh
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+namespace fleece { namespace impl {
+    class Encoder;
+} }
+
+namespace litecore {
+
+    /** A histogram of durations, in power-of-2 buckets: bucket 0 counts durations under 1µs,
+        and bucket i durations from 2^(i-1) up to 2^i µs; the last bucket also counts anything
+        longer. Recording is lock-free. */
+    class LatencyHistogram {
+    public:
+        static constexpr unsigned kNumBuckets = 24;         // Last one starts at ~4 sec
+
+        void record(double seconds) noexcept;
+
+        uint64_t count() const noexcept     {return _count.load(std::memory_order_relaxed);}
+
+        /** Writes a dict with the count, total & max seconds, and the bucket counts (with
+            trailing empty buckets omitted.) */
+        void writeTo(fleece::impl::Encoder&) const;
+
+    private:
+        std::atomic<uint64_t> _buckets[kNumBuckets] {};
+        std::atomic<uint64_t> _count {0};
+        std::atomic<uint64_t> _totalMicros {0};
+        std::atomic<uint64_t> _maxMicros {0};
+    };
+
+
+    /** Cumulative performance counters of a database file, shared by all DataFile instances
+        that have it open. The counters are updated with relaxed atomics, so they're cheap to
+        maintain but only approximately consistent with each other while being read. */
+    struct DataFileStats {
+        std::atomic<uint64_t> statementSteps {0};       // SQLite steps, by KeyStores & queries
+        std::atomic<uint64_t> recordsRead {0};          // Records read by KeyStores
+        std::atomic<uint64_t> bodyBytesRead {0};        // Bytes of record bodies read
+        std::atomic<uint64_t> bodyBytesCompressed {0};  // Bytes of bodies compressed on write
+        std::atomic<uint64_t> bodyBytesStored {0};      // ...and their size once compressed
+        std::atomic<uint64_t> transactionWaits {0};     // Transactions blocked by another
+        LatencyHistogram transactionWaitTime;           // ...and how long they were blocked
+        LatencyHistogram sqliteCommitTime;              // Time of the SQLite COMMIT
+        LatencyHistogram commitTime;                    // Database commit, incl. notifications
+        std::atomic<uint64_t> queriesRun {0};           // Query enumerators created
+        std::atomic<uint64_t> queryRowsRecorded {0};    // Rows collected by fastForward
+        LatencyHistogram fastForwardTime;               // Time of each fastForward
+        std::atomic<uint64_t> queryCacheHits {0};       // Queries found in the query cache
+        std::atomic<uint64_t> queryCacheMisses {0};     // Queries parsed & added to the cache
+        std::atomic<uint64_t> queryCacheEvictions {0};  // Least recently used queries evicted
+        std::atomic<uint64_t> statementsPrepared {0};   // Query statements compiled by SQLite
+        std::atomic<uint64_t> statementsReused {0};     // Query statements reused from the cache
+
+        static void add(std::atomic<uint64_t> &counter, uint64_t n =1) noexcept {
+            counter.fetch_add(n, std::memory_order_relaxed);
+        }
+
+        /** Writes all the statistics as a dict. */
+        void writeTo(fleece::impl::Encoder&) const;
+    };
+
+}
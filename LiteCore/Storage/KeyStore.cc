@@ -51,11 +51,22 @@ namespace litecore {
         fn(get(seq));
     }
 
+    void KeyStore::getMany(const vector<slice> &keys, ContentOption option,
+                           function_ref<void(Record&)> callback)
+    {
+        for (slice key : keys) {
+            Record rec(key);
+            read(rec, option);
+            callback(rec);
+        }
+    }
+
     void KeyStore::readBody(Record &rec) const {
         if (!rec.body()) {
             Record fullDoc = rec.sequence() ? get(rec.sequence())
                                             : get(rec.key(), kEntireBody);
             rec._body = fullDoc._body;
+            rec._extra = fullDoc._extra;
         }
     }
 
@@ -66,7 +77,8 @@ namespace litecore {
 #endif
     
     void KeyStore::write(Record &rec, Transaction &t, const sequence_t *replacingSequence) {
-        auto seq = set(rec.key(), rec.version(), rec.body(), rec.flags(), t, replacingSequence);
+        auto seq = set(rec.key(), rec.version(), rec.body(), rec.extra(), rec.flags(), t,
+                       replacingSequence);
         rec.setExists();
         rec.updateSequence(seq);
     }
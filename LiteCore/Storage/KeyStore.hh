@@ -76,6 +76,12 @@ namespace litecore {
         virtual void get(slice key, ContentOption, function_ref<void(const Record&)>);
         virtual void get(sequence_t, function_ref<void(const Record&)>);
 
+        /** Reads multiple records, calling the callback once for each key, in order. If a key
+            doesn't exist, the callback's Record has that key but its exists() is false.
+            Subclasses can override this to read the records with fewer queries. */
+        virtual void getMany(const std::vector<slice> &keys, ContentOption,
+                             function_ref<void(Record&)> callback);
+
         /** Reads a record whose key() is already set. */
         virtual bool read(Record &rec, ContentOption = kEntireBody) const =0;
 
@@ -91,13 +97,23 @@ namespace litecore {
 
         /** Core write method. If replacingSequence is not null, will only update the
             record if its existing sequence matches. (Or if the record doesn't already
-            exist, in the case where *replacingSequence == 0.) */
-        virtual sequence_t set(slice key, slice version, slice value,
+            exist, in the case where *replacingSequence == 0.)
+            `extra` is stored alongside the value; it may only be non-null if the DataFile
+            uses split bodies. */
+        virtual sequence_t set(slice key, slice version, slice value, slice extra,
                                DocumentFlags,
                                Transaction&,
                                const sequence_t *replacingSequence =nullptr,
                                bool newSequence =true) =0;
 
+        sequence_t set(slice key, slice version, slice value,
+                       DocumentFlags flags,
+                       Transaction &t,
+                       const sequence_t *replacingSequence =nullptr,
+                       bool newSequence =true) {
+            return set(key, version, value, nullslice, flags, t, replacingSequence, newSequence);
+        }
+
         sequence_t set(slice key, slice value, Transaction &t,
                        const sequence_t *replacingSequence =nullptr) {
             return set(key, nullslice, value, DocumentFlags::kNone, t, replacingSequence);
@@ -130,8 +146,10 @@ namespace litecore {
         using ExpirationCallback = std::function<void(slice docID)>;
 
         /** Deletes all records whose expiration time is in the past.
+            If `limit` is nonzero, at most that many records (the earliest-expiring) are deleted,
+            so that the caller can purge a large backlog in a series of short transactions.
             @return  The number of records deleted */
-        virtual unsigned expireRecords(ExpirationCallback =nullptr) =0;
+        virtual unsigned expireRecords(ExpirationCallback =nullptr, unsigned limit =0) =0;
 
 
         //////// Indexing:
@@ -150,6 +168,7 @@ namespace litecore {
             bool ignoreDiacritics;  ///< True to strip diacritical marks/accents from letters
             bool disableStemming;   ///< Disables stemming
             const char *stopWords;  ///< NULL for default, or comma-delimited string, or empty
+            bool background;        ///< Index existing records later, via buildIndexes()
         };
 
         struct IndexSpec {
@@ -173,6 +192,24 @@ namespace litecore {
         virtual void deleteIndex(slice name) =0;
         virtual std::vector<IndexSpec> getIndexes() const =0;
 
+        /** Indexes existing records for indexes that were created with the `background` option,
+            covering at most `limit` sequences. Call this in a transaction, repeatedly, so that
+            a large database is indexed in a series of short transactions.
+            @return  The number of sequences covered; 0 if there's nothing left to index. */
+        virtual sequence_t buildIndexes(sequence_t limit)              {return 0;}
+
+        /** Returns true if the named index is still being built in the background, and sets
+            `indexed` and `total` to the number of existing sequences indexed so far and in all.
+            Returns false once the index is complete, or if it wasn't built in the background. */
+        virtual bool getIndexBuildProgress(slice name, sequence_t &indexed, sequence_t &total) {
+            return false;
+        }
+
+        /** Creates any internal indexes that an enumerator with these options would use.
+            Enumerators do this themselves on a writeable DataFile, but a read-only one (such as
+            a pooled reader) can't, so call this first on a writeable DataFile. */
+        virtual void createEnumeratorIndexes(bool bySequence, RecordEnumerator::Options) { }
+
         // public for complicated reasons; clients should never call it
         virtual ~KeyStore()                             { }
 
@@ -39,6 +39,7 @@ namespace litecore {
     :_key(d._key),
      _version(d._version),
      _body(d._body),
+     _extra(d._extra),
      _bodySize(d._bodySize),
      _sequence(d._sequence),
      _flags(d._flags),
@@ -49,6 +50,7 @@ namespace litecore {
     :_key(move(d._key)),
      _version(move(d._version)),
      _body(move(d._body)),
+     _extra(move(d._extra)),
      _bodySize(d._bodySize),
      _sequence(d._sequence),
      _flags(d._flags),
@@ -58,6 +60,7 @@ namespace litecore {
     void Record::clearMetaAndBody() noexcept {
         setVersion(nullslice);
         setBody(nullslice);
+        setExtra(nullslice);
         _bodySize = _sequence = 0;
         _flags = DocumentFlags::kNone;
         _exists = false;
@@ -62,6 +62,10 @@ namespace litecore {
         const alloc_slice& version() const      {return _version;}
         const alloc_slice& body() const         {return _body;}
 
+        /** Secondary value stored alongside the body. Only loaded with kEntireBody, and only
+            persisted by DataFiles that use split bodies (see DataFile::Options::splitBodies.) */
+        const alloc_slice& extra() const        {return _extra;}
+
         size_t bodySize() const                 {return _bodySize;}
 
         sequence_t sequence() const             {return _sequence;}
@@ -79,6 +83,8 @@ namespace litecore {
             void setVersion(const T &vers)      {_version = vers;}
         template <typename T>
             void setBody(const T &body)         {_body = body; _bodySize = _body.size;}
+        template <typename T>
+            void setExtra(const T &extra)       {_extra = extra;}
 
         uint64_t bodyAsUInt() const noexcept;
         void setBodyAsUInt(uint64_t) noexcept;
@@ -103,6 +109,7 @@ namespace litecore {
         friend class RecordEnumerator;
 
         alloc_slice     _key, _version, _body;  // The key, metadata and body of the record
+        alloc_slice     _extra;                 // Secondary value (only used with split bodies)
         size_t          _bodySize {0};          // Size of body, if body wasn't loaded
         sequence_t      _sequence {0};          // Sequence number (if KeyStore supports sequences)
         expiration_t    _expiration {0};        // Expiration time (only set by RecordEnumerator)
@@ -55,6 +55,10 @@ namespace litecore {
             bool           onlyConflicts  = false;   ///< Only include records with conflicts
             SortOption     sortOption     = kAscending;    ///< Sort order, or unsorted
             ContentOption  contentOption  = kEntireBody;       ///< Load record bodies?
+            alloc_slice    minKey;                   ///< If non-null, skip keys less than this
+            alloc_slice    maxKey;                   ///< If non-null, skip keys greater than this
+            uint64_t       skip           = 0;       ///< Number of records to skip at the start
+            uint64_t       limit          = UINT64_MAX;     ///< Max number of records to return
 
             Options() { }
         };
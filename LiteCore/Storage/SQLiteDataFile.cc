@@ -21,10 +21,13 @@
  * 201: Initial Version
  * 301: Add index table for use with FTS
  * 302: Add purgeCnt entry to kvmeta
+ * 400: Add info table, whose feature flags readers must check (split, compressed and delta
+ *      bodies; compressed blobs)
  */
 
 #include "SQLiteDataFile.hh"
 #include "SQLiteKeyStore.hh"
+#include "SQLiteQueryCache.hh"
 #include "SQLite_Internal.hh"
 #include "Record.hh"
 #include "UnicodeCollator.hh"
@@ -179,7 +182,24 @@ namespace litecore {
     }
 
 
+    SQLiteQueryCache& SQLiteDataFile::queryCache() {
+        if (!_queryCache)
+            _queryCache.reset(new SQLiteQueryCache(stats()));
+        return *_queryCache;
+    }
+
+
+    pair<int64_t, uint64_t> SQLiteDataFile::queryCacheStamp() {
+        checkOpen();
+        // (Read the generation first, so a change committed in between makes the stamp stale.)
+        uint64_t generation = indexGeneration();
+        return {(int64_t)_sqlDb->execAndGet("PRAGMA schema_version"), generation};
+    }
+
+
     void SQLiteDataFile::reopen() {
+        if (_queryCache)
+            _queryCache->clear();
         DataFile::reopen();
         reopenSQLiteHandle();
         decrypt();
@@ -190,22 +210,57 @@ namespace litecore {
             bool isNew = false;
             if (_schemaVersion == SchemaVersion::None) {
                 isNew = true;
+                // Split and compressed bodies can only be chosen at creation time, since every
+                // KeyStore table needs the 'extra' column, every body needs a compression header,
+                // and older versions of LiteCore can't read them:
+                int64_t features = (options().splitBodies ? kSplitBodies : 0)
+                                 | (options().compressBodies ? kCompressedBodies : 0);
+                auto version = features ? SchemaVersion::WithFeatures
+                                        : SchemaVersion::WithPurgeCount;
+                string infoSQL;
+                if (features)
+                    infoSQL = format("CREATE TABLE IF NOT EXISTS "  // Table of file properties
+                                     "  info (key TEXT PRIMARY KEY, value) WITHOUT ROWID; "
+                                     "INSERT OR REPLACE INTO info (key, value) "
+                                     "  VALUES ('features', %lld); ",
+                                     (long long)features);
                 // Configure persistent db settings, and create the schema:
-                _exec("PRAGMA journal_mode=WAL; "        // faster writes, better concurrency
-                     "PRAGMA auto_vacuum=incremental; " // incremental vacuum mode
-                     "BEGIN; "
-                     "CREATE TABLE IF NOT EXISTS "      // Table of metadata about KeyStores
-                     "  kvmeta (name TEXT PRIMARY KEY, lastSeq INTEGER DEFAULT 0, purgeCnt INTEGER DEFAULT 0) WITHOUT ROWID; "
-                     "PRAGMA user_version=302; "
-                     "END;"
-                     );
-                _schemaVersion = SchemaVersion::WithPurgeCount;
+                _exec(format("PRAGMA journal_mode=WAL; "        // faster writes, better concurrency
+                            "PRAGMA auto_vacuum=incremental; " // incremental vacuum mode
+                            "BEGIN; "
+                            "CREATE TABLE IF NOT EXISTS "      // Table of metadata about KeyStores
+                            "  kvmeta (name TEXT PRIMARY KEY, lastSeq INTEGER DEFAULT 0, purgeCnt INTEGER DEFAULT 0) WITHOUT ROWID; "
+                            "%s"
+                            "PRAGMA user_version=%d; "
+                            "END;",
+                            infoSQL.c_str(), int(version)));
+                _schemaVersion = version;
+                _features = features;
                 // Create the default KeyStore's table:
                 (void)defaultKeyStore();
             } else if (_schemaVersion < SchemaVersion::MinReadable) {
                 error::_throw(error::DatabaseTooOld);
             } else if (_schemaVersion > SchemaVersion::MaxReadable) {
                 error::_throw(error::DatabaseTooNew);
+            } else {
+                _features = readFeatures();
+                if (_features & ~kKnownFeatures)
+                    error::_throw(error::DatabaseTooNew);
+            }
+
+            // The splitBodies and compressBodies options are properties of the file, not of the
+            // caller's request:
+            bool splitBodies = (_features & kSplitBodies) != 0;
+            bool compressBodies = (_features & kCompressedBodies) != 0;
+            if (splitBodies != options().splitBodies || compressBodies != options().compressBodies) {
+                if (!splitBodies && options().splitBodies)
+                    LogTo(DBLog, "Ignoring splitBodies option; existing database doesn't use it");
+                if (!compressBodies && options().compressBodies)
+                    LogTo(DBLog, "Ignoring compressBodies option; existing database doesn't use it");
+                auto opts = options();
+                opts.splitBodies = splitBodies;
+                opts.compressBodies = compressBodies;
+                setOptions(opts);
             }
 
             if (_schemaVersion < SchemaVersion::WithPurgeCount) {
@@ -254,7 +309,7 @@ namespace litecore {
 
         // Register collators, custom functions, and the FTS tokenizer:
         RegisterSQLiteUnicodeCollations(sqlite, _collationContexts);
-        RegisterSQLiteFunctions(sqlite, {delegate(), documentKeys()});
+        RegisterSQLiteFunctions(sqlite, {delegate(), documentKeys(), options().compressBodies});
         int rc = register_unicodesn_tokenizer(sqlite);
         if (rc != SQLITE_OK)
             warn("Unable to register FTS tokenizer: SQLite err %d", rc);
@@ -271,12 +326,58 @@ namespace litecore {
     }
 
 
+    // Must be called in a transaction. Another connection may have raised the version since this
+    // one last read it, so the check is made against the file, and the version is never lowered.
     void SQLiteDataFile::ensureSchemaVersionAtLeast(SchemaVersion version) {
-        if (_schemaVersion < version) {
+        Assert(inTransaction());
+        auto current = SchemaVersion((int)_sqlDb->execAndGet("PRAGMA user_version"));
+        if (current < version) {
             const auto versionSql = "PRAGMA user_version=" + to_string(int(version));
             _exec(versionSql);
-            _schemaVersion = version;
+            current = version;
         }
+        _schemaVersion = current;
+    }
+
+
+    // Reads the feature flags from the file, not from this connection's copy.
+    int64_t SQLiteDataFile::readFeatures() {
+        if (!tableExists("info"))
+            return 0;
+        SQLite::Statement st(*_sqlDb, "SELECT value FROM info WHERE key='features'");
+        return st.executeStep() ? st.getColumn(0).getInt64() : 0;
+    }
+
+
+    // Must be called in a transaction. Another connection may have added features since this
+    // one read them, so the new flags are merged with the ones in the file.
+    void SQLiteDataFile::addFeatures(int64_t features) {
+        Assert(inTransaction());
+        int64_t current = readFeatures();
+        if ((current & features) != features) {
+            current |= features;
+            _exec("CREATE TABLE IF NOT EXISTS info (key TEXT PRIMARY KEY, value) WITHOUT ROWID");
+            _exec(format("INSERT OR REPLACE INTO info (key, value) VALUES ('features', %lld)",
+                         (long long)current));
+            ensureSchemaVersionAtLeast(SchemaVersion::WithFeatures);
+        }
+        _features = current;
+    }
+
+
+    // Delta bodies are a feature of the file's contents, not its schema, so they only make it
+    // unreadable by older versions once the first one is saved.
+    void SQLiteDataFile::willSaveDeltaBodies() {
+        if (!(_features & kDeltaBodies))
+            addFeatures(kDeltaBodies);
+    }
+
+
+    // Compressed blobs live in the blob store, not the file, but older versions opening the
+    // file would find them unreadable, and delete them as unused when compacting.
+    void SQLiteDataFile::markCompressedBlobs() {
+        if (!(_features & kCompressedBlobs))
+            addFeatures(kCompressedBlobs);
     }
 
 
@@ -287,12 +388,15 @@ namespace litecore {
 
     // Called by DataFile::close (the public method)
     void SQLiteDataFile::_close(bool forDelete) {
+        if (_queryCache)
+            _queryCache->clear();
         _getLastSeqStmt.reset();
         _setLastSeqStmt.reset();
         _getPurgeCntStmt.reset();
         _setPurgeCntStmt.reset();
         if (_sqlDb) {
-            optimizeAndVacuum();
+            if (options().writeable)
+                optimizeAndVacuum();
             // Close the SQLite database:
             if (!_sqlDb->closeUnlessStatementsOpen()) {
                 // There are still SQLite statements (queries) open, probably in QueryEnumerators
@@ -391,6 +495,9 @@ namespace litecore {
 
     void SQLiteDataFile::rekey(EncryptionAlgorithm alg, slice newKey) {
 #ifdef COUCHBASE_ENTERPRISE
+        // Pooled readers would be left with the old key:
+        closeReaders();
+
         if (!factory().encryptionEnabled(alg))
             error::_throw(error::UnsupportedEncryption);
 
@@ -457,7 +564,22 @@ namespace litecore {
             ((SQLiteKeyStore&)ks).transactionWillEnd(commit);
         });
 
-        exec(commit ? "COMMIT" : "ROLLBACK");
+        if (commit) {
+            Stopwatch st;
+            exec("COMMIT");
+            stats().sqliteCommitTime.record(st.elapsed());
+        } else {
+            exec("ROLLBACK");
+            // A schema version or feature change made in the transaction was rolled back too:
+            _schemaVersion = SchemaVersion((int)_sqlDb->execAndGet("PRAGMA user_version"));
+            _features = readFeatures();
+        }
+        if (_indexesChanged) {
+            // Now that the change is visible (or undone), other connections' cached queries
+            // are stale, as are ones this connection compiled during the transaction:
+            _indexesChanged = false;
+            bumpIndexGeneration();
+        }
     }
 
 
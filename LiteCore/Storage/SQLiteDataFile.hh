@@ -31,6 +31,7 @@ namespace SQLite {
 namespace litecore {
 
     class SQLiteKeyStore;
+    class SQLiteQueryCache;
 
 
     /** SQLite implementation of DataFile. */
@@ -42,6 +43,8 @@ namespace litecore {
 
         bool isOpen() const noexcept override;
         void compact() override;
+        void willSaveDeltaBodies() override;
+        void markCompressedBlobs() override;
         void optimize();
 
         static void shutdown() { }
@@ -60,6 +63,14 @@ namespace litecore {
 
         fleece::alloc_slice rawQuery(const std::string &query) override;
 
+        /** The cache of compiled queries, shared by all Query objects on this DataFile. */
+        SQLiteQueryCache& queryCache();
+
+        /** Identifies the state of the schema and indexes that queries are translated against:
+            SQLite's schema version, which changes when any connection alters the schema, and the
+            index generation, which also changes when a background index build finishes. */
+        std::pair<int64_t, uint64_t> queryCacheStamp();
+
         class Factory : public DataFile::Factory {
         public:
             Factory();
@@ -124,21 +135,48 @@ namespace litecore {
         IndexSpec getIndex(slice name);
         std::vector<IndexSpec> getIndexes(const KeyStore*);
 
+        // Background index builds:
+        void registerIndexBuild(const std::string &indexTableName,
+                                const std::string &keyStoreName,
+                                sequence_t lastSequence,
+                                const std::string &populateSQL,
+                                const std::string &finishSQL);
+        bool indexTableIsBuilding(const std::string &indexTableName) const;
+        bool getIndexBuild(const std::string &indexTableName,
+                           sequence_t &outSequence, sequence_t &outLastSequence) const;
+        sequence_t continueIndexBuild(const std::string &keyStoreName, sequence_t limit);
+
     private:
         friend class SQLiteKeyStore;
 
-        // SQLite schema versioning (values of `pragma user_version`)
+        // SQLite schema versioning (values of `pragma user_version`). This is the oldest schema a
+        // reader has to understand to open the file; it's raised when needed, never lowered.
         enum class SchemaVersion {
             None            = 0,    // Newly created database
             MinReadable     = 201,  // Cannot open earlier versions than this (CBL 2.0)
-            MaxReadable     = 399,  // Cannot open versions newer than this
+            MaxReadable     = 499,  // Cannot open versions newer than this
 
             WithIndexTable  = 301,  // Added 'indexes' table (CBL 2.5)
             WithPurgeCount  = 302,  // Added 'purgeCnt' column to KeyStores (CBL 2.7)
+            WithFeatures    = 400,  // Added 'info' table; readers must check its feature flags
+        };
+
+        // Optional features of the file's contents, stored as bit flags in the 'info' table.
+        // Using any of them raises the schema version to WithFeatures, so versions of LiteCore
+        // that don't know about the flags can't open the file.
+        enum Features : int64_t {
+            kSplitBodies        = 0x01, // KeyStores have an 'extra' column (chosen at creation)
+            kCompressedBodies   = 0x02, // Bodies have a compression header (chosen at creation)
+            kDeltaBodies        = 0x04, // Rev trees may have delta bodies (set when first saved)
+            kCompressedBlobs    = 0x08, // Blob store may have compressed blobs (set when first
+                                        // stored)
+            kKnownFeatures      = 0x0F  // All of the above; files with other flags can't be read
         };
 
         void reopenSQLiteHandle();
         void ensureSchemaVersionAtLeast(SchemaVersion);
+        int64_t readFeatures();
+        void addFeatures(int64_t);
         void decrypt();
         bool _decrypt(EncryptionAlgorithm, slice key);
         int _exec(const std::string &sql);
@@ -150,14 +188,20 @@ namespace litecore {
                            const std::string &indexTableName);
         void unregisterIndex(slice indexName);
         void garbageCollectIndexTable(const std::string &tableName);
+        bool indexBuildTableExists() const;
+        void unregisterIndexBuild(const std::string &indexTableName);
+        void indexesChanged();
         IndexSpec specFromStatement(SQLite::Statement &stmt);
         std::vector<IndexSpec> getIndexesOldStyle(const KeyStore *store =nullptr);
 
         std::unique_ptr<SQLite::Database>    _sqlDb;         // SQLite database object
         std::unique_ptr<SQLite::Statement>   _getLastSeqStmt, _setLastSeqStmt;
         std::unique_ptr<SQLite::Statement>   _getPurgeCntStmt, _setPurgeCntStmt;
+        std::unique_ptr<SQLiteQueryCache>    _queryCache;    // Compiled queries
         CollationContextVector               _collationContexts;
         SchemaVersion                        _schemaVersion {SchemaVersion::None};
+        int64_t                              _features {0};  // Features known to be in use
+        bool                                 _indexesChanged {false}; // ...in this transaction
     };
 
 }
@@ -19,12 +19,14 @@
 #include "SQLiteKeyStore.hh"
 #include "SQLiteDataFile.hh"
 #include "SQLite_Internal.hh"
+#include "Compression.hh"
 #include "Logging.hh"
 #include "RecordEnumerator.hh"
 #include "Error.hh"
 #include "FleeceImpl.hh"
 #include "Path.hh"
 #include "SQLiteCpp/SQLiteCpp.h"
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 
@@ -36,14 +38,18 @@ namespace litecore {
 
    class SQLiteEnumerator : public RecordEnumerator::Impl {
     public:
-        SQLiteEnumerator(SQLite::Statement *stmt, ContentOption content)
+        SQLiteEnumerator(SQLite::Statement *stmt, ContentOption content, bool compressed,
+                         DataFileStats &stats)
         :_stmt(stmt),
-         _content(content)
+         _content(content),
+         _compressed(compressed),
+         _stats(stats)
         {
             LogTo(SQL, "Enumerator: %s", _stmt->getQuery().c_str());
         }
 
         virtual bool next() override {
+            DataFileStats::add(_stats.statementSteps);
             return _stmt->executeStep();
         }
 
@@ -51,33 +57,52 @@ namespace litecore {
             rec.updateSequence((int64_t)_stmt->getColumn(0));
             rec.setFlags((DocumentFlags)(int)_stmt->getColumn(1));
             rec.setKey(SQLiteKeyStore::columnAsSlice(_stmt->getColumn(2)));
-            rec.setExpiration(_stmt->getColumn(5));
-            SQLiteKeyStore::setRecordMetaAndBody(rec, *_stmt.get(), _content);
+            rec.setExpiration(_stmt->getColumn(6));
+            SQLiteKeyStore::setRecordMetaAndBody(rec, *_stmt.get(), _content, _compressed);
+            DataFileStats::add(_stats.recordsRead);
+            DataFileStats::add(_stats.bodyBytesRead, rec.body().size);
             return true;
         }
 
     private:
         unique_ptr<SQLite::Statement> _stmt;
         ContentOption _content;
+        bool _compressed;
+        DataFileStats &_stats;
     };
 
 
+    void SQLiteKeyStore::createEnumeratorIndexes(bool bySequence,
+                                                 RecordEnumerator::Options options)
+    {
+        if (bySequence)
+            createSequenceIndex();
+        if (options.onlyConflicts)
+            createConflictsIndex();
+        if (options.onlyBlobs)
+            createBlobsIndex();
+    }
+
+
     RecordEnumerator::Impl* SQLiteKeyStore::newEnumeratorImpl(bool bySequence,
                                                               sequence_t since,
                                                               RecordEnumerator::Options options)
     {
-        if (_db.options().writeable) {
-            if (bySequence)
-                createSequenceIndex();
-            if (options.onlyConflicts)
-                createConflictsIndex();
-            if (options.onlyBlobs)
-                createBlobsIndex();
-        }
+        if (_db.options().writeable)
+            createEnumeratorIndexes(bySequence, options);
 
         stringstream sql;
         const char* kBodyItem[3] = {"body", "fl_root(body)", "length(body)"};
-        sql << "SELECT sequence, flags, key, version, " << kBodyItem[options.contentOption];
+        const char* bodyItem = kBodyItem[options.contentOption];
+        if (splitBodies() && options.contentOption == kCurrentRevOnly)
+            bodyItem = "body";
+        sql << "SELECT sequence, flags, key, version, " << bodyItem;
+        if (splitBodies() && options.contentOption == kEntireBody)
+            sql << ", extra";
+        else if (compressBodies() && options.contentOption == kMetaOnly)
+            sql << ", substr(body,1," << kMaxBodyHeaderSize << ")";  // for decompressed length
+        else
+            sql << ", NULL";
         if (hasExpiration())
             sql << ", expiration";
         else
@@ -85,31 +110,38 @@ namespace litecore {
         sql << " FROM kv_" << name();
         
         bool writeAnd = false;
-        if (bySequence) {
-            sql << " WHERE sequence > ?";
+        auto writeCondition = [&]() -> stringstream& {
+            sql << (writeAnd ? " AND " : " WHERE ");
             writeAnd = true;
-        } else {
-            if (!options.includeDeleted || options.onlyBlobs || options.onlyConflicts)
-                sql << " WHERE ";
-        }
-
+            return sql;
+        };
         auto writeFlagTest = [&](DocumentFlags flag, const char *test) {
-            if (writeAnd) sql << " AND "; else writeAnd = true;
-            sql << "(flags & " << int(flag) << ") " << test;
+            writeCondition() << "(flags & " << int(flag) << ") " << test;
         };
-        
+
+        if (bySequence)
+            writeCondition() << "sequence > ?";
         if (!options.includeDeleted)
             writeFlagTest(DocumentFlags::kDeleted, "== 0");
         if (options.onlyBlobs)
             writeFlagTest(DocumentFlags::kHasAttachments, "!= 0");
         if (options.onlyConflicts)
             writeFlagTest(DocumentFlags::kConflicted, "!= 0");
+        // The key range and limit are applied by SQLite, so it can use the primary-key index
+        // to seek to the start, and stop early:
+        if (options.minKey)
+            writeCondition() << "key >= ?";
+        if (options.maxKey)
+            writeCondition() << "key <= ?";
 
         if (options.sortOption != kUnsorted) {
             sql << (bySequence ? " ORDER BY sequence" : " ORDER BY key");
             if (options.sortOption == kDescending)
                 sql << " DESC";
         }
+        bool limited = (options.limit < UINT64_MAX || options.skip > 0);
+        if (limited)
+            sql << " LIMIT ? OFFSET ?";
 
         auto sqlStr = sql.str();
         auto stmt = new SQLite::Statement(db(), sqlStr);        // TODO: Cache a statement
@@ -127,9 +159,19 @@ namespace litecore {
         }
 
 
+        int param = 1;
         if (bySequence)
-            stmt->bind(1, (long long)since);
-        return new SQLiteEnumerator(stmt, options.contentOption);
+            stmt->bind(param++, (long long)since);
+        if (options.minKey)
+            stmt->bind(param++, options.minKey.asString());
+        if (options.maxKey)
+            stmt->bind(param++, options.maxKey.asString());
+        if (limited) {
+            stmt->bind(param++, (long long)min(options.limit, uint64_t(INT64_MAX)));
+            stmt->bind(param++, (long long)min(options.skip, uint64_t(INT64_MAX)));
+        }
+        return new SQLiteEnumerator(stmt, options.contentOption,
+                                    readsCompressedBody(options.contentOption), _db.stats());
     }
 
 }
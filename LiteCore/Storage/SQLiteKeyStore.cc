@@ -20,6 +20,7 @@
 #include "SQLiteDataFile.hh"
 #include "SQLite_Internal.hh"
 #include "Record.hh"
+#include "Compression.hh"
 #include "Error.hh"
 #include "StringUtil.hh"
 #include "SQLiteCpp/SQLiteCpp.h"
@@ -62,12 +63,21 @@ namespace litecore {
             // more efficient in SQLite to keep large columns at the end of a row.
             // Create the sequence and flags columns regardless of options, otherwise it's too
             // complicated to customize all the SQL queries to conditionally use them...
-            db.execWithLock(subst("CREATE TABLE IF NOT EXISTS kv_@ ("
-                                  "  key TEXT PRIMARY KEY,"
-                                  "  sequence INTEGER,"
-                                  "  flags INTEGER DEFAULT 0,"
-                                  "  version BLOB,"
-                                  "  body BLOB)"));
+            // With split bodies, the 'extra' column goes after the body, so that reading the body
+            // never has to page in the (usually larger) extra data.
+            db.execWithLock(subst(splitBodies() ? "CREATE TABLE IF NOT EXISTS kv_@ ("
+                                                  "  key TEXT PRIMARY KEY,"
+                                                  "  sequence INTEGER,"
+                                                  "  flags INTEGER DEFAULT 0,"
+                                                  "  version BLOB,"
+                                                  "  body BLOB,"
+                                                  "  extra BLOB)"
+                                                : "CREATE TABLE IF NOT EXISTS kv_@ ("
+                                                  "  key TEXT PRIMARY KEY,"
+                                                  "  sequence INTEGER,"
+                                                  "  flags INTEGER DEFAULT 0,"
+                                                  "  version BLOB,"
+                                                  "  body BLOB)"));
         }
     }
 
@@ -81,6 +91,9 @@ namespace litecore {
         _getBySeqStmt.reset();
         _getCurBySeqStmt.reset();
         _getMetaBySeqStmt.reset();
+        _getManyStmt.reset();
+        _getManyCurStmt.reset();
+        _getManyMetaStmt.reset();
         _setStmt.reset();
         _insertStmt.reset();
         _replaceStmt.reset();
@@ -92,6 +105,7 @@ namespace litecore {
         _getExpStmt.reset();
         _nextExpStmt.reset();
         _findExpStmt.reset();
+        _findExpBatchStmt.reset();
         KeyStore::close();
     }
 
@@ -207,18 +221,60 @@ namespace litecore {
     // alloc_slice (not just slice).
 
 
-    // Gets flags from col 1, version from col 3, and body (or its length) from col 4
+    // (The kMetaOnly queries below read the header with `substr(body,1,6)`.)
+    static_assert(kMaxBodyHeaderSize == 6, "Update the kMetaOnly queries' header size");
+
+
+    // Gets flags from col 1, version from col 3, body (or its length) from col 4,
+    // and extra (if the body is entirely loaded) from col 5.
+    // If `compressed` is true, the body and extra columns are decompressed; with kMetaOnly,
+    // col 5 instead holds the body's compression header, to get its decompressed length.
     /*static*/ void SQLiteKeyStore::setRecordMetaAndBody(Record &rec,
                                                          SQLite::Statement &stmt,
-                                                         ContentOption content)
+                                                         ContentOption content,
+                                                         bool compressed)
     {
         rec.setExists();
         rec.setFlags((DocumentFlags)(int)stmt.getColumn(1));
         rec.setVersion(columnAsSlice(stmt.getColumn(3)));
-        if (content == kMetaOnly)
-            rec.setUnloadedBodySize((ssize_t)stmt.getColumn(4));
-        else
+        if (content == kMetaOnly) {
+            if (compressed) {
+                size_t storedSize = (size_t)(int64_t)stmt.getColumn(4);
+                rec.setUnloadedBodySize((ssize_t)DecodedBodySize(columnAsSlice(stmt.getColumn(5)),
+                                                                 storedSize));
+            } else {
+                rec.setUnloadedBodySize((ssize_t)stmt.getColumn(4));
+            }
+        } else if (compressed) {
+            alloc_slice buffer;
+            slice body = DecompressBody(columnAsSlice(stmt.getColumn(4)), buffer);
+            if (buffer)
+                rec.setBody(buffer);
+            else
+                rec.setBody(body);
+        } else {
             rec.setBody(columnAsSlice(stmt.getColumn(4)));
+        }
+        if (content == kEntireBody) {
+            if (compressed) {
+                alloc_slice buffer;
+                slice extra = DecompressBody(columnAsSlice(stmt.getColumn(5)), buffer);
+                if (buffer)
+                    rec.setExtra(buffer);
+                else
+                    rec.setExtra(extra);
+            } else {
+                rec.setExtra(columnAsSlice(stmt.getColumn(5)));
+            }
+        }
+    }
+
+
+    // True if the body column read with this content option needs decompressing, or with
+    // kMetaOnly, if its length has to be read from its header. (With kCurrentRevOnly in a
+    // non-split database, it's already been decompressed by fl_root.)
+    bool SQLiteKeyStore::readsCompressedBody(ContentOption content) const {
+        return compressBodies() && (content != kCurrentRevOnly || splitBodies());
     }
     
 
@@ -226,36 +282,124 @@ namespace litecore {
         SQLite::Statement *stmt;
         switch (content) {
             case kMetaOnly:
-                stmt = &compile(_getMetaByKeyStmt,
-                        "SELECT sequence, flags, 0, version, length(body) FROM kv_@ WHERE key=?");
+                // (In a compressed db the decompressed length is in the body's header.)
+                stmt = &compile(_getMetaByKeyStmt, compressBodies()
+                        ? "SELECT sequence, flags, 0, version, length(body), substr(body,1,6) "
+                          "FROM kv_@ WHERE key=?"
+                        : "SELECT sequence, flags, 0, version, length(body) FROM kv_@ WHERE key=?");
                 break;
             case kCurrentRevOnly:
-                stmt = &compile(_getCurByKeyStmt,
-                        "SELECT sequence, flags, 0, version, fl_root(body) FROM kv_@ WHERE key=?");
+                // With split bodies the body column already is the current revision:
+                stmt = &compile(_getCurByKeyStmt, splitBodies()
+                        ? "SELECT sequence, flags, 0, version, body FROM kv_@ WHERE key=?"
+                        : "SELECT sequence, flags, 0, version, fl_root(body) FROM kv_@ WHERE key=?");
                 break;
             case kEntireBody:
-                stmt = &compile(_getByKeyStmt,
-                        "SELECT sequence, flags, 0, version, body FROM kv_@ WHERE key=?");
+                stmt = &compile(_getByKeyStmt, splitBodies()
+                        ? "SELECT sequence, flags, 0, version, body, extra FROM kv_@ WHERE key=?"
+                        : "SELECT sequence, flags, 0, version, body, NULL FROM kv_@ WHERE key=?");
                 break;
             default:
                 return false;
         }
 
+        auto &stats = _db.stats();
         {
             lock_guard<mutex> lock(_stmtMutex);
             stmt->bindNoCopy(1, (const char*)rec.key().buf, (int)rec.key().size);
             UsingStatement u(*stmt);
+            DataFileStats::add(stats.statementSteps);
             if (!stmt->executeStep())
                 return false;
 
             sequence_t seq = (int64_t)stmt->getColumn(0);
             rec.updateSequence(seq);
-            setRecordMetaAndBody(rec, *stmt, content);
+            setRecordMetaAndBody(rec, *stmt, content, readsCompressedBody(content));
         }
+        DataFileStats::add(stats.recordsRead);
+        DataFileStats::add(stats.bodyBytesRead, rec.body().size);
         return true;
     }
 
 
+    // Number of keys looked up by each execution of a getMany statement. Unused parameters are
+    // left NULL, so one prepared statement serves any number of keys.
+    static constexpr size_t kGetManyBatchSize = 64;
+
+
+    void SQLiteKeyStore::getMany(const vector<slice> &keys, ContentOption content,
+                                 function_ref<void(Record&)> callback)
+    {
+        if (keys.empty())
+            return;
+        string params = "?";
+        for (size_t i = 1; i < kGetManyBatchSize; ++i)
+            params += ",?";
+        SQLite::Statement *stmt;
+        switch (content) {
+            case kMetaOnly:
+                stmt = &compile(_getManyMetaStmt,
+                        (string(compressBodies()
+                            ? "SELECT sequence, flags, key, version, length(body), substr(body,1,6) "
+                              "FROM kv_@ "
+                            : "SELECT sequence, flags, key, version, length(body) FROM kv_@ ")
+                         + "WHERE key IN (" + params + ")").c_str());
+                break;
+            case kCurrentRevOnly:
+                stmt = &compile(_getManyCurStmt,
+                        (string(splitBodies()
+                            ? "SELECT sequence, flags, key, version, body FROM kv_@ "
+                            : "SELECT sequence, flags, key, version, fl_root(body) FROM kv_@ ")
+                         + "WHERE key IN (" + params + ")").c_str());
+                break;
+            case kEntireBody:
+                stmt = &compile(_getManyStmt,
+                        (string(splitBodies()
+                            ? "SELECT sequence, flags, key, version, body, extra FROM kv_@ "
+                            : "SELECT sequence, flags, key, version, body, NULL FROM kv_@ ")
+                         + "WHERE key IN (" + params + ")").c_str());
+                break;
+            default:
+                return KeyStore::getMany(keys, content, callback);
+        }
+
+        auto &stats = _db.stats();
+        for (size_t start = 0; start < keys.size(); start += kGetManyBatchSize) {
+            size_t end = min(start + kGetManyBatchSize, keys.size());
+            unordered_map<slice, Record, fleece::sliceHash> found;
+            uint64_t bodyBytes = 0;
+            {
+                lock_guard<mutex> lock(_stmtMutex);
+                stmt->clearBindings();
+                for (size_t i = start; i < end; ++i)
+                    stmt->bindNoCopy(int(i - start + 1), (const char*)keys[i].buf, (int)keys[i].size);
+                UsingStatement u(*stmt);
+                while (stmt->executeStep()) {
+                    Record rec(columnAsSlice(stmt->getColumn(2)));
+                    rec.updateSequence((int64_t)stmt->getColumn(0));
+                    setRecordMetaAndBody(rec, *stmt, content, readsCompressedBody(content));
+                    bodyBytes += rec.body().size;
+                    slice key = rec.key();      // (points into rec, which is moved, not copied)
+                    found.emplace(key, move(rec));
+                }
+            }
+            DataFileStats::add(stats.statementSteps, found.size() + 1);
+            DataFileStats::add(stats.recordsRead, found.size());
+            DataFileStats::add(stats.bodyBytesRead, bodyBytes);
+            // Call the callback outside the lock, in the order of the keys:
+            for (size_t i = start; i < end; ++i) {
+                auto f = found.find(keys[i]);
+                if (f != found.end()) {
+                    callback(f->second);
+                } else {
+                    Record rec(keys[i]);
+                    callback(rec);
+                }
+            }
+        }
+    }
+
+
     Record SQLiteKeyStore::get(sequence_t seq /*, ContentOptions content*/) const {
         constexpr ContentOption content = kEntireBody;  // this used to be a param but not used
         Assert(_capabilities.sequences);
@@ -263,16 +407,20 @@ namespace litecore {
         SQLite::Statement *stmt;
         switch (content) {
             case kMetaOnly:
-                stmt = &compile(_getMetaBySeqStmt,
-                        "SELECT 0, flags, key, version, length(body) FROM kv_@ WHERE sequence=?");
+                stmt = &compile(_getMetaBySeqStmt, compressBodies()
+                        ? "SELECT 0, flags, key, version, length(body), substr(body,1,6) "
+                          "FROM kv_@ WHERE sequence=?"
+                        : "SELECT 0, flags, key, version, length(body) FROM kv_@ WHERE sequence=?");
                 break;
             case kCurrentRevOnly:
-                stmt = &compile(_getCurBySeqStmt,
-                        "SELECT 0, flags, key, version, fl_root(body) FROM kv_@ WHERE sequence=?");
+                stmt = &compile(_getCurBySeqStmt, splitBodies()
+                        ? "SELECT 0, flags, key, version, body FROM kv_@ WHERE sequence=?"
+                        : "SELECT 0, flags, key, version, fl_root(body) FROM kv_@ WHERE sequence=?");
                 break;
             case kEntireBody:
-                stmt = &compile(_getBySeqStmt,
-                        "SELECT 0, flags, key, version, body FROM kv_@ WHERE sequence=?");
+                stmt = &compile(_getBySeqStmt, splitBodies()
+                        ? "SELECT 0, flags, key, version, body, extra FROM kv_@ WHERE sequence=?"
+                        : "SELECT 0, flags, key, version, body, NULL FROM kv_@ WHERE sequence=?");
                 break;
             default:
                 error::_throw(error::UnexpectedError);
@@ -283,39 +431,62 @@ namespace litecore {
         if (stmt->executeStep()) {
             rec.setKey(columnAsSlice(stmt->getColumn(2)));
             rec.updateSequence(seq);
-            setRecordMetaAndBody(rec, *stmt, content);
+            setRecordMetaAndBody(rec, *stmt, content, readsCompressedBody(content));
         }
         return rec;
     }
 
 
-    sequence_t SQLiteKeyStore::set(slice key, slice vers, slice body, DocumentFlags flags,
+    // In split-bodies mode the statements take `extra` as parameter 7, so that the other
+    // parameter numbers are the same in both modes.
+    sequence_t SQLiteKeyStore::set(slice key, slice vers, slice body, slice extra,
+                                   DocumentFlags flags,
                                    Transaction&,
                                    const sequence_t *replacingSequence,
                                    bool newSequence)
     {
+        bool split = splitBodies();
+        Assert(split || !extra.buf, "Can't store extra data without split bodies");
+        alloc_slice compressedBody, compressedExtra;
+        if (compressBodies()) {
+            auto &stats = _db.stats();
+            DataFileStats::add(stats.bodyBytesCompressed, body.size + extra.size);
+            compressedBody = CompressBody(body);
+            body = compressedBody;
+            if (split) {
+                compressedExtra = CompressBody(extra);
+                extra = compressedExtra;
+            }
+            DataFileStats::add(stats.bodyBytesStored, body.size + extra.size);
+        }
         const char *opName;
         SQLite::Statement *stmt;
         if (replacingSequence == nullptr) {
             // Default:
-            compile(_setStmt,
-                    "INSERT OR REPLACE INTO kv_@ (version, body, flags, sequence, key)"
-                    " VALUES (?, ?, ?, ?, ?)");
+            compile(_setStmt, split
+                    ? "INSERT OR REPLACE INTO kv_@ (version, body, flags, sequence, key, extra)"
+                      " VALUES (?1, ?2, ?3, ?4, ?5, ?7)"
+                    : "INSERT OR REPLACE INTO kv_@ (version, body, flags, sequence, key)"
+                      " VALUES (?, ?, ?, ?, ?)");
             stmt = _setStmt.get();
             opName = "set";
         } else if (*replacingSequence == 0) {
             // Insert only:
-            compile(_insertStmt,
-                    "INSERT OR IGNORE INTO kv_@ (version, body, flags, sequence, key)"
-                    " VALUES (?, ?, ?, ?, ?)");
+            compile(_insertStmt, split
+                    ? "INSERT OR IGNORE INTO kv_@ (version, body, flags, sequence, key, extra)"
+                      " VALUES (?1, ?2, ?3, ?4, ?5, ?7)"
+                    : "INSERT OR IGNORE INTO kv_@ (version, body, flags, sequence, key)"
+                      " VALUES (?, ?, ?, ?, ?)");
             stmt = _insertStmt.get();
             opName = "insert";
         } else {
             // Replace only:
             Assert(_capabilities.sequences);
-            compile(_replaceStmt,
-                    "UPDATE kv_@ SET version=?, body=?, flags=?, sequence=?"
-                    " WHERE key=? AND sequence=?");
+            compile(_replaceStmt, split
+                    ? "UPDATE kv_@ SET version=?1, body=?2, flags=?3, sequence=?4, extra=?7"
+                      " WHERE key=?5 AND sequence=?6"
+                    : "UPDATE kv_@ SET version=?, body=?, flags=?, sequence=?"
+                      " WHERE key=? AND sequence=?");
             stmt = _replaceStmt.get();
             stmt->bind(6, (long long)*replacingSequence);
             opName = "update";
@@ -324,6 +495,8 @@ namespace litecore {
         stmt->bindNoCopy(2, body.buf, (int)body.size);
         stmt->bind(3, (int)flags);
         stmt->bindNoCopy(5, (const char*)key.buf, (int)key.size);
+        if (split)
+            stmt->bindNoCopy(7, extra.buf, (int)extra.size);
 
         sequence_t seq = 0;
         if (_capabilities.sequences) {
@@ -399,9 +572,19 @@ namespace litecore {
                                        const char *when,
                                        const string &statements)
     {
-        db().exec(CONCAT("CREATE TRIGGER \"" << triggerName << "::" << triggerSuffix  << "\" "
-                         << operation << " ON kv_" << name() << ' ' << when << ' '
-                         << " BEGIN " << statements << "; END"));
+        db().exec(triggerSQL(triggerName, triggerSuffix, operation, when, statements));
+    }
+
+
+    string SQLiteKeyStore::triggerSQL(const string &triggerName,
+                                      const char *triggerSuffix,
+                                      const char *operation,
+                                      const char *when,
+                                      const string &statements) const
+    {
+        return CONCAT("CREATE TRIGGER \"" << triggerName << "::" << triggerSuffix  << "\" "
+                      << operation << " ON kv_" << name() << ' ' << when << ' '
+                      << " BEGIN " << statements << "; END");
     }
 
 
@@ -477,25 +660,52 @@ namespace litecore {
     }
 
 
-    unsigned SQLiteKeyStore::expireRecords(ExpirationCallback callback) {
+    unsigned SQLiteKeyStore::expireRecords(ExpirationCallback callback, unsigned limit) {
         if (!hasExpiration())
             return 0;
         expiration_t t = now();
         unsigned expired = 0;
-        bool none = false;
-        if (callback) {
-            compile(_findExpStmt, "SELECT key FROM kv_@ WHERE expiration <= ?");
-            UsingStatement u(*_findExpStmt);
-            _findExpStmt->bind(1, (long long)t);
-            none = true;
-            while (_findExpStmt->executeStep()) {
-                none = false;
-                callback(columnAsSlice(_findExpStmt->getColumn(0)));
+        if (limit > 0) {
+            // Find the earliest-expiring records (using the expiration index), then delete them
+            // individually, so the work done in this transaction is bounded:
+            vector<alloc_slice> keys;
+            {
+                compile(_findExpBatchStmt, "SELECT key FROM kv_@ WHERE expiration <= ? "
+                                           "ORDER BY expiration LIMIT ?");
+                UsingStatement u(*_findExpBatchStmt);
+                _findExpBatchStmt->bind(1, (long long)t);
+                _findExpBatchStmt->bind(2, (long long)limit);
+                while (_findExpBatchStmt->executeStep())
+                    keys.emplace_back(columnAsSlice(_findExpBatchStmt->getColumn(0)));
+            }
+            compile(_delByKeyStmt, "DELETE FROM kv_@ WHERE key=?");
+            for (auto &key : keys) {
+                _delByKeyStmt->bindNoCopy(1, (const char*)key.buf, (int)key.size);
+                UsingStatement u(*_delByKeyStmt);
+                if (_delByKeyStmt->exec() > 0) {
+                    ++expired;
+                    if (callback)
+                        callback(key);
+                }
+            }
+            if (expired > 0)
+                incrementPurgeCount();
+        } else {
+            bool none = false;
+            if (callback) {
+                compile(_findExpStmt, "SELECT key FROM kv_@ WHERE expiration <= ?");
+                UsingStatement u(*_findExpStmt);
+                _findExpStmt->bind(1, (long long)t);
+                none = true;
+                while (_findExpStmt->executeStep()) {
+                    none = false;
+                    callback(columnAsSlice(_findExpStmt->getColumn(0)));
+                }
+            }
+            if (!none) {
+                expired = db().exec(format("DELETE FROM kv_%s WHERE expiration <= %" PRId64,
+                                           name().c_str(), t));
             }
-        }
-        if (!none) {
-            expired = db().exec(format("DELETE FROM kv_%s WHERE expiration <= %" PRId64,
-                                       name().c_str(), t));
         }
         db()._logInfo("Purged %u expired documents", expired);
         return expired;
@@ -43,8 +43,11 @@ namespace litecore {
 
         Record get(sequence_t) const override;
         bool read(Record &rec, ContentOption) const override;
+        void getMany(const std::vector<slice> &keys, ContentOption,
+                     function_ref<void(Record&)> callback) override;
 
-        sequence_t set(slice key, slice meta, slice value, DocumentFlags,
+        using KeyStore::set;
+        sequence_t set(slice key, slice meta, slice value, slice extra, DocumentFlags,
                        Transaction&,
                        const sequence_t *replacingSequence =nullptr,
                        bool newSequence =true) override;
@@ -58,14 +61,17 @@ namespace litecore {
         virtual bool setExpiration(slice key, expiration_t) override;
         virtual expiration_t getExpiration(slice key) override;
         virtual expiration_t nextExpiration() override;
-        virtual unsigned expireRecords(ExpirationCallback =nullptr) override;
+        virtual unsigned expireRecords(ExpirationCallback =nullptr, unsigned limit =0) override;
 
         bool supportsIndexes(IndexType t) const override               {return true;}
         bool createIndex(const IndexSpec&, const IndexOptions* = nullptr) override;
 
         void deleteIndex(slice name) override;
         std::vector<IndexSpec> getIndexes() const override;
+        sequence_t buildIndexes(sequence_t limit) override;
+        bool getIndexBuildProgress(slice name, sequence_t &indexed, sequence_t &total) override;
 
+        void createEnumeratorIndexes(bool bySequence, RecordEnumerator::Options) override;
         void createSequenceIndex();
         void createConflictsIndex();
         void createBlobsIndex();
@@ -78,6 +84,7 @@ namespace litecore {
         virtual std::string predictiveTableName(const std::string &property) const override;
 #endif
         virtual bool tableExists(const std::string &tableName) const override;
+        virtual std::vector<QueryParser::CoveringIndex> coveringIndexes() const override;
 
 
     protected:
@@ -97,7 +104,8 @@ namespace litecore {
         static slice columnAsSlice(const SQLite::Column &col);
         static void setRecordMetaAndBody(Record &rec,
                                          SQLite::Statement &stmt,
-                                         ContentOption);
+                                         ContentOption,
+                                         bool compressed =false);
 
     private:
         friend class SQLiteDataFile;
@@ -106,6 +114,9 @@ namespace litecore {
         
         SQLiteKeyStore(SQLiteDataFile&, const std::string &name, KeyStore::Capabilities options);
         SQLiteDataFile& db() const                    {return (SQLiteDataFile&)dataFile();}
+        bool splitBodies() const                      {return _db.options().splitBodies;}
+        bool compressBodies() const                   {return _db.options().compressBodies;}
+        bool readsCompressedBody(ContentOption) const;
         std::string subst(const char *sqlTemplate) const;
         void setLastSequence(sequence_t seq);
         void incrementPurgeCount();
@@ -114,11 +125,26 @@ namespace litecore {
                            const char *operation,
                            const char *when,
                            const std::string &statements);
+        std::string triggerSQL(const std::string &triggerName,
+                               const char *triggerSuffix,
+                               const char *operation,
+                               const char *when,
+                               const std::string &statements) const;
         void _createFlagsIndex(const char *indexName NONNULL, DocumentFlags flag, bool &created);
         bool createValueIndex(const IndexSpec&,
                               const std::string &sourceTableName,
                               fleece::impl::Array::iterator &expressions,
-                              const IndexOptions *options);
+                              const IndexOptions *options,
+                              const fleece::impl::Array *included =nullptr);
+        void createCoveringTable(const std::string &coveringTableName,
+                                 fleece::impl::Array::iterator indexed,
+                                 const fleece::impl::Array *included,
+                                 const IndexOptions*);
+        bool populateIndexTable(const std::string &indexTableName,
+                                const std::string &insertSQL,
+                                const char *condition,
+                                const IndexOptions*,
+                                const std::string &finishSQL ="");
         bool createFTSIndex(const IndexSpec&, const fleece::impl::Array *params, const IndexOptions*);
         bool createArrayIndex(const IndexSpec&, const fleece::impl::Array *params, const IndexOptions*);
         std::string createUnnestedTable(const fleece::impl::Value *arrayPath, const IndexOptions*);
@@ -136,10 +162,12 @@ namespace litecore {
         std::unique_ptr<SQLite::Statement> _recCountStmt;
         std::unique_ptr<SQLite::Statement> _getByKeyStmt, _getCurByKeyStmt, _getMetaByKeyStmt;
         std::unique_ptr<SQLite::Statement> _getBySeqStmt, _getCurBySeqStmt, _getMetaBySeqStmt;
+        std::unique_ptr<SQLite::Statement> _getManyStmt, _getManyCurStmt, _getManyMetaStmt;
         std::unique_ptr<SQLite::Statement> _setStmt, _insertStmt, _replaceStmt, _updateBodyStmt;
         std::unique_ptr<SQLite::Statement> _delByKeyStmt, _delBySeqStmt, _delByBothStmt;
         std::unique_ptr<SQLite::Statement> _setFlagStmt;
         std::unique_ptr<SQLite::Statement> _setExpStmt, _getExpStmt, _nextExpStmt, _findExpStmt;
+        std::unique_ptr<SQLite::Statement> _findExpBatchStmt;
 
         bool _createdSeqIndex {false}, _createdConflictsIndex {false}, _createdBlobsIndex {false};
         bool _lastSequenceChanged {false};
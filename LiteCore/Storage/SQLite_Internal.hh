@@ -56,15 +56,30 @@ namespace litecore {
     };
 
 
+    // The document body most recently decompressed by a SQLite function, so the several fl_*
+    // calls that evaluate one row decompress its body only once. It's shared by all the
+    // functions registered on a connection; calls on one connection never overlap.
+    struct DecompressedBodyCache {
+        alloc_slice stored;                         // The body as stored
+        alloc_slice body;                           // Its decompressed contents
+    };
+
+
     // What the user_data of a registered function points to
     struct fleeceFuncContext {
         fleeceFuncContext(DataFile::Delegate *d,
-                          fleece::impl::SharedKeys *sk)
-        :delegate(d), sharedKeys(sk)
-        { }
+                          fleece::impl::SharedKeys *sk,
+                          bool compressed =false)
+        :delegate(d), sharedKeys(sk), compressedBodies(compressed)
+        {
+            if (compressed)
+                bodyCache = std::make_shared<DecompressedBodyCache>();
+        }
 
         DataFile::Delegate* delegate;
         fleece::impl::SharedKeys* const sharedKeys;
+        bool compressedBodies;                      // Bodies have CompressBody headers
+        std::shared_ptr<DecompressedBodyCache> bodyCache;   // Used if compressedBodies
     };
 
 
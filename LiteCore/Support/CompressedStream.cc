@@ -0,0 +1,238 @@
+//
+// CompressedStream.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "CompressedStream.hh"
+#include "Compression.hh"
+#include "Error.hh"
+#include "Logging.hh"
+#include "Endian.hh"
+#include <algorithm>
+
+/*
+    File format (all integers are big-endian):
+
+    - Header: the 4-byte magic number, then the 32-bit uncompressed block size.
+    - The blocks, in order. Each holds kBlockSize bytes of data (the last may hold fewer),
+      compressed with raw DEFLATE; a block that doesn't compress is stored as-is.
+    - The index: one 32-bit entry per block, giving its stored size. The high bit is set if
+      the block is stored uncompressed.
+    - Trailer: the 64-bit total uncompressed length, the 32-bit block count, and the magic
+      number again.
+
+    The index goes at the end so the writer never has to seek. A reader reads the trailer and
+    index first, after which it can seek to any position by decompressing one block.
+*/
+
+namespace litecore {
+    using namespace std;
+
+    extern LogDomain BlobLog;
+
+    static const uint8_t kMagic[4] = {'L', 'C', 'B', 'Z'};
+    static const size_t kHeaderSize = sizeof(kMagic) + 4;
+    static const size_t kTrailerSize = 8 + 4 + sizeof(kMagic);
+    static const uint32_t kStoredBlockFlag = 0x80000000;
+
+
+#pragma mark - WRITER:
+
+
+    CompressedWriteStream::CompressedWriteStream(std::shared_ptr<WriteStream> output)
+    :_output(output),
+     _buffer(kBlockSize)
+    {
+        uint8_t header[kHeaderSize];
+        memcpy(header, kMagic, sizeof(kMagic));
+        uint32_t blockSize = _enc32(kBlockSize);
+        memcpy(&header[sizeof(kMagic)], &blockSize, sizeof(blockSize));
+        _output->write(slice(header, sizeof(header)));
+    }
+
+
+    CompressedWriteStream::~CompressedWriteStream() {
+        // Don't write the index: the output is incomplete if close() wasn't called.
+    }
+
+
+    void CompressedWriteStream::writeBlock(slice data) {
+        alloc_slice compressed = DeflateData(data);
+        uint32_t entry;
+        if (compressed) {
+            _output->write(compressed);
+            entry = (uint32_t)compressed.size;
+        } else {
+            _output->write(data);
+            entry = (uint32_t)data.size | kStoredBlockFlag;
+        }
+        _blockSizes.push_back(entry);
+        _length += data.size;
+    }
+
+
+    void CompressedWriteStream::write(slice data) {
+        auto buffer = (uint8_t*)_buffer.buf;
+        if (_bufferPos > 0) {
+            // Fill the buffer, and write it if it's full:
+            size_t n = min(data.size, kBlockSize - _bufferPos);
+            memcpy(&buffer[_bufferPos], data.buf, n);
+            _bufferPos += n;
+            data.moveStart(n);
+            if (_bufferPos < kBlockSize)
+                return;
+            writeBlock(_buffer);
+            _bufferPos = 0;
+        }
+
+        // Write entire blocks directly from the input:
+        while (data.size >= kBlockSize)
+            writeBlock(data.read(kBlockSize));
+
+        // Save remainder (if any) in the buffer:
+        memcpy(buffer, data.buf, data.size);
+        _bufferPos = data.size;
+    }
+
+
+    void CompressedWriteStream::close() {
+        if (_output) {
+            if (_bufferPos > 0) {
+                writeBlock(slice(_buffer.buf, _bufferPos));
+                _bufferPos = 0;
+            }
+            // Write the index:
+            vector<uint32_t> index(_blockSizes.size());
+            for (size_t i = 0; i < index.size(); ++i)
+                index[i] = _enc32(_blockSizes[i]);
+            _output->write(slice(index.data(), index.size() * sizeof(uint32_t)));
+            // Write the trailer:
+            uint8_t trailer[kTrailerSize];
+            uint64_t length = _endian_encode(_length);
+            uint32_t count = _enc32((uint32_t)_blockSizes.size());
+            memcpy(&trailer[0], &length, sizeof(length));
+            memcpy(&trailer[8], &count, sizeof(count));
+            memcpy(&trailer[12], kMagic, sizeof(kMagic));
+            _output->write(slice(trailer, sizeof(trailer)));
+            _output->close();
+            _output = nullptr;
+        }
+    }
+
+
+#pragma mark - READER:
+
+
+    CompressedReadStream::CompressedReadStream(std::shared_ptr<SeekableReadStream> input)
+    :_input(input)
+    {
+        uint64_t inputLength = _input->getLength();
+        if (inputLength < kHeaderSize + kTrailerSize)
+            error::_throw(error::CorruptData, "Compressed stream is too short");
+
+        uint8_t header[kHeaderSize];
+        readInput(header, sizeof(header));
+        uint32_t blockSize;
+        memcpy(&blockSize, &header[sizeof(kMagic)], sizeof(blockSize));
+        if (memcmp(header, kMagic, sizeof(kMagic)) != 0 || _dec32(blockSize) != kBlockSize)
+            error::_throw(error::CorruptData, "Compressed stream has invalid header");
+
+        uint8_t trailer[kTrailerSize];
+        _input->seek(inputLength - kTrailerSize);
+        readInput(trailer, sizeof(trailer));
+        uint64_t length;
+        uint32_t count;
+        memcpy(&length, &trailer[0], sizeof(length));
+        memcpy(&count, &trailer[8], sizeof(count));
+        _length = _endian_decode(length);
+        count = _dec32(count);
+        uint64_t indexSize = (uint64_t)count * sizeof(uint32_t);
+        if (memcmp(&trailer[12], kMagic, sizeof(kMagic)) != 0
+                || indexSize > inputLength - kHeaderSize - kTrailerSize
+                || _length > (uint64_t)count * kBlockSize)
+            error::_throw(error::CorruptData, "Compressed stream has invalid trailer");
+
+        // Read the index and compute each block's position in the input:
+        uint64_t indexPos = inputLength - kTrailerSize - indexSize;
+        _blockSizes.resize(count);
+        _input->seek(indexPos);
+        readInput(_blockSizes.data(), (size_t)indexSize);
+        _blockOffsets.resize(count);
+        uint64_t offset = kHeaderSize;
+        for (size_t i = 0; i < count; ++i) {
+            _blockSizes[i] = _dec32(_blockSizes[i]);
+            _blockOffsets[i] = offset;
+            offset += _blockSizes[i] & ~kStoredBlockFlag;
+        }
+        if (offset != indexPos)
+            error::_throw(error::CorruptData, "Compressed stream has invalid index");
+    }
+
+
+    void CompressedReadStream::close() {
+        if (_input) {
+            _input->close();
+            _input = nullptr;
+        }
+    }
+
+
+    void CompressedReadStream::readInput(void *dst, size_t count) {
+        if (_input->read(dst, count) < count)
+            error::_throw(error::CorruptData, "Compressed stream is truncated");
+    }
+
+
+    // Reads & decompresses a block into _buffer.
+    void CompressedReadStream::loadBlock(size_t blockID) {
+        uint64_t blockPos = (uint64_t)blockID * kBlockSize;
+        size_t size = (size_t)min<uint64_t>((uint64_t)kBlockSize, _length - blockPos);
+        uint32_t entry = _blockSizes[blockID];
+        alloc_slice stored(entry & ~kStoredBlockFlag);
+        _input->seek(_blockOffsets[blockID]);
+        readInput((void*)stored.buf, stored.size);
+        if (entry & kStoredBlockFlag) {
+            if (stored.size != size)
+                error::_throw(error::CorruptData, "Compressed stream has invalid block");
+            _buffer = stored;
+        } else {
+            _buffer = InflateData(stored, size);
+        }
+        _bufferBlockID = blockID;
+        LogVerbose(BlobLog, "READ  #%2zu: %zu bytes --> %zu bytes", blockID, stored.size, size);
+    }
+
+
+    size_t CompressedReadStream::read(void *dst, size_t count) {
+        slice remaining(dst, count);
+        while (remaining.size > 0 && _pos < _length) {
+            size_t blockID = (size_t)(_pos / kBlockSize);
+            if (blockID != _bufferBlockID)
+                loadBlock(blockID);
+            size_t offset = (size_t)(_pos - (uint64_t)blockID * kBlockSize);
+            size_t n = min(_buffer.size - offset, remaining.size);
+            remaining.writeFrom(slice((const uint8_t*)_buffer.buf + offset, n));
+            _pos += n;
+        }
+        return (uint8_t*)remaining.buf - (uint8_t*)dst;
+    }
+
+
+    void CompressedReadStream::seek(uint64_t pos) {
+        _pos = min(pos, _length);
+    }
+
+}
@@ -0,0 +1,82 @@
+//
+// CompressedStream.hh
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "Stream.hh"
+#include <vector>
+
+
+namespace litecore {
+
+    /** Abstract base class of CompressedReadStream and CompressedWriteStream.
+        The data is split into fixed-size blocks that are compressed independently, followed by
+        an index of the blocks' stored sizes, so that a reader can seek by decompressing only
+        the block containing the new position. */
+    class CompressedStream {
+    public:
+        static const unsigned kBlockSize = 32768;       // Uncompressed size of each block
+
+    protected:
+        CompressedStream() { }
+        virtual ~CompressedStream() = default;
+
+        std::vector<uint32_t> _blockSizes;          // Stored size (and flags) of each block
+        uint64_t _length {0};                       // Total uncompressed length
+    };
+
+
+    /** Compresses data written to it, and writes it to a wrapped WriteStream.
+        To compress and encrypt, wrap this around an EncryptedWriteStream. */
+    class CompressedWriteStream : public CompressedStream, public virtual WriteStream {
+    public:
+        CompressedWriteStream(std::shared_ptr<WriteStream> output);
+        ~CompressedWriteStream();
+
+        void write(slice) override;
+        void close() override;
+
+    private:
+        void writeBlock(slice data);
+
+        std::shared_ptr<WriteStream> _output;   // Wrapped stream that the compressed data goes to
+        alloc_slice _buffer;                    // Holds a partial block across calls
+        size_t _bufferPos {0};
+    };
+
+
+    /** Provides (random) access to a data stream compressed by CompressedWriteStream. */
+    class CompressedReadStream : public CompressedStream, public virtual SeekableReadStream {
+    public:
+        CompressedReadStream(std::shared_ptr<SeekableReadStream> input);
+        uint64_t getLength() const override                 {return _length;}
+        size_t read(void *dst NONNULL, size_t count) override;
+        void seek(uint64_t pos) override;
+        void close() override;
+
+    private:
+        void readInput(void *dst NONNULL, size_t count);
+        void loadBlock(size_t blockID);
+
+        std::shared_ptr<SeekableReadStream> _input;  // Wrapped stream the compressed data is in
+        std::vector<uint64_t> _blockOffsets;        // Offset of each block in the input
+        alloc_slice _buffer;                        // Decompressed contents of current block
+        size_t _bufferBlockID {SIZE_MAX};
+        uint64_t _pos {0};                          // Current (uncompressed) position
+    };
+
+}
@@ -0,0 +1,145 @@
+//
+// Compression.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "Compression.hh"
+#include "Error.hh"
+#include "Endian.hh"
+#include <zlib.h>
+
+namespace litecore {
+
+    // Body header codecs:
+    enum : uint8_t {
+        kStoredCodec  = 0,      // Body follows header, uncompressed
+        kDeflateCodec = 1,      // Decompressed size (big-endian uint32) then DEFLATE data
+    };
+
+    static const size_t kHeaderSize = 2;            // Even, to keep Fleece data 2-byte aligned
+    static const size_t kDeflateHeaderSize = kHeaderSize + 4;
+    static_assert(kDeflateHeaderSize == kMaxBodyHeaderSize, "kMaxBodyHeaderSize is wrong");
+    static const size_t kMinCompressibleSize = 64;  // Smaller bodies aren't worth compressing
+
+
+    alloc_slice DeflateData(slice data) {
+        z_stream z = {};
+        if (deflateInit2(&z, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            error::_throw(error::MemoryError);
+        // Don't bother finishing if the output would be as large as the input:
+        alloc_slice output(data.size);
+        z.next_in = (Bytef*)data.buf;
+        z.avail_in = (uInt)data.size;
+        z.next_out = (Bytef*)output.buf;
+        z.avail_out = (uInt)output.size;
+        int result = deflate(&z, Z_FINISH);
+        size_t outputSize = z.total_out;
+        deflateEnd(&z);
+        if (result != Z_STREAM_END)
+            return nullslice;
+        output.shorten(outputSize);
+        return output;
+    }
+
+
+    alloc_slice InflateData(slice compressed, size_t uncompressedSize) {
+        z_stream z = {};
+        if (inflateInit2(&z, -MAX_WBITS) != Z_OK)
+            error::_throw(error::MemoryError);
+        alloc_slice output(uncompressedSize);
+        z.next_in = (Bytef*)compressed.buf;
+        z.avail_in = (uInt)compressed.size;
+        z.next_out = (Bytef*)output.buf;
+        z.avail_out = (uInt)output.size;
+        int result = inflate(&z, Z_FINISH);
+        size_t outputSize = z.total_out;
+        inflateEnd(&z);
+        if (result != Z_STREAM_END || outputSize != uncompressedSize)
+            error::_throw(error::CorruptData, "Compressed data is invalid");
+        return output;
+    }
+
+
+    alloc_slice CompressBody(slice body) {
+        if (body.size == 0)
+            return alloc_slice(body);
+        if (body.size >= kMinCompressibleSize && body.size <= UINT32_MAX) {
+            alloc_slice compressed = DeflateData(body);
+            // Only use it if it saves at least 1/8 of the size:
+            if (compressed && compressed.size + kDeflateHeaderSize <= body.size - body.size / 8) {
+                alloc_slice result(kDeflateHeaderSize + compressed.size);
+                auto header = (uint8_t*)result.buf;
+                header[0] = kDeflateCodec;
+                header[1] = 0;
+                uint32_t size = _enc32((uint32_t)body.size);
+                memcpy(&header[kHeaderSize], &size, sizeof(size));
+                memcpy(&header[kDeflateHeaderSize], compressed.buf, compressed.size);
+                return result;
+            }
+        }
+        alloc_slice result(kHeaderSize + body.size);
+        auto header = (uint8_t*)result.buf;
+        header[0] = kStoredCodec;
+        header[1] = 0;
+        memcpy(&header[kHeaderSize], body.buf, body.size);
+        return result;
+    }
+
+
+    slice DecompressBody(slice stored, alloc_slice &buffer) {
+        if (stored.size == 0)
+            return stored;
+        if (stored.size < kHeaderSize)
+            error::_throw(error::CorruptData, "Stored body is too short");
+        switch (stored[0]) {
+            case kStoredCodec:
+                return stored.from(kHeaderSize);
+            case kDeflateCodec: {
+                if (stored.size < kDeflateHeaderSize)
+                    error::_throw(error::CorruptData, "Stored body is too short");
+                uint32_t size;
+                memcpy(&size, (const uint8_t*)stored.buf + kHeaderSize, sizeof(size));
+                buffer = InflateData(stored.from(kDeflateHeaderSize), _dec32(size));
+                return buffer;
+            }
+            default:
+                error::_throw(error::CorruptData, "Unknown body compression codec %d", stored[0]);
+        }
+    }
+
+
+    size_t DecodedBodySize(slice storedPrefix, size_t storedSize) {
+        if (storedSize == 0)
+            return 0;
+        if (storedSize < kHeaderSize || storedPrefix.size < kHeaderSize)
+            error::_throw(error::CorruptData, "Stored body is too short");
+        switch (storedPrefix[0]) {
+            case kStoredCodec:
+                return storedSize - kHeaderSize;
+            case kDeflateCodec: {
+                if (storedPrefix.size < kDeflateHeaderSize)
+                    error::_throw(error::CorruptData, "Stored body is too short");
+                uint32_t size;
+                memcpy(&size, (const uint8_t*)storedPrefix.buf + kHeaderSize, sizeof(size));
+                return _dec32(size);
+            }
+            default:
+                error::_throw(error::CorruptData, "Unknown body compression codec %d",
+                              storedPrefix[0]);
+        }
+    }
+
+}
@@ -0,0 +1,51 @@
+//
+// Compression.hh
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "Base.hh"
+
+namespace litecore {
+
+    /** Compresses data with raw DEFLATE (zlib), at its fastest level.
+        Returns nullslice if that doesn't make it any smaller. */
+    alloc_slice DeflateData(slice data);
+
+    /** Decompresses raw DEFLATE data whose decompressed size is known.
+        Throws CorruptData if the data is invalid or doesn't decompress to exactly that size. */
+    alloc_slice InflateData(slice compressed, size_t uncompressedSize);
+
+
+    /** Encodes a record body for a database with compressed bodies. The result starts with a
+        2-byte header giving the codec; compressed bodies then have their 32-bit decompressed size.
+        Small or incompressible bodies are stored as-is after the header. An empty body stays
+        empty. */
+    alloc_slice CompressBody(slice body);
+
+    /** Decodes a body encoded by CompressBody. If it was compressed, it's decompressed into
+        `buffer` and the result points to that; otherwise the result points into `stored`. */
+    slice DecompressBody(slice stored, alloc_slice &buffer);
+
+    /** The most bytes of header CompressBody puts in front of a body. */
+    constexpr size_t kMaxBodyHeaderSize = 6;
+
+    /** Returns the size a body encoded by CompressBody will have when decoded, without
+        decompressing it. `storedPrefix` is its first kMaxBodyHeaderSize bytes (or all of it, if
+        it's shorter), and `storedSize` is its entire size. */
+    size_t DecodedBodySize(slice storedPrefix, size_t storedSize);
+
+}
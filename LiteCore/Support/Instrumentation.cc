@@ -22,8 +22,41 @@
 #include <sys/kdebug_signpost.h>
 #endif
 
+#if LITECORE_SIGNPOST_RING
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if LITECORE_USDT
+#include <sys/sdt.h>
+#endif
+#endif
+
+using namespace std;
+
 namespace litecore {
 
+#if LITECORE_SIGNPOSTS
+    const char* Signpost::name(Type t) {
+        static const char* const kNames[] = {
+            nullptr, "transaction", "replicatorConnect", "replicatorDisconnect", "replication",
+            "changesBackPressure", "revsBackPressure", "handlingChanges", "handlingRev",
+            "blipReceived", "blipSent", "queryFastForward", "insertRevisions", "getChanges",
+            "transactionWait",
+        };
+        if (t <= 0 || t >= sizeof(kNames)/sizeof(kNames[0]))
+            return "?";
+        return kNames[t];
+    }
+#endif
+
 #if defined(__APPLE__) && LITECORE_SIGNPOSTS
     enum Color {
         blue, green, purple, orange, red    // used for last argument
@@ -43,6 +76,182 @@ namespace litecore {
         if (__builtin_available(macOS 10.12, iOS 10, tvOS 10, *))
             kdebug_signpost_end(t, param, param2, 0, (t % 5));
     }
+
+#elif LITECORE_SIGNPOST_RING
+
+    // Events are written into a fixed-size ring by atomically claiming the next slot, so
+    // recording is wait-free; the oldest events are overwritten. Each slot's `seq` is zero while
+    // it's being written, so a concurrent reader can detect and skip torn events.
+
+    enum Phase : uint8_t {kMark, kBegin, kEnd};
+
+    struct SignpostEvent {
+        atomic<uint64_t> seq {0};           // Index in the ring + 1, or 0 if being written
+        atomic<uint64_t> time;              // Nanoseconds since sStartTime
+        atomic<uint64_t> param1, param2;
+        atomic<uint32_t> thread;
+        atomic<uint8_t>  type, phase;
+    };
+
+    struct SignpostRing {
+        explicit SignpostRing(size_t capacity)
+        :events(new SignpostEvent[capacity])
+        ,mask(capacity - 1)
+        { }
+
+        unique_ptr<SignpostEvent[]> events;
+        size_t const mask;
+        atomic<uint64_t> next {0};
+    };
+
+    static const chrono::steady_clock::time_point sStartTime = chrono::steady_clock::now();
+    static atomic<SignpostRing*> sRing {nullptr};       // Ring being recorded into, if any
+    static atomic<SignpostRing*> sLastRing {nullptr};   // Most recent ring, for writing out
+    static mutex sRingsMutex;
+    // Rings are never freed while the process runs, since other threads may still be writing
+    // to one after recording stops:
+    static vector<unique_ptr<SignpostRing>> sRings;
+
+
+    static uint32_t currentThreadID() {
+        static thread_local uint32_t tID = (uint32_t)syscall(SYS_gettid);
+        return tID;
+    }
+
+
+    static void record(Signpost::Type t, Phase phase, uintptr_t param1, uintptr_t param2) {
+        SignpostRing *ring = sRing.load(memory_order_acquire);
+        if (!ring)
+            return;
+        uint64_t i = ring->next.fetch_add(1, memory_order_relaxed);
+        SignpostEvent &e = ring->events[i & ring->mask];
+        e.seq.store(0, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        auto time = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now()
+                                                               - sStartTime);
+        e.time.store(time.count(), memory_order_relaxed);
+        e.param1.store(param1, memory_order_relaxed);
+        e.param2.store(param2, memory_order_relaxed);
+        e.thread.store(currentThreadID(), memory_order_relaxed);
+        e.type.store((uint8_t)t, memory_order_relaxed);
+        e.phase.store(phase, memory_order_relaxed);
+        e.seq.store(i + 1, memory_order_release);
+    }
+
+
+    void Signpost::mark(Type t, uintptr_t param, uintptr_t param2) {
+#if LITECORE_USDT
+        DTRACE_PROBE3(litecore, signpost_mark, t, param, param2);
+#endif
+        record(t, kMark, param, param2);
+    }
+
+    void Signpost::begin(Type t, uintptr_t param, uintptr_t param2) {
+#if LITECORE_USDT
+        DTRACE_PROBE3(litecore, signpost_begin, t, param, param2);
+#endif
+        record(t, kBegin, param, param2);
+    }
+
+    void Signpost::end(Type t, uintptr_t param, uintptr_t param2) {
+#if LITECORE_USDT
+        DTRACE_PROBE3(litecore, signpost_end, t, param, param2);
+#endif
+        record(t, kEnd, param, param2);
+    }
+
+
+    void Signpost::startRecording(size_t capacity) {
+        size_t size = 1;
+        while (size < max(capacity, size_t(2)))
+            size <<= 1;
+        lock_guard<mutex> lock(sRingsMutex);
+        sRings.emplace_back(new SignpostRing(size));
+        sLastRing = sRings.back().get();
+        sRing.store(sLastRing, memory_order_release);
+    }
+
+    void Signpost::stopRecording() {
+        sRing = nullptr;
+    }
+
+    bool Signpost::recording() {
+        return sRing != nullptr;
+    }
+
+
+    void Signpost::writeChromeTrace(ostream &out) {
+        struct Event {
+            uint64_t seq, time, param1, param2;
+            uint32_t thread;
+            uint8_t type, phase;
+        };
+
+        // Copy the completed events out of the ring, oldest first:
+        vector<Event> events;
+        SignpostRing *ring = sLastRing;
+        if (ring) {
+            uint64_t end = ring->next.load(memory_order_acquire);
+            uint64_t capacity = ring->mask + 1;
+            uint64_t start = (end > capacity) ? end - capacity : 0;
+            events.reserve(end - start);
+            for (uint64_t i = start; i < end; ++i) {
+                SignpostEvent &e = ring->events[i & ring->mask];
+                uint64_t seq = e.seq.load(memory_order_acquire);
+                if (seq == 0)
+                    continue;
+                Event copy;
+                copy.seq = seq;
+                copy.time = e.time.load(memory_order_relaxed);
+                copy.param1 = e.param1.load(memory_order_relaxed);
+                copy.param2 = e.param2.load(memory_order_relaxed);
+                copy.thread = e.thread.load(memory_order_relaxed);
+                copy.type = e.type.load(memory_order_relaxed);
+                copy.phase = e.phase.load(memory_order_relaxed);
+                atomic_thread_fence(memory_order_acquire);
+                if (e.seq.load(memory_order_relaxed) != seq || seq - 1 < start)
+                    continue;       // Overwritten while being copied
+                events.push_back(copy);
+            }
+            sort(events.begin(), events.end(), [](const Event &a, const Event &b) {
+                return a.seq < b.seq;
+            });
+        }
+
+        static const char* const kPhases[] = {"\"i\",\"s\":\"t\"", "\"b\"", "\"e\""};
+        auto pid = (unsigned long)getpid();
+        char buf[300];
+        out << "{\"traceEvents\":[";
+        bool first = true;
+        for (auto &e : events) {
+            snprintf(buf, sizeof(buf),
+                     "%s\n{\"name\":\"%s\",\"cat\":\"litecore\",\"ph\":%s,"
+                     "\"id\":\"0x%llx\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%u,"
+                     "\"args\":{\"param1\":%llu,\"param2\":%llu}}",
+                     (first ? "" : ","), name(Type(e.type)), kPhases[e.phase],
+                     (unsigned long long)e.param1, e.time / 1000.0, pid, e.thread,
+                     (unsigned long long)e.param1, (unsigned long long)e.param2);
+            out << buf;
+            first = false;
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    }
+
+
+    // Starts recording at launch if the "LiteCoreSignpostTrace" environment variable is set to
+    // a file path, and writes the trace to that file at exit.
+    static const bool sRecordingFromEnvironment = [] {
+        if (!getenv("LiteCoreSignpostTrace"))
+            return false;
+        Signpost::startRecording();
+        atexit([] {
+            Signpost::stopRecording();
+            ofstream out(getenv("LiteCoreSignpostTrace"), ofstream::out|ofstream::trunc);
+            Signpost::writeChromeTrace(out);
+        });
+        return true;
+    }();
+
 #endif
 
 }
@@ -18,11 +18,16 @@
 
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
+#include <iosfwd>
 
 namespace litecore {
 
-#ifdef __APPLE__
+#if defined(__APPLE__)
 #define LITECORE_SIGNPOSTS 1
+#elif defined(__linux__)
+#define LITECORE_SIGNPOSTS 1
+#define LITECORE_SIGNPOST_RING 1    // Events are recorded in memory; see Signpost::startRecording
 #endif
 
     /** A utility for logging chronological points and regions of interest, for profiling. */
@@ -39,6 +44,10 @@ namespace litecore {
             handlingRev,
             blipReceived,
             blipSent,           // 10
+            queryFastForward,           // begin/end
+            insertRevisions,            // begin/end
+            getChanges,                 // begin/end
+            transactionWait,            // begin/end
         };
 
 #if LITECORE_SIGNPOSTS
@@ -46,12 +55,35 @@ namespace litecore {
         static void begin(Type, uintptr_t param =0, uintptr_t param2 =0);
         static void end(Type, uintptr_t param =0, uintptr_t param2 =0);
 
+        /** The name of a signpost type, e.g. "handlingRev". */
+        static const char* name(Type);
+
         Signpost(Type t, uintptr_t param1 =0, uintptr_t param2 =0)
         :_type(t), _param1(param1), _param2(param2)
         {begin(_type, _param1, _param2);}
         ~Signpost()
         {end(_type, _param1, _param2);}
 
+#if LITECORE_SIGNPOST_RING
+        static constexpr size_t kDefaultCapacity = 64 * 1024;
+
+        /** Starts recording signposts into an in-memory ring buffer that keeps the most recent
+            `capacity` events (rounded up to a power of 2), discarding any earlier recording.
+            Recording can also be started by setting the environment variable
+            "LiteCoreSignpostTrace" to a file path; the trace is written there at exit. */
+        static void startRecording(size_t capacity =kDefaultCapacity);
+
+        /** Stops recording. The events recorded so far can still be written out. */
+        static void stopRecording();
+
+        static bool recording();
+
+        /** Writes the recorded events in the Chrome trace-event JSON format, which can be
+            opened in chrome://tracing or Perfetto. Begin/end pairs become async events whose
+            ID is the first parameter, since they may begin and end on different threads. */
+        static void writeChromeTrace(std::ostream&);
+#endif
+
     private:
         Type const _type;
         uintptr_t _param1, _param2;
@@ -61,7 +93,7 @@ namespace litecore {
         static inline void begin(Type, uintptr_t param =0, uintptr_t param2 =0)   { }
         static inline void end(Type, uintptr_t param =0, uintptr_t param2 =0)     { }
 
-        Signpost(Type t)                                    { }
+        Signpost(Type t, uintptr_t param1 =0, uintptr_t param2 =0)    { }
         ~Signpost()                                         { }
 #endif
     };
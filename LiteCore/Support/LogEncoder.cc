@@ -21,6 +21,7 @@
 #include "Endian.hh"
 #include "StringUtil.hh"
 #include "varint.hh"
+#include <algorithm>
 #include <exception>
 #include <iostream>
 #include <time.h>
@@ -56,7 +57,7 @@ namespace litecore {
         auto now = LogDecoder::now();
         _writeUVarInt(now.secs);
         _lastElapsed = -(int)now.microsecs;  // so first delta will be accurate
-        _st.reset();
+        _startTime = chrono::steady_clock::now();
     }
 
     LogEncoder::~LogEncoder() {
@@ -79,38 +80,23 @@ namespace litecore {
 
 
     int64_t LogEncoder::_timeElapsed() const {
-        return int64_t(_st.elapsed() * kTicksPerSec);
+        return _timeElapsed(chrono::steady_clock::now());
+    }
+
+    int64_t LogEncoder::_timeElapsed(chrono::steady_clock::time_point time) const {
+        return chrono::duration_cast<chrono::microseconds>(time - _startTime).count();
     }
 
     void LogEncoder::vlog(const char *domain, const map<unsigned, string> &objectMap,
                           ObjectRef object, const char *format, va_list args) {
-        lock_guard<mutex> lock(_mutex);
-
-        // Write the number of ticks elapsed since the last message:
-        auto elapsed = _timeElapsed();
-        uint64_t delta = elapsed - _lastElapsed;
-        _lastElapsed = elapsed;
-        _writeUVarInt(delta);
-
-        // Write level, domain, format string:
-        _writer.write(&_level, sizeof(_level));
-        _writeStringToken(domain ? domain : "");
-
-        const auto objRef = (unsigned)object;
-        _writeUVarInt(objRef);
-        if (object != ObjectRef::None && _seenObjects.find(objRef) == _seenObjects.end()) {
-            _seenObjects.insert(objRef);
-            const auto i = objectMap.find(objRef);
-            if(i == objectMap.end()) {
-                _writer.write({"?\0", 2});
-            } else {
-                _writer.write(slice(i->second.c_str()));
-                _writer.write("\0", 1);
-            }
-        }
+        auto now = chrono::steady_clock::now();
+        ArgList captured;
+        captureArgs(format, args, captured);
+        logCaptured(now, domain, objectMap, object, format, captured);
+    }
 
-        _writeStringToken(format);
 
+    /*static*/ void LogEncoder::captureArgs(const char *format, va_list args, ArgList &out) {
         // Parse the format string looking for substitutions:
         for (const char *c = format; *c != '\0'; ++c) {
             if (*c == '%') {
@@ -136,6 +122,7 @@ namespace litecore {
                 }
                 c += strspn(c, "hljtzq");
 
+                Arg arg;
                 switch(*c) {
                     case 'c':
                     case 'd':
@@ -151,9 +138,8 @@ namespace litecore {
                             param = va_arg(args, long);
                         else
                             param = va_arg(args, long long);
-                        uint8_t sign = (param < 0) ? 1 : 0;
-                        _writer.write(&sign, 1);
-                        _writeUVarInt(abs(param));
+                        arg.type = Arg::Int;
+                        arg.i = param;
                         break;
                     }
                     case 'u':
@@ -169,15 +155,16 @@ namespace litecore {
                             param = va_arg(args, unsigned long);
                         else
                             param = va_arg(args, unsigned long long);
-                        _writeUVarInt(param);
+                        arg.type = Arg::UInt;
+                        arg.u = param;
                         break;
                     }
                     case 'e': case 'E':
                     case 'f': case 'F':
                     case 'g': case 'G':
                     case 'a': case 'A': {
-                        littleEndianDouble param = va_arg(args, double);
-                        _writer.write(&param, sizeof(param));
+                        arg.type = Arg::Double;
+                        arg.d = va_arg(args, double);
                         break;
                     }
                     case 's': {
@@ -191,30 +178,26 @@ namespace litecore {
                             size = strlen(str);
                         }
                         if (minus && !dotStar) {
-                            _writeStringToken(str);
+                            arg.type = Arg::Token;
+                            arg.token = str;
                         } else {
-                            _writeUVarInt(size);
-                            if (size > 0)
-                                _writer.write(str, size);
+                            arg.type = Arg::String;
+                            arg.str.assign(str, size);
                         }
                         break;
                     }
                     case 'p': {
-                        size_t param = va_arg(args, size_t);
-                        if (sizeof(param) == 8)
-                            param = _encLittle64(param);
-                        else
-                            param = _encLittle32(param);
-                        _writer.write(&param, sizeof(param));
+                        arg.type = Arg::Pointer;
+                        arg.pointer = va_arg(args, size_t);
                         break;
                     }
 #if __APPLE__
                     case '@': {
                         // "%@" substitutes an Objective-C or CoreFoundation object's description.
                         CFTypeRef param = va_arg(args, CFTypeRef);
+                        arg.type = Arg::String;
                         if (param == nullptr) {
-                            _writeUVarInt(6);
-                            _writer.write("(null)", 6);
+                            arg.str = "(null)";
                         } else {
                             CFStringRef description;
                             if (CFGetTypeID(param) == CFStringGetTypeID())
@@ -222,8 +205,7 @@ namespace litecore {
                             else
                                 description = CFCopyDescription(param);
                             nsstring_slice descSlice(description);
-                            _writeUVarInt(descSlice.size);
-                            _writer.write(descSlice);
+                            arg.str = string(descSlice);
                             if (description != param)
                                 CFRelease(description);
                         }
@@ -231,10 +213,79 @@ namespace litecore {
                     }
 #endif
                     case '%':
-                        break;
+                        continue;
                     default:
                         throw invalid_argument("Unknown type in LogEncoder format string");
                 }
+                out.push_back(move(arg));
+            }
+        }
+    }
+
+
+    void LogEncoder::logCaptured(chrono::steady_clock::time_point time,
+                                 const char *domain, const map<unsigned, string> &objectMap,
+                                 ObjectRef object, const char *format, const ArgList &args) {
+        lock_guard<mutex> lock(_mutex);
+
+        // Write the number of ticks elapsed since the last message:
+        auto elapsed = max(_timeElapsed(time), _lastElapsed);
+        uint64_t delta = elapsed - _lastElapsed;
+        _lastElapsed = elapsed;
+        _writeUVarInt(delta);
+
+        // Write level, domain, format string:
+        _writer.write(&_level, sizeof(_level));
+        _writeStringToken(domain ? domain : "");
+
+        const auto objRef = (unsigned)object;
+        _writeUVarInt(objRef);
+        if (object != ObjectRef::None && _seenObjects.find(objRef) == _seenObjects.end()) {
+            _seenObjects.insert(objRef);
+            const auto i = objectMap.find(objRef);
+            if(i == objectMap.end()) {
+                _writer.write({"?\0", 2});
+            } else {
+                _writer.write(slice(i->second.c_str()));
+                _writer.write("\0", 1);
+            }
+        }
+
+        _writeStringToken(format);
+
+        for (auto &arg : args) {
+            switch (arg.type) {
+                case Arg::Int: {
+                    uint8_t sign = (arg.i < 0) ? 1 : 0;
+                    _writer.write(&sign, 1);
+                    _writeUVarInt(abs(arg.i));
+                    break;
+                }
+                case Arg::UInt:
+                    _writeUVarInt(arg.u);
+                    break;
+                case Arg::Double: {
+                    littleEndianDouble param = arg.d;
+                    _writer.write(&param, sizeof(param));
+                    break;
+                }
+                case Arg::String:
+                    _writeUVarInt(arg.str.size());
+                    if (!arg.str.empty())
+                        _writer.write(arg.str.data(), arg.str.size());
+                    break;
+                case Arg::Token:
+                    _writeStringToken(arg.token);
+                    break;
+                case Arg::Pointer: {
+                    size_t param = arg.pointer;
+                    if (sizeof(param) == 8)
+                        param = _encLittle64(param);
+                    else
+                        param = _encLittle32(param);
+                    _writer.write(&param, sizeof(param));
+                    break;
+                }
             }
         }
 
@@ -23,10 +23,12 @@
 #include "PlatformCompat.hh"
 #include "Logging.hh"
 #include <stdarg.h>
+#include <chrono>
 #include <iostream>
 #include <mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace litecore {
 
@@ -47,6 +49,33 @@ namespace litecore {
 
         void log(const char *domain, const std::map<unsigned, std::string>&, ObjectRef, const char *format, ...) __printflike(5, 6);
 
+        /** A format-string argument captured from a va_list, so the message can be encoded
+            later (possibly on another thread.) Strings are copied, except for tokenized
+            ("%-s") strings, which are assumed to be long-lived like the format string itself. */
+        struct Arg {
+            enum Type : uint8_t {Int, UInt, Double, String, Token, Pointer};
+            Type type;
+            union {
+                int64_t i;
+                uint64_t u;
+                double d;
+                const char *token;
+                size_t pointer;
+            };
+            std::string str;
+        };
+        using ArgList = std::vector<Arg>;
+
+        /** Parses the format string and appends its arguments to `outArgs`. */
+        static void captureArgs(const char *format, va_list args, ArgList &outArgs);
+
+        /** Encodes a message whose arguments were captured earlier by `captureArgs`.
+            `time` is when the message was logged; it should not be earlier than that of the
+            previous message, else it's treated as simultaneous. */
+        void logCaptured(std::chrono::steady_clock::time_point time,
+                         const char *domain, const std::map<unsigned, std::string>&, ObjectRef,
+                         const char *format, const ArgList &args);
+
         void flush();
 
         /** A timestamp, given as a standard time_t (seconds since 1/1/1970) plus microseconds. */
@@ -65,6 +94,7 @@ namespace litecore {
 
     private:
         int64_t _timeElapsed() const;
+        int64_t _timeElapsed(std::chrono::steady_clock::time_point) const;
         void _writeUVarInt(uint64_t);
         void _writeStringToken(const char *token);
         void _flush();
@@ -75,7 +105,7 @@ namespace litecore {
         fleece::Writer _writer;
         std::ostream &_out;
         std::unique_ptr<actor::Timer> _flushTimer;
-        fleece::Stopwatch _st;
+        std::chrono::steady_clock::time_point _startTime;
         int64_t _lastElapsed {0};
         int64_t _lastSaved {0};
         LogLevel _level;
@@ -22,9 +22,14 @@
 #include "LogDecoder.hh"
 #include "PlatformIO.hh"
 #include "FilePath.hh"
+#include <algorithm>
+#include <condition_variable>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
 #include <ctime>
 
 #if __APPLE__
@@ -53,19 +58,25 @@ namespace litecore {
     static LogDomain _ActorLog("Actor");
     LogDomain &ActorLog = _ActorLog;
 
-    LogLevel LogDomain::sCallbackMinLevel = LogLevel::Uninitialized;
+    atomic<LogLevel> LogDomain::sCallbackMinLevel {LogLevel::Uninitialized};
     static LogDomain::Callback_t sCallback = LogDomain::defaultCallback;
     static bool sCallbackPreformatted = false;
-    LogLevel LogDomain::sFileMinLevel = LogLevel::None;
+    atomic<LogLevel> LogDomain::sFileMinLevel {LogLevel::None};
     unsigned LogDomain::slastObjRef {0};
     map<unsigned, string> LogDomain::sObjNames;
+    static vector<unsigned> sObjRefsToUnregister;   // Erased from sObjNames after next flush
+    static mutex sLogMutex;
+
+    // The log files are written by a background thread (see ASYNC FILE OUTPUT, below.)
+    // These variables are guarded by sFileMutex, which is never acquired while holding sLogMutex:
     static ofstream* sFileOut[5] = {}; // File per log level
     static LogEncoder* sLogEncoder[5] = {};
     static string sLogDirectory;
     static int sMaxCount = 0;       // For rotation
     static int64_t sMaxSize = 1024; // For rotation
     static string sInitialMessage;  // For rotation, goes at top of each log
-    static mutex sLogMutex;
+    static mutex sFileMutex;
+    static atomic<bool> sPlaintextFiles {false};
 
     static const char* const kLevelNames[] = {"debug", "verbose", "info",
                 "warning", "error", nullptr};
@@ -161,7 +172,7 @@ namespace litecore {
         }
     }
 
-    void Logging::rotateLog(LogLevel level)
+    static void rotateLog(LogLevel level)
     {
         auto encoder = sLogEncoder[(int)level];
         auto file = sFileOut[(int)level];
@@ -202,7 +213,9 @@ namespace litecore {
     void LogDomain::writeEncodedLogsTo(const LogFileOptions& options,
                                        const string &initialMessage)
     {
-        unique_lock<mutex> lock(sLogMutex);
+        unique_lock<mutex> fileLock(sFileMutex);
+        _flushLogBuffers();     // Pending messages belong in the current files
+
         sMaxSize = max((int64_t)1024, options.maxSize);
         sMaxCount = max(0, options.maxCount);
         const bool teardown = needsTeardown(options);
@@ -213,56 +226,75 @@ namespace litecore {
 
         sLogDirectory = options.path;
         sInitialMessage = initialMessage;
-        if (sLogDirectory.empty()) {
-            sFileMinLevel = LogLevel::None;
-        } else {
-            sFileMinLevel = options.level;
-            if(!teardown) {
-                return;
-            }
-
-            purgeOldLogs();
-            setupFileOut();
-            if(!options.isPlaintext) {
-                setupEncoders();
-            }
+        sPlaintextFiles = options.isPlaintext;
+        LogLevel fileLevel = LogLevel::None;
+        if (!sLogDirectory.empty()) {
+            fileLevel = options.level;
+            if(teardown) {
+                purgeOldLogs();
+                setupFileOut();
+                if(!options.isPlaintext) {
+                    setupEncoders();
+                }
 
-            if (!sInitialMessage.empty()) {
-                if(sLogEncoder[0]) {
-                    for(auto& encoder : sLogEncoder) {
-                        encoder->log("", {}, LogEncoder::None, "---- %s ----", sInitialMessage.c_str());
-                        encoder->flush(); // Make sure at least the magic bytes are present
-                    }
-                } else {
-                    for(auto& fout : sFileOut) {
-                        *fout << "---- " << sInitialMessage << " ----" << endl;
+                if (!sInitialMessage.empty()) {
+                    if(sLogEncoder[0]) {
+                        for(auto& encoder : sLogEncoder) {
+                            encoder->log("", {}, LogEncoder::None, "---- %s ----", sInitialMessage.c_str());
+                            encoder->flush(); // Make sure at least the magic bytes are present
+                        }
+                    } else {
+                        for(auto& fout : sFileOut) {
+                            *fout << "---- " << sInitialMessage << " ----" << endl;
+                        }
                     }
                 }
             }
 
-            // Make sure to flush the log when the process exits:
             static once_flag f;
             call_once(f, []{
+                startFlusher();
+                // Make sure to flush the log when the process exits:
                 atexit([]{
-                    if (sLogMutex.try_lock()) {     // avoid deadlock on crash inside logging code
+                    stopFlusher();
+                    if (sFileMutex.try_lock()) {     // avoid deadlock on crash inside logging code
+                        _flushLogBuffers();
                         if (sLogEncoder[0]) {
                             for(auto& encoder : sLogEncoder) {
                                 encoder->log("", {}, LogEncoder::None,
                                              "---- END ----");
                             }
                         }
-                            
+
                         teardownEncoders();
                         teardownFileOut();
-                        sLogMutex.unlock();
+                        sFileMutex.unlock();
                     }
                 });
             });
         }
+        fileLock.unlock();
+
+        unique_lock<mutex> lock(sLogMutex);
+        sFileMinLevel = fileLevel;
         _invalidateEffectiveLevels();
     }
 
 
+    void LogDomain::flushLogFiles() {
+        unique_lock<mutex> fileLock(sFileMutex);
+        _flushLogBuffers();
+        for (auto encoder : sLogEncoder) {
+            if (encoder)
+                encoder->flush();
+        }
+        for (auto fout : sFileOut) {
+            if (fout)
+                fout->flush();
+        }
+    }
+
+
     void LogDomain::setCallbackLogLevel(LogLevel level) noexcept {
         unique_lock<mutex> lock(sLogMutex);
 
@@ -300,7 +332,7 @@ namespace litecore {
 
     // Only call while holding sLogMutex!
     LogLevel LogDomain::_callbackLogLevel() noexcept {
-        auto level = sCallbackMinLevel;
+        LogLevel level = sCallbackMinLevel;
         if (level == LogLevel::Uninitialized) {
             // Allow 'LiteCoreLog' env var to set initial callback level:
             level = kC4Cpp_DefaultLog.levelFromEnvironment();
@@ -356,7 +388,7 @@ namespace litecore {
         _level = level;
         // The effective level is the level at which I will actually trigger because there is
         // a place for my output to go:
-        _effectiveLevel = max((LogLevel)_level, min(_callbackLogLevel(), sFileMinLevel));
+        _effectiveLevel = max((LogLevel)_level, min(_callbackLogLevel(), sFileMinLevel.load()));
     }
 
 
@@ -376,16 +408,18 @@ namespace litecore {
 
     static char sFormatBuffer[2048];
 
-    void LogDomain::vlog(LogLevel level, unsigned objRef, bool doCallback, const char *fmt, va_list args) {
+    void LogDomain::vlog(LogLevel level, unsigned objRef, bool doCallback, bool literalFormat,
+                         const char *fmt, va_list args)
+    {
         if (_effectiveLevel == LogLevel::Uninitialized)
             computeLevel();
         if (!willLog(level))
             return;
 
-        unique_lock<mutex> lock(sLogMutex);
-
-        // Invoke the client callback:
-        if (doCallback && sCallback && level >= _callbackLogLevel()) {
+        // Invoke the client callback. This is serialized, since callbacks aren't required to be
+        // thread-safe:
+        if (doCallback && sCallback && level >= sCallbackMinLevel) {
+            unique_lock<mutex> lock(sLogMutex);
             auto obj = getObject(objRef);
 
             va_list args2;
@@ -411,63 +445,288 @@ namespace litecore {
             va_end(args2);
         }
 
-        // Write to the encoded log file:
+        // Write to the encoded log file. This doesn't take any global lock:
         if (level >= sFileMinLevel) {
-            dylog(level, _name, (LogEncoder::ObjectRef)objRef, fmt, args);
+            dylog(level, _name, objRef, literalFormat, fmt, args);
         }
     }
 
 
     void LogDomain::vlog(LogLevel level, const char *fmt, va_list args) {
-        vlog(level, LogEncoder::None, true, fmt, args);
+        // The format string comes from the client and might not outlive this call:
+        vlog(level, LogEncoder::None, true, false, fmt, args);
     }
 
 
     void LogDomain::log(LogLevel level, const char *fmt, ...) {
         va_list args;
         va_start(args, fmt);
-        vlog(level, LogEncoder::None, true, fmt, args);
+        vlog(level, LogEncoder::None, true, true, fmt, args);
         va_end(args);
     }
 
     void LogDomain::vlogNoCallback(LogLevel level, const char *fmt, va_list args) {
-        vlog(level, LogEncoder::None, false, fmt, args);
+        vlog(level, LogEncoder::None, false, true, fmt, args);
     }
 
 
     void LogDomain::logNoCallback(LogLevel level, const char *fmt, ...) {
         va_list args;
         va_start(args, fmt);
-        vlog(level, LogEncoder::None, false, fmt, args);
+        vlog(level, LogEncoder::None, false, true, fmt, args);
         va_end(args);
     }
 
-    void LogDomain::dylog(LogLevel level, const char* domain, unsigned objRef, const char *fmt, va_list args)
+
+#pragma mark - ASYNC FILE OUTPUT:
+
+
+    // Messages bound for the log files are captured into a buffer owned by the logging thread,
+    // and a background thread periodically collects them, in time order, and writes them to
+    // the LogEncoders or plaintext files (rotating them as needed.) So logging threads never
+    // wait for file I/O or contend with each other; the only lock they take is their own
+    // buffer's, which the flusher holds just long enough to swap out its contents.
+
+    // Interval at which the flusher collects messages:
+    static constexpr auto kLogFlushInterval = chrono::milliseconds(100);
+
+    // A thread wakes up the flusher early when its buffer reaches this many messages:
+    static constexpr size_t kLogBufferFlushThreshold = 1000;
+
+    // Past this many messages a thread's buffer is full, and messages are dropped rather than
+    // making the thread wait for the flusher:
+    static constexpr size_t kLogBufferCapacity = 20000;
+
+    // A captured log message.
+    struct BufferedLogEntry {
+        steady_clock::time_point time;          // Time logged, used by LogEncoder
+        LogDecoder::Timestamp wallTime;         // Time logged, used by plaintext files
+        LogLevel level;
+        const char *domain;
+        unsigned objRef;
+        const char *format;                     // "%s" if preformatted
+        LogEncoder::ArgList args;               // Single string arg if preformatted
+        bool preformatted;
+    };
+
+    struct LogBuffer {
+        mutex lock;
+        vector<BufferedLogEntry> entries;       // Guarded by `lock`
+        bool threadExited {false};              // Guarded by `lock`
+        vector<BufferedLogEntry> drained;       // Only used by the flusher
+    };
+
+    static mutex sBuffersMutex;
+    static vector<shared_ptr<LogBuffer>> sBuffers;      // Every thread's buffer
+    static atomic<uint64_t> sDroppedEntries {0};
+
+    static thread sFlusher;
+    static atomic<bool> sFlusherStop {false};
+    static atomic<bool> sFlusherRunning {false};
+    static condition_variable sFlusherCond;
+
+    namespace {
+        // Registers the calling thread's buffer, and marks it when the thread exits so that the
+        // flusher knows to drop it once it's been drained.
+        struct ThreadLogBuffer {
+            shared_ptr<LogBuffer> buffer {make_shared<LogBuffer>()};
+
+            ThreadLogBuffer() {
+                lock_guard<mutex> lock(sBuffersMutex);
+                sBuffers.push_back(buffer);
+            }
+
+            ~ThreadLogBuffer() {
+                lock_guard<mutex> lock(buffer->lock);
+                buffer->threadExited = true;
+            }
+        };
+    }
+
+    static LogBuffer& threadLogBuffer() {
+        static thread_local ThreadLogBuffer tBuffer;
+        return *tBuffer.buffer;
+    }
+
+
+    // Called by logging threads.
+    void LogDomain::dylog(LogLevel level, const char* domain, unsigned objRef,
+                          bool literalFormat, const char *fmt, va_list args)
     {
-        auto obj = getObject(objRef);
-
-        if(sLogEncoder[(int)level]) {
-            sLogEncoder[(int)level]->vlog(domain, sObjNames, (LogEncoder::ObjectRef)objRef, fmt, args);
-        } else if(sFileOut[(int)level]) {
-            static char formatBuffer[2048];
-            size_t n = 0;
-            LogDecoder::writeTimestamp(LogDecoder::now(), *sFileOut[(int)level]);
-            LogDecoder::writeHeader(kLevels[(int)level], domain, *sFileOut[(int)level]);
-            if (objRef)
-                n = snprintf(formatBuffer, sizeof(formatBuffer), "{%s#%u} ", obj.c_str(), objRef);
-            vsnprintf(&formatBuffer[n], sizeof(formatBuffer) - n, fmt, args);
-            *sFileOut[(int)level] << formatBuffer << endl;
+        BufferedLogEntry entry;
+        entry.time = steady_clock::now();
+        entry.level = level;
+        entry.domain = domain;
+        entry.objRef = objRef;
+        entry.preformatted = !literalFormat || sPlaintextFiles;
+        if (entry.preformatted) {
+            static thread_local char tFormatBuffer[2048];
+            entry.wallTime = LogDecoder::now();
+            vsnprintf(tFormatBuffer, sizeof(tFormatBuffer), fmt, args);
+            entry.format = "%s";
+            entry.args.resize(1);
+            entry.args[0].type = LogEncoder::Arg::String;
+            entry.args[0].str = tFormatBuffer;
+        } else {
+            entry.format = fmt;
+            LogEncoder::captureArgs(fmt, args, entry.args);
+        }
+
+        LogBuffer &buffer = threadLogBuffer();
+        size_t count;
+        {
+            lock_guard<mutex> lock(buffer.lock);
+            count = buffer.entries.size();
+            if (count < kLogBufferCapacity)
+                buffer.entries.push_back(move(entry));
+        }
+        if (count >= kLogBufferCapacity)
+            ++sDroppedEntries;
+        else if (count + 1 == kLogBufferFlushThreshold)
+            sFlusherCond.notify_one();
+    }
+
+
+    // Writes a captured message to its level's file. Must hold sFileMutex.
+    static void writeLogEntry(const BufferedLogEntry &entry,
+                              const map<unsigned, string> &objNames)
+    {
+        const int level = (int)entry.level;
+        if (sLogEncoder[level]) {
+            sLogEncoder[level]->logCaptured(entry.time, entry.domain, objNames,
+                                            (LogEncoder::ObjectRef)entry.objRef,
+                                            entry.format, entry.args);
+        } else if (sFileOut[level]) {
+            auto &out = *sFileOut[level];
+            LogDecoder::writeTimestamp(entry.wallTime, out);
+            LogDecoder::writeHeader(kLevels[level], entry.domain, out);
+            if (entry.objRef) {
+                auto i = objNames.find(entry.objRef);
+                out << '{' << (i != objNames.end() ? i->second : "?")
+                    << '#' << entry.objRef << "} ";
+            }
+            // (A message captured for a binary log, just before switching to plaintext,
+            // can only be written as its format string.)
+            out << (entry.preformatted ? entry.args[0].str : entry.format) << '\n';
         } else {
             // No rotation if neither encoder nor file is present
             return;
         }
 
-        const auto pos = sFileOut[(int)level]->tellp();
+        const auto pos = sFileOut[level]->tellp();
         if(pos >= sMaxSize) {
-            Logging::rotateLog(level);
+            rotateLog(entry.level);
         }
     }
-    
+
+
+    // Collects the messages from all the threads' buffers and writes them to the files.
+    // Must hold sFileMutex.
+    void LogDomain::_flushLogBuffers() {
+        // Objects that unregistered before this point have logged their last message; their
+        // names can be forgotten once the messages collected below have been written.
+        vector<unsigned> unregistered;
+        {
+            lock_guard<mutex> lock(sLogMutex);
+            unregistered.swap(sObjRefsToUnregister);
+        }
+
+        static vector<BufferedLogEntry> sEntries;
+        {
+            lock_guard<mutex> lock(sBuffersMutex);
+            for (auto i = sBuffers.begin(); i != sBuffers.end(); ) {
+                LogBuffer &buffer = **i;
+                bool exited;
+                {
+                    lock_guard<mutex> bufLock(buffer.lock);
+                    buffer.entries.swap(buffer.drained);
+                    exited = buffer.threadExited;
+                }
+                for (auto &entry : buffer.drained)
+                    sEntries.push_back(move(entry));
+                buffer.drained.clear();
+                if (exited)
+                    i = sBuffers.erase(i);
+                else
+                    ++i;
+            }
+        }
+
+        auto dropped = sDroppedEntries.exchange(0);
+        if (dropped > 0) {
+            char message[100];
+            snprintf(message, sizeof(message),
+                     "(%llu log messages were dropped because the log files fell behind)",
+                     (unsigned long long)dropped);
+            BufferedLogEntry entry;
+            entry.time = steady_clock::now();
+            entry.wallTime = LogDecoder::now();
+            entry.level = LogLevel::Warning;
+            entry.domain = "";
+            entry.objRef = 0;
+            entry.format = "%s";
+            entry.args.resize(1);
+            entry.args[0].type = LogEncoder::Arg::String;
+            entry.args[0].str = message;
+            entry.preformatted = true;
+            sEntries.push_back(move(entry));
+        }
+
+        if (!sEntries.empty()) {
+            // Each thread's messages are in order; merge them:
+            stable_sort(sEntries.begin(), sEntries.end(),
+                        [](const BufferedLogEntry &a, const BufferedLogEntry &b) {
+                            return a.time < b.time;
+                        });
+
+            map<unsigned, string> objNames;
+            {
+                lock_guard<mutex> lock(sLogMutex);
+                for (auto &entry : sEntries) {
+                    if (entry.objRef && objNames.find(entry.objRef) == objNames.end())
+                        objNames.emplace(entry.objRef, getObject(entry.objRef));
+                }
+            }
+
+            try {
+                for (auto &entry : sEntries)
+                    writeLogEntry(entry, objNames);
+            } catch (...) {
+                // Nowhere to report a failure to write the log; drop the messages.
+            }
+            sEntries.clear();
+        }
+
+        if (!unregistered.empty()) {
+            lock_guard<mutex> lock(sLogMutex);
+            for (auto ref : unregistered)
+                sObjNames.erase(ref);
+        }
+    }
+
+
+    void LogDomain::startFlusher() {
+        sFlusherRunning = true;
+        sFlusher = thread([]{
+            unique_lock<mutex> lock(sFileMutex);
+            while (!sFlusherStop) {
+                sFlusherCond.wait_for(lock, kLogFlushInterval);
+                _flushLogBuffers();
+            }
+        });
+    }
+
+
+    void LogDomain::stopFlusher() {
+        sFlusherStop = true;
+        sFlusherCond.notify_one();
+        if (sFlusher.joinable())
+            sFlusher.join();
+        lock_guard<mutex> lock(sLogMutex);
+        sFlusherRunning = false;
+    }
+
+
     static void invokeCallback(LogDomain &domain, LogLevel level, const char *fmt, ...) {
         va_list args;
         va_start(args, fmt);
@@ -531,7 +790,10 @@ namespace litecore {
 
     void LogDomain::unregisterObject(unsigned objectRef) {
         unique_lock<mutex> lock(sLogMutex);
-        sObjNames.erase(objectRef);
+        if (sFlusherRunning)
+            sObjRefsToUnregister.push_back(objectRef);  // Its messages may not be written yet
+        else
+            sObjNames.erase(objectRef);
     }
 
 
@@ -593,7 +855,7 @@ namespace litecore {
             _objectRef = _domain.registerObject(this, identifier, nickname, level);
         }
         
-        _domain.vlog(level, _objectRef, true, format, args);
+        _domain.vlog(level, _objectRef, true, true, format, args);
     }
 
 
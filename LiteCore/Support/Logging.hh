@@ -117,6 +117,10 @@ public:
     static void writeEncodedLogsTo(const LogFileOptions& options,
                                    const std::string &initialMessage);
 
+    /** Messages are written to the log files asynchronously, on a background thread. This
+        writes any pending messages and flushes the files, before returning. */
+    static void flushLogFiles();
+
     static LogLevel callbackLogLevel() noexcept;
     static LogLevel fileLogLevel() noexcept             {return sFileMinLevel;}
     static void setCallbackLogLevel(LogLevel) noexcept;
@@ -128,7 +132,8 @@ private:
     unsigned registerObject(const void *object, const std::string &description,
                             const std::string &nickname, LogLevel level);
     void unregisterObject(unsigned obj);
-    void vlog(LogLevel level, unsigned obj, bool callback, const char *fmt, va_list);
+    void vlog(LogLevel level, unsigned obj, bool callback, bool literalFormat,
+              const char *fmt, va_list);
 
 private:
     static LogLevel _callbackLogLevel() noexcept;
@@ -136,7 +141,11 @@ private:
     LogLevel levelFromEnvironment() const noexcept;
     static void _invalidateEffectiveLevels() noexcept;
 
-    void dylog(LogLevel level, const char* domain, unsigned objRef, const char *fmt, va_list);
+    void dylog(LogLevel level, const char* domain, unsigned objRef, bool literalFormat,
+               const char *fmt, va_list);
+    static void _flushLogBuffers();
+    static void startFlusher();
+    static void stopFlusher();
 
     std::atomic<LogLevel> _effectiveLevel {LogLevel::Uninitialized};
     std::atomic<LogLevel> _level;
@@ -146,8 +155,8 @@ private:
     static unsigned slastObjRef;
     static std::map<unsigned,std::string> sObjNames;
     static LogDomain* sFirstDomain;
-    static LogLevel sCallbackMinLevel;
-    static LogLevel sFileMinLevel;
+    static std::atomic<LogLevel> sCallbackMinLevel;
+    static std::atomic<LogLevel> sFileMinLevel;
 };
 
 extern "C" LogDomain kC4Cpp_DefaultLog;
@@ -234,7 +243,6 @@ static inline bool WillLog(LogLevel lv)     {return kC4Cpp_DefaultLog.willLog(lv
         LogDomain &_domain;
 private:
         friend class LogDomain;
-        static void rotateLog(LogLevel level);
 
         mutable unsigned _objectRef {0};
     };
@@ -17,17 +17,28 @@
 //
 
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <mutex>
-#include <set>
+#include <utility>
+#include <vector>
 
 namespace litecore {
 
     /** A set of positive integers, generally representing database sequences.
         This is used by the replicator to keep track of which revisions are being pushed.
-        \note  This class is thread-safe. */
+
+        The set is stored as a sorted list of ranges of consecutive sequences, so a backlog of
+        millions of sequences takes only as much space as it has gaps. Adding a sequence higher
+        than any in the set, and removing the lowest, are O(1); other changes are O(log n) to
+        find the range plus, rarely, O(n) to split it.
+        \note  This class is thread-safe. `maxEver` can be read without locking, and so can
+                `hasRemoved` for sequences above it. */
     class SequenceSet {
     public:
         typedef uint64_t sequence;
+        using RangeList = std::vector<std::pair<sequence,sequence>>;  // Inclusive ranges
         class reference;
 
         SequenceSet() { }
@@ -36,26 +47,47 @@ namespace litecore {
 
         /** Empties the set.
             The optional `max` parameter sets the initial value of the `maxEver` property. */
-        void clear(sequence max =0)             {SSLOCK; _sequences.clear(); _max = max;}
+        void clear(sequence max =0)             {SSLOCK; _ranges.clear(); _size = 0; _max = max;}
 
-        bool empty() const                      {SSLOCK; return _sequences.empty();}
-        size_t size() const                     {SSLOCK; return _sequences.size();}
+        bool empty() const                      {SSLOCK; return _ranges.empty();}
+        size_t size() const                     {SSLOCK; return _size;}
 
         /** Returns the lowest sequence in the set. If the set is empty, returns 0. */
-        sequence first() const                  {SSLOCK; return _sequences.empty() ? 0 : *_sequences.begin();}
+        sequence first() const                  {SSLOCK; return _ranges.empty() ? 0 : _ranges.front().first;}
 
         /** The largest sequence ever stored in the set. (The clear() function resets this.) */
-        sequence maxEver() const                {SSLOCK; return _max;}
-
-        bool contains(sequence s) const         {SSLOCK; return _sequences.find(s) != _sequences.end();}
-        bool hasRemoved(sequence s) const       {SSLOCK; return s <= _max && _sequences.find(s) == _sequences.end();}
-
-        void add(sequence s)                    {SSLOCK; _sequences.insert(s); _max = std::max(_max, s);}
-        void remove(sequence s)                 {SSLOCK; _sequences.erase(s);}
+        sequence maxEver() const                {return _max;}
+
+        bool contains(sequence s) const         {SSLOCK; return _contains(s);}
+
+        bool hasRemoved(sequence s) const {
+            if (s > _max)
+                return false;
+            SSLOCK;
+            return s <= _max && !_contains(s);
+        }
+
+        /** Returns the ranges of sequences that have been removed (or only seen), between the
+            lowest sequence in the set and `maxEver`, in ascending order. (A sequence that isn't
+            finished must therefore stay in the set until it is, even after it's been seen.) At most `maxCount`
+            ranges are returned, the lowest ones. If the set is empty, returns an empty list. */
+        RangeList removedRanges(size_t maxCount) const {
+            SSLOCK;
+            RangeList result;
+            for (size_t i = 0; i < _ranges.size() && result.size() < maxCount; ++i) {
+                sequence end = (i + 1 < _ranges.size()) ? _ranges[i+1].first - 1 : sequence(_max);
+                if (end > _ranges[i].last)
+                    result.emplace_back(_ranges[i].last + 1, end);
+            }
+            return result;
+        }
+
+        void add(sequence s)                    {SSLOCK; _add(s); seenMax(s);}
+        void remove(sequence s)                 {SSLOCK; _remove(s);}
         void set(sequence s, bool present)      {present ? add(s) : remove(s);}
 
         /** Marks a sequence as seen but not in the set; equivalent to add() then remove(). */
-        void seen(sequence s)                   {SSLOCK; _max = std::max(_max, s);}
+        void seen(sequence s)                   {SSLOCK; seenMax(s);}
 
         reference operator[] (sequence s)               {return reference(*this, s);}
         const reference operator[] (sequence s) const   {return reference(*(SequenceSet*)this, s);}
@@ -76,9 +108,87 @@ namespace litecore {
         };
 
     private:
+        struct Range {
+            sequence first, last;                       // inclusive
+        };
+        using Ranges = std::deque<Range>;
+
+        // Returns the first range whose `last` is >= s, or end().
+        Ranges::const_iterator find(sequence s) const {
+            return std::lower_bound(_ranges.begin(), _ranges.end(), s,
+                                    [](const Range &r, sequence s) {return r.last < s;});
+        }
+
+        bool _contains(sequence s) const {
+            auto i = find(s);
+            return i != _ranges.end() && i->first <= s;
+        }
+
+        void _add(sequence s) {
+            // Fast path: appending to the end:
+            if (_ranges.empty() || s > _ranges.back().last) {
+                if (!_ranges.empty() && s == _ranges.back().last + 1)
+                    _ranges.back().last = s;
+                else
+                    _ranges.push_back({s, s});
+                ++_size;
+                return;
+            }
+            auto i = _ranges.begin() + (find(s) - _ranges.cbegin());
+            if (i->first <= s)
+                return;                                 // already present
+            ++_size;
+            bool joinsPrev = (i != _ranges.begin() && std::prev(i)->last + 1 == s);
+            bool joinsNext = (i->first == s + 1);
+            if (joinsPrev && joinsNext) {
+                std::prev(i)->last = i->last;
+                _ranges.erase(i);
+            } else if (joinsPrev) {
+                std::prev(i)->last = s;
+            } else if (joinsNext) {
+                i->first = s;
+            } else {
+                _ranges.insert(i, {s, s});
+            }
+        }
+
+        void _remove(sequence s) {
+            // Fast path: removing the lowest sequence:
+            if (!_ranges.empty() && s == _ranges.front().first) {
+                if (_ranges.front().first == _ranges.front().last)
+                    _ranges.pop_front();
+                else
+                    ++_ranges.front().first;
+                --_size;
+                return;
+            }
+            auto i = _ranges.begin() + (find(s) - _ranges.cbegin());
+            if (i == _ranges.end() || i->first > s)
+                return;                                 // not present
+            --_size;
+            if (i->first == i->last) {
+                _ranges.erase(i);
+            } else if (s == i->first) {
+                ++i->first;
+            } else if (s == i->last) {
+                --i->last;
+            } else {
+                // Split the range in two:
+                Range before {i->first, s - 1};
+                i->first = s + 1;
+                _ranges.insert(i, before);
+            }
+        }
+
+        void seenMax(sequence s) {
+            if (s > _max)
+                _max = s;
+        }
+
         mutable std::mutex _mutex;
-        std::set<sequence> _sequences;
-        sequence _max {0};
+        Ranges _ranges;                                 // Sorted, disjoint, non-adjacent ranges
+        size_t _size {0};                               // Total number of sequences in _ranges
+        std::atomic<sequence> _max {0};
     };
 
 }
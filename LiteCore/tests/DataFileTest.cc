@@ -23,6 +23,8 @@
 #include "FleeceImpl.hh"
 #include "Benchmark.hh"
 #include "SecureRandomize.hh"
+#include <atomic>
+#include <thread>
 #ifndef _MSC_VER
 #include <sys/stat.h>
 #endif
@@ -413,6 +415,46 @@ N_WAY_TEST_CASE_METHOD (DataFileTestFixture, "DataFile ReadOnly", "[DataFile][!t
 }
 
 
+N_WAY_TEST_CASE_METHOD (DataFileTestFixture, "DataFile Reader Pool", "[DataFile]") {
+    createNumberedDocs(store);
+
+    // A reader is isolated from an uncommitted transaction:
+    {
+        Transaction t(db);
+        store->set("rec-001"_sl, "changed"_sl, t);
+        db->useReader([&](DataFile *reader) {
+            CHECK(reader != db.get());
+            CHECK(!reader->options().writeable);
+            Record rec = reader->defaultKeyStore().get("rec-001"_sl);
+            REQUIRE(rec.exists());
+            CHECK(rec.body() == "rec-001"_sl);
+        });
+        t.commit();
+    }
+    db->useReader([&](DataFile *reader) {
+        CHECK(reader->defaultKeyStore().get("rec-001"_sl).body() == "changed"_sl);
+    });
+
+    // Multiple threads can read at once:
+    atomic<int> found {0};
+    vector<thread> threads;
+    for (int n = 0; n < 8; ++n) {
+        threads.emplace_back([&] {
+            db->useReader([&](DataFile *reader) {
+                for (int i = 1; i <= 100; i++) {
+                    string docID = stringWithFormat("rec-%03d", i);
+                    if (reader->defaultKeyStore().get(slice(docID)).exists())
+                        ++found;
+                }
+            });
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    CHECK(found == 800);
+}
+
+
 N_WAY_TEST_CASE_METHOD (DataFileTestFixture, "DataFile Compact", "[DataFile]") {
     createNumberedDocs(store);
 
@@ -0,0 +1,79 @@
+//
+// InstrumentationTest.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "Instrumentation.hh"
+#include "LiteCoreTest.hh"
+#include <sstream>
+#include <thread>
+
+#if LITECORE_SIGNPOST_RING
+
+static size_t countOf(const string &str, const string &substr) {
+    size_t n = 0;
+    for (auto pos = str.find(substr); pos != string::npos; pos = str.find(substr, pos + 1))
+        ++n;
+    return n;
+}
+
+
+TEST_CASE("Signpost Chrome trace", "[Signpost]") {
+    Signpost::startRecording(16);
+    CHECK(Signpost::recording());
+    {
+        Signpost s(Signpost::transaction, 0x1234);
+        Signpost::mark(Signpost::replicatorConnect, 7);
+    }
+    thread([] {
+        Signpost::begin(Signpost::handlingRev, 1);
+        Signpost::end(Signpost::handlingRev, 1);
+    }).join();
+    Signpost::stopRecording();
+    CHECK(!Signpost::recording());
+    Signpost::mark(Signpost::replicatorDisconnect);     // not recorded
+
+    stringstream out;
+    Signpost::writeChromeTrace(out);
+    string json = out.str();
+    CHECK(json.find("{\"traceEvents\":[") == 0);
+    CHECK(countOf(json, "\"name\":") == 5);
+    CHECK(countOf(json, "\"name\":\"transaction\"") == 2);
+    CHECK(countOf(json, "\"ph\":\"b\"") == 2);
+    CHECK(countOf(json, "\"ph\":\"e\"") == 2);
+    CHECK(countOf(json, "\"ph\":\"i\"") == 1);
+    CHECK(json.find("\"id\":\"0x1234\"") != string::npos);
+    CHECK(json.find("replicatorDisconnect") == string::npos);
+}
+
+
+TEST_CASE("Signpost ring overflow", "[Signpost]") {
+    Signpost::startRecording(8);
+    for (uintptr_t i = 0; i < 20; ++i)
+        Signpost::mark(Signpost::blipSent, i);
+    Signpost::stopRecording();
+
+    stringstream out;
+    Signpost::writeChromeTrace(out);
+    string json = out.str();
+    // Only the 8 most recent events are kept:
+    CHECK(countOf(json, "\"name\":") == 8);
+    CHECK(json.find("\"param1\":11,") == string::npos);
+    CHECK(json.find("\"param1\":12,") != string::npos);
+    CHECK(json.find("\"param1\":19,") != string::npos);
+}
+
+#endif
@@ -21,9 +21,11 @@
 #include "LogDecoder.hh"
 #include "LiteCoreTest.hh"
 #include "StringUtil.hh"
+#include "Stopwatch.hh"
 #include <regex>
 #include <sstream>
 #include <fstream>
+#include <thread>
 
 #define DATESTAMP "\\w+, \\d{2}/\\d{2}/\\d{2}"
 #define TIMESTAMP "\\d{2}:\\d{2}:\\d{2}\\.\\d{6}\\| "
@@ -268,6 +270,7 @@ TEST_CASE("Logging plaintext", "[Log]") {
     LogDomain::writeEncodedLogsTo(fileOptions, "Hello");
     LogObject obj("dummy");
     obj.doLog("This will be in plaintext");
+    LogDomain::flushLogFiles();
 
     vector<string> infoFiles;
     tmpLogDir.forEachFile([&infoFiles](const FilePath f)
@@ -292,3 +295,37 @@ TEST_CASE("Logging plaintext", "[Log]") {
     CHECK(lines[1].find("This will be in plaintext") != string::npos);
 }
 
+
+
+TEST_CASE("Logging throughput", "[Log][Perf][.slow]") {
+    char folderName[64];
+    sprintf(folderName, "Log_Throughput_%lld/", chrono::milliseconds(time(nullptr)).count());
+    FilePath tmpLogDir = FilePath::tempDirectory()[folderName];
+    tmpLogDir.delRecursive();
+    tmpLogDir.mkdir();
+
+    auto callbackLevel = LogDomain::callbackLogLevel();
+    LogDomain::setCallbackLogLevel(LogLevel::None);
+    LogFileOptions fileOptions { tmpLogDir.canonicalPath(), LogLevel::Info, 1024*1024, 2, false };
+    LogDomain::writeEncodedLogsTo(fileOptions, "Hello");
+
+    static constexpr int kCallsPerThread = 100000;
+    for (int nThreads = 1; nThreads <= 8; nThreads *= 2) {
+        Stopwatch st;
+        vector<thread> threads;
+        for (int t = 0; t < nThreads; ++t) {
+            threads.emplace_back([t] {
+                LogObject obj("bench");
+                for (int i = 0; i < kCallsPerThread; ++i)
+                    obj.doLog("Thread %d, line %d: %s", t, i, "some text");
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+        double secs = st.elapsed();
+        fprintf(stderr, "%d threads: %.0f log calls/sec\n",
+                nThreads, nThreads * kCallsPerThread / secs);
+    }
+    LogDomain::flushLogFiles();
+    LogDomain::setCallbackLogLevel(callbackLevel);
+}
@@ -17,6 +17,7 @@
 //
 
 #include "QueryTest.hh"
+#include "SQLiteDataFile.hh"
 #include <time.h>
 #include <float.h>
 
@@ -135,6 +136,172 @@ TEST_CASE_METHOD(QueryTest, "Query SELECT", "[Query]") {
 }
 
 
+TEST_CASE_METHOD(QueryTest, "Query covering index", "[Query]") {
+    {
+        Transaction t(store->dataFile());
+        for (int i = 1; i <= 100; i++) {
+            string str = stringWithFormat("str-%03d", i);
+            writeNumberedDoc(i, (i % 2) ? slice(str) : nullslice, t);
+        }
+        t.commit();
+    }
+    store->createIndex("numStr"_sl,
+                       json5("{WHAT: [['.num']], INCLUDE: [['.str']]}"),
+                       KeyStore::kValueIndex);
+
+    Retained<Query> query{ store->compileQuery(json5(
+        "{WHAT: [['.str']], WHERE: ['BETWEEN', ['.num'], 30, 40], ORDER_BY: [['.num']]}")) };
+    string explanation = query->explain();
+    Log("%s", explanation.c_str());
+    CHECK(explanation.find("numStr") != string::npos);
+    CHECK(explanation.find("COVERING INDEX") != string::npos);
+    CHECK(explanation.find("fl_value") == string::npos);    // no document bodies are read
+
+    auto checkResults = [&](int changed) {
+        Retained<QueryEnumerator> e(query->createEnumerator());
+        int i = 30;
+        while (e->next()) {
+            if (i == changed) {
+                CHECK(e->columns()[0]->asString() == "changed"_sl);
+            } else if (i % 2) {
+                CHECK(e->columns()[0]->asString() == slice(stringWithFormat("str-%03d", i)));
+                CHECK(e->missingColumns() == 0);
+            } else {
+                CHECK(e->missingColumns() == 1);
+            }
+            ++i;
+        }
+        CHECK(i == 41);
+    };
+    checkResults(0);
+
+    // The index's table is kept up to date as documents change:
+    {
+        Transaction t(store->dataFile());
+        writeNumberedDoc(34, "changed"_sl, t);
+        t.commit();
+    }
+    checkResults(34);
+
+    // A query using a property that isn't in the index has to read the documents:
+    query = store->compileQuery(json5("{WHAT: [['.str'], ['.other']], WHERE: ['BETWEEN', ['.num'], 30, 40]}"));
+    explanation = query->explain();
+    CHECK(explanation.find(":cover:") == string::npos);
+    CHECK(explanation.find("fl_value") != string::npos);
+
+    // Only value indexes can include properties:
+    ExpectException(error::LiteCore, error::InvalidQuery, [&]{
+        store->createIndex("strFTS"_sl, json5("{WHAT: [['.str']], INCLUDE: [['.num']]}"),
+                           KeyStore::kFullTextIndex);
+    });
+}
+
+
+TEST_CASE_METHOD(QueryTest, "Query FTS index built in background", "[Query][FTS]") {
+    {
+        Transaction t(store->dataFile());
+        for (int i = 1; i <= 100; i++)
+            writeNumberedDoc(i, (i % 2) ? "odd"_sl : "even"_sl, t);
+        t.commit();
+    }
+    KeyStore::IndexOptions options { };
+    options.background = true;
+    CHECK(store->createIndex("strFTS"_sl, "[[\".str\"]]"_sl, KeyStore::kFullTextIndex, &options));
+
+    // Queries can't use the index until it's complete:
+    sequence_t indexed, total;
+    CHECK(store->getIndexBuildProgress("strFTS"_sl, indexed, total));
+    CHECK(indexed == 0);
+    CHECK(total == 100);
+    ExpectException(error::LiteCore, error::NoSuchIndex, [&]{
+        Retained<Query> query{ store->compileQuery(json5("['MATCH', 'strFTS', 'even']")) };
+    });
+
+    // Changes made meanwhile are indexed by the triggers, even to docs not yet indexed:
+    {
+        Transaction t(store->dataFile());
+        writeNumberedDoc(5, "even"_sl, t);
+        writeNumberedDoc(101, "even"_sl, t);
+        t.commit();
+    }
+
+    // Index the existing docs in batches:
+    int batches = 0;
+    for (;;) {
+        Transaction t(store->dataFile());
+        sequence_t n = store->buildIndexes(30);
+        t.commit();
+        if (n == 0)
+            break;
+        ++batches;
+        if (batches == 1) {
+            CHECK(store->getIndexBuildProgress("strFTS"_sl, indexed, total));
+            CHECK(indexed == 30);
+            CHECK(total == 100);
+        }
+    }
+    CHECK(batches == 4);
+    CHECK(!store->getIndexBuildProgress("strFTS"_sl, indexed, total));
+
+    Retained<Query> query{ store->compileQuery(json5("['MATCH', 'strFTS', 'even']")) };
+    Retained<QueryEnumerator> e(query->createEnumerator());
+    CHECK(e->getRowCount() == 52);
+
+    // Once it's complete, the update trigger goes back to updating the row in place:
+    string triggerSQL;
+    REQUIRE(((SQLiteDataFile*)db.get())->getSchema("kv_default::strFTS::upd", "trigger",
+                                                   "kv_default", triggerSQL));
+    CHECK(triggerSQL.find("UPDATE \"kv_default::strFTS\" SET") != string::npos);
+    CHECK(triggerSQL.find("DELETE") == string::npos);
+    {
+        Transaction t(store->dataFile());
+        writeNumberedDoc(2, "odd"_sl, t);
+        t.commit();
+    }
+    e = query->createEnumerator();
+    CHECK(e->getRowCount() == 51);
+}
+
+
+TEST_CASE_METHOD(QueryTest, "Query cache", "[Query]") {
+    addNumberedDocs();
+    auto &stats = db->stats();
+    uint64_t hits = stats.queryCacheHits, misses = stats.queryCacheMisses;
+    uint64_t reused = stats.statementsReused;
+
+    Retained<Query> query1{ store->compileQuery(json5("['AND', ['>=', ['.', 'num'], 30], ['<=', ['.', 'num'], 40]]")) };
+    CHECK(stats.queryCacheMisses == misses + 1);
+    // An equivalent query, formatted differently, shares the cache entry:
+    Retained<Query> query2{ store->compileQuery(json5("['AND',['>=',['.','num'],30],['<=',['.','num'],40]]")) };
+    CHECK(stats.queryCacheHits == hits + 1);
+    CHECK(stats.queryCacheMisses == misses + 1);
+    CHECK(query2->columnCount() == query1->columnCount());
+
+    // Both queries can be enumerated at once, each with its own statement:
+    Retained<QueryEnumerator> e1(query1->createEnumerator());
+    Retained<QueryEnumerator> e2(query2->createEnumerator());
+    CHECK(e1->getRowCount() == 11);
+    CHECK(e2->getRowCount() == 11);
+    CHECK(stats.statementsReused >= reused + 1);
+
+    // Creating an index flushes the cache, but existing queries keep working:
+    store->createIndex("num"_sl, "[\".num\"]"_sl);
+    Retained<QueryEnumerator> e3(query1->createEnumerator());
+    CHECK(e3->getRowCount() == 11);
+    Retained<Query> query3{ store->compileQuery(json5("['AND', ['>=', ['.', 'num'], 30], ['<=', ['.', 'num'], 40]]")) };
+    CHECK(stats.queryCacheMisses == misses + 2);
+
+    // So does deleting an index on another connection to the same file:
+    {
+        unique_ptr<DataFile> db2(newDatabase(db->filePath()));
+        db2->defaultKeyStore().deleteIndex("num"_sl);
+    }
+    Retained<Query> query4{ store->compileQuery(json5("['AND', ['>=', ['.', 'num'], 30], ['<=', ['.', 'num'], 40]]")) };
+    CHECK(stats.queryCacheMisses == misses + 3);
+    CHECK(query4->explain().find("USING INDEX num") == string::npos);
+}
+
+
 TEST_CASE_METHOD(QueryTest, "Query SELECT WHAT", "[Query][N1QL]") {
     addNumberedDocs();
     Retained<Query> query;
@@ -275,6 +442,36 @@ TEST_CASE_METHOD(QueryTest, "Query refresh", "[Query]") {
 }
 
 
+TEST_CASE_METHOD(QueryTest, "Query matching keys", "[Query]") {
+    addNumberedDocs();
+    Retained<Query> query{ store->compileQuery(json5(
+                     "{WHAT: ['.num'], WHERE: ['>', ['.num'], 90], ORDER_BY: ['.num']}")) };
+    REQUIRE(query->canCheckChangedDocs());
+    Query::KeySet keys = query->matchingKeys();
+    CHECK(keys.size() == 10);
+    CHECK(keys.count(alloc_slice("rec-091")) == 1);
+    CHECK(keys.count(alloc_slice("rec-090")) == 0);
+
+    CHECK(!query->anyKeyMatches({alloc_slice("rec-001"), alloc_slice("rec-090")}));
+    CHECK(query->anyKeyMatches({alloc_slice("rec-001"), alloc_slice("rec-100")}));
+    CHECK(!query->anyKeyMatches({alloc_slice("nonexistent")}));
+
+    // Deleted docs don't match:
+    {
+        Transaction t(db);
+        store->set("rec-100"_sl, "2-ffff"_sl, nullslice, DocumentFlags::kDeleted, t);
+        t.commit();
+    }
+    CHECK(!query->anyKeyMatches({alloc_slice("rec-100")}));
+    CHECK(query->matchingKeys().size() == 9);
+
+    // Aggregate queries can't check changed docs individually:
+    Retained<Query> aggQuery{ store->compileQuery(json5(
+                     "{WHAT: [['count()', ['.num']]], WHERE: ['>', ['.num'], 90]}")) };
+    CHECK(!aggQuery->canCheckChangedDocs());
+}
+
+
 TEST_CASE_METHOD(QueryTest, "Query boolean", "[Query]") {
     {
         Transaction t(store->dataFile());
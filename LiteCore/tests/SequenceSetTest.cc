@@ -0,0 +1,173 @@
+//
+// SequenceSetTest.cc
+//
+// Copyright (c) 2019 Couchbase, Inc All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "LiteCoreTest.hh"
+#include "SequenceSet.hh"
+#include "SecureRandomize.hh"
+#include "Stopwatch.hh"
+#include <set>
+
+using namespace std;
+using namespace litecore;
+
+
+TEST_CASE("SequenceSet", "[SequenceSet]") {
+    SequenceSet s;
+    CHECK(s.empty());
+    CHECK(s.size() == 0);
+    CHECK(s.first() == 0);
+    CHECK(s.maxEver() == 0);
+
+    for (SequenceSet::sequence seq = 1; seq <= 10; ++seq)
+        s.add(seq);
+    s.seen(11);
+    s.add(12);
+    CHECK(s.size() == 11);
+    CHECK(s.first() == 1);
+    CHECK(s.maxEver() == 12);
+    CHECK(s.contains(10));
+    CHECK(!s.contains(11));
+    CHECK(s.hasRemoved(11));
+    CHECK(!s.hasRemoved(13));
+
+    // Remove from the middle of a range, splitting it:
+    s.remove(5);
+    CHECK(!s.contains(5));
+    CHECK(s.contains(4));
+    CHECK(s.contains(6));
+    CHECK(s.hasRemoved(5));
+    CHECK(s.size() == 10);
+
+    // Re-add, joining the ranges again:
+    s[5] = true;
+    CHECK(s[5]);
+    CHECK(s.size() == 11);
+
+    // Remove from the front:
+    s.remove(1);
+    s.remove(2);
+    CHECK(s.first() == 3);
+    s.remove(99);
+    CHECK(s.size() == 9);
+
+    s.clear(50);
+    CHECK(s.empty());
+    CHECK(s.first() == 0);
+    CHECK(s.maxEver() == 50);
+    CHECK(s.hasRemoved(3));
+}
+
+
+TEST_CASE("SequenceSet removed ranges", "[SequenceSet]") {
+    using RangeList = SequenceSet::RangeList;
+    SequenceSet s;
+    CHECK(s.removedRanges(10).empty());
+
+    for (SequenceSet::sequence seq = 1; seq <= 20; ++seq)
+        s.add(seq);
+    s.seen(25);
+    CHECK(s.removedRanges(10) == (RangeList{{21, 25}}));
+
+    s.remove(1);
+    s.remove(5);
+    s.remove(6);
+    s.remove(10);
+    CHECK(s.removedRanges(10) == (RangeList{{5, 6}, {10, 10}, {21, 25}}));
+    CHECK(s.removedRanges(2) == (RangeList{{5, 6}, {10, 10}}));
+
+    // Only the lowest range of the set and above count:
+    s.remove(2);
+    s.remove(3);
+    s.remove(4);
+    CHECK(s.removedRanges(10) == (RangeList{{10, 10}, {21, 25}}));
+
+    for (SequenceSet::sequence seq = 7; seq <= 20; ++seq)
+        s.remove(seq);
+    CHECK(s.removedRanges(10).empty());
+}
+
+
+TEST_CASE("SequenceSet random operations", "[SequenceSet]") {
+    // Compare against std::set:
+    SequenceSet s;
+    set<SequenceSet::sequence> expected;
+    for (int op = 0; op < 10000; ++op) {
+        SequenceSet::sequence seq = RandomNumber(500) + 1;
+        if (RandomNumber(2)) {
+            s.add(seq);
+            expected.insert(seq);
+        } else {
+            s.remove(seq);
+            expected.erase(seq);
+        }
+        REQUIRE(s.size() == expected.size());
+        REQUIRE(s.first() == (expected.empty() ? 0 : *expected.begin()));
+        auto probe = RandomNumber(510);
+        REQUIRE(s.contains(probe) == (expected.count(probe) > 0));
+    }
+}
+
+
+namespace {
+    // The previous implementation of SequenceSet, for comparison in the benchmark below.
+    class TreeSequenceSet {
+    public:
+        typedef uint64_t sequence;
+        bool contains(sequence s) const {lock_guard<mutex> lock(_mutex); return _sequences.find(s) != _sequences.end();}
+        void add(sequence s)            {lock_guard<mutex> lock(_mutex); _sequences.insert(s); _max = max(_max, s);}
+        void remove(sequence s)         {lock_guard<mutex> lock(_mutex); _sequences.erase(s);}
+        void seen(sequence s)           {lock_guard<mutex> lock(_mutex); _max = max(_max, s);}
+        size_t size() const             {lock_guard<mutex> lock(_mutex); return _sequences.size();}
+    private:
+        mutable mutex _mutex;
+        set<sequence> _sequences;
+        sequence _max {0};
+    };
+
+
+    // Simulates the Pusher: sequences arrive in order (with some filtered out), and are removed
+    // roughly in order as revisions are acknowledged.
+    template <class SET>
+    double pushBacklog(SET &s, uint64_t count) {
+        fleece::Stopwatch st;
+        for (uint64_t seq = 1; seq <= count; ++seq) {
+            if (seq % 10 == 0)
+                s.seen(seq);
+            else
+                s.add(seq);
+        }
+        for (uint64_t seq = 1; seq <= count; ++seq) {
+            (void)s.contains(seq);
+            // Acknowledgements arrive slightly out of order:
+            s.remove(((seq - 1) ^ 1) + 1);
+        }
+        CHECK(s.size() == 0);
+        return st.elapsedMS();
+    }
+}
+
+
+TEST_CASE("SequenceSet performance", "[SequenceSet][Perf][.slow]") {
+    static constexpr uint64_t kCount = 1000000;
+    TreeSequenceSet tree;
+    SequenceSet ranges;
+    double treeMS = pushBacklog(tree, kCount);
+    double rangesMS = pushBacklog(ranges, kCount);
+    fprintf(stderr, "Pushing %llu sequences: std::set %.1fms, ranges %.1fms (%.1fx faster)\n",
+            (unsigned long long)kCount, treeMS, rangesMS, treeMS / rangesMS);
+}
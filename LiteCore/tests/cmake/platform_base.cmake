@@ -11,12 +11,14 @@ function(set_source_files_base)
         DataFileTest.cc
         DocumentKeysTest.cc
         FTSTest.cc
+        InstrumentationTest.cc
         LiteCoreTest.cc
         LogEncoderTest.cc
         PredictiveQueryTest.cc
         QueryParserTest.cc
         QueryTest.cc
         RevTreeTest.cc
+        SequenceSetTest.cc
         SequenceTrackerTest.cc
         SQLiteFunctionsTest.cc
         UpgraderTest.cc
@@ -33,8 +35,11 @@ function(set_source_files_base)
         ${TOP}vendor/fleece/Tests/ValueTests.cc
         ${TOP}vendor/fleece/Experimental/KeyTree.cc
         ${TOP}Replicator/tests/ReplicatorLoopbackTest.cc
+        ${TOP}Replicator/tests/ReplicatorPerfTest.cc
         ${TOP}C/tests/c4Test.cc 
         ${TOP}Replicator/tests/CookieStoreTest.cc
+        ${TOP}Replicator/tests/InsertionTunerTest.cc
+        ${TOP}Replicator/tests/CheckpointTest.cc
         ${TOP}REST/Response.cc
         main.cpp
         PARENT_SCOPE
@@ -25,7 +25,9 @@
 #include "Request.hh"
 #include "StringUtil.hh"
 #include "c4ExceptionUtils.hh"
+#include <algorithm>
 #include <functional>
+#include <thread>
 
 using namespace std;
 using namespace fleece;
@@ -138,9 +140,32 @@ namespace litecore { namespace REST {
     }
 
 
+    void RESTListener::handleGetStats(RequestResponse &rq, C4Database *db) {
+        C4Error err;
+        alloc_slice stats = c4db_getStatistics(db, &err);
+        if (!stats)
+            return rq.respondWithError(err);
+        rq.jsonEncoder().writeValue(Value::fromData(stats, kFLTrusted));
+    }
+
+
 #pragma mark - DOCUMENT HANDLERS:
 
 
+    // Returns the value of a docID query parameter, like `startkey`. CouchDB expects these to
+    // be JSON strings, but a bare docID is accepted too.
+    static string docIDQuery(RequestResponse &rq, const char *param) {
+        string value = rq.query(param);
+        if (!value.empty() && value[0] == '"') {
+            Doc json = Doc::fromJSON(slice(value));
+            slice str = json.root().asString();
+            if (str)
+                return string(str);
+        }
+        return value;
+    }
+
+
     void RESTListener::handleGetAllDocs(RequestResponse &rq, C4Database *db) {
         // Apply options:
         C4EnumeratorOptions options;
@@ -150,19 +175,30 @@ namespace litecore { namespace REST {
         bool includeDocs = rq.boolQuery("include_docs");
         if (includeDocs)
             options.flags |= kC4IncludeBodies;
-        // TODO: Implement startkey, endkey, skip, limit, etc.
+        string startKey = docIDQuery(rq, "startkey");
+        string endKey = docIDQuery(rq, "endkey");
+        int64_t skip = rq.intQuery("skip", 0);
+        int64_t limit = rq.intQuery("limit", -1);
+        if (skip < 0 || limit < -1)
+            return rq.respondWithStatus(HTTPStatus::BadRequest, "Invalid skip or limit");
 
         // Create enumerator:
         C4Error err;
-        c4::ref<C4DocEnumerator> e = c4db_enumerateAllDocs(db, &options, &err);
+        c4::ref<C4DocEnumerator> e = c4db_enumerateDocRange(db,
+                                        (startKey.empty() ? nullslice : slice(startKey)),
+                                        (endKey.empty() ? nullslice : slice(endKey)),
+                                        skip,
+                                        (limit < 0 ? UINT64_MAX : uint64_t(limit)),
+                                        &options, &err);
         if (!e)
             return rq.respondWithError(err);
 
-        // Enumerate, building JSON:
-        auto &json = rq.jsonEncoder();
-        json.beginDict();
-        json.writeKey("rows"_sl);
-        json.beginArray();
+        // Enumerate, streaming the JSON one row at a time so it's never all in memory:
+        rq.setHeader("Content-Type", "application/json");
+        rq.setChunked();
+        rq.write("{\"rows\":[");
+        JSONEncoder json;
+        bool first = true;
         while (c4enum_next(e, &err)) {
             C4DocumentInfo info;
             c4enum_getDocumentInfo(e, &info);
@@ -178,19 +214,37 @@ namespace litecore { namespace REST {
             json.endDict();
 
             if (includeDocs) {
+                // Headers have already been sent, so a failure can only be reported in the row:
+                alloc_slice docBody;
                 c4::ref<C4Document> doc = c4enum_getDocument(e, &err);
-                if (!doc)
-                    return rq.respondWithError(err);
-                alloc_slice docBody = c4doc_bodyAsJSON(doc, false, &err);
-                if (!docBody)
-                    return rq.respondWithError(err);
-                json.writeKey("doc"_sl);
-                json.writeRaw(docBody);
+                if (doc)
+                    docBody = c4doc_bodyAsJSON(doc, false, &err);
+                if (docBody) {
+                    json.writeKey("doc"_sl);
+                    json.writeRaw(docBody);
+                } else {
+                    alloc_slice message = c4error_getMessage(err);
+                    json.writeKey("error"_sl);
+                    json.writeString(message);
+                    err = {};
+                }
             }
             json.endDict();
+
+            if (!first)
+                rq.write(",");
+            first = false;
+            rq.write(json.finish());
+            json.reset();
         }
-        json.endArray();
-        json.endDict();
+        rq.write("]");
+        if (err.code) {
+            alloc_slice message = c4error_getMessage(err);
+            json.writeString(message);
+            rq.write(",\"error\":");
+            rq.write(json.finish());
+        }
+        rq.write("}");
     }
 
 
@@ -220,7 +274,7 @@ namespace litecore { namespace REST {
 
         // Splice the _id and _rev into the start of the JSON:
         rq.setHeader("Content-Type", "application/json");
-        rq.setChunked();    // OPT: Buffer this and write in one go
+        rq.setChunked();
         rq.write("{\"_id\":\"");
         rq.write(docID);
         rq.write("\",\"_rev\":\"");
@@ -247,6 +301,29 @@ namespace litecore { namespace REST {
                              C4Database *db,
                              fleece::JSONEncoder& json,
                              C4Error *outError)
+    {
+        // The body has to be encoded in a transaction, since it may add to the shared keys:
+        c4::Transaction t(db);
+        if (!t.begin(outError))
+            return false;
+        DocEdit edit;
+        return prepareDoc(body, docID, revIDQuery, deleting, newEdits,
+                          c4db_getFLSharedKeys(db), edit, outError)
+            && saveDoc(edit, newEdits, db, json, outError)
+            && t.commit(outError);
+    }
+
+
+    // Validates a doc update and encodes its body as Fleece, using the given shared keys.
+    // This doesn't access the database, so it can be called on any thread.
+    bool RESTListener::prepareDoc(Dict body,
+                                  string docID,
+                                  string revIDQuery,
+                                  bool deleting,
+                                  bool newEdits,
+                                  FLSharedKeys sharedKeys,
+                                  DocEdit &edit,
+                                  C4Error *outError)
     {
         if (!deleting && !body) {
             c4error_return(WebSocketDomain, (int)HTTPStatus::BadRequest,
@@ -285,40 +362,42 @@ namespace litecore { namespace REST {
         if (body["_deleted"_sl].asBool())
             deleting = true;
 
-        c4::ref<C4Document> doc;
-        {
-            c4::Transaction t(db);
-            if (!t.begin(outError))
+        // Encode body as Fleece (and strip _id and _rev):
+        if (body) {
+            edit.body = c4doc_encodeStrippingOldMetaProperties(body, sharedKeys, outError);
+            if (!edit.body)
                 return false;
+        }
+        edit.docID = docID;
+        if (revID)
+            edit.revID = alloc_slice(revID);
+        edit.deleting = deleting;
+        return true;
+    }
 
-            // Encode body as Fleece (and strip _id and _rev):
-            alloc_slice encodedBody;
-            if (body) {
-                encodedBody = c4doc_encodeStrippingOldMetaProperties(body,
-                                                                     c4db_getFLSharedKeys(db),
-                                                                     outError);
-                if (!encodedBody)
-                    return false;
-            }
 
-            // Save the revision:
-            C4Slice history[1] = {revID};
-            C4DocPutRequest put = {};
-            put.allocedBody = {(void*)encodedBody.buf, encodedBody.size};
-            if (!docID.empty())
-                put.docID = slice(docID);
-            put.revFlags = (deleting ? kRevDeleted : 0);
-            put.existingRevision = !newEdits;
-            put.allowConflict = false;
-            put.history = history;
-            put.historyCount = revID ? 1 : 0;
-            put.save = true;
-            doc = c4doc_put(db, &put, nullptr, outError);
-
-            if (!doc || !t.commit(outError))
-                return false;
-        }
-        revID = slice(doc->selectedRev.revID);
+    // Saves a prepared doc update, and writes its result to `json`. Must be called in a
+    // transaction.
+    bool RESTListener::saveDoc(const DocEdit &edit,
+                               bool newEdits,
+                               C4Database *db,
+                               fleece::JSONEncoder& json,
+                               C4Error *outError)
+    {
+        C4Slice history[1] = {edit.revID};
+        C4DocPutRequest put = {};
+        put.allocedBody = {(void*)edit.body.buf, edit.body.size};
+        if (!edit.docID.empty())
+            put.docID = slice(edit.docID);
+        put.revFlags = (edit.deleting ? kRevDeleted : 0);
+        put.existingRevision = !newEdits;
+        put.allowConflict = false;
+        put.history = history;
+        put.historyCount = edit.revID ? 1 : 0;
+        put.save = true;
+        c4::ref<C4Document> doc = c4doc_put(db, &put, nullptr, outError);
+        if (!doc)
+            return false;
 
         json.writeKey("ok"_sl);
         json.writeBool(true);
@@ -368,6 +447,40 @@ namespace litecore { namespace REST {
         Value v = body["new_edits"];
         bool newEdits = v ? v.asBool() : true;
 
+        // Validate and encode the docs in parallel, before starting the transaction, so the
+        // database is only locked while they're saved. They're encoded with a copy of the
+        // database's shared keys, since those can only be added to in a transaction.
+        SharedKeys dbKeys = c4db_getFLSharedKeys(db);
+        SharedKeys tempKeys = SharedKeys::create(dbKeys.stateData());
+        unsigned initialKeyCount = tempKeys.count();
+
+        uint32_t count = docs.count();
+        vector<DocEdit> edits(count);
+        vector<C4Error> errors(count);
+        auto prepareDocs = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; ++i) {
+                errors[i] = {};
+                prepareDoc(docs[i].asDict(), "", "", false, newEdits, tempKeys,
+                           edits[i], &errors[i]);
+            }
+        };
+        static constexpr uint32_t kMinDocsPerThread = 64;
+        uint32_t nThreads = max(1u, min(thread::hardware_concurrency(),
+                                        count / kMinDocsPerThread));
+        if (nThreads > 1) {
+            vector<thread> threads;
+            uint32_t perThread = (count + nThreads - 1) / nThreads;
+            for (uint32_t begin = perThread; begin < count; begin += perThread)
+                threads.emplace_back(prepareDocs, begin, min(begin + perThread, count));
+            prepareDocs(0, perThread);
+            for (auto &t : threads)
+                t.join();
+        } else {
+            prepareDocs(0, count);
+        }
+        // If encoding added new keys, those bodies can't be used as-is in the database:
+        bool reEncode = (tempKeys.count() > initialKeyCount);
+
         C4Error error;
         c4::Transaction t(db);
         if (!t.begin(&error))
@@ -375,10 +488,20 @@ namespace litecore { namespace REST {
 
         auto &json = rq.jsonEncoder();
         json.beginArray();
-        for (Array::iterator i(docs); i; ++i) {
+        for (uint32_t i = 0; i < count; ++i) {
             json.beginDict();
-            Dict doc = i.value().asDict();
-            if (!modifyDoc(doc, "", "", false, newEdits, db, json, &error))
+            DocEdit &edit = edits[i];
+            error = errors[i];
+            if (error.code == 0) {
+                if (reEncode && edit.body) {
+                    SharedEncoder enc(c4db_getSharedFleeceEncoder(db));
+                    enc.writeValue(Doc(edit.body, kFLTrusted, tempKeys).root());
+                    edit.body = enc.finish();
+                    enc.reset();
+                }
+                saveDoc(edit, newEdits, db, json, &error);
+            }
+            if (error.code)
                 rq.writeErrorJSON(error);
             json.endDict();
         }
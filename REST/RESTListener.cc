@@ -91,6 +91,7 @@ namespace litecore { namespace REST {
             // Database-level special handlers:
             addDBHandler(Server::GET, "/*/_all_docs$", &RESTListener::handleGetAllDocs);
             addDBHandler(Server::POST, "/*/_bulk_docs$", &RESTListener::handleBulkDocs);
+            addDBHandler(Server::GET, "/*/_stats$", &RESTListener::handleGetStats);
             _server->addHandler(Server::DEFAULT, "/*/_", notFound);
 
             // Document:
@@ -107,6 +107,7 @@ namespace litecore { namespace REST {
         void handleGetDatabase(RequestResponse&, C4Database*);
         void handleCreateDatabase(RequestResponse&);
         void handleDeleteDatabase(RequestResponse&, C4Database*);
+        void handleGetStats(RequestResponse&, C4Database*);
 
         void handleGetAllDocs(RequestResponse&, C4Database*);
         void handleGetDoc(RequestResponse&, C4Database*);
@@ -122,6 +123,28 @@ namespace litecore { namespace REST {
                        fleece::JSONEncoder& json,
                        C4Error *outError);
 
+        // A document update that's been validated and encoded, ready to be saved.
+        struct DocEdit {
+            std::string docID;
+            fleece::alloc_slice revID;
+            fleece::alloc_slice body;                   // Fleece, without _id, _rev, etc.
+            bool deleting {false};
+        };
+
+        static bool prepareDoc(fleece::Dict body,
+                               std::string docID,
+                               std::string revIDQuery,
+                               bool deleting,
+                               bool newEdits,
+                               FLSharedKeys,
+                               DocEdit&,
+                               C4Error *outError);
+        static bool saveDoc(const DocEdit&,
+                            bool newEdits,
+                            C4Database *db,
+                            fleece::JSONEncoder& json,
+                            C4Error *outError);
+
         std::unique_ptr<FilePath> _directory;
         const bool _allowCreateDB, _allowDeleteDB;
         std::unique_ptr<Server> _server;
@@ -29,6 +29,9 @@ using namespace fleece;
 
 namespace litecore { namespace REST {
 
+    // Size at which buffered output is sent as a chunk, in chunked mode
+    static constexpr size_t kChunkSize = 16384;
+
 #pragma mark - REQUEST:
 
 
@@ -255,7 +258,9 @@ namespace litecore { namespace REST {
         }
         _contentSent += content.size;
         if (_chunked) {
-            mg_send_chunk(_conn, (const char*)content.buf, (unsigned)content.size);
+            _chunkBuffer.append((const char*)content.buf, content.size);
+            if (_chunkBuffer.size() >= kChunkSize)
+                flush();
         } else {
             Assert(_contentLength >= 0);
             mg_write(_conn, content.buf, content.size);
@@ -263,6 +268,15 @@ namespace litecore { namespace REST {
     }
 
 
+    void RequestResponse::flush() {
+        if (_chunked && !_chunkBuffer.empty()) {
+            sendHeaders();
+            mg_send_chunk(_conn, _chunkBuffer.data(), (unsigned)_chunkBuffer.size());
+            _chunkBuffer.clear();
+        }
+    }
+
+
     void RequestResponse::printf(const char *format, ...) {
         char *str;
         va_list args;
@@ -291,6 +305,7 @@ namespace litecore { namespace REST {
             setContentLength(0);
         sendHeaders();
         if (_chunked) {
+            flush();
             mg_send_chunk(_conn, nullptr, 0);
             mg_write(_conn, "\r\n", 2);
         } else {
@@ -69,10 +69,15 @@ namespace litecore { namespace REST {
         void setChunked();
         void uncacheable();
 
+        // In chunked mode, written data is buffered and sent in chunks of about kChunkSize bytes,
+        // so a large response can be streamed without holding all of it in memory.
         void write(fleece::slice);
         void write(const char *content)                     {write(fleece::slice(content));}
         void printf(const char *format, ...) __printflike(2, 3);
 
+        // Sends any data buffered by write() in chunked mode.
+        void flush();
+
         fleece::JSONEncoder& jsonEncoder();
 
         void writeStatusJSON(HTTPStatus status, const char *message =nullptr);
@@ -94,6 +99,7 @@ namespace litecore { namespace REST {
         bool _chunked {false};
         int64_t _contentLength {-1};
         int64_t _contentSent {0};
+        std::string _chunkBuffer;
         std::unique_ptr<fleece::JSONEncoder> _jsonEncoder;
     };
 
@@ -21,6 +21,7 @@
 #include "c4.hh"
 #include "FilePath.hh"
 #include "Response.hh"
+#include <sstream>
 
 using namespace std;
 using namespace fleece;
@@ -283,6 +284,37 @@ TEST_CASE_METHOD(C4RESTTest, "REST _all_docs", "[REST][C]") {
 }
 
 
+TEST_CASE_METHOD(C4RESTTest, "REST _all_docs range", "[REST][C]") {
+    createNumberedDocs(20);
+
+    auto docIDs = [&](string query) {
+        auto r = request("GET", "/db/_all_docs?" + query, HTTPStatus::OK);
+        string ids;
+        for (Array::iterator i(r->bodyAsJSON().asDict()["rows"].asArray()); i; ++i) {
+            if (!ids.empty())
+                ids += ",";
+            ids += to_str(i.value().asDict()["id"]);
+        }
+        return ids;
+    };
+
+    CHECK(docIDs("limit=3") == "doc-001,doc-002,doc-003");
+    CHECK(docIDs("limit=2&skip=5") == "doc-006,doc-007");
+    CHECK(docIDs("startkey=%22doc-018%22") == "doc-018,doc-019,doc-020");
+    CHECK(docIDs("startkey=doc-004&endkey=doc-006") == "doc-004,doc-005,doc-006");
+    CHECK(docIDs("descending=true&startkey=doc-003") == "doc-003,doc-002,doc-001");
+    CHECK(docIDs("descending=true&limit=1") == "doc-020");
+    CHECK(docIDs("limit=0") == "");
+
+    auto r = request("GET", "/db/_all_docs?include_docs=true&startkey=doc-010&limit=1",
+                     HTTPStatus::OK);
+    auto row = r->bodyAsJSON().asDict()["rows"].asArray()[0].asDict();
+    CHECK(row["doc"].asDict());
+
+    request("GET", "/db/_all_docs?limit=-5", HTTPStatus::BadRequest);
+}
+
+
 TEST_CASE_METHOD(C4RESTTest, "REST _bulk_docs", "[REST][C]") {
     unique_ptr<Response> r;
     r = request("POST", "/db/_bulk_docs",
@@ -314,3 +346,33 @@ TEST_CASE_METHOD(C4RESTTest, "REST _bulk_docs", "[REST][C]") {
     CHECK(doc["status"].asInt() == 404);
     CHECK(doc["error"].asString() == "Not Found"_sl);
 }
+
+
+TEST_CASE_METHOD(C4RESTTest, "REST _bulk_docs many", "[REST][C]") {
+    // Enough docs to be encoded on several threads, each with a property name that isn't in
+    // the database's shared keys yet:
+    static constexpr int kNumDocs = 1000;
+    stringstream json;
+    json << "{\"docs\":[";
+    for (int i = 0; i < kNumDocs; ++i) {
+        if (i > 0)
+            json << ",";
+        json << "{\"_id\":\"doc-" << i << "\",\"prop" << (i % 50) << "\":" << i << "}";
+    }
+    json << "]}";
+    auto r = request("POST", "/db/_bulk_docs",
+                     {{"Content-Type", "application/json"}},
+                     slice(json.str()), HTTPStatus::OK);
+    Array body = r->bodyAsJSON().asArray();
+    REQUIRE(body.count() == kNumDocs);
+    for (Array::iterator i(body); i; ++i)
+        CHECK(i.value().asDict()["ok"].asBool());
+    CHECK(c4db_getDocumentCount(db) == kNumDocs);
+
+    for (int i : {0, 1, 499, 999}) {
+        string docID = "doc-" + to_string(i);
+        r = request("GET", "/db/" + docID, HTTPStatus::OK);
+        Dict doc = r->bodyAsJSON().asDict();
+        CHECK(doc["prop" + to_string(i % 50)].asInt() == i);
+    }
+}
@@ -0,0 +1,287 @@
+//
+// ChangesFeed.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "ChangesFeed.hh"
+#include "Replicator.hh"
+#include "DBAccess.hh"
+#include "fleece/Fleece.hh"
+#include "StringUtil.hh"
+#include "c4Private.h"
+#include "c4Document+Fleece.h"
+#include "c4Replicator.h"
+#include "Instrumentation.hh"
+
+using namespace std;
+using namespace fleece;
+
+namespace litecore { namespace repl {
+
+    ChangesFeed::ChangesFeed(Replicator *replicator)
+    :Worker(replicator, "ChangesFeed")
+    {
+        _important = false;
+    }
+
+
+    void ChangesFeed::_getChanges(Params p, bool prefetch, Callback callback) {
+        if (!connection())
+            return;
+        _callback = callback;
+        _params = p;
+        if (_maxSequence < p.since)
+            _maxSequence = p.since;
+
+        Batch changes;
+        C4SequenceNumber lastSequence;
+        bool caughtUp;
+        C4Error error;
+        if (_prefetched && _prefetchedParams.since == p.since && _prefetchedParams.sameFilters(p)) {
+            // The batch the Pusher wants has already been read:
+            logVerbose("Using %zu prefetched changes since #%" PRIu64, _prefetched->size(), p.since);
+            changes = move(_prefetched);
+            lastSequence = _prefetchedLastSequence;
+            caughtUp = _prefetchedCaughtUp;
+            error = _prefetchedError;
+        } else {
+            changes = readChanges(p, true, lastSequence, caughtUp, error);
+        }
+        _prefetched.reset();
+
+        _callback(changes, lastSequence, caughtUp, error);
+
+        // Read the next batch ahead of time, after giving other requests a chance to run:
+        _wantPrefetch = (prefetch && !caughtUp && !error.code);
+        if (_wantPrefetch) {
+            _prefetchedParams = p;
+            _prefetchedParams.since = lastSequence;
+            enqueue(&ChangesFeed::_prefetch);
+        }
+    }
+
+
+    void ChangesFeed::_prefetch() {
+        if (!_wantPrefetch || !connection())
+            return;
+        _wantPrefetch = false;
+        // Don't start the observer here; if the batch turns out to reach the end of the db in
+        // continuous mode it's discarded, so the Pusher's next request re-reads it and starts
+        // observing at the same time, without missing any changes in between.
+        _prefetched = readChanges(_prefetchedParams, false,
+                                  _prefetchedLastSequence, _prefetchedCaughtUp, _prefetchedError);
+        if (_prefetchedCaughtUp && _prefetchedParams.continuous) {
+            logDebug("Prefetch reached end of db; discarding it");
+            _prefetched.reset();
+        }
+    }
+
+
+    void ChangesFeed::_connectionClosed() {
+        Worker::_connectionClosed();
+        _changeObserver = nullptr;
+        _callback = nullptr;
+        _prefetched.reset();
+        _wantPrefetch = false;
+    }
+
+
+    // Runs a by-sequence enumerator to find the next batch of changed docs.
+    ChangesFeed::Batch ChangesFeed::readChanges(const Params &p, bool canObserve,
+                                                C4SequenceNumber &outLastSequence,
+                                                bool &outCaughtUp,
+                                                C4Error &outError)
+    {
+        Signpost signpost(Signpost::getChanges, uintptr_t(this), p.since);
+        auto limit = p.limit;
+        logVerbose("Reading up to %u local changes since #%" PRIu64, limit, p.since);
+
+        if (p.getForeignAncestors)
+            _db->markRevsSyncedNow();   // make sure foreign ancestors are up to date
+
+        auto changes = make_shared<RevToSendList>();
+        C4SequenceNumber lastSequence = p.since;
+        outError = {};
+        C4EnumeratorOptions options = kC4DefaultEnumeratorOptions;
+        if (!p.getForeignAncestors && !_options.pushFilter)
+            options.flags &= ~kC4IncludeBodies;
+        if (!p.skipDeleted)
+            options.flags |= kC4IncludeDeleted;
+
+        _db->use([&](C4Database* db) {
+            c4::ref<C4DocEnumerator> e = c4db_enumerateChanges(db, p.since, &options, &outError);
+            if (e) {
+                changes->reserve(limit);
+                while (c4enum_next(e, &outError) && limit > 0) {
+                    C4DocumentInfo info;
+                    c4enum_getDocumentInfo(e, &info);
+                    lastSequence = info.sequence;
+                    auto rev = retained(new RevToSend(info));
+                    C4Error docError = {};
+                    if (passesFilters(rev, e, db, p, &docError)) {
+                        changes->push_back(rev);
+                        --limit;
+                    } else if (docError.code) {
+                        finishedDocumentWithError(rev, docError, false);
+                    }
+                }
+            }
+
+            if (canObserve && p.continuous && limit > 0 && !_changeObserver) {
+                // Reached the end of history; now start observing for future changes
+                _changeObserver = c4dbobs_create(db,
+                                                 [](C4DatabaseObserver* observer, void *context) {
+                                                     auto self = (ChangesFeed*)context;
+                                                     self->enqueue(&ChangesFeed::dbChanged);
+                                                 },
+                                                 this);
+                logDebug("Started DB observer");
+            }
+        });
+
+        _maxSequence = max(_maxSequence, lastSequence);
+        outLastSequence = lastSequence;
+        outCaughtUp = (limit > 0);
+        return changes;
+    }
+
+
+    // (Async) callback from the C4DatabaseObserver when the database has changed
+    void ChangesFeed::dbChanged() {
+        if (!_changeObserver || !_callback)
+            return; // if replication has stopped already by the time this async call occurs
+
+        if (_params.getForeignAncestors)
+            _db->markRevsSyncedNow();   // make sure foreign ancestors are up to date
+
+        static const uint32_t kMaxChanges = 100;
+        C4DatabaseChange c4changes[kMaxChanges];
+        bool external;
+        uint32_t nChanges;
+        Batch changes;
+        bool sawChanges = false;
+
+        while (true) {
+            nChanges = c4dbobs_getChanges(_changeObserver, c4changes, kMaxChanges, &external);
+            if (nChanges == 0)
+                break;        // no more changes
+            sawChanges = true;
+            if (!external) {
+                logDebug("Notified of %u of my own db changes #%llu ... #%llu (ignoring)",
+                         nChanges, c4changes[0].sequence, c4changes[nChanges-1].sequence);
+                _maxSequence = c4changes[nChanges-1].sequence;
+                c4dbobs_releaseChanges(c4changes, nChanges);
+                continue;     // ignore changes I made myself
+            }
+            logVerbose("Notified of %u db changes #%" PRIu64 " ... #%" PRIu64,
+                       nChanges, c4changes[0].sequence, c4changes[nChanges-1].sequence);
+
+            // Copy the changes into a vector of RevToSend:
+            C4DatabaseChange *c4change = c4changes;
+            _db->use([&](C4Database *db) {
+                for (uint32_t i = 0; i < nChanges; ++i, ++c4change) {
+                    if (!changes) {
+                        changes = make_shared<RevToSendList>();
+                        changes->reserve(nChanges - i);
+                    }
+                    _maxSequence = c4change->sequence;
+                    auto rev = retained(new RevToSend({0, c4change->docID, c4change->revID,
+                                                       c4change->sequence, c4change->bodySize}));
+                    // Note: we send tombstones even if the original getChanges() call specified
+                    // skipDeletions. This is intentional; skipDeletions applies only to the initial
+                    // dump of existing docs, not to 'live' changes.
+                    C4Error docError = {};
+                    if (passesFilters(rev, nullptr, db, _params, &docError)) {
+                        changes->push_back(rev);
+                        if (changes->size() >= kMaxChanges) {
+                            _callback(move(changes), _maxSequence, true, {});
+                            changes.reset();
+                        }
+                    } else if (docError.code) {
+                        finishedDocumentWithError(rev, docError, false);
+                    }
+                }
+            });
+
+            c4dbobs_releaseChanges(c4changes, nChanges);
+        }
+
+        if (changes && changes->size() > 0)
+            _callback(move(changes), _maxSequence, true, {});
+        else if (sawChanges)
+            _callback(nullptr, _maxSequence, true, {});     // Just report the latest sequence
+    }
+
+
+    bool ChangesFeed::shouldPushRev(RevToSend *rev, const Params &p, C4Error *outError) const {
+        return _db->use<bool>([&](C4Database *db) {
+            return passesFilters(rev, nullptr, db, p, outError);
+        });
+    }
+
+
+    bool ChangesFeed::passesFilters(RevToSend *rev, C4DocEnumerator *e, C4Database *db,
+                                    const Params &p, C4Error *outError) const
+    {
+        if (p.docIDs != nullptr)
+            if (p.docIDs->find(slice(rev->docID).asString()) == p.docIDs->end())
+                return false;
+
+        if (rev->expiration > 0 && rev->expiration < c4_now()) {
+            logVerbose("'%.*s' is expired; not pushing it", SPLAT(rev->docID));
+            return false;
+        }
+
+        bool needRemoteRevID = p.getForeignAncestors && !rev->remoteAncestorRevID
+                                                     && _checkpointValid;
+        if (needRemoteRevID || _options.pushFilter) {
+            c4::ref<C4Document> doc;
+            doc = e ? c4enum_getDocument(e, outError) : c4doc_get(db, rev->docID, true, outError);
+            if (!doc)
+                return false;   // reject rev: error getting doc
+            if (slice(doc->revID) != slice(rev->revID))
+                return false;   // ignore rev: there's a newer one already
+
+            if (needRemoteRevID) {
+                // For proposeChanges, find the nearest foreign ancestor of the current rev:
+                Assert(_db->remoteDBID());
+                alloc_slice foreignAncestor = _db->getDocRemoteAncestor(doc);
+                logDebug("remoteRevID of '%.*s' is %.*s", SPLAT(doc->docID), SPLAT(foreignAncestor));
+                if (p.skipForeign && foreignAncestor == slice(rev->revID))
+                    return false;   // skip this rev: it's already on the peer
+                if (foreignAncestor
+                        && c4rev_getGeneration(foreignAncestor) >= c4rev_getGeneration(rev->revID)) {
+                    if (_options.pull <= kC4Passive) {
+                        *outError = c4error_make(WebSocketDomain, 409,
+                                                 "conflicts with newer server revision"_sl);
+                    }
+                    return false;    // ignore rev: there's a newer one on the server
+                }
+                rev->remoteAncestorRevID = foreignAncestor;
+            }
+
+            if (_options.pushFilter) {
+                if (!_options.pushFilter(doc->docID, doc->selectedRev.revID, doc->selectedRev.flags,
+                                         DBAccess::getDocRoot(doc), _options.callbackContext)) {
+                    logVerbose("Doc '%.*s' rejected by push filter", SPLAT(doc->docID));
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+} }
@@ -0,0 +1,119 @@
+//
+// ChangesFeed.hh
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "Worker.hh"
+#include "ReplicatorTypes.hh"
+#include "c4.hh"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_set>
+
+namespace litecore { namespace repl {
+
+    /** Used by the Pusher to read local changes from the database on a separate actor, so the
+        Pusher isn't blocked by DB I/O. After delivering a full batch it reads the following one
+        ahead of time, so it's ready by the time the Pusher asks for it. In continuous mode it
+        also owns the database observer that reports later changes; closing the connection
+        stops it and releases the callback.
+
+        Only change metadata is read ahead. Revision bodies are still read by the Pusher when
+        it sends each "rev" message: a C4Document loads revisions lazily through its own
+        C4Database, so it can't be handed across threads, and most proposed revs are never
+        requested by the peer anyway. */
+    class ChangesFeed : public Worker {
+    public:
+        using DocIDSet = std::shared_ptr<std::unordered_set<std::string>>;
+
+        struct Params {
+            C4SequenceNumber since;
+            DocIDSet docIDs;
+            unsigned limit;
+            bool continuous, getForeignAncestors;
+            bool skipDeleted, skipForeign;
+
+            bool sameFilters(const Params &other) const {
+                return docIDs == other.docIDs && limit == other.limit
+                    && continuous == other.continuous
+                    && getForeignAncestors == other.getForeignAncestors
+                    && skipDeleted == other.skipDeleted && skipForeign == other.skipForeign;
+            }
+        };
+
+        /** Called with each batch of changes: the revs to push, the last sequence examined,
+            whether the end of the database was reached, and any error.
+            The db observer calls it with a null list when it only saw changes that won't be
+            pushed (such as the replicator's own), so the Pusher can still advance its
+            sequence. */
+        using Callback = std::function<void(std::shared_ptr<RevToSendList>,
+                                            C4SequenceNumber lastSequence,
+                                            bool caughtUp,
+                                            C4Error)>;
+
+        ChangesFeed(Replicator* NONNULL);
+
+        /** Asynchronously reads up to `p.limit` changes after `p.since` and calls the callback.
+            If `prefetch` is true and the batch is full, the next batch is then read ahead.
+            The callback is also used to deliver changes found later by the database observer. */
+        void getChanges(const Params &p, bool prefetch, Callback callback) {
+            enqueue(&ChangesFeed::_getChanges, p, prefetch, callback);
+        }
+
+        void checkpointIsInvalid()              {_checkpointValid = false;}
+
+        /** Checks the per-document criteria for pushing a rev: the docID filter, expiration,
+            foreign ancestor and push filter. The Pusher calls this directly (on its own thread)
+            for revs it was holding back. It holds the database lock throughout, as the feed
+            does while reading changes, so the two threads' checks never overlap and the push
+            filter is never called concurrently.
+            If the rev is rejected because of an error, the error is stored in `*outError`. */
+        bool shouldPushRev(RevToSend* NONNULL, const Params&, C4Error *outError) const;
+
+    private:
+        using Batch = std::shared_ptr<RevToSendList>;
+
+        // Must be called within `_db->use()`:
+        bool passesFilters(RevToSend* NONNULL,
+                           C4DocEnumerator*,
+                           C4Database* NONNULL,
+                           const Params&,
+                           C4Error *outError) const;
+
+        void _getChanges(Params, bool prefetch, Callback);
+        void _prefetch();
+        virtual void _connectionClosed() override;
+        void dbChanged();
+        Batch readChanges(const Params&, bool canObserve,
+                          C4SequenceNumber &outLastSequence, bool &outCaughtUp, C4Error &outError);
+
+        Callback _callback;                             // Where to deliver batches
+        Params _params {};                              // Params of the latest request
+        Batch _prefetched;                              // Batch read ahead of time, if any
+        Params _prefetchedParams {};                    // Params _prefetched was read with
+        C4SequenceNumber _prefetchedLastSequence {0};
+        bool _prefetchedCaughtUp {false};
+        C4Error _prefetchedError {};
+        bool _wantPrefetch {false};                     // Should _prefetch() read a batch?
+        C4SequenceNumber _maxSequence {0};              // Latest sequence read from the db
+        c4::ref<C4DatabaseObserver> _changeObserver;    // Used in continuous push mode
+        std::atomic<bool> _checkpointValid {true};
+    };
+
+} }
@@ -35,10 +35,14 @@ namespace litecore { namespace repl {
         return _seq;
     }
 
-    void Checkpoint::set(const C4SequenceNumber *local, const slice *remote) {
+    void Checkpoint::set(const C4SequenceNumber *local, const slice *remote,
+                         const SequenceSet::RangeList *completed)
+    {
         LOCK();
         if (local)
             _seq.local = *local;
+        if (completed)
+            _seq.localCompleted = *completed;
         if (remote)
             _seq.remote = *remote;
 
@@ -59,7 +63,11 @@ namespace litecore { namespace repl {
                   (unsigned long long)_seq.local,
                   (unsigned long long)itsState.local);
             _seq.local = 0;
+            _seq.localCompleted.clear();
             match = false;
+        } else if (_seq.localCompleted != itsState.localCompleted) {
+            LogTo(SyncLog, "Completed local sequences mismatch; ignoring them");
+            _seq.localCompleted.clear();
         }
         if (_seq.remote && _seq.remote != itsState.remote) {
             LogTo(SyncLog, "Remote sequence mismatch: I had '%.*s', remote had '%.*s'",
@@ -76,10 +84,27 @@ namespace litecore { namespace repl {
         LOCK();
         _seq.local = 0;
         _seq.remote = nullslice;
+        _seq.localCompleted.clear();
         if (json) {
             Doc root = Doc::fromJSON(json, nullptr);
             _seq.local = (C4SequenceNumber) root["local"_sl].asInt();
             _seq.remote = root["remote"_sl].toJSON();
+
+            // Completed ranges must be ascending, disjoint, and above the local sequence;
+            // if they're not, ignore them all rather than risk skipping unpushed revisions:
+            C4SequenceNumber prev = _seq.local;
+            for (Array::iterator i(root["localCompleted"_sl].asArray()); i; ++i) {
+                Array range = i.value().asArray();
+                auto first = (C4SequenceNumber)range[0].asUnsigned();
+                auto last  = (C4SequenceNumber)range[1].asUnsigned();
+                if (range.count() != 2 || first <= prev || last < first) {
+                    LogTo(SyncLog, "Ignoring invalid completed ranges in checkpoint");
+                    _seq.localCompleted.clear();
+                    break;
+                }
+                _seq.localCompleted.emplace_back(first, last);
+                prev = last;
+            }
         }
     }
 
@@ -92,6 +117,17 @@ namespace litecore { namespace repl {
             enc.writeKey("local"_sl);
             enc.writeUInt(_seq.local);
         }
+        if (!_seq.localCompleted.empty()) {
+            enc.writeKey("localCompleted"_sl);
+            enc.beginArray();
+            for (auto &range : _seq.localCompleted) {
+                enc.beginArray();
+                enc.writeUInt(range.first);
+                enc.writeUInt(range.second);
+                enc.endArray();
+            }
+            enc.endArray();
+        }
         if (_seq.remote) {
             enc.writeKey("remote"_sl);
             enc.writeRaw(_seq.remote);   // _seq.remote is already JSON
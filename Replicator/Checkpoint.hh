@@ -18,6 +18,7 @@
 
 #pragma once
 #include "Timer.hh"
+#include "SequenceSet.hh"
 #include "c4.h"
 #include "fleece/slice.hh"
 #include <chrono>
@@ -30,13 +31,17 @@ namespace litecore { namespace repl {
         struct Sequences {
             C4SequenceNumber local;
             fleece::alloc_slice remote;
+            SequenceSet::RangeList localCompleted;  // Ranges above `local` already pushed
         };
 
         /** Returns my local and remote sequences. */
         Sequences sequences() const;
 
-        /** Sets my local sequence without affecting the remote one. */
-        void setLocalSeq(C4SequenceNumber s)        {set(&s, nullptr);}
+        /** Sets my local sequence, and the ranges of higher sequences that have also been
+            pushed, without affecting the remote sequence. */
+        void setLocalSeq(C4SequenceNumber s, const SequenceSet::RangeList &completed = {}) {
+            set(&s, nullptr, &completed);
+        }
 
         /** Sets my remote sequence without affecting the local one. */
         void setRemoteSeq(fleece::slice s)          {set(nullptr, &s);}
@@ -48,7 +53,9 @@ namespace litecore { namespace repl {
         fleece::alloc_slice encode() const;
 
         /** Compares my state with another Checkpoint. If the local sequences differ, mine
-            will be reset to 0; if the remote sequences differ, mine will be reset to empty. */
+            will be reset to 0; if the remote sequences differ, mine will be reset to empty.
+            If only the completed local ranges differ, mine are cleared but this still counts
+            as a match, since the local sequence alone is a valid (if coarser) checkpoint. */
         bool validateWith(const Checkpoint&);
 
         // Autosave:
@@ -78,7 +85,8 @@ namespace litecore { namespace repl {
 
     private:
         fleece::alloc_slice _encode() const;
-        void set(const C4SequenceNumber *local, const fleece::slice *remote);
+        void set(const C4SequenceNumber *local, const fleece::slice *remote,
+                 const SequenceSet::RangeList *completed =nullptr);
 
         mutable std::mutex _mutex;
 
@@ -29,7 +29,10 @@
 namespace litecore { namespace repl {
     class ReplicatedRev;
 
-    /** Thread-safe access to a C4Database. */
+    /** Thread-safe access to a C4Database.
+        (Reads don't use the DataFile's pool of read-only connections, since they go through the
+        C4 document API: a C4Document belongs to its C4Database, and may load revisions from it
+        long after the call that created it has returned a pooled reader.) */
     class DBAccess : public access_lock<C4Database*>, public Logging {
     public:
         using slice = fleece::slice;
@@ -56,6 +59,35 @@ namespace litecore { namespace repl {
             });
         }
 
+        /** Gets a document's metadata (current revID, flags, sequence) without its body. */
+        C4Document* getDocMeta(slice docID, C4Error *outError) const {
+            return use<C4Document*>([&](C4Database *db) {
+                return c4doc_getMeta(db, docID, outError);
+            });
+        }
+
+        /** Gets multiple documents by ID, in one batch. Missing documents are null.
+            If `metadataOnly` is true, the documents' bodies and rev trees aren't read (until
+            needed.) On error, returns an empty vector. */
+        std::vector<c4::ref<C4Document>> getDocs(const std::vector<slice> &docIDs,
+                                                 bool metadataOnly,
+                                                 C4Error *outError) const
+        {
+            std::vector<C4String> ids(docIDs.begin(), docIDs.end());
+            std::vector<C4Document*> docs(docIDs.size());
+            bool ok = use<bool>([&](C4Database *db) {
+                return c4db_getDocs(db, ids.data(), ids.size(), metadataOnly, docs.data(),
+                                    outError);
+            });
+            std::vector<c4::ref<C4Document>> result;
+            if (ok) {
+                result.reserve(docs.size());
+                for (auto doc : docs)
+                    result.emplace_back(doc);
+            }
+            return result;
+        }
+
         /** Gets a RawDocument. */
         C4RawDocument* getRawDoc(slice storeID, slice docID, C4Error *outError) const {
             return use<C4RawDocument*>([&](C4Database *db) {
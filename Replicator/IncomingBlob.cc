@@ -17,9 +17,12 @@
 //
 
 #include "IncomingBlob.hh"
+#include "IncomingRev.hh"
 #include "Replicator.hh"
+#include "ReplicatorTuning.hh"
 #include "StringUtil.hh"
 #include "MessageBuilder.hh"
+#include <algorithm>
 #include <atomic>
 
 using namespace fleece;
@@ -85,7 +88,11 @@ namespace litecore { namespace repl {
     void IncomingBlob::writeToBlob(alloc_slice data) {
         C4Error err;
 		if(_writer == nullptr) {
-            _writer = c4blob_openWriteStream(_blobStore, &err);
+            // Store compressible blobs compressed, just as they're requested compressed:
+            if (_blob.compressible)
+                _writer = c4blob_openCompressedWriteStream(_blobStore, &err);
+            else
+                _writer = c4blob_openWriteStream(_blobStore, &err);
             if (!_writer)
                 return gotError(err);
 #if DEBUG
@@ -158,4 +165,64 @@ namespace litecore { namespace repl {
             return kC4Idle;
     }
 
+
+
+#pragma mark - BLOB THROTTLE:
+
+
+    BlobThrottle::Reservation BlobThrottle::reserve(IncomingRev *rev, const PendingBlob &blob) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto i = _inFlight.find(keyString(blob.key));
+        if (i != _inFlight.end()) {
+            i->second.push_back(rev);
+            return kDuplicate;
+        }
+        if (_blobsInFlight > 0 && (_blobsInFlight >= tuning::kMaxBlobsInFlight
+                                   || _bytesInFlight + blob.length > tuning::kMaxBlobBytesInFlight)) {
+            if (std::find(_waiting.begin(), _waiting.end(), rev) == _waiting.end())
+                _waiting.push_back(rev);
+            return kWait;
+        }
+        ++_blobsInFlight;
+        _bytesInFlight += blob.length;
+        _inFlight[keyString(blob.key)];
+        return kStart;
+    }
+
+
+    void BlobThrottle::finished(const PendingBlob &blob, C4Error error) {
+        std::vector<Retained<IncomingRev>> duplicates;
+        std::deque<Retained<IncomingRev>> waiting;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto i = _inFlight.find(keyString(blob.key));
+            if (i == _inFlight.end())
+                return;
+            duplicates = move(i->second);
+            _inFlight.erase(i);
+            --_blobsInFlight;
+            _bytesInFlight -= blob.length;
+            swap(waiting, _waiting);
+        }
+        // Notify outside the lock, since the revs may call reserve() again:
+        for (auto &rev : duplicates)
+            rev->duplicateBlobFinished(error);
+        for (auto &rev : waiting)
+            rev->blobCapacityAvailable();
+    }
+
+
+    void BlobThrottle::clear() {
+        std::unordered_map<std::string, std::vector<Retained<IncomingRev>>> inFlight;
+        std::deque<Retained<IncomingRev>> waiting;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            swap(inFlight, _inFlight);
+            swap(waiting, _waiting);
+            _blobsInFlight = 0;
+            _bytesInFlight = 0;
+        }
+        // (The revs are released here, outside the lock.)
+    }
+
 } }
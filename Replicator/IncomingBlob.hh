@@ -20,8 +20,14 @@
 #include "Worker.hh"
 #include "ReplicatorTypes.hh"
 #include "c4.hh"
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace litecore { namespace repl {
+    class IncomingRev;
 
     /** Pulls a single blob. Invoked by IncomingRev. */
     class IncomingBlob : public Worker {
@@ -49,4 +55,42 @@ namespace litecore { namespace repl {
         bool _busy {false};
         actor::Timer::time _lastNotifyTime;
     };
+
+
+    /** Limits the number of blobs, and bytes, being downloaded at once by all of a Puller's
+        IncomingRevs, and makes sure the same blob isn't downloaded twice at the same time.
+        It's called directly by IncomingRevs on their own threads, so it's thread-safe.
+        A download is always allowed if none are in progress, so a single blob larger than
+        kMaxBlobBytesInFlight can still be pulled. */
+    class BlobThrottle {
+    public:
+        enum Reservation {
+            kStart,         // Go ahead and download the blob
+            kWait,          // Too busy; IncomingRev::blobCapacityAvailable() will be called later
+            kDuplicate,     // Already being downloaded; IncomingRev::duplicateBlobFinished()
+                            //      will be called when it's done
+        };
+
+        /** Asks permission for `rev` to download `blob`. */
+        Reservation reserve(IncomingRev *rev NONNULL, const PendingBlob &blob);
+
+        /** Must be called after a download allowed by `reserve` finishes or fails. */
+        void finished(const PendingBlob &blob, C4Error error);
+
+        /** Forgets all waiting and duplicate revs, without notifying them. Called by the Puller
+            when the connection closes, since the revs retain the Puller that owns this. */
+        void clear();
+
+    private:
+        static std::string keyString(const C4BlobKey &key) {
+            return std::string((const char*)key.bytes, sizeof(key.bytes));
+        }
+
+        std::mutex _mutex;
+        unsigned _blobsInFlight {0};
+        uint64_t _bytesInFlight {0};
+        std::unordered_map<std::string, std::vector<Retained<IncomingRev>>> _inFlight; // key->dups
+        std::deque<Retained<IncomingRev>> _waiting;     // Revs waiting for capacity
+    };
+
 } }
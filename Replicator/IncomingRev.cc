@@ -19,6 +19,7 @@
 #include "IncomingRev.hh"
 #include "IncomingBlob.hh"
 #include "Puller.hh"
+#include "ReplicatorTuning.hh"
 #include "StringUtil.hh"
 #include "c4Document+Fleece.h"
 #include "Instrumentation.hh"
@@ -50,7 +51,7 @@ namespace litecore { namespace repl {
         // (Re)initialize state (I can be used multiple times by the Puller):
         _parent = _puller;  // Necessary because Worker clears _parent when first completed
         _provisionallyInserted = false;
-        DebugAssert(_pendingCallbacks == 0 && !_currentBlob && _pendingBlobs.empty());
+        DebugAssert(_pendingCallbacks == 0 && _activeBlobs.empty() && _pendingBlobs.empty());
 
         // Set up to handle the current message:
         DebugAssert(!_revMessage);
@@ -195,50 +196,87 @@ namespace litecore { namespace repl {
             }
         }
 
-        // Request the first blob, or if there are none, finish:
-        if (!fetchNextBlob())
+        // Request the blobs, or if there are none, finish:
+        _fetchingBlobs = true;
+        if (!fetchBlobs()) {
+            _fetchingBlobs = false;
             insertRevision();
+        }
     }
 
 
-    bool IncomingRev::fetchNextBlob() {
+    // Starts downloading as many pending blobs as the limits allow. Returns false if there are
+    // no more blobs to wait for.
+    bool IncomingRev::fetchBlobs() {
         auto blobStore = _db->blobStore();
-        while (!_pendingBlobs.empty()) {
-            PendingBlob firstPending = _pendingBlobs.front();
-            _pendingBlobs.erase(_pendingBlobs.begin());
-            if (c4blob_getSize(blobStore, firstPending.key) < 0) {
-                if (!_currentBlob)
-                    _currentBlob = new IncomingBlob(this, blobStore);
-                _currentBlob->start(firstPending);
-                return true;
+        auto &throttle = _puller->blobThrottle();
+        while (!_pendingBlobs.empty() && _rev->error.code == 0
+                    && _activeBlobs.size() < tuning::kMaxBlobsInFlightPerRev) {
+            PendingBlob &next = _pendingBlobs.front();
+            if (c4blob_getSize(blobStore, next.key) < 0) {
+                auto reservation = throttle.reserve(this, next);
+                if (reservation == BlobThrottle::kWait) {
+                    break;          // blobCapacityAvailable() will be called later
+                } else if (reservation == BlobThrottle::kStart) {
+                    Retained<IncomingBlob> blob = new IncomingBlob(this, blobStore);
+                    blob->start(next);
+                    _activeBlobs.emplace_back(blob, next);
+                } else {
+                    ++_duplicateBlobs;
+                }
             }
+            _pendingBlobs.erase(_pendingBlobs.begin());
+        }
+        if (_rev->error.code != 0)
+            _pendingBlobs.clear();
+        return !_pendingBlobs.empty() || !_activeBlobs.empty() || _duplicateBlobs > 0;
+    }
+
+
+    void IncomingRev::continueFetchingBlobs() {
+        if (!_fetchingBlobs || fetchBlobs())
+            return;
+        // All blobs completed, now finish:
+        _fetchingBlobs = false;
+        if (_rev->error.code == 0) {
+            logVerbose("All blobs received, now inserting revision");
+            insertRevision();
+        } else {
+            finish();
         }
-        _currentBlob = nullptr;
-        return false;
     }
 
 
     void IncomingRev::_childChangedStatus(Worker *task, Status status) {
         addProgress(status.progressDelta);
         if (status.level == kC4Idle) {
-            if (status.error.code && !_rev->error.code)
-                _rev->error = status.error;
-            if (!fetchNextBlob()) {
-                // All blobs completed, now finish:
-                if (_rev->error.code == 0) {
-                    logVerbose("All blobs received, now inserting revision");
-                    insertRevision();
-                } else {
-                    finish();
+            for (auto i = _activeBlobs.begin(); i != _activeBlobs.end(); ++i) {
+                if (i->first == task) {
+                    if (status.error.code && !_rev->error.code)
+                        _rev->error = status.error;
+                    _puller->blobThrottle().finished(i->second, status.error);
+                    _activeBlobs.erase(i);
+                    continueFetchingBlobs();
+                    break;
                 }
             }
         }
     }
 
 
+    // Another IncomingRev finished downloading a blob I also need:
+    void IncomingRev::_duplicateBlobFinished(C4Error err) {
+        Assert(_duplicateBlobs > 0);
+        --_duplicateBlobs;
+        if (err.code && !_rev->error.code)
+            _rev->error = err;
+        continueFetchingBlobs();
+    }
+
+
     // Asks the DBAgent to insert the revision, then sends the reply and notifies the Puller.
     void IncomingRev::insertRevision() {
-        Assert(_pendingBlobs.empty() && !_currentBlob);
+        Assert(_pendingBlobs.empty() && _activeBlobs.empty() && _duplicateBlobs == 0);
         Assert(_rev->error.code == 0);
         Assert(_rev->deltaSrc || _rev->doc);
         increment(_pendingCallbacks);
@@ -276,8 +314,7 @@ namespace litecore { namespace repl {
             _rev->error = c4error_make(WebSocketDomain, 502, "Peer failed to send revision"_sl);
 
         // Free up memory now that I'm done:
-        Assert(_pendingCallbacks == 0 && !_currentBlob && _pendingBlobs.empty());
-        _currentBlob = nullptr;
+        Assert(_pendingCallbacks == 0 && _activeBlobs.empty() && _pendingBlobs.empty());
         _pendingBlobs.clear();
         _rev->trim();
 
@@ -286,7 +323,8 @@ namespace litecore { namespace repl {
 
 
     Worker::ActivityLevel IncomingRev::computeActivityLevel() const {
-        if (Worker::computeActivityLevel() == kC4Busy || _pendingCallbacks > 0 || _currentBlob) {
+        if (Worker::computeActivityLevel() == kC4Busy || _pendingCallbacks > 0
+                || !_activeBlobs.empty() || _duplicateBlobs > 0) {
             return kC4Busy;
         } else {
             return kC4Stopped;
@@ -21,6 +21,7 @@
 #include "ReplicatorTypes.hh"
 #include "function_ref.hh"
 #include <atomic>
+#include <utility>
 #include <vector>
 
 namespace litecore { namespace repl {
@@ -46,6 +47,10 @@ namespace litecore { namespace repl {
         void revisionProvisionallyInserted();
         void revisionInserted()                 {enqueue(&IncomingRev::_revisionInserted);}
 
+        // Called by the BlobThrottle:
+        void blobCapacityAvailable()            {enqueue(&IncomingRev::continueFetchingBlobs);}
+        void duplicateBlobFinished(C4Error err) {enqueue(&IncomingRev::_duplicateBlobFinished, err);}
+
     protected:
         ActivityLevel computeActivityLevel() const override;
 
@@ -54,7 +59,9 @@ namespace litecore { namespace repl {
         void _handleRev(Retained<blip::MessageIn>);
         void gotDeltaSrc(alloc_slice deltaSrcBody);
         void processBody(fleece::Doc, C4Error);
-        bool fetchNextBlob();
+        bool fetchBlobs();
+        void continueFetchingBlobs();
+        void _duplicateBlobFinished(C4Error);
         void insertRevision();
         void _revisionInserted();
         void finish();
@@ -66,7 +73,9 @@ namespace litecore { namespace repl {
         Retained<RevToInsert> _rev;
         unsigned _pendingCallbacks {0};
         std::vector<PendingBlob> _pendingBlobs;
-        Retained<IncomingBlob> _currentBlob;
+        std::vector<std::pair<Retained<IncomingBlob>, PendingBlob>> _activeBlobs;
+        unsigned _duplicateBlobs {0};       // # of blobs being downloaded by other revs
+        bool _fetchingBlobs {false};
         int _peerError {0};
         alloc_slice _remoteSequence;
         uint32_t _serialNumber {0};
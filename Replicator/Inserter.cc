@@ -39,23 +39,64 @@ namespace litecore { namespace repl {
 
     Inserter::Inserter(Replicator *repl)
     :Worker(repl, "Insert")
-    ,_revsToInsert(this, &Inserter::_insertRevisionsNow,
-                   tuning::kInsertionDelay, tuning::kInsertionBatchSize)
+    ,_tuner(repl->insertionTuner())
     { }
 
 
+    Inserter::~Inserter() {
+        if (_tuner.batchCount() > 0)
+            logInfo("Inserted %u batches; final batch size %zu, delay %.1fms",
+                    _tuner.batchCount(), _tuner.batchSize(), _tuner.delay().count() * 1000);
+    }
+
+
+    // Adds a rev to the queue. The first rev schedules an insertion after the tuner's delay;
+    // filling a batch schedules one immediately. (This is the same policy as ActorBatcher, but
+    // with the tuner's current settings instead of fixed ones.) The queue can already be over
+    // the batch size, if the tuner shrank it after the queue started filling.
     void Inserter::insertRevision(RevToInsert *rev) {
-        _revsToInsert.push(rev);
+        lock_guard<mutex> lock(_revsMutex);
+        if (!_revsToInsert) {
+            _revsToInsert.reset(new RevList);
+            _revsToInsert->reserve(_tuner.batchSize());
+        }
+        _revsToInsert->push_back(rev);
+        if (!_insertScheduled) {
+            _insertScheduled = true;
+            enqueueAfter(_tuner.delay(), &Inserter::_insertRevisionsNow, _insertGeneration);
+        } else if (!_insertNowScheduled && _revsToInsert->size() >= _tuner.batchSize()) {
+            _insertNowScheduled = true;
+            enqueue(&Inserter::_insertRevisionsNow, _insertGeneration);
+        }
+    }
+
+
+    // Takes all the queued revs, unless they've already been taken by a call with a later `gen`.
+    unique_ptr<Inserter::RevList> Inserter::popRevisions(int gen) {
+        lock_guard<mutex> lock(_revsMutex);
+        if (gen < _insertGeneration)
+            return nullptr;
+        _insertScheduled = _insertNowScheduled = false;
+        ++_insertGeneration;
+        return move(_revsToInsert);
+    }
+
+
+    // The number of revs waiting for the next batch.
+    size_t Inserter::queuedRevisionCount() {
+        lock_guard<mutex> lock(_revsMutex);
+        return _revsToInsert ? _revsToInsert->size() : 0;
     }
 
 
     // Insert all the revisions queued for insertion, and sync the ones queued for syncing.
     void Inserter::_insertRevisionsNow(int gen) {
-        auto revs = _revsToInsert.pop(gen);
+        auto revs = popRevisions(gen);
         if (!revs)
             return;
 
         logVerbose("Inserting %zu revs:", revs->size());
+        Signpost signpost(Signpost::insertRevisions, uintptr_t(this), revs->size());
         Stopwatch st;
         double commitTime = 0;
 
@@ -85,7 +126,7 @@ namespace litecore { namespace repl {
             Stopwatch stCommit;
             if (transaction.commit(&transactionErr))
                 transactionErr = {};
-            commitTime = st.elapsed();
+            commitTime = stCommit.elapsed();
         }
 
         if (transactionErr.code != 0)
@@ -105,6 +146,9 @@ namespace litecore { namespace repl {
             double t = st.elapsed();
             logInfo("Inserted %3zu revs in %6.2fms (%5.0f/sec) of which %4.1f%% was commit",
                     revs->size(), t*1000, revs->size()/t, commitTime/t*100);
+            _tuner.inserted(revs->size(), t, commitTime, queuedRevisionCount());
+            logVerbose("Next batch size %zu, delay %.1fms",
+                       _tuner.batchSize(), _tuner.delay().count() * 1000);
         }
     }
 
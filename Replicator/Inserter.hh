@@ -18,27 +18,43 @@
 
 #pragma once
 #include "Worker.hh"
-#include "Batcher.hh"
+#include "InsertionTuner.hh"
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace litecore { namespace repl {
     class Replicator;
     class RevToInsert;
 
-    /** Inserts revisions into the database in batches. */
+    /** Inserts revisions into the database in batches. The batch size and the delay before
+        inserting a partial batch are adjusted by an InsertionTuner. */
     class Inserter : public Worker {
     public:
         Inserter(Replicator*);
 
         void insertRevision(RevToInsert* NONNULL);
 
+    protected:
+        ~Inserter();
+
     private:
+        using RevList = std::vector<Retained<RevToInsert>>;
+
+        std::unique_ptr<RevList> popRevisions(int gen);
+        size_t queuedRevisionCount();
         void _insertRevisionsNow(int gen);
         bool insertRevisionNow(RevToInsert* NONNULL, C4Error*);
         C4SliceResult applyDeltaCallback(const C4Revision *baseRevision NONNULL,
                                          C4Slice deltaJSON,
                                          C4Error *outError);
 
-        actor::ActorBatcher<Inserter,RevToInsert> _revsToInsert; // Pending revs to be added to db
+        std::mutex _revsMutex;                      // Protects the following four members
+        std::unique_ptr<RevList> _revsToInsert;     // Pending revs to be added to db
+        bool _insertScheduled {false};              // Is an _insertRevisionsNow call queued?
+        bool _insertNowScheduled {false};           // Is one queued because the batch is full?
+        int _insertGeneration {0};                  // Incremented by each popRevisions call
+        InsertionTuner &_tuner;                     // Adapts batch size & delay (Replicator's)
     };
 
 } }
@@ -0,0 +1,85 @@
+//
+// InsertionTuner.hh
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#pragma once
+#include "ReplicatorTuning.hh"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace litecore { namespace repl {
+
+    /** Adapts the Inserter's batch size and delay to how fast the database is.
+        - If a transaction takes longer than kMaxInsertionTime, the batch size shrinks so the
+          next one fits in that time.
+        - If a full batch finishes in under half that time, the batch size grows by 50%, so that
+          more revisions share the cost of each commit.
+        - The delay tracks the (smoothed) commit time, so that on a slow disk more revisions
+          accumulate before each commit, while on a fast one they're inserted promptly.
+        - But if revisions pile up in the queue to half of kMaxPendingRevs, the Puller is about
+          to stop requesting more, so the delay drops to the minimum.
+        The settings are atomic so they can be read by any thread; `inserted` must only be
+        called by one thread at a time. */
+    class InsertionTuner {
+    public:
+        static_assert(tuning::kMaxInsertionBatchSize <= tuning::kMaxPendingRevs,
+                      "Insertion batches bigger than kMaxPendingRevs would never fill up");
+
+        using delay_t = std::chrono::duration<double>;
+
+        size_t batchSize() const                {return _batchSize;}
+        delay_t delay() const                   {return delay_t(_delay);}
+
+        /** Number of batches recorded so far. */
+        unsigned batchCount() const             {return _batchCount;}
+
+        /** Records that `count` revisions were inserted in `time` seconds, of which `commitTime`
+            seconds were spent committing the transaction, and adjusts the settings. `queued` is
+            the number of revisions that arrived meanwhile and are waiting for the next batch. */
+        void inserted(size_t count, double time, double commitTime, size_t queued) {
+            ++_batchCount;
+            if (_avgCommitTime == 0)
+                _avgCommitTime = commitTime;
+            else
+                _avgCommitTime = 0.75 * _avgCommitTime + 0.25 * commitTime;
+
+            size_t size = _batchSize;
+            if (time > tuning::kMaxInsertionTime) {
+                auto fits = size_t(count * tuning::kMaxInsertionTime / time);
+                size = std::min(size, std::max(fits, tuning::kMinInsertionBatchSize));
+            } else if (count >= size && time < tuning::kMaxInsertionTime / 2) {
+                size = std::min(size * 3 / 2, tuning::kMaxInsertionBatchSize);
+            }
+            _batchSize = size;
+
+            double minDelay = delay_t(tuning::kMinInsertionDelay).count();
+            double maxDelay = delay_t(tuning::kMaxInsertionDelay).count();
+            if (queued >= tuning::kMaxPendingRevs / 2)
+                _delay = minDelay;
+            else
+                _delay = std::min(std::max(_avgCommitTime, minDelay), maxDelay);
+        }
+
+    private:
+        std::atomic<size_t> _batchSize {tuning::kInsertionBatchSize};
+        std::atomic<double> _delay {delay_t(tuning::kInsertionDelay).count()};
+        std::atomic<unsigned> _batchCount {0};
+        double _avgCommitTime {0};                      // Moving average, in seconds
+    };
+
+} }
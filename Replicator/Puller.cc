@@ -359,6 +359,13 @@ namespace litecore { namespace repl {
     }
 
     
+    void Puller::_connectionClosed() {
+        Worker::_connectionClosed();
+        // Break the cycle of IncomingRevs waiting on the throttle, which retain me:
+        _blobThrottle.clear();
+    }
+
+
     Worker::ActivityLevel Puller::computeActivityLevel() const {
         ActivityLevel level;
         if (_unfinishedIncomingRevs > 0) {
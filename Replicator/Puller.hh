@@ -19,6 +19,7 @@
 #pragma once
 #include "ReplicatorTypes.hh"
 #include "Replicator.hh"
+#include "IncomingBlob.hh"
 #include "Actor.hh"
 #include "RemoteSequenceSet.hh"
 #include "Batcher.hh"
@@ -44,12 +45,14 @@ namespace litecore { namespace repl {
         // Called only by IncomingRev
         void revWasProvisionallyHandled()       {enqueue(&Puller::_revWasProvisionallyHandled);}
         void revWasHandled(IncomingRev *inc NONNULL);
+        BlobThrottle& blobThrottle()            {return _blobThrottle;}
 
         void insertRevision(RevToInsert *rev NONNULL);
 
     protected:
         bool nonPassive() const                 {return _options.pull > kC4Passive;}
         virtual void _childChangedStatus(Worker *task NONNULL, Status) override;
+        virtual void _connectionClosed() override;
         virtual ActivityLevel computeActivityLevel() const override;
         void activityLevelChanged(ActivityLevel level);
 
@@ -84,6 +87,7 @@ namespace litecore { namespace repl {
         actor::ActorBatcher<Puller,IncomingRev> _returningRevs;
         Retained<Inserter> _inserter;
         Retained<RevFinder> _revFinder;
+        BlobThrottle _blobThrottle;         // Limits concurrent blob downloads
         unsigned _pendingRevMessages {0};   // # of 'rev' msgs expected but not yet being processed
         unsigned _activeIncomingRevs {0};   // # of IncomingRev workers running
         unsigned _unfinishedIncomingRevs {0};
@@ -37,128 +37,32 @@ namespace litecore { namespace repl {
 #pragma mark - CHANGES:
 
 
-    // Gets the next batch of changes from the DB. Will respond by calling gotChanges.
-    void Pusher::getChanges(const GetChangesParams &p)
-    {
-        if (!connection())
-            return;
-        auto limit = p.limit;
-        logVerbose("Reading up to %u local changes since #%" PRIu64, limit, p.since);
-        _getForeignAncestors = p.getForeignAncestors;
-        _skipForeignChanges = p.skipForeign;
-        _pushDocIDs = p.docIDs;
-        if (_maxPushedSequence == 0)
-            _maxPushedSequence = p.since;
-
-        if (_getForeignAncestors)
-            _db->markRevsSyncedNow();   // make sure foreign ancestors are up to date
-
-        // Run a by-sequence enumerator to find the changed docs:
-        auto changes = make_shared<RevToSendList>();
-        C4Error error = {};
-        C4EnumeratorOptions options = kC4DefaultEnumeratorOptions;
-        if (!p.getForeignAncestors && !_options.pushFilter)
-            options.flags &= ~kC4IncludeBodies;
-        if (!p.skipDeleted)
-            options.flags |= kC4IncludeDeleted;
-
-        _db->use([&](C4Database* db) {
-            c4::ref<C4DocEnumerator> e = c4db_enumerateChanges(db, p.since, &options, &error);
-            if (e) {
-                changes->reserve(limit);
-                while (c4enum_next(e, &error) && limit > 0) {
-                    C4DocumentInfo info;
-                    c4enum_getDocumentInfo(e, &info);
-                    _maxPushedSequence = info.sequence;
-                    auto rev = retained(new RevToSend(info));
-                    if (shouldPushRev(rev, e, db)) {
-                        changes->push_back(rev);
-                        --limit;
-                    }
-                }
-            }
-
-            if (p.continuous && limit > 0 && !_changeObserver) {
-                // Reached the end of history; now start observing for future changes
-                _changeObserver = c4dbobs_create(db,
-                                                 [](C4DatabaseObserver* observer, void *context) {
-                                                     auto self = (Pusher*)context;
-                                                     self->enqueue(&Pusher::dbChanged);
-                                                 },
-                                                 this);
-                logDebug("Started DB observer");
-            }
-        });
-
-        gotChanges(move(changes), _maxPushedSequence, error);
+    // The parameters for reading the next batch of changes from the ChangesFeed.
+    ChangesFeed::Params Pusher::changesParams() const {
+        return {_lastSequenceRead,
+                _docIDs,
+                _changesBatchSize,
+                _continuous,
+                _proposeChanges || !_proposeChangesKnown,  // getForeignAncestors
+                _skipDeleted,                              // skipDeleted
+                _proposeChanges};                          // skipForeign
     }
 
 
-    // (Async) callback from the C4DatabaseObserver when the database has changed
-    void Pusher::dbChanged() {
-        if (!_changeObserver)
-            return; // if replication has stopped already by the time this async call occurs
-
-        if (_getForeignAncestors)
-            _db->markRevsSyncedNow();   // make sure foreign ancestors are up to date
-
-        static const uint32_t kMaxChanges = 100;
-        C4DatabaseChange c4changes[kMaxChanges];
-        bool external;
-        uint32_t nChanges;
-        shared_ptr<RevToSendList> changes;
-
-        while (true) {
-            nChanges = c4dbobs_getChanges(_changeObserver, c4changes, kMaxChanges, &external);
-            if (nChanges == 0)
-                break;        // no more changes
-            if (!external) {
-                logDebug("Notified of %u of my own db changes #%llu ... #%llu (ignoring)",
-                         nChanges, c4changes[0].sequence, c4changes[nChanges-1].sequence);
-                _maxPushedSequence = c4changes[nChanges-1].sequence;
-                continue;     // ignore changes I made myself
-            }
-            logVerbose("Notified of %u db changes #%" PRIu64 " ... #%" PRIu64,
-                       nChanges, c4changes[0].sequence, c4changes[nChanges-1].sequence);
-
-            // Copy the changes into a vector of RevToSend:
-            C4DatabaseChange *c4change = c4changes;
-            _db->use([&](C4Database *db) {
-                for (uint32_t i = 0; i < nChanges; ++i, ++c4change) {
-                    if (!changes) {
-                        changes = make_shared<RevToSendList>();
-                        changes->reserve(nChanges - i);
-                    }
-                    _maxPushedSequence = c4change->sequence;
-                    auto rev = retained(new RevToSend({0, c4change->docID, c4change->revID,
-                                                       c4change->sequence, c4change->bodySize}));
-                    // Note: we send tombstones even if the original getChanges() call specified
-                    // skipDeletions. This is intentional; skipDeletions applies only to the initial
-                    // dump of existing docs, not to 'live' changes.
-                    if (shouldPushRev(rev, nullptr, db)) {
-                        changes->push_back(rev);
-                        if (changes->size() >= kMaxChanges) {
-                            gotChanges(move(changes), _maxPushedSequence, {});
-                            changes.reset();
-                        }
-                    }
-                }
-            });
-
-            c4dbobs_releaseChanges(c4changes, nChanges);
+    // Removes changes to docs that already have a revision being pushed; they'll be processed
+    // later by doneWithRev().
+    void Pusher::removeActiveDocs(RevToSendList &changes) {
+        auto dst = changes.begin();
+        for (auto &rev : changes) {
+            if (beginPushingRev(rev))
+                *dst++ = move(rev);
         }
-
-        if (changes && changes->size() > 0)
-            gotChanges(move(changes), _maxPushedSequence, {});
+        changes.erase(dst, changes.end());
     }
 
 
-    // Common subroutine of _getChanges and dbChanged that adds a document to a list of Revs.
-    bool Pusher::shouldPushRev(RevToSend *rev, C4DocEnumerator *e, C4Database *db) {
-        if (_pushDocIDs != nullptr)
-            if (_pushDocIDs->find(slice(rev->docID).asString()) == _pushDocIDs->end())
-                return false;
-
+    // Registers a rev in _pushingDocs, or returns false if its doc is already being pushed.
+    bool Pusher::beginPushingRev(RevToSend *rev) {
         // _pushingDocs has an entry for each docID involved in the push process, from change
         // detection all the way to confirmation of the upload. The value of the entry is usually
         // null; if not, it holds a later revision of that document that should be processed
@@ -168,55 +72,17 @@ namespace litecore { namespace repl {
             // This doc already has a revision being sent; wait till that one is done
             logVerbose("Holding off on change '%.*s' %.*s till earlier rev is done",
                        SPLAT(rev->docID), SPLAT(rev->revID));
+            if (!passive()) {
+                // Keep the held rev's sequence pending, so it isn't checkpointed as pushed;
+                // any rev it replaces will never be pushed, so that one's no longer pending:
+                if (active->second)
+                    _pendingSequences.remove(active->second->sequence);
+                _pendingSequences.add(rev->sequence);
+            }
             active->second = rev;
             return false;
         }
 
-        if (rev->expiration > 0 && rev->expiration < c4_now()) {
-            logVerbose("'%.*s' is expired; not pushing it", SPLAT(rev->docID));
-            return false;
-        }
-
-        bool needRemoteRevID = _getForeignAncestors && !rev->remoteAncestorRevID &&_checkpointValid;
-        if (needRemoteRevID || _options.pushFilter) {
-            c4::ref<C4Document> doc;
-            C4Error error;
-            doc = e ? c4enum_getDocument(e, &error) : c4doc_get(db, rev->docID, true, &error);
-            if (!doc) {
-                finishedDocumentWithError(rev, error, false);
-                return false;   // reject rev: error getting doc
-            }
-            if (slice(doc->revID) != slice(rev->revID))
-                return false;   // ignore rev: there's a newer one already
-
-            if (needRemoteRevID) {
-                // For proposeChanges, find the nearest foreign ancestor of the current rev:
-                Assert(_db->remoteDBID());
-                alloc_slice foreignAncestor = _db->getDocRemoteAncestor(doc);
-                logDebug("remoteRevID of '%.*s' is %.*s", SPLAT(doc->docID), SPLAT(foreignAncestor));
-                if (_skipForeignChanges && foreignAncestor == slice(rev->revID))
-                    return false;   // skip this rev: it's already on the peer
-                if (foreignAncestor
-                        && c4rev_getGeneration(foreignAncestor) >= c4rev_getGeneration(rev->revID)) {
-                    if (_options.pull <= kC4Passive) {
-                        error = c4error_make(WebSocketDomain, 409,
-                                             "conflicts with newer server revision"_sl);
-                        finishedDocumentWithError(rev, error, false);
-                    }
-                    return false;    // ignore rev: there's a newer one on the server
-                }
-                rev->remoteAncestorRevID = foreignAncestor;
-            }
-
-            if (_options.pushFilter) {
-                if (!_options.pushFilter(doc->docID, doc->selectedRev.revID, doc->selectedRev.flags,
-                                         DBAccess::getDocRoot(doc), _options.callbackContext)) {
-                    logVerbose("Doc '%.*s' rejected by push filter", SPLAT(doc->docID));
-                    return false;
-                }
-            }
-        }
-
         _pushingDocs.insert({rev->docID, nullptr});
         return true;
     }
@@ -35,6 +35,7 @@ namespace litecore { namespace repl {
     :Worker(replicator, "Push")
     ,_continuous(_options.push == kC4Continuous)
     ,_skipDeleted(_options.skipDeleted())
+    ,_changesFeed(new ChangesFeed(replicator))
     {
         if (passive()) {
             // Passive replicator always sends "changes"
@@ -73,11 +74,16 @@ namespace litecore { namespace repl {
 
 
     // Begins active push, starting from the next sequence after sinceSequence
-    void Pusher::_start(C4SequenceNumber sinceSequence) {
+    void Pusher::_start(C4SequenceNumber sinceSequence, SequenceSet::RangeList completed) {
         logInfo("Starting %spush from local seq #%" PRIu64,
             (_continuous ? "continuous " : ""), sinceSequence+1);
         _started = true;
         _pendingSequences.clear(sinceSequence);
+        _alreadyPushed = move(completed);
+        _checkpointedRanges = _alreadyPushed;
+        if (!_alreadyPushed.empty())
+            logInfo("Skipping %zu ranges of sequences pushed previously, up to #%" PRIu64,
+                    _alreadyPushed.size(), _alreadyPushed.back().second);
         startSending(sinceSequence);
     }
 
@@ -128,13 +134,27 @@ namespace litecore { namespace repl {
             increment(_changeListsInFlight); // will be decremented at start of _gotChanges
             logVerbose("Asking DB for %u changes since sequence #%" PRIu64 " ...",
                 _changesBatchSize, _lastSequenceRead);
-            getChanges({_lastSequenceRead,
-                                   _docIDs,
-                                   _changesBatchSize,
-                                   _continuous,
-                                   _proposeChanges || !_proposeChangesKnown,  // getForeignAncestors
-                                   _skipDeleted,                              // skipDeleted
-                                   _proposeChanges});                         // skipForeign
+            auto params = changesParams();
+            _getForeignAncestors = params.getForeignAncestors;
+            if (_maxPushedSequence == 0)
+                _maxPushedSequence = params.since;
+
+            // Let the feed read the following batch ahead of time, if there's room for it:
+            bool prefetch = _changeListsInFlight < tuning::kMaxChangeListsInFlight
+                         && _revsToSend.size() + _changesBatchSize < tuning::kMaxRevsQueued;
+
+            _changesFeed->getChanges(params, prefetch,
+                                     asynchronize([=](shared_ptr<RevToSendList> changes,
+                                                      C4SequenceNumber lastSequence,
+                                                      bool caughtUp,
+                                                      C4Error err) {
+                // This is also called later with changes found by the feed's db observer
+                _maxPushedSequence = max(_maxPushedSequence, lastSequence);
+                if (!changes)
+                    return;     // Observer saw only changes that won't be pushed
+                removeActiveDocs(*changes);
+                gotChanges(move(changes), lastSequence, caughtUp, err);
+            }));
             // response will be to call _gotChanges
         }
     }
@@ -143,6 +163,7 @@ namespace litecore { namespace repl {
     // Received a list of changes from the database [initiated in maybeGetMoreChanges]
     void Pusher::gotChanges(std::shared_ptr<RevToSendList> changes,
                              C4SequenceNumber lastSequence,
+                             bool caughtUp,
                              C4Error err)
     {
         if (_gettingChanges) {
@@ -154,7 +175,9 @@ namespace litecore { namespace repl {
             return;
         if (err.code)
             return gotError(err);
-        
+
+        if (!_alreadyPushed.empty())
+            skipAlreadyPushed(*changes, lastSequence);
         _lastSequenceRead = lastSequence;
         _pendingSequences.seen(lastSequence);
         if (changes->empty()) {
@@ -184,7 +207,7 @@ namespace litecore { namespace repl {
         auto changeCount = changes->size();
         sendChanges(move(changes));
 
-        if (changeCount < _changesBatchSize) {
+        if (caughtUp) {
             if (!_caughtUp) {
                 logInfo("Caught up, at lastSequence #%" PRIu64, _lastSequenceRead);
                 _caughtUp = true;
@@ -608,10 +631,11 @@ namespace litecore { namespace repl {
                 // Don't send; it'll conflict with what's on the server
             } else {
                 // Send newRev as though it had just arrived:
-                bool should = _db->use<bool>([&](C4Database *db) {
-                    return shouldPushRev(newRev, nullptr, db);
-                });
-                if (should) {
+                C4Error error = {};
+                bool should = _changesFeed->shouldPushRev(newRev, changesParams(), &error);
+                if (error.code)
+                    finishedDocumentWithError(newRev, error, false);
+                if (should && beginPushingRev(newRev)) {
                     _maxPushedSequence = max(_maxPushedSequence, rev->sequence);
                     gotOutOfOrderChange(newRev);
                     ok = true;
@@ -620,6 +644,10 @@ namespace litecore { namespace repl {
             if (!ok) {
                 logVerbose("   ... nope, decided not to propose '%.*s' %.*s",
                            SPLAT(newRev->docID), SPLAT(newRev->revID));
+                if (!passive()) {
+                    _pendingSequences.remove(newRev->sequence);
+                    updateCheckpoint();
+                }
             }
         } else {
             logDebug("Done pushing '%.*s' %.*s", SPLAT(rev->docID), SPLAT(rev->revID));
@@ -630,17 +658,68 @@ namespace litecore { namespace repl {
     void Pusher::updateCheckpoint() {
         auto firstPending = _pendingSequences.first();
         auto lastSeq = firstPending ? firstPending - 1 : _pendingSequences.maxEver();
-        if (lastSeq > _lastSequence) {
+
+        // Optionally also checkpoint the sequences after that which have been pushed, plus any
+        // ranges from the previous checkpoint that haven't been read yet:
+        SequenceSet::RangeList completed;
+        if (_options.checkpointRanges()) {
+            completed = _pendingSequences.removedRanges(tuning::kMaxCheckpointRanges);
+            auto maxSeq = _pendingSequences.maxEver();
+            for (auto &range : _alreadyPushed) {
+                if (completed.size() >= tuning::kMaxCheckpointRanges)
+                    break;
+                if (range.second <= maxSeq)
+                    continue;
+                auto first = max(range.first, maxSeq + 1);
+                if (!completed.empty() && completed.back().second + 1 == first)
+                    completed.back().second = range.second;
+                else if (first > lastSeq + 1)
+                    completed.emplace_back(first, range.second);
+                else
+                    lastSeq = range.second;
+            }
+        }
+
+        if (lastSeq > _lastSequence || completed != _checkpointedRanges) {
             if (lastSeq / 1000 > _lastSequence / 1000)
                 logInfo("Checkpoint now at #%" PRIu64, lastSeq);
             else
-                logVerbose("Checkpoint now at #%" PRIu64, lastSeq);
-            _lastSequence = lastSeq;
+                logVerbose("Checkpoint now at #%" PRIu64 " (+%zu pushed ranges)",
+                           lastSeq, completed.size());
+            _lastSequence = max(_lastSequence, lastSeq);
+            _checkpointedRanges = move(completed);
             if (replicator())
-                replicator()->updatePushCheckpoint(_lastSequence);
+                replicator()->updatePushCheckpoint(_lastSequence, _checkpointedRanges);
         }
     }
 
+
+    // Removes changes that the checkpoint says were already pushed, and forgets about ranges
+    // that have been read past.
+    void Pusher::skipAlreadyPushed(RevToSendList &changes, C4SequenceNumber lastSequence) {
+        auto &ranges = _alreadyPushed;
+        auto dst = remove_if(changes.begin(), changes.end(), [&](const Retained<RevToSend> &rev) {
+            auto r = upper_bound(ranges.begin(), ranges.end(), rev->sequence,
+                                 [](C4SequenceNumber seq, const pair<uint64_t,uint64_t> &range) {
+                                     return seq < range.first;
+                                 });
+            return r != ranges.begin() && prev(r)->second >= rev->sequence;
+        });
+        if (dst != changes.end()) {
+            logVerbose("Skipping %zd changes already pushed", changes.end() - dst);
+            changes.erase(dst, changes.end());
+        }
+        while (!ranges.empty() && ranges.front().second <= lastSequence)
+            ranges.erase(ranges.begin());
+    }
+
+
+    void Pusher::_connectionClosed() {
+        Worker::_connectionClosed();
+        _changesFeed->connectionClosed();
+    }
+
+
     void Pusher::afterEvent() {
         Worker::afterEvent();
 
@@ -652,7 +731,8 @@ namespace litecore { namespace repl {
                 _pushingDocs[revToRetry->docID] = revToRetry;
             }
             
-            gotChanges(make_shared<RevToSendList>(revsToRetry), _maxPushedSequence, {});
+            gotChanges(make_shared<RevToSendList>(revsToRetry), _maxPushedSequence,
+                       revsToRetry.size() < _changesBatchSize, {});
         }
     }
 
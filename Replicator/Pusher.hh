@@ -20,6 +20,7 @@
 #include "Replicator.hh"
 #include "ReplicatorTuning.hh"
 #include "ReplicatorTypes.hh"
+#include "ChangesFeed.hh"
 #include "Actor.hh"
 #include "SequenceSet.hh"
 #include "fleece/slice.hh"
@@ -36,11 +37,13 @@ namespace litecore { namespace repl {
     public:
         Pusher(Replicator *replicator NONNULL);
 
-        // Starts an active push
-        void start(C4SequenceNumber sinceSequence)  {enqueue(&Pusher::_start, sinceSequence);}
+        // Starts an active push, skipping sequences in the `completed` ranges
+        void start(C4SequenceNumber sinceSequence, const SequenceSet::RangeList &completed = {}) {
+            enqueue(&Pusher::_start, sinceSequence, completed);
+        }
 
         void checkpointIsInvalid() {
-            _checkpointValid = false;
+            _changesFeed->checkpointIsInvalid();
         }
 
         // Checks if a given sequence number is pending to be pushed
@@ -50,14 +53,16 @@ namespace litecore { namespace repl {
         
     protected:
         virtual void afterEvent() override;
+        virtual void _connectionClosed() override;
 
     private:
-        void _start(C4SequenceNumber sinceSequence);
+        void _start(C4SequenceNumber sinceSequence, SequenceSet::RangeList completed);
         bool passive() const                         {return _options.push <= kC4Passive;}
         virtual ActivityLevel computeActivityLevel() const override;
         void startSending(C4SequenceNumber sinceSequence);
         void handleSubChanges(Retained<blip::MessageIn> req);
-        void gotChanges(std::shared_ptr<RevToSendList> changes, C4SequenceNumber lastSequence, C4Error err);
+        void gotChanges(std::shared_ptr<RevToSendList> changes, C4SequenceNumber lastSequence,
+                        bool caughtUp, C4Error err);
         void gotOutOfOrderChange(RevToSend* NONNULL);
         void sendChanges(std::shared_ptr<RevToSendList>);
         void maybeGetMoreChanges();
@@ -67,6 +72,7 @@ namespace litecore { namespace repl {
         void couldntSendRevision(RevToSend* NONNULL);
         void doneWithRev(RevToSend*, bool successful, bool pushed);
         void updateCheckpoint();
+        void skipAlreadyPushed(RevToSendList&, C4SequenceNumber lastSequence);
         void handleGetAttachment(Retained<MessageIn>);
         void handleProveAttachment(Retained<MessageIn>);
         void _attachmentSent();
@@ -76,18 +82,11 @@ namespace litecore { namespace repl {
                                           C4Error *outError);
         void filterByDocIDs(fleece::Array docIDs);
 
-        using DocIDSet = std::shared_ptr<std::unordered_set<std::string>>;
+        using DocIDSet = ChangesFeed::DocIDSet;
 
-        struct GetChangesParams {
-            C4SequenceNumber since;
-            DocIDSet docIDs;
-            unsigned limit;
-            bool continuous, getForeignAncestors;
-            bool skipDeleted, skipForeign;
-        };
-        void getChanges(const GetChangesParams&);
-        void dbChanged();
-        bool shouldPushRev(RevToSend* NONNULL, C4DocEnumerator*, C4Database* NONNULL);
+        ChangesFeed::Params changesParams() const;
+        void removeActiveDocs(RevToSendList&);
+        bool beginPushingRev(RevToSend* NONNULL);
         void sendRevision(RevToSend *request NONNULL,
                           blip::MessageProgressCallback onProgress);
         alloc_slice createRevisionDelta(C4Document *doc NONNULL, RevToSend *request NONNULL,
@@ -104,11 +103,13 @@ namespace litecore { namespace repl {
         bool _skipDeleted;
         bool _proposeChanges;
         bool _proposeChangesKnown;
-        std::atomic<bool> _checkpointValid {true};
+        Retained<ChangesFeed> _changesFeed;       // Reads changes from the db in the background
 
         C4SequenceNumber _lastSequence {0};       // Checkpointed last-sequence
         bool _gettingChanges {false};             // Waiting for _gotChanges() call?
         SequenceSet _pendingSequences;            // Sequences rcvd from db but not pushed yet
+        SequenceSet::RangeList _alreadyPushed;    // Ranges pushed before, per the checkpoint
+        SequenceSet::RangeList _checkpointedRanges; // Pushed ranges last saved in the checkpoint
         C4SequenceNumber _lastSequenceRead {0};   // Last sequence read from db
         bool _started {false};
         bool _caughtUp {false};                   // Received backlog of existing changes?
@@ -123,12 +124,9 @@ namespace litecore { namespace repl {
         using DocIDToRevMap = std::unordered_map<alloc_slice, Retained<RevToSend>, fleece::sliceHash>;
 
         C4BlobStore* _blobStore;
-        c4::ref<C4DatabaseObserver> _changeObserver;        // Used in continuous push mode
-        DocIDSet _pushDocIDs;                               // Optional set of doc IDs to push
         C4SequenceNumber _maxPushedSequence {0};            // Latest seq that's been pushed
         DocIDToRevMap _pushingDocs;                         // Revs being processed by push
         bool _getForeignAncestors {false};
-        bool _skipForeignChanges {false};
     };
     
     
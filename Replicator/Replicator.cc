@@ -184,7 +184,7 @@ namespace litecore { namespace repl {
     void Replicator::startReplicating() {
         auto cp = _checkpoint.sequences();
         if (_options.push > kC4Passive)
-            _pusher->start(cp.local);
+            _pusher->start(cp.local, cp.localCompleted);
         if (_options.pull > kC4Passive)
             _puller->start(cp.remote);
     }
@@ -457,8 +457,8 @@ namespace litecore { namespace repl {
         } else if (cp.data) {
             _checkpoint.decodeFrom(cp.data);
             auto seq = _checkpoint.sequences();
-            logInfo("Local checkpoint '%.*s' is [%" PRIu64 ", '%.*s']; getting remote ...",
-                SPLAT(cp.checkpointID), seq.local, SPLAT(seq.remote));
+            logInfo("Local checkpoint '%.*s' is [%" PRIu64 ", '%.*s'] (+%zu pushed ranges); getting remote ...",
+                SPLAT(cp.checkpointID), seq.local, SPLAT(seq.remote), seq.localCompleted.size());
             _hadLocalCheckpoint = true;
         } else if (cp.err.code == 0) {
             logInfo("No local checkpoint '%.*s'", SPLAT(cp.checkpointID));
@@ -673,6 +673,23 @@ namespace litecore { namespace repl {
     }
 
 
+    alloc_slice Replicator::statistics() const {
+        Encoder enc;
+        enc.beginDict();
+        enc.writeKey("insertion"_sl);
+        enc.beginDict();
+        enc.writeKey("batches"_sl);
+        enc.writeUInt(_insertionTuner.batchCount());
+        enc.writeKey("batchSize"_sl);
+        enc.writeUInt(_insertionTuner.batchSize());
+        enc.writeKey("delay"_sl);
+        enc.writeDouble(_insertionTuner.delay().count());
+        enc.endDict();
+        enc.endDict();
+        return enc.finish();
+    }
+
+
     bool Replicator::isDocumentPending(slice docId, C4Error* outErr) {
         if(_options.push < kC4OneShot) {
             // Couchbase Lite should not allow this case
@@ -22,6 +22,7 @@
 #include "Checkpoint.hh"
 #include "BLIPConnection.hh"
 #include "Batcher.hh"
+#include "InsertionTuner.hh"
 #include "fleece/Fleece.hh"
 #include "Stopwatch.hh"
 #include <unordered_set>
@@ -94,12 +95,20 @@ namespace litecore { namespace repl {
         /** Checks if the document with the given ID has any pending revisions to push*/
         bool isDocumentPending(slice docId, C4Error* outErr);
 
+        /** Returns a Fleece-encoded dict of performance statistics. Can be called on any thread. */
+        alloc_slice statistics() const;
+
+        // internal API for Inserter:
+        InsertionTuner& insertionTuner()        {return _insertionTuner;}
+
         // exposed for unit tests:
         websocket::WebSocket* webSocket() const {return connection()->webSocket();}
         alloc_slice checkpointID() const        {return _checkpointDocID;}
 
         // internal API for Pusher/Puller:
-        void updatePushCheckpoint(C4SequenceNumber s)   {_checkpoint.setLocalSeq(s);}
+        void updatePushCheckpoint(C4SequenceNumber s, const SequenceSet::RangeList &completed = {}) {
+            _checkpoint.setLocalSeq(s, completed);
+        }
         void updatePullCheckpoint(const alloc_slice &s) {_checkpoint.setRemoteSeq(s);}
 
         void endedDocument(ReplicatedRev *d NONNULL);
@@ -182,6 +191,7 @@ namespace litecore { namespace repl {
         Delegate* _delegate;
         Retained<Pusher> _pusher;
         Retained<Puller> _puller;
+        InsertionTuner _insertionTuner;     // Batch size & delay of the Puller's Inserter
         Connection::State _connectionState;
         Status _pushStatus {}, _pullStatus {};
         fleece::Stopwatch _sinceDelegateCall;
@@ -64,6 +64,10 @@ namespace litecore { namespace repl {
             return std::chrono::seconds(secs);
         }
 
+        /** If true, push checkpoints also record which sequences after the first unpushed one
+            have already been pushed, so a resumed push can skip them. */
+        bool checkpointRanges() const {return properties[kC4ReplicatorCheckpointRanges].asBool();}
+
         fleece::Array channels() const {return arrayProperty(kC4ReplicatorOptionChannels);}
         fleece::Array docIDs() const   {return arrayProperty(kC4ReplicatorOptionDocIDs);}
         fleece::Dict headers() const  {return dictProperty(kC4ReplicatorOptionExtraHeaders);}
@@ -40,6 +40,19 @@ namespace litecore { namespace repl {
            if the queue size hasn't reached kInsertionBatchSize yet. */
         constexpr actor::Timer::duration kInsertionDelay = std::chrono::milliseconds(20);
 
+        /* The two values above are only starting points; the Inserter adapts them to the
+           observed insertion speed (see InsertionTuner.) These are the bounds it stays within.
+           The maximum batch size is no more than kMaxPendingRevs (below), since the Puller stops
+           asking for revs once that many are pending; a bigger batch would never fill up. */
+        constexpr size_t kMinInsertionBatchSize = 20;
+        constexpr size_t kMaxInsertionBatchSize = 200;
+        constexpr actor::Timer::duration kMinInsertionDelay = std::chrono::milliseconds(2);
+        constexpr actor::Timer::duration kMaxInsertionDelay = std::chrono::milliseconds(100);
+
+        /* Desired maximum duration of an insertion transaction, in seconds. Longer transactions
+           block other writers and delay notifying IncomingRevs, so the batch size shrinks. */
+        constexpr double kMaxInsertionTime = 0.1;
+
         /* Minimum document body size that will be considered for delta compression.
             (This is the size of the Fleece encoding, which is usually smaller than the JSON.)
            This is not declared `constexpr`, so that the delta-sync unit tests can change it. */
@@ -64,6 +77,14 @@ namespace litecore { namespace repl {
 
         constexpr unsigned kMaxUnfinishedIncomingRevs = 200;
 
+        /* Max # of blobs a single IncomingRev will download at once. */
+        constexpr unsigned kMaxBlobsInFlightPerRev = 4;
+
+        /* Max # of blobs, and their total size in bytes, that all IncomingRevs will download at
+            once. (A blob is always downloaded if no others are, even if it's larger.) */
+        constexpr unsigned kMaxBlobsInFlight = 20;
+        constexpr uint64_t kMaxBlobBytesInFlight = 4*1024*1024;
+
 
         //// Pusher:
 
@@ -86,6 +107,10 @@ namespace litecore { namespace repl {
             yet. This is limited to avoid flooding the peer with too much JSON data. */
         constexpr unsigned kMaxRevBytesAwaitingReply = 2*1024*1024;
 
+        /* Max number of ranges of already-pushed sequences to save in a checkpoint, if the
+            `checkpointRanges` option is enabled. Only the lowest ranges are saved. */
+        constexpr size_t kMaxCheckpointRanges = 100;
+
         //// Replicator:
 
         /* How long to wait between delegate calls notifying that that docs have finished. */
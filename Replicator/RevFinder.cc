@@ -73,6 +73,19 @@ namespace litecore { namespace repl {
             response["deltas"_sl] = "true"_sl;
             _announcedDeltaSupport = true;
         }
+        // Read all the docs at once, rather than one query per change. Proposed changes only
+        // need each doc's current revID and flags, so don't read their bodies:
+        vector<slice> docIDs;
+        docIDs.reserve(changes.count());
+        for (auto item : changes)
+            docIDs.push_back(item.asArray()[proposed ? 0 : 1].asString());
+        C4Error batchErr;
+        auto docs = _db->getDocs(docIDs, proposed, &batchErr);
+        bool prefetched = (docs.size() == docIDs.size());
+        if (!prefetched)
+            warn("Couldn't read docs in a batch (%d/%d); reading them individually",
+                 batchErr.domain, batchErr.code);
+
         vector<bool> whichRequested(changes.count());
         unsigned itemsWritten = 0, requested = 0;
         vector<alloc_slice> ancestors;
@@ -92,13 +105,22 @@ namespace litecore { namespace repl {
                 continue;     // ???  Should this abort the replication?
             }
 
+            C4Error err = {LiteCoreDomain, kC4ErrorNotFound};
+            c4::ref<C4Document> doc;
+            if (prefetched)
+                doc = move(docs[i]);
+            else if (proposed)
+                doc = _db->getDocMeta(docID, &err);
+            else
+                doc = _db->getDoc(docID, &err);
+
             if (proposed) {
                 // Proposed change (peer is LiteCore)
                 slice parentRevID = change[2].asString();
                 if (parentRevID.size == 0)
                     parentRevID = nullslice;
                 alloc_slice currentRevID;
-                int status = findProposedChange(docID, revID, parentRevID, currentRevID);
+                int status = findProposedChange(doc, err, revID, parentRevID, currentRevID);
                 if (status == 0) {
                     // Accept rev by (lazily) appending a 0:
                     logDebug("    - Accepting proposed change '%.*s' #%.*s with parent %.*s",
@@ -117,7 +139,7 @@ namespace litecore { namespace repl {
             } else {
                 // Non-proposed change (peer is SG):
                 ancestors.clear();
-                if (incomingDocs->contains(docID) || !findAncestors(docID, revID, ancestors)) {
+                if (incomingDocs->contains(docID) || !findAncestors(doc, err, revID, ancestors)) {
                     // I don't have this revision, so request it:
                     ++requested;
                     whichRequested[i] = true;
@@ -144,13 +166,12 @@ namespace litecore { namespace repl {
 
 
     // Checks whether the revID (if any) is really current for the given doc.
+    // `doc` is null if it couldn't be read, in which case `err` is the error.
     // Returns an HTTP-ish status code: 0=OK, 409=conflict, 500=internal error
-    int RevFinder::findProposedChange(slice docID, slice revID, slice parentRevID,
-                                     alloc_slice &outCurrentRevID)
+    int RevFinder::findProposedChange(C4Document *doc, const C4Error &err,
+                                      slice revID, slice parentRevID,
+                                      alloc_slice &outCurrentRevID)
     {
-        C4Error err;
-        //OPT: We don't need the document body, just its metadata, but there's no way to say that
-        c4::ref<C4Document> doc = _db->getDoc(docID, &err);
         if (!doc) {
             if (isNotFoundError(err)) {
                 // Doc doesn't exist; it's a conflict if the peer thinks it does:
@@ -181,10 +202,12 @@ namespace litecore { namespace repl {
 
 
     // Returns true if revision exists; else returns false and sets ancestors to an array of
-    // ancestor revisions I do have (empty if doc doesn't exist at all)
-    bool RevFinder::findAncestors(slice docID, slice revID, vector<alloc_slice> &ancestors) {
-        C4Error err;
-        c4::ref<C4Document> doc = _db->getDoc(docID, &err);
+    // ancestor revisions I do have (empty if doc doesn't exist at all.)
+    // `doc` is null if it couldn't be read, in which case `err` is the error.
+    bool RevFinder::findAncestors(C4Document *doc, const C4Error &err,
+                                  slice revID, vector<alloc_slice> &ancestors)
+    {
+        C4Error selectErr;
         if (!doc) {
             ancestors.resize(0);
             if (!isNotFoundError(err))
@@ -194,7 +217,7 @@ namespace litecore { namespace repl {
 
         alloc_slice remoteRevID = _db->getDocRemoteAncestor(doc);
 
-        if (c4doc_selectRevision(doc, revID, false, &err)) {
+        if (c4doc_selectRevision(doc, revID, false, &selectErr)) {
             // I already have this revision. Make sure it's marked as current for this remote:
             if (remoteRevID != revID && _db->remoteDBID())
                 updateRemoteRev(doc);
@@ -208,7 +231,7 @@ namespace litecore { namespace repl {
         };
 
         // Revision isn't found, but look for ancestors. Start with the common ancestor:
-        if (c4doc_selectRevision(doc, remoteRevID, true, &err))
+        if (c4doc_selectRevision(doc, remoteRevID, true, &selectErr))
             addAncestor();
 
         if (c4doc_selectFirstPossibleAncestorOf(doc, revID)) {
@@ -44,9 +44,9 @@ namespace litecore { namespace repl {
         void _findOrRequestRevs(Retained<blip::MessageIn>,
                                 DocIDMultiset *incomingDocs,
                                 std::function<void(std::vector<bool>)> completion);
-        bool findAncestors(slice docID, slice revID,
+        bool findAncestors(C4Document*, const C4Error&, slice revID,
                            std::vector<alloc_slice> &ancestors);
-        int findProposedChange(slice docID, slice revID, slice parentRevID,
+        int findProposedChange(C4Document*, const C4Error&, slice revID, slice parentRevID,
                                alloc_slice &outCurrentRevID);
         void updateRemoteRev(C4Document*);
 
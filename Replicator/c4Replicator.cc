@@ -249,6 +249,14 @@ C4SliceResult c4repl_getPendingDocIDs(C4Replicator* repl, C4Error* outErr) C4API
     return {nullptr, 0};
 }
 
+C4SliceResult c4repl_getStatistics(C4Replicator* repl, C4Error* outErr) C4API {
+    try {
+        return repl->statistics();
+    } catchError(outErr);
+
+    return {nullptr, 0};
+}
+
 bool c4repl_isDocumentPending(C4Replicator* repl, C4Slice docID, C4Error* outErr) C4API {
     try {
         return repl->isDocumentPending(docID, outErr);
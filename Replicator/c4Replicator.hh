@@ -157,6 +157,10 @@ struct C4Replicator : public RefCounted, Replicator::Delegate {
         return (C4SliceResult)_replicator->pendingDocumentIDs(outErr);
     }
 
+    C4SliceResult statistics() {
+        return (C4SliceResult)_replicator->statistics();
+    }
+
     bool isDocumentPending(C4Slice docID, C4Error* outErr) {
         lock_guard<mutex> lock(_mutex);
         return _replicator->isDocumentPending(docID, outErr);
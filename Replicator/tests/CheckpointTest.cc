@@ -0,0 +1,86 @@
+//
+// CheckpointTest.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "Checkpoint.hh"
+#include "LiteCoreTest.hh"
+
+using namespace litecore;
+using namespace litecore::repl;
+using namespace fleece;
+using namespace std;
+
+using RangeList = SequenceSet::RangeList;
+
+
+TEST_CASE("Checkpoint encoding", "[Push]") {
+    Checkpoint cp;
+    cp.setLocalSeq(100);
+    cp.setRemoteSeq("\"123\""_sl);
+    CHECK(cp.encode() == "{\"local\":100,\"remote\":\"123\"}"_sl);
+
+    cp.setLocalSeq(100, {{105, 110}, {200, 200}});
+    alloc_slice json = cp.encode();
+    CHECK(json == "{\"local\":100,\"localCompleted\":[[105,110],[200,200]],\"remote\":\"123\"}"_sl);
+
+    Checkpoint cp2;
+    cp2.decodeFrom(json);
+    auto seq = cp2.sequences();
+    CHECK(seq.local == 100);
+    CHECK(seq.remote == "\"123\""_sl);
+    CHECK(seq.localCompleted == (RangeList{{105, 110}, {200, 200}}));
+
+    // Setting the local sequence alone clears the ranges:
+    cp2.setLocalSeq(300);
+    CHECK(cp2.sequences().localCompleted.empty());
+}
+
+
+TEST_CASE("Checkpoint invalid ranges", "[Push]") {
+    Checkpoint cp;
+    cp.decodeFrom("{\"local\":100,\"localCompleted\":[[50,60]]}"_sl);
+    CHECK(cp.sequences().local == 100);
+    CHECK(cp.sequences().localCompleted.empty());
+
+    cp.decodeFrom("{\"local\":100,\"localCompleted\":[[150,160],[110,120]]}"_sl);
+    CHECK(cp.sequences().localCompleted.empty());
+
+    cp.decodeFrom("{\"local\":100,\"localCompleted\":[[150]]}"_sl);
+    CHECK(cp.sequences().localCompleted.empty());
+}
+
+
+TEST_CASE("Checkpoint validate ranges", "[Push]") {
+    Checkpoint local, remote;
+    local.setLocalSeq(100, {{105, 110}});
+    remote.setLocalSeq(100, {{105, 110}});
+    CHECK(local.validateWith(remote));
+    CHECK(local.sequences().localCompleted == (RangeList{{105, 110}}));
+
+    // Differing ranges are dropped, but the local sequence is still valid:
+    remote.setLocalSeq(100, {{105, 120}});
+    CHECK(local.validateWith(remote));
+    CHECK(local.sequences().local == 100);
+    CHECK(local.sequences().localCompleted.empty());
+
+    // Differing local sequences invalidate everything:
+    local.setLocalSeq(100, {{105, 110}});
+    remote.setLocalSeq(90, {{105, 110}});
+    CHECK(!local.validateWith(remote));
+    CHECK(local.sequences().local == 0);
+    CHECK(local.sequences().localCompleted.empty());
+}
@@ -0,0 +1,84 @@
+//
+// InsertionTunerTest.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "InsertionTuner.hh"
+#include "LiteCoreTest.hh"
+
+using namespace litecore::repl;
+using namespace std;
+
+
+static double ms(InsertionTuner::delay_t d) {
+    return d.count() * 1000;
+}
+
+
+TEST_CASE("InsertionTuner defaults", "[Push]") {
+    InsertionTuner tuner;
+    CHECK(tuner.batchSize() == tuning::kInsertionBatchSize);
+    CHECK(tuner.delay() == InsertionTuner::delay_t(tuning::kInsertionDelay));
+    CHECK(tuner.batchCount() == 0);
+}
+
+
+TEST_CASE("InsertionTuner fast disk", "[Push]") {
+    InsertionTuner tuner;
+    // Full batches that take 5ms, 1ms of which is the commit:
+    for (int i = 0; i < 20; ++i)
+        tuner.inserted(tuner.batchSize(), 0.005, 0.001, 0);
+    CHECK(tuner.batchCount() == 20);
+    CHECK(tuner.batchSize() == tuning::kMaxInsertionBatchSize);
+    // Commits take 1ms, which is below the minimum delay:
+    CHECK(tuner.delay() == InsertionTuner::delay_t(tuning::kMinInsertionDelay));
+
+    // A partial batch doesn't grow it further, or shrink it:
+    tuner.inserted(10, 0.001, 0.0005, 0);
+    CHECK(tuner.batchSize() == tuning::kMaxInsertionBatchSize);
+}
+
+
+TEST_CASE("InsertionTuner slow disk", "[Push]") {
+    InsertionTuner tuner;
+    // A batch of 60 that takes 200ms, mostly commit:
+    tuner.inserted(60, 0.2, 0.15, 0);
+    CHECK(tuner.batchSize() == 30);         // 60 * 0.1 / 0.2
+    CHECK(ms(tuner.delay()) == ms(tuning::kMaxInsertionDelay));
+
+    // Even slower; the size bottoms out at the minimum:
+    for (int i = 0; i < 10; ++i)
+        tuner.inserted(tuner.batchSize(), 2.0, 1.5, 0);
+    CHECK(tuner.batchSize() == tuning::kMinInsertionBatchSize);
+
+    // Disk speeds up; the size grows again:
+    for (int i = 0; i < 10; ++i)
+        tuner.inserted(tuner.batchSize(), 0.01, 0.005, 0);
+    CHECK(tuner.batchSize() == tuning::kMaxInsertionBatchSize);
+}
+
+
+TEST_CASE("InsertionTuner back-pressure", "[Push]") {
+    InsertionTuner tuner;
+    tuner.inserted(50, 0.04, 0.03, 10);
+    CHECK(ms(tuner.delay()) == Approx(30.0));
+    // A big batch alone doesn't mean there's a backlog:
+    tuner.inserted(tuning::kMaxPendingRevs, 0.08, 0.03, 0);
+    CHECK(ms(tuner.delay()) == Approx(30.0));
+    // But a backlog of queued revs means the Puller is about to stall, so stop waiting:
+    tuner.inserted(50, 0.04, 0.03, tuning::kMaxPendingRevs / 2);
+    CHECK(tuner.delay() == InsertionTuner::delay_t(tuning::kMinInsertionDelay));
+}
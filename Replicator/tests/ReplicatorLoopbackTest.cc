@@ -509,6 +509,75 @@ TEST_CASE_METHOD(ReplicatorLoopbackTest, "Different Checkpoint IDs", "[Push]") {
 }
 
 
+TEST_CASE_METHOD(ReplicatorLoopbackTest, "Push Interrupted With Doc In Flight", "[Push]") {
+    // A newer rev of a doc that's being pushed is held back until the push of the older one
+    // finishes. If the push is interrupted in between, the checkpoint mustn't claim the newer
+    // rev was pushed, or a restarted replicator would skip it. The server's validator blocks
+    // to keep the first rev in flight.
+    struct Gate {
+        mutex m;
+        condition_variable cond;
+        bool entered {false}, open {false};
+    } gate;
+    auto serverOpts = Replicator::Options::passive();
+    serverOpts.callbackContext = &gate;
+    serverOpts.pullValidator = [](FLString docID, FLString revID, C4RevisionFlags flags,
+                                  FLDict body, void *context) -> bool {
+        auto &gate = *(Gate*)context;
+        unique_lock<mutex> lock(gate.m);
+        gate.entered = true;
+        gate.cond.notify_all();
+        gate.cond.wait(lock, [&]{return gate.open;});
+        return true;
+    };
+
+    auto clientOptions = [](C4ReplicatorMode mode) {
+        fleece::Encoder enc;
+        enc.beginDict();
+        enc.writeKey(C4STR(kC4ReplicatorCheckpointRanges));
+        enc.writeBool(true);
+        enc.writeKey(C4STR(kC4ReplicatorCheckpointInterval));
+        enc.writeInt(1);
+        enc.endDict();
+        return Replicator::Options(mode, kC4Disabled, enc.finish());
+    };
+
+    createFleeceRev(db, "doc"_sl, kRevID, "{\"agent\":7}"_sl);
+    string latestRevID;
+    _parallelThread.reset(runInParallel([&]() {
+        // Note: Can't use Catch (CHECK, REQUIRE) on a background thread
+        {
+            unique_lock<mutex> lock(gate.m);
+            gate.cond.wait(lock, [&]{return gate.entered;});
+        }
+        latestRevID = createNewRev(db, "doc"_sl, kFleeceBody);
+        sleepFor(chrono::milliseconds(2500));   // let the checkpoint be saved
+        {
+            lock_guard<mutex> lock(_mutex);
+            _replClient->stop();
+        }
+        lock_guard<mutex> lock(gate.m);
+        gate.open = true;
+        gate.cond.notify_all();
+    }));
+
+    _expectedDocumentCount = -1;
+    _checkDocsFinished = false;
+    _checkProgressComplete = false;
+    runReplicators(clientOptions(kC4Continuous), serverOpts);
+    _parallelThread->join();
+    _parallelThread.reset();
+
+    // Resume; the newer revision must still be pushed:
+    _checkProgressComplete = true;
+    runReplicators(clientOptions(kC4OneShot), serverOpts);
+    C4Error error;
+    c4::ref<C4Document> doc = c4doc_get(db2, "doc"_sl, true, &error);
+    REQUIRE(doc);
+    CHECK(slice(doc->revID) == slice(latestRevID));
+}
+
+
 TEST_CASE_METHOD(ReplicatorLoopbackTest, "Push Overflowed Rev Tree", "[Push]") {
     // For #436
     createRev("doc"_sl, kRevID, kFleeceBody);
@@ -772,6 +841,31 @@ TEST_CASE_METHOD(ReplicatorLoopbackTest, "Pull Lots Of Attachments", "[Pull][blo
 }
 
 
+TEST_CASE_METHOD(ReplicatorLoopbackTest, "Pull Shared Attachments", "[Pull][blob]") {
+    // Many docs share the same attachments, and each has more than the per-rev download limit,
+    // so blobs are downloaded concurrently and identical ones are requested by several revs:
+    static const int kNumDocs = 50, kNumBlobsPerDoc = 3 * tuning::kMaxBlobsInFlightPerRev;
+    vector<string> attachments;
+    for (int iAtt = 0; iAtt < kNumBlobsPerDoc; iAtt++)
+        attachments.push_back(format("shared attachment #%d ", iAtt) + string(iAtt * 1000, '*'));
+    vector<C4BlobKey> blobKeys;
+    {
+        TransactionHelper t(db);
+        char docid[100];
+        for (int iDoc = 0; iDoc < kNumDocs; ++iDoc) {
+            sprintf(docid, "doc%03d", iDoc);
+            blobKeys = addDocWithAttachments(c4str(docid), attachments, "text/plain");
+            ++_expectedDocumentCount;
+        }
+    }
+    runPullReplication();
+    compareDatabases();
+    validateCheckpoints(db2, db, format("{\"remote\":%d}", kNumDocs).c_str());
+
+    checkAttachments(db2, blobKeys, attachments);
+}
+
+
 TEST_CASE_METHOD(ReplicatorLoopbackTest, "Push Uncompressible Blob", "[Push][blob]") {
     // Test case for issue #354
     alloc_slice image = readFile(sFixturesDir + "for#354.jpg");
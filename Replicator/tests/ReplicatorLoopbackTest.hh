@@ -71,10 +71,10 @@ public:
 
         // Create client (active) and server (passive) replicators:
         _replClient = new Replicator(dbClient,
-                                     new LoopbackWebSocket(alloc_slice("ws://srv/"_sl), Role::Client, kLatency),
+                                     new LoopbackWebSocket(alloc_slice("ws://srv/"_sl), Role::Client, _latency),
                                      *this, opts1);
         _replServer = new Replicator(dbServer,
-                                     new LoopbackWebSocket(alloc_slice("ws://cli/"_sl), Role::Server, kLatency),
+                                     new LoopbackWebSocket(alloc_slice("ws://cli/"_sl), Role::Server, _latency),
                                      *this, opts2);
 
         // Response headers:
@@ -105,7 +105,8 @@ public:
         CHECK(_gotResponse);
         CHECK(_statusChangedCalls > 0);
         CHECK(_statusReceived.level == kC4Stopped);
-        CHECK(_statusReceived.progress.unitsCompleted == _statusReceived.progress.unitsTotal);
+        if (_checkProgressComplete)
+            CHECK(_statusReceived.progress.unitsCompleted == _statusReceived.progress.unitsTotal);
         if(_expectedUnitsComplete >= 0)
             CHECK(_expectedUnitsComplete == _statusReceived.progress.unitsCompleted);
         if (_expectedDocumentCount >= 0)
@@ -504,6 +505,7 @@ public:
     }
 
     C4Database* db2 {nullptr};
+    duration _latency {kLatency};           // Simulated network latency of the loopback
     Retained<Replicator> _replClient, _replServer;
     alloc_slice _checkpointID;
     unique_ptr<thread> _parallelThread;
@@ -520,6 +522,7 @@ public:
     set<string> _docPushErrors, _docPullErrors;
     set<string> _expectedDocPushErrors, _expectedDocPullErrors;
     bool _checkDocsFinished {true};
+    bool _checkProgressComplete {true};
     multiset<string> _docsFinished, _expectedDocsFinished;
     unsigned _blobPushProgressCallbacks {0}, _blobPullProgressCallbacks {0};
     Replicator::BlobProgress _lastBlobPushProgress {}, _lastBlobPullProgress {};
@@ -0,0 +1,387 @@
+//
+// ReplicatorPerfTest.cc
+//
+// Copyright © 2019 Couchbase. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "ReplicatorLoopbackTest.hh"
+#include "c4Observer.h"
+#include "Benchmark.hh"
+#include <atomic>
+#include <fstream>
+#include <unordered_map>
+#ifndef _MSC_VER
+#include <sys/resource.h>
+#endif
+
+
+/** Benchmarks of the replicator over the loopback WebSocket. Each benchmark generates a
+    dataset in `db`, then replicates it (to `db2`, or from it), a few times over, and prints
+    the throughput, the percentiles of the time each document took to arrive, and the peak
+    memory used while replicating. Use these to evaluate changes to ReplicatorTuning.hh. */
+class ReplicatorPerfTest : public ReplicatorLoopbackTest {
+public:
+    /** Parameters of a generated dataset. */
+    struct Dataset {
+        unsigned docCount    {1000};
+        size_t   bodySize    {1000};     // Approximate size of each revision's JSON body
+        unsigned blobsPerDoc {0};
+        size_t   blobSize    {0};
+        unsigned revDepth    {1};        // Number of revisions of each doc
+    };
+
+    static constexpr unsigned kRuns = 3;
+
+    ReplicatorPerfTest() {
+        _latency = chrono::milliseconds(5);
+        _expectedDocumentCount = -1;
+        _checkDocsFinished = false;
+    }
+
+
+    // Creates the docs of a dataset in `database`, with IDs starting with `prefix`, and returns
+    // the total size of their latest revisions' bodies and blobs. `variant` changes the contents.
+    uint64_t createDataset(C4Database *database, const Dataset &d, const char *prefix,
+                           int variant =0)
+    {
+        C4BlobStore *blobStore = c4db_getBlobStore(database, nullptr);
+        REQUIRE(blobStore);
+        uint64_t totalBytes = 0;
+        TransactionHelper t(database);
+        for (unsigned iDoc = 0; iDoc < d.docCount; ++iDoc) {
+            string docID = format("%s%06u", prefix, iDoc);
+
+            string blobs;
+            for (unsigned iBlob = 0; iBlob < d.blobsPerDoc; ++iBlob) {
+                string content = format("%s #%u/%u/%d ", docID.c_str(), iBlob, d.blobsPerDoc, variant);
+                content.resize(max(d.blobSize, content.size()), char('a' + iBlob % 26));
+                C4BlobKey key;
+                C4Error error;
+                REQUIRE(c4blob_create(blobStore, slice(content), nullptr, &key, &error));
+                alloc_slice digest = c4blob_keyToString(key);
+                blobs += format("%s{\"@type\":\"blob\",\"digest\":\"%.*s\",\"length\":%zu}",
+                                (iBlob ? "," : ""), SPLAT(digest), content.size());
+                totalBytes += content.size();
+            }
+
+            for (unsigned rev = 1; rev <= d.revDepth; ++rev) {
+                string json = format("{\"doc\":%u,\"rev\":%u,\"variant\":%d,\"blobs\":[%s],\"text\":\"",
+                                     iDoc, rev, variant, blobs.c_str());
+                json.resize(max(d.bodySize, json.size() + 2), char('A' + (iDoc + rev) % 26));
+                json += "\"}";
+                createFleeceRev(database, slice(docID), nullslice, slice(json));
+                if (rev == d.revDepth)
+                    totalBytes += json.size();
+            }
+        }
+        return totalBytes;
+    }
+
+
+    // Creates a new doc from JSON. Unlike createFleeceRev it doesn't use Catch or Assert, so it
+    // can be called on a background thread; the caller checks the result on the main thread.
+    static bool tryCreateDoc(C4Database *database, slice docID, slice json) {
+        c4::Transaction t(database);
+        C4Error error;
+        if (!t.begin(&error))
+            return false;
+        alloc_slice body(c4db_encodeJSON(database, json, &error));
+        if (!body)
+            return false;
+        C4Document *doc = c4doc_create(database, docID, body, 0, &error);
+        if (!doc)
+            return false;
+        c4doc_free(doc);
+        return t.commit(&error);
+    }
+
+
+    // Records when each document arrives in `database`, relative to `_stopwatch`.
+    C4DatabaseObserver* observeArrivals(C4Database *database) {
+        return c4dbobs_create(database, [](C4DatabaseObserver *obs, void *ctx) {
+            ((ReplicatorPerfTest*)ctx)->docsArrived(obs);
+        }, this);
+    }
+
+    void docsArrived(C4DatabaseObserver *obs) {
+        // Note: Can't use Catch (CHECK, REQUIRE) on a background thread
+        double now = _stopwatch.elapsed();
+        C4DatabaseChange changes[100];
+        uint32_t n;
+        bool external;
+        while ((n = c4dbobs_getChanges(obs, changes, 100, &external)) > 0) {
+            {
+                lock_guard<mutex> lock(_arrivalMutex);
+                for (uint32_t i = 0; i < n; ++i) {
+                    string docID = slice(changes[i].docID).asString();
+                    if (_arrivals.find(docID) == _arrivals.end())
+                        _arrivals[docID] = now;
+                }
+            }
+            c4dbobs_releaseChanges(changes, n);
+        }
+    }
+
+
+    // Runs `replicate` kRuns times. Before each run both databases are reset, then `populate`
+    // is called to create the dataset (untimed); it returns the number of revs & bytes that the
+    // replication will transfer. Arrivals are timed in `db` and/or `db2` per `intoDB1`/`intoDB2`.
+    void benchmark(const char *name,
+                   function<pair<unsigned,uint64_t>()> populate,
+                   function<void()> replicate,
+                   bool intoDB1 =false, bool intoDB2 =true)
+    {
+        Benchmark bench;
+        vector<double> latencies;
+        unsigned revs = 0;
+        uint64_t bytes = 0;
+        long peakMemory = 0, memoryGrowth = 0;
+        for (unsigned run = 0; run < kRuns; ++run) {
+            deleteAndRecreateDB(db);
+            deleteAndRecreateDB(db2);
+            tie(revs, bytes) = populate();
+            _docPushErrors.clear();
+            _docPullErrors.clear();
+            _docsFinished.clear();
+            _arrivals.clear();
+
+            c4::ref<C4DatabaseObserver> obs1, obs2;
+            if (intoDB1)
+                obs1 = observeArrivals(db);
+            if (intoDB2)
+                obs2 = observeArrivals(db2);
+            resetPeakMemory();
+            long startMemory = peakMemoryKB();
+            _stopwatch.reset();
+            bench.start();
+            replicate();
+            bench.stop();
+            obs1 = obs2 = nullptr;
+            long endMemory = peakMemoryKB();
+            peakMemory = max(peakMemory, endMemory);
+            memoryGrowth = max(memoryGrowth, endMemory - startMemory);
+
+            lock_guard<mutex> lock(_arrivalMutex);
+            for (auto &arrival : _arrivals) {
+                auto created = _createdAt.find(arrival.first);
+                double start = (created != _createdAt.end()) ? created->second : 0.0;
+                latencies.push_back(arrival.second - start);
+            }
+        }
+        report(name, bench, latencies, revs, bytes, peakMemory, memoryGrowth);
+    }
+
+
+    static double percentile(const vector<double> &sorted, double p) {
+        if (sorted.empty())
+            return 0.0;
+        return sorted[min(size_t(p * sorted.size()), sorted.size() - 1)];
+    }
+
+    // Resets the process's peak RSS to its current RSS, where the OS allows it (Linux).
+    // Elsewhere the peak can't be reset, so a run only shows growth if it exceeds every
+    // earlier peak, including the dataset generation.
+    static void resetPeakMemory() {
+#ifdef __linux__
+        ofstream("/proc/self/clear_refs") << "5";
+#endif
+    }
+
+    static long peakMemoryKB() {
+#ifdef __linux__
+        // Unlike getrusage's ru_maxrss, VmHWM honors resetPeakMemory():
+        ifstream status("/proc/self/status");
+        string line;
+        while (getline(status, line)) {
+            if (line.compare(0, 6, "VmHWM:") == 0)
+                return atol(line.c_str() + 6);
+        }
+#endif
+#ifndef _MSC_VER
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) == 0)
+    #ifdef __APPLE__
+            return usage.ru_maxrss / 1024;      // macOS reports bytes, Linux KB
+    #else
+            return usage.ru_maxrss;
+    #endif
+#endif
+        return -1;
+    }
+
+    void report(const char *name, Benchmark &bench, vector<double> &latencies,
+                unsigned revs, uint64_t bytes, long peakMemory, long memoryGrowth)
+    {
+        fprintf(stderr, "\n==== %s: %u revs, %.1f KB, %ums latency ====\n",
+                name, revs, bytes / 1024.0, unsigned(chrono::duration_cast<chrono::milliseconds>(_latency).count()));
+        bench.printReport(1.0 / revs, "rev");
+        double time = bench.median();
+        fprintf(stderr, "Throughput: %.0f revs/sec, %.1f KB/sec\n",
+                revs / time, bytes / time / 1024.0);
+        sort(latencies.begin(), latencies.end());
+        fprintf(stderr, "Arrival time: p50 %.1fms, p90 %.1fms, p99 %.1fms, max %.1fms (%zu docs)\n",
+                percentile(latencies, 0.5) * 1000, percentile(latencies, 0.9) * 1000,
+                percentile(latencies, 0.99) * 1000, percentile(latencies, 1.0) * 1000,
+                latencies.size());
+        fprintf(stderr, "Peak memory: %ld KB, growing by up to %ld KB while replicating\n",
+                peakMemory, memoryGrowth);
+    }
+
+
+    Stopwatch _stopwatch;
+    mutex _arrivalMutex;
+    unordered_map<string, double> _arrivals;     // docID -> arrival time
+    unordered_map<string, double> _createdAt;    // docID -> creation time (continuous mode)
+};
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Push", "[Perf][Push][.slow]") {
+    Dataset d;
+    benchmark("Push", [&]() {
+        return make_pair(d.docCount, createDataset(db, d, "doc"));
+    }, [&]() {
+        runPushReplication();
+    });
+}
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Pull", "[Perf][Pull][.slow]") {
+    Dataset d;
+    benchmark("Pull", [&]() {
+        return make_pair(d.docCount, createDataset(db, d, "doc"));
+    }, [&]() {
+        runPullReplication();
+    });
+}
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Push-Pull", "[Perf][Push][Pull][.slow]") {
+    Dataset d;
+    benchmark("Push-Pull", [&]() {
+        uint64_t bytes = createDataset(db, d, "db1-") + createDataset(db2, d, "db2-");
+        return make_pair(2 * d.docCount, bytes);
+    }, [&]() {
+        runPushPullReplication();
+    }, true, true);
+}
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Push Large Docs", "[Perf][Push][.slow]") {
+    Dataset d;
+    d.docCount = 200;
+    d.bodySize = 50000;
+    benchmark("Push large docs", [&]() {
+        return make_pair(d.docCount, createDataset(db, d, "doc"));
+    }, [&]() {
+        runPushReplication();
+    });
+}
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Push Deep Trees", "[Perf][Push][.slow]") {
+    Dataset d;
+    d.revDepth = 50;
+    d.bodySize = 200;
+    benchmark("Push deep rev trees", [&]() {
+        return make_pair(d.docCount, createDataset(db, d, "doc"));
+    }, [&]() {
+        runPushReplication();
+    });
+}
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Push Deltas", "[Perf][Push][Delta][.slow]") {
+    Dataset d;
+    d.bodySize = 5000;
+    benchmark("Push deltas", [&]() {
+        // Push the docs to db2, then update each one in db:
+        createDataset(db, d, "doc");
+        runPushReplication();
+        Dataset update = d;
+        update.revDepth = 1;
+        uint64_t bytes = createDataset(db, update, "doc", 1);
+        return make_pair(d.docCount, bytes);
+    }, [&]() {
+        runPushReplication();
+    });
+}
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Pull Attachments", "[Perf][Pull][blob][.slow]") {
+    Dataset d;
+    d.docCount = 200;
+    d.bodySize = 200;
+    d.blobsPerDoc = 5;
+    d.blobSize = 20000;
+    benchmark("Pull attachments", [&]() {
+        return make_pair(d.docCount, createDataset(db, d, "doc"));
+    }, [&]() {
+        runPullReplication();
+    });
+}
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Pull Conflicts", "[Perf][Pull][Conflict][.slow]") {
+    Dataset d;
+    benchmark("Pull conflicts", [&]() {
+        // Push the docs to db2, then update each one differently in both dbs:
+        createDataset(db, d, "doc");
+        runPushReplication();
+        createDataset(db, d, "doc", 1);
+        uint64_t bytes = createDataset(db2, d, "doc", 2);
+        _expectedDocPullErrors.clear();
+        for (unsigned i = 0; i < d.docCount; ++i)
+            _expectedDocPullErrors.insert(format("doc%06u", i));
+        return make_pair(d.docCount, bytes);
+    }, [&]() {
+        runReplicators(Replicator::Options::pulling(), Replicator::Options::passive());
+    }, true, false);
+}
+
+
+TEST_CASE_METHOD(ReplicatorPerfTest, "Perf Continuous Push Latency", "[Perf][Push][.slow]") {
+    // Creates docs one at a time while a continuous push is running, and measures how long
+    // each takes to arrive in db2:
+    static const unsigned kNumDocs = 500;
+    Dataset d;
+    atomic<unsigned> failedDocs {0};
+    benchmark("Continuous push latency", [&]() {
+        _createdAt.clear();
+        return make_pair(kNumDocs, uint64_t(kNumDocs * d.bodySize));
+    }, [&]() {
+        _stopOnIdle = false;
+        _parallelThread.reset(runInParallel([&]() {
+            for (unsigned i = 0; i < kNumDocs; ++i) {
+                sleepFor(chrono::milliseconds(10));
+                string docID = format("live%04u", i);
+                string json = format("{\"doc\":%u,\"text\":\"", i);
+                json.resize(d.bodySize, 'x');
+                json += "\"}";
+                {
+                    lock_guard<mutex> lock(_arrivalMutex);
+                    _createdAt[docID] = _stopwatch.elapsed();
+                }
+                if (!tryCreateDoc(db, slice(docID), slice(json)))
+                    ++failedDocs;
+            }
+            sleepFor(chrono::seconds(1));
+            stopWhenIdle();
+        }));
+        runPushReplication(kC4Continuous);
+        _parallelThread->join();
+        _parallelThread.reset();
+        CHECK(failedDocs == 0);
+    });
+}
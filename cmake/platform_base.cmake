@@ -28,6 +28,7 @@ function(set_litecore_source_base)
         LiteCore/Database/BackgroundDB.cc
         LiteCore/Database/Database.cc
         LiteCore/Database/Document.cc
+        LiteCore/Database/Housekeeper.cc
         LiteCore/Database/LeafDocument.cc
         LiteCore/Database/LegacyAttachments.cc
         LiteCore/Database/LiveQuerier.cc
@@ -51,12 +52,14 @@ function(set_litecore_source_base)
         LiteCore/Query/SQLiteN1QLFunctions.cc
         LiteCore/Query/SQLitePredictionFunction.cc
         LiteCore/Query/SQLiteQuery.cc
+        LiteCore/Query/SQLiteQueryCache.cc
         LiteCore/Query/N1QL_Parser/n1ql.cc
         LiteCore/RevTrees/RawRevTree.cc
         LiteCore/RevTrees/RevID.cc
         LiteCore/RevTrees/RevTree.cc
         LiteCore/RevTrees/VersionedDocument.cc
         LiteCore/Storage/DataFile.cc
+        LiteCore/Storage/DataFileStats.cc
         LiteCore/Storage/KeyStore.cc
         LiteCore/Storage/Record.cc
         LiteCore/Storage/RecordEnumerator.cc
@@ -75,6 +78,7 @@ function(set_litecore_source_base)
         Replicator/c4Replicator.cc
         Replicator/c4Socket.cc
         Replicator/Checkpoint.cc
+        Replicator/ChangesFeed.cc
         Replicator/CivetWebSocket.cc
         Replicator/CookieStore.cc
         Replicator/DatabaseCookies.cc
@@ -107,6 +111,8 @@ function(set_support_source_base)
     set(
         ${BASE_SSS_RESULT}
         LiteCore/Support/c4ExceptionUtils.cc
+        LiteCore/Support/Compression.cc
+        LiteCore/Support/CompressedStream.cc
         LiteCore/Support/EncryptedStream.cc
         LiteCore/Support/Error.cc
         LiteCore/Support/FilePath.cc
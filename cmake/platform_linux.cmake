@@ -40,6 +40,7 @@ function(set_support_source_linux)
         LiteCore/Unix/strlcat.c
         LiteCore/Unix/arc4random.cc
         LiteCore/Support/StringUtil_icu.cc
+        LiteCore/Support/Instrumentation.cc
         PARENT_SCOPE
     )
 endfunction()
@@ -74,6 +75,13 @@ function(setup_support_build_linux)
         )
     endif()
 
+    if(LITECORE_USDT)
+        target_compile_definitions(
+            Support PRIVATE
+            -DLITECORE_USDT=1
+        )
+    endif()
+
     target_include_directories(
         Support PRIVATE
         LiteCore/Unix